@@ -22,11 +22,76 @@
 
 #include "cursor.h"
 #include "surface.h"
+#include "surface_pool.h"
 
 #include <guacamole/client.h>
+#include <guacamole/recording.h>
 #include <guacamole/socket.h>
+#include <guacamole/timestamp.h>
+#include <guacamole/user.h>
 
 #include <pthread.h>
+#include <stddef.h>
+
+/**
+ * The processing lag, in milliseconds, beyond which a user other than the
+ * owner stops receiving live updates. Updates for that user are instead
+ * coalesced until the user has caught up, such that a single slow user does
+ * not slow updates for all other users.
+ */
+#define GUAC_COMMON_DISPLAY_PAUSE_LAG 500
+
+/**
+ * The processing lag, in milliseconds, at or below which a user that
+ * previously stopped receiving live updates is sent all surfaces modified in
+ * the meantime and again receives live updates.
+ */
+#define GUAC_COMMON_DISPLAY_RESUME_LAG 100
+
+/**
+ * The percentage of its rate limits (see guac_socket_get_rate_fill()) that
+ * must be available before a user that stopped receiving live updates due to
+ * exhausting those limits is sent all surfaces modified in the meantime and
+ * again receives live updates.
+ */
+#define GUAC_COMMON_DISPLAY_RESUME_FILL 50
+
+/**
+ * A list element describing a user which is not currently receiving live
+ * updates from a guac_common_display due to processing lag.
+ */
+typedef struct guac_common_display_paused_user
+    guac_common_display_paused_user;
+
+struct guac_common_display_paused_user {
+
+    /**
+     * The user which is not receiving live updates. This pointer is only
+     * compared and is never dereferenced, as the user may since have left.
+     */
+    guac_user* user;
+
+    /**
+     * The time of the display flush after which the user stopped receiving
+     * live updates. All surfaces modified at or after this time must be sent
+     * to the user before the user again receives live updates.
+     */
+    guac_timestamp since;
+
+    /**
+     * Whether the user was found to still be connected during the current
+     * display flush. Entries for users which are no longer connected are
+     * freed at the end of each flush.
+     */
+    int present;
+
+    /**
+     * The next paused user within the list, or NULL if this is the last
+     * paused user.
+     */
+    guac_common_display_paused_user* next;
+
+};
 
 /**
  * A list element representing a pairing of a Guacamole layer with a
@@ -89,7 +154,9 @@ typedef struct guac_common_display {
      * The first element within a linked list of all currently-allocated
      * layers, or NULL if no layers are currently allocated. The default layer,
      * layer #0, is stored within default_surface and will not have a
-     * corresponding element within this list.
+     * corresponding element within this list. Layers whose updates were left
+     * pending by the most recent flush are moved to the start of this list,
+     * such that they are flushed first.
      */
     guac_common_display_layer* layers;
 
@@ -106,6 +173,52 @@ typedef struct guac_common_display {
      */
     int lossless;
 
+    /**
+     * The number of milliseconds that areas of each layer/buffer sent using
+     * lossy compression must remain unchanged before they are resent
+     * losslessly, or zero if lossy areas should never be resent. By default,
+     * this is GUAC_COMMON_SURFACE_REFRESH_INTERVAL.
+     */
+    int refresh_interval;
+
+    /**
+     * The pool from which the pixels and heat maps of all surfaces of this
+     * display are allocated, and which accounts for the memory they use.
+     */
+    guac_common_surface_pool* pool;
+
+    /**
+     * The number of bytes of surface memory beyond which the least-recently
+     * used evictable buffers of this display are evicted, or zero if buffers
+     * are never evicted.
+     */
+    size_t memory_limit;
+
+    /**
+     * The socket to which all surfaces of this display send their updates.
+     * This socket broadcasts to all connected users which are receiving live
+     * updates, excluding users which have fallen too far behind.
+     */
+    guac_socket* socket;
+
+    /**
+     * All users which are not currently receiving live updates due to
+     * processing lag, or NULL if all users are receiving live updates.
+     */
+    guac_common_display_paused_user* paused_users;
+
+    /**
+     * The time that the most recent flush which sent pending changes to
+     * users began.
+     */
+    guac_timestamp last_flush;
+
+    /**
+     * Non-zero if updates to the default surface were left pending by the
+     * most recent flush because the frame budget had been exhausted.
+     */
+    int default_deferred;
+
     /**
      * Mutex which is locked internally when access to the display must be
      * synchronized. All public functions of guac_common_display should be
@@ -163,7 +276,22 @@ void guac_common_display_dup(
 
 /**
  * Flushes pending changes to the given display. All pending operations will
- * become visible to any connected users.
+ * become visible to any connected users which are receiving live updates,
+ * except that no more data is sent than the connections of those users can
+ * deliver in the time since the previous flush (see
+ * guac_client_get_frame_budget()). Changes beyond that budget are left
+ * pending and sent by later flushes, starting with the layers which were
+ * left behind.
+ * Users other than the owner whose processing lag exceeds
+ * GUAC_COMMON_DISPLAY_PAUSE_LAG stop receiving live updates, and are sent
+ * only the areas of surfaces modified in the meantime (see
+ * guac_common_surface_resync()) once their processing lag has
+ * fallen to GUAC_COMMON_DISPLAY_RESUME_LAG, at which point they again receive
+ * live updates. Any user, including the owner, which has exhausted its rate
+ * limits (see guac_socket_get_rate_fill()) is paused in the same way until at
+ * least GUAC_COMMON_DISPLAY_RESUME_FILL percent of those limits is again
+ * available. Paused users are not considered when pacing updates by
+ * guac_client_get_processing_lag().
  *
  * @param display
  *     The display to flush.
@@ -258,5 +386,72 @@ void guac_common_display_free_buffer(guac_common_display* display,
 void guac_common_display_set_lossless(guac_common_display* display,
         int lossless);
 
+/**
+ * Sets the number of milliseconds that areas of all current and future
+ * layers/buffers of the given display sent using lossy compression must
+ * remain unchanged before they are resent losslessly. By default,
+ * newly-created displays use GUAC_COMMON_SURFACE_REFRESH_INTERVAL.
+ *
+ * Note that this can also be adjusted on a per-layer / per-buffer basis with
+ * guac_common_surface_set_refresh_interval().
+ *
+ * @param display
+ *     The display to modify.
+ *
+ * @param interval
+ *     The number of milliseconds that lossy areas must remain unchanged
+ *     before being refreshed, or zero to disable lossless refresh.
+ */
+void guac_common_display_set_refresh_interval(guac_common_display* display,
+        int interval);
+
+/**
+ * Associates the given session recording with the given display, such that
+ * all graphical updates sent for the display are written to the recording,
+ * including updates which are not sent to any user because all users are
+ * lagging. This has no effect if the recording does not include output.
+ *
+ * @param display
+ *     The display to associate with the recording.
+ *
+ * @param recording
+ *     The recording which should receive all graphical updates of the given
+ *     display. The socket of a recording which includes output is freed only
+ *     along with the client socket, and thus remains valid for the lifetime
+ *     of the display even if the recording itself is freed first.
+ */
+void guac_common_display_set_recording(guac_common_display* display,
+        guac_recording* recording);
+
+/**
+ * Sets the amount of surface memory that the given display may use before
+ * the pixels of its least-recently used buffers are evicted. Only buffers
+ * having a restore handler (see guac_common_surface_set_restore_handler())
+ * are evicted. The limit is enforced whenever a new layer or buffer is
+ * allocated, evicting buffers until usage falls to three quarters of the
+ * limit. By default, newly-created displays have no limit.
+ *
+ * @param display
+ *     The display to modify.
+ *
+ * @param limit
+ *     The number of bytes of surface memory at which eviction begins, or
+ *     zero to never evict buffers.
+ */
+void guac_common_display_set_memory_limit(guac_common_display* display,
+        size_t limit);
+
+/**
+ * Returns the number of bytes of memory currently used by the pixels and heat
+ * maps of all surfaces of the given display, including the default surface.
+ *
+ * @param display
+ *     The display to query.
+ *
+ * @return
+ *     The number of bytes of surface memory currently in use.
+ */
+size_t guac_common_display_get_memory_usage(guac_common_display* display);
+
 #endif
 
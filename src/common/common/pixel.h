@@ -0,0 +1,218 @@
+/*
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ * KIND, either express or implied.  See the License for the
+ * specific language governing permissions and limitations
+ * under the License.
+ */
+
+#ifndef __GUAC_COMMON_PIXEL_H
+#define __GUAC_COMMON_PIXEL_H
+
+#include "config.h"
+
+#include <guacamole/protocol-types.h>
+
+#include <stdint.h>
+
+/**
+ * The implementations of pixel operations which may be selected with
+ * guac_common_pixel_set_implementation(). By default, the fastest
+ * implementation supported by the current CPU is used.
+ */
+typedef enum guac_common_pixel_implementation {
+
+    /**
+     * Portable, one-pixel-at-a-time implementations. These serve as the
+     * reference implementations against which all others are tested.
+     */
+    GUAC_COMMON_PIXEL_SCALAR,
+
+    /**
+     * Implementations using SSE2 instructions, processing four pixels at a
+     * time.
+     */
+    GUAC_COMMON_PIXEL_SSE2,
+
+    /**
+     * Implementations using AVX2 instructions, processing eight pixels at a
+     * time.
+     */
+    GUAC_COMMON_PIXEL_AVX2
+
+} guac_common_pixel_implementation;
+
+/**
+ * Selects the implementation used by all guac_common_pixel_*() row
+ * operations, if supported by the current CPU and build.
+ *
+ * @param implementation
+ *     The implementation to use.
+ *
+ * @return
+ *     Zero if the implementation was selected, non-zero if the implementation
+ *     is not supported and the previous selection remains in effect.
+ */
+int guac_common_pixel_set_implementation(
+        guac_common_pixel_implementation implementation);
+
+/**
+ * Applies the Porter-Duff "over" composite operator, blending each component
+ * of the two given premultiplied ARGB colors.
+ *
+ * @param dst
+ *     The destination ARGB color.
+ *
+ * @param src
+ *     The source ARGB color.
+ *
+ * @return
+ *     The result of applying the Porter-Duff "over" composite operator to the
+ *     given source and destination colors.
+ */
+uint32_t guac_common_pixel_argb_blend(uint32_t dst, uint32_t src);
+
+/**
+ * Applies the given transfer function to the given source and destination
+ * ARGB colors, returning the resulting color.
+ *
+ * @param op
+ *     The transfer function to apply.
+ *
+ * @param src
+ *     The source ARGB color.
+ *
+ * @param dst
+ *     The destination ARGB color.
+ *
+ * @return
+ *     The result of applying the transfer function.
+ */
+uint32_t guac_common_pixel_transfer(guac_transfer_function op, uint32_t src,
+        uint32_t dst);
+
+/**
+ * Returns whether all pixels within the given row are fully opaque.
+ *
+ * @param row
+ *     The row of ARGB pixels to check.
+ *
+ * @param width
+ *     The number of pixels within the row.
+ *
+ * @return
+ *     Non-zero if all pixels within the row are fully opaque, zero otherwise.
+ */
+int guac_common_pixel_is_opaque(const uint32_t* row, int width);
+
+/**
+ * Draws the given row of source pixels over the given row of destination
+ * pixels, recording the range of destination pixels which changed. If the
+ * source is opaque, source pixels simply replace destination pixels.
+ * Otherwise, the source is blended over the destination as with
+ * guac_common_pixel_argb_blend().
+ *
+ * @param dst
+ *     The row of ARGB pixels to draw upon.
+ *
+ * @param src
+ *     The row of ARGB pixels to draw.
+ *
+ * @param width
+ *     The number of pixels within each row.
+ *
+ * @param opaque
+ *     Non-zero if the alpha channel of the source should be ignored and the
+ *     source treated as fully opaque, zero otherwise.
+ *
+ * @param first
+ *     Pointer to an int which will receive the index of the first (leftmost)
+ *     destination pixel which changed, if any pixels changed.
+ *
+ * @param last
+ *     Pointer to an int which will receive the index of the last (rightmost)
+ *     destination pixel which changed, if any pixels changed.
+ *
+ * @return
+ *     Non-zero if any destination pixels changed, zero otherwise.
+ */
+int guac_common_pixel_put_row(uint32_t* dst, const uint32_t* src, int width,
+        int opaque, int* first, int* last);
+
+/**
+ * Assigns the given color to all pixels within the given row, recording the
+ * range of pixels which changed.
+ *
+ * @param dst
+ *     The row of ARGB pixels to modify.
+ *
+ * @param color
+ *     The ARGB color to assign.
+ *
+ * @param width
+ *     The number of pixels within the row.
+ *
+ * @param first
+ *     Pointer to an int which will receive the index of the first (leftmost)
+ *     pixel which changed, if any pixels changed.
+ *
+ * @param last
+ *     Pointer to an int which will receive the index of the last (rightmost)
+ *     pixel which changed, if any pixels changed.
+ *
+ * @return
+ *     Non-zero if any pixels changed, zero otherwise.
+ */
+int guac_common_pixel_fill_row(uint32_t* dst, uint32_t color, int width,
+        int* first, int* last);
+
+/**
+ * Applies the given transfer function to each pair of corresponding pixels
+ * within the given source and destination rows, storing the result within the
+ * destination row and recording the range of pixels which changed. The rows
+ * may overlap, in which case the direction of processing must be chosen such
+ * that source pixels are read before they are overwritten.
+ *
+ * @param op
+ *     The transfer function to apply.
+ *
+ * @param dst
+ *     The row of ARGB pixels to modify.
+ *
+ * @param src
+ *     The row of ARGB source pixels.
+ *
+ * @param width
+ *     The number of pixels within each row.
+ *
+ * @param backwards
+ *     Non-zero if pixels should be processed from right to left, zero if
+ *     pixels should be processed from left to right.
+ *
+ * @param first
+ *     Pointer to an int which will receive the index of the first (leftmost)
+ *     pixel which changed, if any pixels changed.
+ *
+ * @param last
+ *     Pointer to an int which will receive the index of the last (rightmost)
+ *     pixel which changed, if any pixels changed.
+ *
+ * @return
+ *     Non-zero if any destination pixels changed, zero otherwise.
+ */
+int guac_common_pixel_transfer_row(guac_transfer_function op, uint32_t* dst,
+        const uint32_t* src, int width, int backwards, int* first, int* last);
+
+#endif
+
@@ -0,0 +1,219 @@
+/*
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ * KIND, either express or implied.  See the License for the
+ * specific language governing permissions and limitations
+ * under the License.
+ */
+
+#ifndef __GUAC_COMMON_REGION_H
+#define __GUAC_COMMON_REGION_H
+
+#include "config.h"
+#include "rect.h"
+
+/**
+ * A horizontal span of pixels within a single band of a region.
+ */
+typedef struct guac_common_region_span {
+
+    /**
+     * The X coordinate of the leftmost pixel of this span.
+     */
+    int x;
+
+    /**
+     * The width of this span, in pixels.
+     */
+    int width;
+
+} guac_common_region_span;
+
+/**
+ * A horizontal band of a region. All spans within a band share the same
+ * vertical extent, and are stored in ascending order of X coordinate. Spans
+ * within a band never overlap or touch.
+ */
+typedef struct guac_common_region_band {
+
+    /**
+     * The Y coordinate of the topmost row of this band.
+     */
+    int y;
+
+    /**
+     * The height of this band, in pixels.
+     */
+    int height;
+
+    /**
+     * The number of spans within this band.
+     */
+    int span_count;
+
+    /**
+     * The number of spans which may be stored within the spans array before
+     * that array must be reallocated.
+     */
+    int span_capacity;
+
+    /**
+     * All spans within this band, sorted by X coordinate.
+     */
+    guac_common_region_span* spans;
+
+} guac_common_region_band;
+
+/**
+ * An arbitrary set of pixels, represented as a list of non-overlapping
+ * horizontal bands of non-overlapping spans, similar to the banded regions of
+ * pixman and X11. Bands are stored in ascending order of Y coordinate, and
+ * vertically-adjacent bands never contain identical spans, as such bands are
+ * always coalesced into one.
+ */
+typedef struct guac_common_region {
+
+    /**
+     * The number of bands within this region.
+     */
+    int band_count;
+
+    /**
+     * The number of bands which may be stored within the bands array before
+     * that array must be reallocated. Bands beyond band_count retain their
+     * span storage such that it can be reused as the region grows again.
+     */
+    int band_capacity;
+
+    /**
+     * All bands within this region, sorted by Y coordinate.
+     */
+    guac_common_region_band* bands;
+
+} guac_common_region;
+
+/**
+ * Callback which is invoked by guac_common_region_foreach_rect() for each
+ * rectangle within a region.
+ *
+ * @param rect
+ *     The current rectangle.
+ *
+ * @param data
+ *     The arbitrary data passed to guac_common_region_foreach_rect().
+ */
+typedef void guac_common_region_rect_callback(const guac_common_rect* rect,
+        void* data);
+
+/**
+ * Allocates a new, empty region.
+ *
+ * @return
+ *     A newly-allocated, empty region.
+ */
+guac_common_region* guac_common_region_alloc();
+
+/**
+ * Frees the given region and all associated storage.
+ *
+ * @param region
+ *     The region to free.
+ */
+void guac_common_region_free(guac_common_region* region);
+
+/**
+ * Removes all pixels from the given region. Any storage allocated for the
+ * region is retained for reuse.
+ *
+ * @param region
+ *     The region to clear.
+ */
+void guac_common_region_clear(guac_common_region* region);
+
+/**
+ * Returns whether the given region contains no pixels.
+ *
+ * @param region
+ *     The region to test.
+ *
+ * @return
+ *     Non-zero if the given region is empty, zero otherwise.
+ */
+int guac_common_region_is_empty(const guac_common_region* region);
+
+/**
+ * Adds all pixels within the given rectangle to the given region. Rectangles
+ * having a zero or negative width or height are ignored.
+ *
+ * @param region
+ *     The region to modify.
+ *
+ * @param rect
+ *     The rectangle to add to the region.
+ */
+void guac_common_region_union_rect(guac_common_region* region,
+        const guac_common_rect* rect);
+
+/**
+ * Removes all pixels within the given rectangle from the given region.
+ * Rectangles having a zero or negative width or height are ignored.
+ *
+ * @param region
+ *     The region to modify.
+ *
+ * @param rect
+ *     The rectangle to remove from the region.
+ */
+void guac_common_region_subtract_rect(guac_common_region* region,
+        const guac_common_rect* rect);
+
+/**
+ * Stores the smallest rectangle containing all pixels of the given region
+ * within the given rectangle.
+ *
+ * @param region
+ *     The region whose extents should be determined.
+ *
+ * @param extents
+ *     The rectangle which should receive the extents of the region.
+ *
+ * @return
+ *     Non-zero if the region is non-empty and the extents have been stored,
+ *     zero if the region is empty.
+ */
+int guac_common_region_get_extents(const guac_common_region* region,
+        guac_common_rect* extents);
+
+/**
+ * Invokes the given callback for each rectangle within the given region,
+ * ordered top to bottom, then left to right. Spans having identical
+ * horizontal extents within vertically-adjacent bands are combined into a
+ * single rectangle, such that each rectangle is as tall as possible. The
+ * rectangles provided never overlap, and together cover exactly the pixels
+ * of the region.
+ *
+ * @param region
+ *     The region whose rectangles should be iterated.
+ *
+ * @param callback
+ *     The callback to invoke for each rectangle.
+ *
+ * @param data
+ *     Arbitrary data to pass to the callback.
+ */
+void guac_common_region_foreach_rect(const guac_common_region* region,
+        guac_common_region_rect_callback* callback, void* data);
+
+#endif
+
@@ -0,0 +1,232 @@
+/*
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ * KIND, either express or implied.  See the License for the
+ * specific language governing permissions and limitations
+ * under the License.
+ */
+
+#ifndef __GUAC_COMMON_SNAPSHOT_H
+#define __GUAC_COMMON_SNAPSHOT_H
+
+#include "config.h"
+#include "common/rect.h"
+
+#include <guacamole/client.h>
+#include <guacamole/layer.h>
+#include <guacamole/socket.h>
+#include <guacamole/timestamp.h>
+
+#include <pthread.h>
+
+/**
+ * The approximate number of pixels within each independently-encoded band of
+ * a snapshot. Larger snapshots are split into horizontal bands of roughly
+ * this size such that they may be encoded in parallel.
+ */
+#define GUAC_COMMON_SNAPSHOT_BAND_PIXELS 262144
+
+/**
+ * The maximum number of threads which may be used to encode the bands of a
+ * single snapshot.
+ */
+#define GUAC_COMMON_SNAPSHOT_MAX_THREADS 4
+
+/**
+ * A single horizontal band of a snapshot, encoded as PNG.
+ */
+typedef struct guac_common_snapshot_band {
+
+    /**
+     * The Y coordinate of the upper edge of this band, relative to the
+     * snapshot.
+     */
+    int y;
+
+    /**
+     * The height of this band, in pixels.
+     */
+    int height;
+
+    /**
+     * The PNG-encoded contents of this band, or NULL if encoding has not yet
+     * completed or has failed.
+     */
+    unsigned char* data;
+
+    /**
+     * The number of bytes of PNG data within the data buffer.
+     */
+    int length;
+
+    /**
+     * The number of bytes allocated for the data buffer.
+     */
+    int size;
+
+} guac_common_snapshot_band;
+
+/**
+ * A point-in-time copy of a rectangular area of a surface which is encoded
+ * once and may then be sent to any number of sockets. Copying the pixels of
+ * a snapshot is cheap and may be done while the surface is locked, while the
+ * comparatively expensive encoding is deferred to the first call to
+ * guac_common_snapshot_send(), which need not hold any lock on the original
+ * surface. Snapshots are reference counted, such that a cached snapshot may
+ * be shared between concurrent senders.
+ */
+typedef struct guac_common_snapshot {
+
+    /**
+     * Lock which guards the reference count and encoding state of this
+     * snapshot.
+     */
+    pthread_mutex_t _lock;
+
+    /**
+     * Condition which is signalled when encoding of this snapshot completes.
+     */
+    pthread_cond_t _encoded;
+
+    /**
+     * The number of references to this snapshot which have not yet been
+     * released.
+     */
+    int _refcount;
+
+    /**
+     * Non-zero if a thread is currently encoding this snapshot, zero
+     * otherwise.
+     */
+    int _encoding;
+
+    /**
+     * Non-zero if this snapshot has been encoded and the raw copy of its
+     * pixels has been freed, zero otherwise.
+     */
+    int _encoded_complete;
+
+    /**
+     * The area of the original surface covered by this snapshot.
+     */
+    guac_common_rect rect;
+
+    /**
+     * The time that this snapshot was taken.
+     */
+    guac_timestamp timestamp;
+
+    /**
+     * A copy of the pixels within the snapshotted area, in 32-bit ARGB
+     * format, or NULL if this snapshot has already been encoded.
+     */
+    unsigned char* buffer;
+
+    /**
+     * The number of bytes in each row of the copied pixels.
+     */
+    int stride;
+
+    /**
+     * Whether all copied pixels are fully opaque.
+     */
+    int opaque;
+
+    /**
+     * The index of the next band to be encoded by an encoding thread.
+     */
+    int _next_band;
+
+    /**
+     * The number of bands in the bands array.
+     */
+    int band_count;
+
+    /**
+     * The horizontal bands making up this snapshot.
+     */
+    guac_common_snapshot_band* bands;
+
+} guac_common_snapshot;
+
+/**
+ * Allocates a new snapshot containing a copy of the pixels within the given
+ * rectangle of the given ARGB32 buffer. The returned snapshot holds a single
+ * reference which must eventually be released with
+ * guac_common_snapshot_release().
+ *
+ * @param buffer
+ *     The buffer containing the pixels to copy, in 32-bit ARGB format.
+ *
+ * @param stride
+ *     The number of bytes in each row of the given buffer.
+ *
+ * @param rect
+ *     The rectangle within the given buffer to copy. This rectangle must be
+ *     non-empty and lie entirely within the buffer.
+ *
+ * @return
+ *     A newly-allocated snapshot of the given area.
+ */
+guac_common_snapshot* guac_common_snapshot_alloc(const unsigned char* buffer,
+        int stride, const guac_common_rect* rect);
+
+/**
+ * Acquires an additional reference to the given snapshot. Each reference
+ * acquired must eventually be released with guac_common_snapshot_release().
+ *
+ * @param snapshot
+ *     The snapshot to acquire a reference to.
+ *
+ * @return
+ *     The given snapshot.
+ */
+guac_common_snapshot* guac_common_snapshot_retain(
+        guac_common_snapshot* snapshot);
+
+/**
+ * Releases a reference to the given snapshot, freeing the snapshot if no
+ * references remain.
+ *
+ * @param snapshot
+ *     The snapshot to release.
+ */
+void guac_common_snapshot_release(guac_common_snapshot* snapshot);
+
+/**
+ * Sends the contents of the given snapshot to the given layer over the given
+ * socket as a series of PNG images, drawn at the same location as the
+ * snapshotted area, replacing any existing content of that area. If the
+ * snapshot has not yet been encoded, it is encoded first, using multiple
+ * threads if the snapshot is large. If another thread is already encoding
+ * the snapshot, this function waits for that encoding to complete rather
+ * than encoding the snapshot again.
+ *
+ * @param snapshot
+ *     The snapshot to send.
+ *
+ * @param client
+ *     The client to use to allocate the streams for each image.
+ *
+ * @param socket
+ *     The socket to send the images over.
+ *
+ * @param layer
+ *     The layer to draw the images to.
+ */
+void guac_common_snapshot_send(guac_common_snapshot* snapshot,
+        guac_client* client, guac_socket* socket, const guac_layer* layer);
+
+#endif
+
@@ -22,20 +22,20 @@
 
 #include "config.h"
 #include "rect.h"
+#include "region.h"
+#include "snapshot.h"
+#include "surface_pool.h"
 
 #include <cairo/cairo.h>
 #include <guacamole/client.h>
 #include <guacamole/layer.h>
 #include <guacamole/protocol.h>
 #include <guacamole/socket.h>
+#include <guacamole/timestamp.h>
+#include <guacamole/video.h>
 
 #include <pthread.h>
 
-/**
- * The maximum number of updates to allow within the bitmap queue.
- */
-#define GUAC_COMMON_SURFACE_QUEUE_SIZE 256
-
 /**
  * Heat map cell size in pixels. Each side of each heat map cell will consist
  * of this many pixels.
@@ -58,6 +58,51 @@
  */
 #define GUAC_COMMON_SURFACE_HEAT_CELL_HISTORY_SIZE 5
 
+/**
+ * The number of milliseconds that a snapshot of a surface taken for a joining
+ * user may be reused for subsequent joining users.
+ */
+#define GUAC_COMMON_SURFACE_SNAPSHOT_TTL 2000
+
+/**
+ * The default number of milliseconds that an area sent using lossy
+ * compression must remain unchanged before it is refreshed losslessly.
+ */
+#define GUAC_COMMON_SURFACE_REFRESH_INTERVAL 1000
+
+/**
+ * The kind of content most recently observed within a heat map cell, as
+ * determined by its edge density, color count and update frequency.
+ */
+typedef enum guac_common_surface_content {
+
+    /**
+     * Too little of the cell has been updated to classify its content.
+     */
+    GUAC_COMMON_SURFACE_CONTENT_UNKNOWN,
+
+    /**
+     * Few colors with dense, sharp edges, such as text.
+     */
+    GUAC_COMMON_SURFACE_CONTENT_TEXT,
+
+    /**
+     * Few colors with sparse edges, such as flat UI elements.
+     */
+    GUAC_COMMON_SURFACE_CONTENT_UI,
+
+    /**
+     * Many colors updated infrequently, such as photographs.
+     */
+    GUAC_COMMON_SURFACE_CONTENT_PHOTO,
+
+    /**
+     * Many colors updated continuously, such as video or animation.
+     */
+    GUAC_COMMON_SURFACE_CONTENT_VIDEO
+
+} guac_common_surface_content;
+
 /**
  * Representation of a cell in the refresh heat map. This cell is used to keep
  * track of how often an area on a surface is refreshed.
@@ -79,25 +124,58 @@ typedef struct guac_common_surface_heat_cell {
      */
     int oldest_entry;
 
-} guac_common_surface_heat_cell;
+    /**
+     * Running average of the proportion of neighboring pixels within this
+     * cell which differ, where 256 represents all neighboring pixels
+     * differing.
+     */
+    int edge_density;
 
-/**
- * Representation of a bitmap update, having a rectangle of image data (stored
- * elsewhere) and a flushed/not-flushed state.
- */
-typedef struct guac_common_surface_bitmap_rect {
+    /**
+     * Running average of the number of distinct colors within this cell.
+     */
+    int color_count;
 
     /**
-     * Whether this rectangle has been flushed.
+     * The kind of content most recently observed within this cell.
      */
-    int flushed;
+    guac_common_surface_content content;
 
     /**
-     * The rectangle containing the bitmap update.
+     * The time that the contents of the area associated with this cell were
+     * last changed, or were last sent only to users receiving live updates
+     * (such as when refreshed losslessly). Users which stopped receiving
+     * live updates before this time must be sent the contents of this cell
+     * to be brought up to date.
      */
-    guac_common_rect rect;
+    guac_timestamp last_modified;
+
+} guac_common_surface_heat_cell;
 
-} guac_common_surface_bitmap_rect;
+/**
+ * Handler which regenerates the contents of a surface whose pixels were
+ * evicted with guac_common_surface_evict(). The handler is invoked with the
+ * surface locked, and must not call any guac_common_surface function on that
+ * surface.
+ *
+ * @param buffer
+ *     The zero-filled buffer which must receive the contents of the surface,
+ *     in 32-bit ARGB format.
+ *
+ * @param width
+ *     The width of the surface, in pixels.
+ *
+ * @param height
+ *     The height of the surface, in pixels.
+ *
+ * @param stride
+ *     The number of bytes in each row of the buffer.
+ *
+ * @param data
+ *     The arbitrary data provided when the handler was set.
+ */
+typedef void guac_common_surface_restore_handler(unsigned char* buffer,
+        int width, int height, int stride, void* data);
 
 /**
  * Surface which backs a Guacamole buffer or layer, automatically
@@ -133,6 +211,13 @@ typedef struct guac_common_surface {
      */
     int lossless;
 
+    /**
+     * The number of milliseconds that an area sent using lossy compression
+     * must remain unchanged before it is resent losslessly, or zero if lossy
+     * areas should never be refreshed.
+     */
+    int refresh_interval;
+
     /**
      * The X coordinate of the upper-left corner of this layer, in pixels,
      * relative to its parent layer. This is only applicable to visible
@@ -226,14 +311,40 @@ typedef struct guac_common_surface {
     guac_common_rect clip_rect;
 
     /**
-     * The number of updates in the bitmap queue.
+     * All deferred bitmap updates which have not yet been flushed, excluding
+     * the update currently described by the dirty rectangle. Overlapping
+     * updates are merged as they are added, and the region is combined into
+     * as few updates as cost estimates allow when the surface is flushed.
      */
-    int bitmap_queue_length;
+    guac_common_region* dirty_region;
 
     /**
-     * All queued bitmap updates.
+     * Scratch region receiving the deferred updates which could not be sent
+     * within the byte budget of a limited flush (see
+     * guac_common_surface_flush_limited()).
      */
-    guac_common_surface_bitmap_rect bitmap_queue[GUAC_COMMON_SURFACE_QUEUE_SIZE];
+    guac_common_region* budget_region;
+
+    /**
+     * The Y coordinate of the first deferred update left unsent by the most
+     * recent limited flush, or 0 if all deferred updates were sent. The next
+     * flush sends updates at or below this coordinate first, such that
+     * updates nearer the bottom of the surface are not starved by changes
+     * nearer the top.
+     */
+    int budget_resume_y;
+
+    /**
+     * Scratch region used when splitting a flushed update into parts
+     * having different kinds of content.
+     */
+    guac_common_region* content_region;
+
+    /**
+     * All areas of this surface whose most recent update was sent using lossy
+     * compression, and which have not since been refreshed losslessly.
+     */
+    guac_common_region* lossy_region;
 
     /**
      * A heat map keeping track of the refresh frequency of
@@ -241,6 +352,96 @@ typedef struct guac_common_surface {
      */
     guac_common_surface_heat_cell* heat_map;
 
+    /**
+     * The pool from which the pixel buffer and heat map of this surface are
+     * allocated, or NULL if they are allocated directly.
+     */
+    guac_common_surface_pool* pool;
+
+    /**
+     * The handler which can regenerate the contents of this surface if its
+     * pixels are evicted, or NULL if this surface cannot be evicted.
+     */
+    guac_common_surface_restore_handler* restore_handler;
+
+    /**
+     * The arbitrary data to pass to restore_handler.
+     */
+    void* restore_data;
+
+    /**
+     * Non-zero if the pixels of this surface have been evicted and buffer is
+     * NULL, 0 otherwise. The client-side layer of an evicted surface retains
+     * its contents.
+     */
+    int evicted;
+
+    /**
+     * The time that the contents of this surface were last read or modified.
+     * This is only maintained for surfaces having a restore_handler.
+     */
+    guac_timestamp last_used;
+
+    /**
+     * The time that the contents, size, or layer properties of this surface
+     * were last modified. Users which stopped receiving updates before this
+     * time must be brought up to date with guac_common_surface_resync(). The
+     * areas of the surface whose contents changed are tracked separately by
+     * the last_modified member of each heat map cell.
+     */
+    guac_timestamp last_modified;
+
+    /**
+     * The live video stream currently carrying updates to the area of this
+     * surface described by video_rect, or NULL if all updates are being sent
+     * as images.
+     */
+    guac_video_stream* video;
+
+    /**
+     * The layer, stacked directly above this surface, within which the video
+     * stream plays back. This is only valid if video is non-NULL.
+     */
+    guac_layer* video_layer;
+
+    /**
+     * The area of this surface, aligned to heat map cells, whose updates are
+     * being sent as video. This is only valid if video is non-NULL.
+     */
+    guac_common_rect video_rect;
+
+    /**
+     * Non-zero if the contents of video_rect have changed since the last
+     * frame of video was written, 0 otherwise.
+     */
+    int video_dirty;
+
+    /**
+     * The time at which this surface was last considered for promotion to
+     * or demotion from video, in milliseconds.
+     */
+    guac_timestamp video_evaluated;
+
+    /**
+     * The most recent snapshot of this surface taken for a joining user, or
+     * NULL if no such snapshot is cached. The snapshot is reused for further
+     * joining users until GUAC_COMMON_SURFACE_SNAPSHOT_TTL milliseconds have
+     * elapsed.
+     */
+    guac_common_snapshot* snapshot;
+
+    /**
+     * Non-zero if the contents of this surface have changed since snapshot
+     * was taken, 0 otherwise.
+     */
+    int snapshot_dirty;
+
+    /**
+     * The bounds of all changes made to this surface since snapshot was
+     * taken. This is only valid if snapshot_dirty is non-zero.
+     */
+    guac_common_rect snapshot_dirty_rect;
+
     /**
      * Mutex which is locked internally when access to the surface must be
      * synchronized. All public functions of guac_common_surface should be
@@ -274,6 +475,37 @@ typedef struct guac_common_surface {
 guac_common_surface* guac_common_surface_alloc(guac_client* client,
         guac_socket* socket, const guac_layer* layer, int w, int h);
 
+/**
+ * Allocates a new guac_common_surface, assigning it to the given layer, and
+ * allocating its pixels and heat map from the given pool. The pool must not
+ * be freed until the surface is freed.
+ *
+ * @param pool
+ *     The pool to allocate the storage of the surface from, or NULL to
+ *     allocate that storage directly.
+ *
+ * @param client
+ *     The client associated with the given layer.
+ *
+ * @param socket
+ *     The socket to send instructions on when flushing.
+ *
+ * @param layer
+ *     The layer to associate with the new surface.
+ *
+ * @param w
+ *     The width of the surface.
+ *
+ * @param h
+ *     The height of the surface.
+ *
+ * @return
+ *     A newly-allocated guac_common_surface.
+ */
+guac_common_surface* guac_common_surface_alloc_pooled(
+        guac_common_surface_pool* pool, guac_client* client,
+        guac_socket* socket, const guac_layer* layer, int w, int h);
+
 /**
  * Frees the given guac_common_surface. Beware that this will NOT free any
  * associated layers, which must be freed manually.
@@ -483,9 +715,36 @@ void guac_common_surface_set_opacity(guac_common_surface* surface, int opacity);
  */
 void guac_common_surface_flush(guac_common_surface* surface);
 
+/**
+ * Flushes the given surface like guac_common_surface_flush(), except that
+ * deferred updates stop being sent once the given number of bytes have been
+ * written to the surface's socket. Any updates which remain are left pending,
+ * to be combined with later changes and sent by a later flush. Layer
+ * properties and video are always flushed, while lossy areas are only
+ * refreshed if all pending updates were sent.
+ *
+ * @param surface
+ *     The surface to flush.
+ *
+ * @param budget
+ *     The number of bytes which may be written to the surface's socket before
+ *     further updates are left pending. Updates are only left pending once
+ *     the budget has been reached, and any update which has already been
+ *     combined with those sent is sent in full, so somewhat more than this
+ *     number of bytes may be written.
+ *
+ * @return
+ *     Non-zero if any updates were left pending, zero otherwise.
+ */
+int guac_common_surface_flush_limited(guac_common_surface* surface,
+        size_t budget);
+
 /**
  * Duplicates the contents of the current surface to the given socket. Pending
- * changes are not flushed.
+ * changes are not flushed. The surface is locked only while its contents are
+ * copied; encoding and sending happen after the lock is released, and a
+ * recent snapshot is reused (along with any changes made since) if one was
+ * taken within the last GUAC_COMMON_SURFACE_SNAPSHOT_TTL milliseconds.
  *
  * @param surface
  *     The surface to duplicate.
@@ -499,6 +758,33 @@ void guac_common_surface_flush(guac_common_surface* surface);
 void guac_common_surface_dup(guac_common_surface* surface,
         guac_client* client, guac_socket* socket);
 
+/**
+ * Brings a user which stopped receiving live updates at the given time up to
+ * date with the given surface, sending the surface's size and layer
+ * properties along with the contents of only those areas of the surface that
+ * changed at or after that time. Changes are tracked per heat map cell, so
+ * the areas sent are aligned to GUAC_COMMON_SURFACE_HEAT_CELL_SIZE. If the
+ * surface has not changed at all since the given time, nothing is sent.
+ * Pending changes are not flushed. As with guac_common_surface_dup(), the
+ * surface is locked only while its contents are copied, and any video stream
+ * is stopped.
+ *
+ * @param surface
+ *     The surface to resynchronize.
+ *
+ * @param client
+ *     The client whose users are receiving the surface.
+ *
+ * @param socket
+ *     The socket over which the surface should be sent.
+ *
+ * @param since
+ *     The time that the receiving user stopped receiving live updates. If
+ *     zero, the entire surface is sent.
+ */
+void guac_common_surface_resync(guac_common_surface* surface,
+        guac_client* client, guac_socket* socket, guac_timestamp since);
+
 /**
  * Declares that the given surface should receive touch events. By default,
  * surfaces are assumed to not expect touch events. This value is advisory, and
@@ -535,5 +821,59 @@ void guac_common_surface_set_multitouch(guac_common_surface* surface,
 void guac_common_surface_set_lossless(guac_common_surface* surface,
         int lossless);
 
+/**
+ * Sets the handler which regenerates the contents of the given surface after
+ * its pixels have been evicted, allowing the surface to be evicted. Setting
+ * the handler to NULL prevents eviction, restoring the surface first if it
+ * is currently evicted. The handler must be cleared before any operation
+ * makes the contents of the surface differ from what the handler produces.
+ *
+ * @param surface
+ *     The surface to modify.
+ *
+ * @param handler
+ *     The handler to invoke to restore the contents of the surface, or NULL
+ *     if the surface must not be evicted.
+ *
+ * @param data
+ *     Arbitrary data to pass to the handler.
+ */
+void guac_common_surface_set_restore_handler(guac_common_surface* surface,
+        guac_common_surface_restore_handler* handler, void* data);
+
+/**
+ * Frees the pixels backing the given surface, flushing any pending updates
+ * first, if the surface has a restore handler. The client-side contents of
+ * the surface are unaffected. The pixels are regenerated with the restore
+ * handler as soon as the surface is next drawn to, read from, or duplicated
+ * to a joining user.
+ *
+ * @param surface
+ *     The surface to evict.
+ *
+ * @return
+ *     The number of bytes of pixel data freed, or zero if the surface has no
+ *     restore handler or is already evicted.
+ */
+size_t guac_common_surface_evict(guac_common_surface* surface);
+
+/**
+ * Sets the number of milliseconds that areas of the given surface sent using
+ * lossy compression must remain unchanged before they are automatically
+ * resent losslessly. Lossless refreshes are sent as part of subsequent
+ * flushes, a limited amount at a time, and only while the client is keeping
+ * up with the updates it is receiving. By default, newly-created surfaces use
+ * an interval of GUAC_COMMON_SURFACE_REFRESH_INTERVAL.
+ *
+ * @param surface
+ *     The surface to modify.
+ *
+ * @param interval
+ *     The number of milliseconds that lossy areas must remain unchanged
+ *     before being refreshed, or zero to disable lossless refresh.
+ */
+void guac_common_surface_set_refresh_interval(guac_common_surface* surface,
+        int interval);
+
 #endif
 
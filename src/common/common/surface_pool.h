@@ -0,0 +1,166 @@
+/*
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ * KIND, either express or implied.  See the License for the
+ * specific language governing permissions and limitations
+ * under the License.
+ */
+
+#ifndef __GUAC_COMMON_SURFACE_POOL_H
+#define __GUAC_COMMON_SURFACE_POOL_H
+
+#include "config.h"
+
+#include <pthread.h>
+#include <stddef.h>
+
+/**
+ * The base-2 logarithm of the size of the smallest size class of a
+ * guac_common_surface_pool, in bytes.
+ */
+#define GUAC_COMMON_SURFACE_POOL_MIN_SHIFT 6
+
+/**
+ * The base-2 logarithm of the size of the largest size class of a
+ * guac_common_surface_pool, in bytes. Larger allocations are not pooled,
+ * though they are still included in the pool's accounting.
+ */
+#define GUAC_COMMON_SURFACE_POOL_MAX_SHIFT 24
+
+/**
+ * The number of size classes between each power of two. Allocations are
+ * rounded up to the next size class, thus wasting at most 1/STEPS of each
+ * allocation.
+ */
+#define GUAC_COMMON_SURFACE_POOL_STEPS 4
+
+/**
+ * The total number of size classes within a guac_common_surface_pool.
+ */
+#define GUAC_COMMON_SURFACE_POOL_CLASSES (                             \
+        (GUAC_COMMON_SURFACE_POOL_MAX_SHIFT                            \
+            - GUAC_COMMON_SURFACE_POOL_MIN_SHIFT)                      \
+        * GUAC_COMMON_SURFACE_POOL_STEPS + 1                           \
+)
+
+/**
+ * The maximum number of bytes of freed blocks that a single
+ * guac_common_surface_pool will retain for reuse. Blocks freed beyond this
+ * limit are returned to the system.
+ */
+#define GUAC_COMMON_SURFACE_POOL_MAX_RETAINED 8388608
+
+/**
+ * A pool of the memory backing the pixels and heat maps of surfaces, divided
+ * into size classes such that blocks freed by one surface can be reused by
+ * another of similar size without returning to the system allocator. The
+ * pool also tracks the total amount of memory in use by its surfaces.
+ */
+typedef struct guac_common_surface_pool {
+
+    /**
+     * Lock which is acquired whenever the pool is accessed.
+     */
+    pthread_mutex_t _lock;
+
+    /**
+     * The heads of singly-linked lists of free blocks, one list per size
+     * class. The first bytes of each free block point to the next free block
+     * of the same size class.
+     */
+    void* _free_blocks[GUAC_COMMON_SURFACE_POOL_CLASSES];
+
+    /**
+     * The number of bytes currently allocated from this pool and not yet
+     * freed, including the rounding of each allocation to its size class.
+     */
+    size_t used;
+
+    /**
+     * The number of bytes within freed blocks that are retained for reuse.
+     */
+    size_t retained;
+
+} guac_common_surface_pool;
+
+/**
+ * Allocates a new, empty guac_common_surface_pool.
+ *
+ * @return
+ *     A newly-allocated guac_common_surface_pool.
+ */
+guac_common_surface_pool* guac_common_surface_pool_alloc();
+
+/**
+ * Frees the given guac_common_surface_pool, returning all retained blocks to
+ * the system. All blocks allocated from the pool must have been freed.
+ *
+ * @param pool
+ *     The pool to free.
+ */
+void guac_common_surface_pool_free(guac_common_surface_pool* pool);
+
+/**
+ * Allocates a zero-filled block of at least the given size from the given
+ * pool, reusing a previously-freed block of the same size class if
+ * available.
+ *
+ * @param pool
+ *     The pool to allocate from, or NULL to allocate directly from the system
+ *     without pooling or accounting.
+ *
+ * @param size
+ *     The number of bytes required.
+ *
+ * @return
+ *     A zero-filled block of at least the given size, or NULL if the
+ *     allocation fails. The block must be freed with
+ *     guac_common_surface_pool_release() using the same pool and size.
+ */
+void* guac_common_surface_pool_zalloc(guac_common_surface_pool* pool,
+        size_t size);
+
+/**
+ * Returns the given block, allocated with guac_common_surface_pool_zalloc(),
+ * to the given pool. If the pool is already retaining
+ * GUAC_COMMON_SURFACE_POOL_MAX_RETAINED bytes, the block is freed instead.
+ * If the block is NULL, this function has no effect.
+ *
+ * @param pool
+ *     The pool that the block was allocated from, or NULL if the block was
+ *     allocated without a pool.
+ *
+ * @param block
+ *     The block to release.
+ *
+ * @param size
+ *     The size that was requested when the block was allocated.
+ */
+void guac_common_surface_pool_release(guac_common_surface_pool* pool,
+        void* block, size_t size);
+
+/**
+ * Returns the number of bytes currently allocated from the given pool and not
+ * yet released.
+ *
+ * @param pool
+ *     The pool to query.
+ *
+ * @return
+ *     The number of bytes currently in use.
+ */
+size_t guac_common_surface_pool_get_used(guac_common_surface_pool* pool);
+
+#endif
+
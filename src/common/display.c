@@ -20,12 +20,18 @@
 #include "common/cursor.h"
 #include "common/display.h"
 #include "common/surface.h"
+#include "common/surface_pool.h"
 
 #include <guacamole/client.h>
+#include <guacamole/congestion-constants.h>
 #include <guacamole/mem.h>
 #include <guacamole/socket.h>
+#include <guacamole/timestamp.h>
+#include <guacamole/user.h>
 
 #include <pthread.h>
+#include <stddef.h>
+#include <stdint.h>
 #include <stdlib.h>
 #include <string.h>
 
@@ -136,8 +142,20 @@ guac_common_display* guac_common_display_alloc(guac_client* client,
     /* Associate display with given client */
     display->client = client;
 
-    display->default_surface = guac_common_surface_alloc(client,
-            client->socket, GUAC_DEFAULT_LAYER, width, height);
+    /* All surfaces share the same pool, with no limit by default */
+    display->pool = guac_common_surface_pool_alloc();
+    display->memory_limit = 0;
+
+    /* Lossy areas are refreshed at the default interval */
+    display->refresh_interval = GUAC_COMMON_SURFACE_REFRESH_INTERVAL;
+
+    /* All users initially receive live updates */
+    display->socket = guac_socket_broadcast_live(client);
+    display->paused_users = NULL;
+    display->last_flush = guac_timestamp_current();
+
+    display->default_surface = guac_common_surface_alloc_pooled(display->pool,
+            client, display->socket, GUAC_DEFAULT_LAYER, width, height);
 
     /* No initial layers or buffers */
     display->layers = NULL;
@@ -159,6 +177,20 @@ void guac_common_display_free(guac_common_display* display) {
     guac_common_display_free_layers(display->buffers, display->client);
     guac_common_display_free_layers(display->layers, display->client);
 
+    /* Pool can be freed only after all surfaces using it */
+    guac_common_surface_pool_free(display->pool);
+
+    /* Free records of paused users */
+    guac_common_display_paused_user* paused = display->paused_users;
+    while (paused != NULL) {
+        guac_common_display_paused_user* next = paused->next;
+        guac_mem_free(paused);
+        paused = next;
+    }
+
+    /* Socket can be freed only after all surfaces using it */
+    guac_socket_free(display->socket);
+
     pthread_mutex_destroy(&display->_lock);
     guac_mem_free(display);
 
@@ -211,19 +243,363 @@ void guac_common_display_set_lossless(guac_common_display* display,
 
 }
 
-void guac_common_display_flush(guac_common_display* display) {
+void guac_common_display_set_recording(guac_common_display* display,
+        guac_recording* recording) {
+
+    /* Users are sent updates through a socket which skips users that are
+     * lagging, and which is thus separate from the client socket wrapped by
+     * the recording */
+    if (recording->include_output)
+        guac_socket_broadcast_set_recording(display->socket,
+                recording->socket);
+
+}
+
+void guac_common_display_set_refresh_interval(guac_common_display* display,
+        int interval) {
 
     pthread_mutex_lock(&display->_lock);
 
+    /* Update interval to be applied to all newly-allocated layers/buffers */
+    display->refresh_interval = interval;
+
+    /* Update interval of all allocated layers and buffers */
     guac_common_display_layer* current = display->layers;
+    while (current != NULL) {
+        guac_common_surface_set_refresh_interval(current->surface, interval);
+        current = current->next;
+    }
 
-    /* Flush all surfaces */
+    current = display->buffers;
     while (current != NULL) {
-        guac_common_surface_flush(current->surface);
+        guac_common_surface_set_refresh_interval(current->surface, interval);
         current = current->next;
     }
 
-    guac_common_surface_flush(display->default_surface);
+    /* Update interval of default display layer (not included within layers
+     * list) */
+    guac_common_surface_set_refresh_interval(display->default_surface,
+            interval);
+
+    pthread_mutex_unlock(&display->_lock);
+
+}
+
+/**
+ * Sends the areas of each surface within the given linked list that have been
+ * modified at or after the given time to the given user. If the provided
+ * pointer to the linked list is NULL, this function has no effect.
+ *
+ * @param layers
+ *     The head element of the linked list of layers to send, which may be
+ *     NULL if the list is currently empty.
+ *
+ * @param user
+ *     The user to send modified surfaces to.
+ *
+ * @param since
+ *     The time at or after which a surface must have been modified to be
+ *     sent.
+ */
+static void guac_common_display_resync_layers(
+        guac_common_display_layer* layers, guac_user* user,
+        guac_timestamp since) {
+
+    guac_common_display_layer* current = layers;
+
+    while (current != NULL) {
+        guac_common_surface_resync(current->surface, user->client,
+                user->socket, since);
+        current = current->next;
+    }
+
+}
+
+/**
+ * The state of a single display flush which is shared with
+ * guac_common_display_pace_user() for each connected user.
+ */
+typedef struct guac_common_display_pace_state {
+
+    /**
+     * The display being flushed. The display must be locked.
+     */
+    guac_common_display* display;
+
+    /**
+     * The time that the current flush began. All changes made to surfaces
+     * prior to this time have been sent to users receiving live updates.
+     */
+    guac_timestamp flush_started;
+
+} guac_common_display_pace_state;
+
+/**
+ * Callback for guac_client_foreach_user() which stops sending live updates
+ * to the given user if that user has fallen too far behind or has exhausted
+ * its rate limit, or brings the user up to date and again sends live updates
+ * if the user was previously paused but has since caught up. The processing
+ * lag of the owner of the connection is not considered, as the owner sets the
+ * pace of the connection, but the owner is paced like any other user if its
+ * rate limit is exhausted.
+ *
+ * @param user
+ *     The user whose pacing should be updated.
+ *
+ * @param data
+ *     A pointer to the guac_common_display_pace_state of the current flush.
+ *
+ * @return
+ *     Always NULL.
+ */
+static void* guac_common_display_pace_user(guac_user* user, void* data) {
+
+    guac_common_display_pace_state* state =
+        (guac_common_display_pace_state*) data;
+
+    guac_common_display* display = state->display;
+
+    /* The owner sets the pace of the connection and cannot fall behind it,
+     * but any user may write no further data once its rate limit is
+     * exhausted */
+    int behind = !user->owner
+        && user->processing_lag > GUAC_COMMON_DISPLAY_PAUSE_LAG;
+    int rate_fill = guac_socket_get_rate_fill(user->socket);
+
+    /* Locate any record of the user having been paused */
+    guac_common_display_paused_user* paused = display->paused_users;
+    while (paused != NULL && paused->user != user)
+        paused = paused->next;
+
+    if (!user->lagging) {
+
+        if (!behind && rate_fill > 0)
+            return NULL;
+
+        /* Stop sending live updates. Everything modified before this flush
+         * began has already been sent to the user. */
+        if (paused == NULL) {
+            paused = guac_mem_alloc(sizeof(guac_common_display_paused_user));
+            paused->user = user;
+            paused->next = display->paused_users;
+            display->paused_users = paused;
+        }
+
+        paused->since = state->flush_started;
+        paused->present = 1;
+
+        guac_socket_broadcast_set_lagging(display->socket, user, 1);
+
+        if (behind)
+            guac_user_log(user, GUAC_LOG_DEBUG, "User is lagging behind by "
+                    "%i ms. Updates for this user will be coalesced until the "
+                    "user has caught up.", user->processing_lag);
+        else
+            guac_user_log(user, GUAC_LOG_DEBUG, "User has exceeded its "
+                    "bandwidth limit. Updates for this user will be coalesced "
+                    "until its limit allows further data.");
+
+        return NULL;
+
+    }
+
+    /* Lacking any record of when updates stopped, everything must be sent */
+    guac_timestamp since = 0;
+    if (paused != NULL) {
+        since = paused->since;
+        paused->present = 1;
+    }
+
+    /* Continue coalescing updates until the user has caught up and its rate
+     * limit again allows a reasonable amount of data to be sent */
+    if ((!user->owner && user->processing_lag > GUAC_COMMON_DISPLAY_RESUME_LAG)
+            || rate_fill < GUAC_COMMON_DISPLAY_RESUME_FILL)
+        return NULL;
+
+    /* Resume live updates before sending the areas of surfaces modified in
+     * the meantime, such that any update sent from this point onward is
+     * either received live or reflected in the surface contents sent below.
+     * Only the changed areas are sent, as resending entire surfaces could
+     * exhaust the user's rate limit again immediately. */
+    guac_socket_broadcast_set_lagging(display->socket, user, 0);
+
+    guac_common_surface_resync(display->default_surface, user->client,
+            user->socket, since);
+
+    guac_common_display_resync_layers(display->layers, user, since);
+    guac_common_display_resync_layers(display->buffers, user, since);
+
+    guac_socket_flush(user->socket);
+
+    /* The record is freed when stale records are cleaned up */
+    if (paused != NULL)
+        paused->present = 0;
+
+    return NULL;
+
+}
+
+/**
+ * The byte budget of a single display flush, shared by all surfaces flushed.
+ */
+typedef struct guac_common_display_frame {
+
+    /**
+     * The socket to which all surfaces of the display send their updates.
+     */
+    guac_socket* socket;
+
+    /**
+     * The number of bytes written to the socket when the flush began.
+     */
+    uint64_t start;
+
+    /**
+     * The number of bytes which may be written during the flush before
+     * further updates are left pending, or SIZE_MAX if not limited.
+     */
+    size_t budget;
+
+} guac_common_display_frame;
+
+/**
+ * Flushes the given surface using whatever remains of the byte budget of the
+ * given display flush.
+ *
+ * @param frame
+ *     The budget of the current display flush.
+ *
+ * @param surface
+ *     The surface to flush.
+ *
+ * @return
+ *     Non-zero if any updates to the surface were left pending, zero
+ *     otherwise.
+ */
+static int guac_common_display_flush_surface(guac_common_display_frame* frame,
+        guac_common_surface* surface) {
+
+    uint64_t written = frame->socket->bytes_written - frame->start;
+    size_t remaining = 0;
+
+    if (frame->budget == SIZE_MAX)
+        remaining = SIZE_MAX;
+    else if (written < frame->budget)
+        remaining = frame->budget - written;
+
+    return guac_common_surface_flush_limited(surface, remaining);
+
+}
+
+/**
+ * Moves the given display layer to the start of the linked list whose head
+ * pointer is provided.
+ *
+ * @param head
+ *     A pointer to the head pointer of the list of layers. The head pointer
+ *     will be updated by this function to point to the given display layer.
+ *
+ * @param display_layer
+ *     The display layer to move, which must already be within the given
+ *     list.
+ */
+static void guac_common_display_raise_layer(guac_common_display_layer** head,
+        guac_common_display_layer* display_layer) {
+
+    /* Nothing to do if already first */
+    if (display_layer->prev == NULL)
+        return;
+
+    /* Unlink from current position */
+    display_layer->prev->next = display_layer->next;
+    if (display_layer->next != NULL)
+        display_layer->next->prev = display_layer->prev;
+
+    /* Insert as the new head */
+    display_layer->prev = NULL;
+    display_layer->next = *head;
+    (*head)->prev = display_layer;
+    *head = display_layer;
+
+}
+
+void guac_common_display_flush(guac_common_display* display) {
+
+    pthread_mutex_lock(&display->_lock);
+
+    guac_timestamp now = guac_timestamp_current();
+
+    /* Send no more than can be delivered to users before the next frame,
+     * where the next frame is assumed to follow after the same interval as
+     * this one */
+    int frame_duration = now - display->last_flush;
+    if (frame_duration > GUAC_CONGESTION_MAX_FRAME_DURATION)
+        frame_duration = GUAC_CONGESTION_MAX_FRAME_DURATION;
+    else if (frame_duration < 1)
+        frame_duration = 1;
+
+    int budget = guac_client_get_frame_budget(display->client,
+            frame_duration);
+
+    guac_common_display_frame frame = {
+        .socket = display->socket,
+        .start = display->socket->bytes_written,
+        .budget = budget > 0 ? (size_t) budget : SIZE_MAX
+    };
+
+    display->last_flush = now;
+
+    /* Surfaces left behind by the previous flush are flushed first, such
+     * that no surface is starved by updates to others */
+    int default_deferred = display->default_deferred;
+    if (default_deferred)
+        display->default_deferred = guac_common_display_flush_surface(&frame,
+                display->default_surface);
+
+    /* Flush all layers, moving those left behind to the start of the list */
+    guac_common_display_layer* current = display->layers;
+    while (current != NULL) {
+
+        guac_common_display_layer* next = current->next;
+
+        if (guac_common_display_flush_surface(&frame, current->surface))
+            guac_common_display_raise_layer(&display->layers, current);
+
+        current = next;
+
+    }
+
+    if (!default_deferred)
+        display->default_deferred = guac_common_display_flush_surface(&frame,
+                display->default_surface);
+
+    guac_common_display_pace_state state = {
+        .display = display,
+        .flush_started = display->last_flush
+    };
+
+    /* Pause or resume live updates for each user depending on their lag and
+     * rate limits */
+    guac_client_foreach_user(display->client,
+            guac_common_display_pace_user, &state);
+
+    /* Free records of users which have caught up or have left */
+    guac_common_display_paused_user** paused = &display->paused_users;
+    while (*paused != NULL) {
+
+        guac_common_display_paused_user* current_paused = *paused;
+
+        if (current_paused->present) {
+            current_paused->present = 0;
+            paused = &current_paused->next;
+        }
+
+        else {
+            *paused = current_paused->next;
+            guac_mem_free(current_paused);
+        }
+
+    }
 
     pthread_mutex_unlock(&display->_lock);
 
@@ -304,6 +680,95 @@ static void guac_common_display_remove_layer(guac_common_display_layer** head,
 
 }
 
+/**
+ * Compares the last usage times of two surfaces, for use with qsort(), such
+ * that the least-recently used surface is sorted first.
+ *
+ * @param a
+ *     A pointer to the first guac_common_surface pointer to compare.
+ *
+ * @param b
+ *     A pointer to the second guac_common_surface pointer to compare.
+ *
+ * @return
+ *     A negative value if the first surface was used less recently than the
+ *     second, a positive value if the first was used more recently, or zero
+ *     if both were last used at the same time.
+ */
+static int guac_common_display_compare_last_used(const void* a,
+        const void* b) {
+
+    guac_timestamp a_used = (*((guac_common_surface* const*) a))->last_used;
+    guac_timestamp b_used = (*((guac_common_surface* const*) b))->last_used;
+
+    if (a_used < b_used) return -1;
+    if (a_used > b_used) return 1;
+    return 0;
+
+}
+
+/**
+ * Evicts the least-recently used evictable buffers of the given display
+ * until its surface memory usage is at most three quarters of its memory
+ * limit, if its usage currently exceeds that limit. The display must be
+ * locked.
+ *
+ * @param display
+ *     The display whose memory limit should be enforced.
+ */
+static void guac_common_display_enforce_memory_limit(
+        guac_common_display* display) {
+
+    if (display->memory_limit == 0)
+        return;
+
+    size_t used = guac_common_surface_pool_get_used(display->pool);
+    if (used <= display->memory_limit)
+        return;
+
+    /* Gather candidates for eviction */
+    int count = 0;
+    guac_common_display_layer* current = display->buffers;
+    while (current != NULL) {
+        if (current->surface->restore_handler != NULL
+                && !current->surface->evicted)
+            count++;
+        current = current->next;
+    }
+
+    if (count == 0)
+        return;
+
+    guac_common_surface** candidates = guac_mem_alloc(count,
+            sizeof(guac_common_surface*));
+
+    int index = 0;
+    current = display->buffers;
+    while (current != NULL) {
+        if (current->surface->restore_handler != NULL
+                && !current->surface->evicted)
+            candidates[index++] = current->surface;
+        current = current->next;
+    }
+
+    /* Evict least-recently used buffers first, leaving headroom such that
+     * eviction need not occur again for every new buffer */
+    qsort(candidates, count, sizeof(guac_common_surface*),
+            guac_common_display_compare_last_used);
+
+    size_t target = display->memory_limit / 4 * 3;
+    size_t freed = 0;
+    for (index = 0; index < count && used - freed > target; index++)
+        freed += guac_common_surface_evict(candidates[index]);
+
+    guac_client_log(display->client, GUAC_LOG_DEBUG, "Evicted %i of %i "
+            "cached buffers, freeing %zu of %zu bytes of surface memory.",
+            index, count, freed, used);
+
+    guac_mem_free(candidates);
+
+}
+
 guac_common_display_layer* guac_common_display_alloc_layer(
         guac_common_display* display, int width, int height) {
 
@@ -313,16 +778,22 @@ guac_common_display_layer* guac_common_display_alloc_layer(
     guac_layer* layer = guac_client_alloc_layer(display->client);
 
     /* Allocate corresponding surface */
-    guac_common_surface* surface = guac_common_surface_alloc(display->client,
-            display->client->socket, layer, width, height);
+    guac_common_surface* surface = guac_common_surface_alloc_pooled(
+            display->pool, display->client, display->socket, layer,
+            width, height);
 
-    /* Apply current display losslessness */
+    /* Apply current display losslessness and refresh interval */
     guac_common_surface_set_lossless(surface, display->lossless);
+    guac_common_surface_set_refresh_interval(surface,
+            display->refresh_interval);
 
     /* Add layer and surface to list */
     guac_common_display_layer* display_layer =
         guac_common_display_add_layer(&display->layers, layer, surface);
 
+    /* Make room for the new layer if necessary */
+    guac_common_display_enforce_memory_limit(display);
+
     pthread_mutex_unlock(&display->_lock);
     return display_layer;
 
@@ -337,16 +808,22 @@ guac_common_display_layer* guac_common_display_alloc_buffer(
     guac_layer* buffer = guac_client_alloc_buffer(display->client);
 
     /* Allocate corresponding surface */
-    guac_common_surface* surface = guac_common_surface_alloc(display->client,
-            display->client->socket, buffer, width, height);
+    guac_common_surface* surface = guac_common_surface_alloc_pooled(
+            display->pool, display->client, display->socket, buffer,
+            width, height);
 
-    /* Apply current display losslessness */
+    /* Apply current display losslessness and refresh interval */
     guac_common_surface_set_lossless(surface, display->lossless);
+    guac_common_surface_set_refresh_interval(surface,
+            display->refresh_interval);
 
     /* Add buffer and surface to list */
     guac_common_display_layer* display_layer =
         guac_common_display_add_layer(&display->buffers, buffer, surface);
 
+    /* Make room for the new buffer if necessary */
+    guac_common_display_enforce_memory_limit(display);
+
     pthread_mutex_unlock(&display->_lock);
     return display_layer;
 
@@ -389,3 +866,19 @@ void guac_common_display_free_buffer(guac_common_display* display,
     pthread_mutex_unlock(&display->_lock);
 
 }
+
+void guac_common_display_set_memory_limit(guac_common_display* display,
+        size_t limit) {
+
+    pthread_mutex_lock(&display->_lock);
+
+    display->memory_limit = limit;
+    guac_common_display_enforce_memory_limit(display);
+
+    pthread_mutex_unlock(&display->_lock);
+
+}
+
+size_t guac_common_display_get_memory_usage(guac_common_display* display) {
+    return guac_common_surface_pool_get_used(display->pool);
+}
@@ -0,0 +1,1081 @@
+/*
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ * KIND, either express or implied.  See the License for the
+ * specific language governing permissions and limitations
+ * under the License.
+ */
+
+#include "config.h"
+#include "common/pixel.h"
+
+#include <guacamole/protocol-types.h>
+
+#include <pthread.h>
+#include <stdint.h>
+
+#ifdef HAVE_X86_SIMD
+#include <immintrin.h>
+#endif
+
+/**
+ * The set of row operations provided by a single implementation.
+ */
+typedef struct guac_common_pixel_kernels {
+
+    /**
+     * Implementation of guac_common_pixel_is_opaque().
+     */
+    int (*is_opaque)(const uint32_t* row, int width);
+
+    /**
+     * Implementation of guac_common_pixel_put_row().
+     */
+    int (*put_row)(uint32_t* dst, const uint32_t* src, int width,
+            int opaque, int* first, int* last);
+
+    /**
+     * Implementation of guac_common_pixel_fill_row().
+     */
+    int (*fill_row)(uint32_t* dst, uint32_t color, int width,
+            int* first, int* last);
+
+    /**
+     * Implementation of guac_common_pixel_transfer_row().
+     */
+    int (*transfer_row)(guac_transfer_function op, uint32_t* dst,
+            const uint32_t* src, int width, int backwards,
+            int* first, int* last);
+
+} guac_common_pixel_kernels;
+
+/**
+ * Applies the Porter-Duff "over" composite operator, blending the two given
+ * color components using the given alpha value.
+ *
+ * @param dst
+ *     The destination color component.
+ *
+ * @param src
+ *     The source color component.
+ *
+ * @param alpha
+ *     The alpha value which applies to the blending operation.
+ *
+ * @return
+ *     The result of applying the Porter-Duff "over" composite operator to the
+ *     given source and destination components.
+ */
+static int guac_common_pixel_blend_component(int dst, int src, int alpha) {
+
+    int blended = src + dst * (0xFF - alpha);
+
+    /* Do not exceed maximum component value */
+    if (blended > 0xFF)
+        return 0xFF;
+
+    return blended;
+
+}
+
+uint32_t guac_common_pixel_argb_blend(uint32_t dst, uint32_t src) {
+
+    /* Separate destination ARGB color into its components */
+    int dst_a = (dst >> 24) & 0xFF;
+    int dst_r = (dst >> 16) & 0xFF;
+    int dst_g = (dst >>  8) & 0xFF;
+    int dst_b =  dst        & 0xFF;
+
+    /* Separate source ARGB color into its components */
+    int src_a = (src >> 24) & 0xFF;
+    int src_r = (src >> 16) & 0xFF;
+    int src_g = (src >>  8) & 0xFF;
+    int src_b =  src        & 0xFF;
+
+    /* If source is fully opaque (or destination is fully transparent), the
+     * blended result is the source */
+    if (src_a == 0xFF || dst_a == 0x00)
+        return src;
+
+    /* If source is fully transparent, the blended result is the destination */
+    if (src_a == 0x00)
+        return dst;
+
+    /* Otherwise, blend each ARGB component, assuming pre-multiplied alpha */
+    int r = guac_common_pixel_blend_component(dst_r, src_r, src_a);
+    int g = guac_common_pixel_blend_component(dst_g, src_g, src_a);
+    int b = guac_common_pixel_blend_component(dst_b, src_b, src_a);
+    int a = guac_common_pixel_blend_component(dst_a, src_a, src_a);
+
+    /* Recombine blended components */
+    return ((uint32_t) a << 24) | (r << 16) | (g << 8) | b;
+
+}
+
+uint32_t guac_common_pixel_transfer(guac_transfer_function op, uint32_t src,
+        uint32_t dst) {
+
+    switch (op) {
+
+        case GUAC_TRANSFER_BINARY_BLACK:
+            return 0xFF000000;
+
+        case GUAC_TRANSFER_BINARY_WHITE:
+            return 0xFFFFFFFF;
+
+        case GUAC_TRANSFER_BINARY_SRC:
+            return src;
+
+        case GUAC_TRANSFER_BINARY_DEST:
+            return dst;
+
+        case GUAC_TRANSFER_BINARY_NSRC:
+            return src ^ 0x00FFFFFF;
+
+        case GUAC_TRANSFER_BINARY_NDEST:
+            return dst ^ 0x00FFFFFF;
+
+        case GUAC_TRANSFER_BINARY_AND:
+            return dst & (0xFF000000 | src);
+
+        case GUAC_TRANSFER_BINARY_NAND:
+            return (dst & (0xFF000000 | src)) ^ 0x00FFFFFF;
+
+        case GUAC_TRANSFER_BINARY_OR:
+            return dst | (0x00FFFFFF & src);
+
+        case GUAC_TRANSFER_BINARY_NOR:
+            return (dst | (0x00FFFFFF & src)) ^ 0x00FFFFFF;
+
+        case GUAC_TRANSFER_BINARY_XOR:
+            return dst ^ (0x00FFFFFF & src);
+
+        case GUAC_TRANSFER_BINARY_XNOR:
+            return (dst ^ (0x00FFFFFF & src)) ^ 0x00FFFFFF;
+
+        case GUAC_TRANSFER_BINARY_NSRC_AND:
+            return dst & (0xFF000000 | (src ^ 0x00FFFFFF));
+
+        case GUAC_TRANSFER_BINARY_NSRC_NAND:
+            return (dst & (0xFF000000 | (src ^ 0x00FFFFFF))) ^ 0x00FFFFFF;
+
+        case GUAC_TRANSFER_BINARY_NSRC_OR:
+            return dst | (0x00FFFFFF & (src ^ 0x00FFFFFF));
+
+        case GUAC_TRANSFER_BINARY_NSRC_NOR:
+            return (dst | (0x00FFFFFF & (src ^ 0x00FFFFFF))) ^ 0x00FFFFFF;
+
+    }
+
+    /* Unknown transfer functions leave the destination untouched */
+    return dst;
+
+}
+
+/**
+ * Scalar implementation of guac_common_pixel_is_opaque().
+ */
+static int guac_common_pixel_is_opaque_scalar(const uint32_t* row,
+        int width) {
+
+    for (int x = 0; x < width; x++) {
+        if ((row[x] & 0xFF000000) != 0xFF000000)
+            return 0;
+    }
+
+    return 1;
+
+}
+
+/**
+ * Scalar implementation of guac_common_pixel_put_row().
+ */
+static int guac_common_pixel_put_row_scalar(uint32_t* dst,
+        const uint32_t* src, int width, int opaque, int* first, int* last) {
+
+    int min_x = width;
+    int max_x = -1;
+
+    for (int x = 0; x < width; x++) {
+
+        uint32_t color;
+        uint32_t dst_color = dst[x];
+
+        /* Ignore alpha channel if opaque */
+        if (opaque)
+            color = src[x] | 0xFF000000;
+
+        /* Otherwise, perform alpha blending operation */
+        else
+            color = guac_common_pixel_argb_blend(dst_color, src[x]);
+
+        /* Store and record only changed pixels */
+        if (dst_color != color) {
+            if (x < min_x) min_x = x;
+            max_x = x;
+            dst[x] = color;
+        }
+
+    }
+
+    *first = min_x;
+    *last = max_x;
+    return max_x >= 0;
+
+}
+
+/**
+ * Scalar implementation of guac_common_pixel_fill_row().
+ */
+static int guac_common_pixel_fill_row_scalar(uint32_t* dst, uint32_t color,
+        int width, int* first, int* last) {
+
+    int min_x = width;
+    int max_x = -1;
+
+    for (int x = 0; x < width; x++) {
+        if (dst[x] != color) {
+            if (x < min_x) min_x = x;
+            max_x = x;
+            dst[x] = color;
+        }
+    }
+
+    *first = min_x;
+    *last = max_x;
+    return max_x >= 0;
+
+}
+
+/**
+ * Scalar implementation of guac_common_pixel_transfer_row().
+ */
+static int guac_common_pixel_transfer_row_scalar(guac_transfer_function op,
+        uint32_t* dst, const uint32_t* src, int width, int backwards,
+        int* first, int* last) {
+
+    int min_x = width;
+    int max_x = -1;
+
+    int step = backwards ? -1 : 1;
+    int x = backwards ? width - 1 : 0;
+
+    for (int i = 0; i < width; i++, x += step) {
+
+        uint32_t color = guac_common_pixel_transfer(op, src[x], dst[x]);
+
+        if (dst[x] != color) {
+            if (x < min_x) min_x = x;
+            if (x > max_x) max_x = x;
+            dst[x] = color;
+        }
+
+    }
+
+    *first = min_x;
+    *last = max_x;
+    return max_x >= 0;
+
+}
+
+/**
+ * The scalar (reference) implementations of all row operations.
+ */
+static const guac_common_pixel_kernels guac_common_pixel_kernels_scalar = {
+    .is_opaque    = guac_common_pixel_is_opaque_scalar,
+    .put_row      = guac_common_pixel_put_row_scalar,
+    .fill_row     = guac_common_pixel_fill_row_scalar,
+    .transfer_row = guac_common_pixel_transfer_row_scalar
+};
+
+#ifdef HAVE_X86_SIMD
+
+/**
+ * Updates the given range of changed pixels to include all pixels flagged
+ * within the given bit mask, where bit N of the mask corresponds to the pixel
+ * at the given index plus N.
+ *
+ * @param index
+ *     The index of the pixel corresponding to the lowest bit of the mask.
+ *
+ * @param mask
+ *     A bit mask of changed pixels.
+ *
+ * @param min_x
+ *     Pointer to the index of the first changed pixel, which will be updated
+ *     if necessary.
+ *
+ * @param max_x
+ *     Pointer to the index of the last changed pixel, which will be updated
+ *     if necessary.
+ */
+static inline void guac_common_pixel_mark(int index, unsigned int mask,
+        int* min_x, int* max_x) {
+
+    if (!mask)
+        return;
+
+    int first = index + __builtin_ctz(mask);
+    int last = index + 31 - __builtin_clz(mask);
+
+    if (first < *min_x) *min_x = first;
+    if (last > *max_x) *max_x = last;
+
+}
+
+/**
+ * Updates the given range of changed pixels to include the range produced by
+ * a scalar implementation for the pixels beginning at the given index.
+ *
+ * @param index
+ *     The index of the first pixel processed by the scalar implementation.
+ *
+ * @param changed
+ *     The value returned by the scalar implementation.
+ *
+ * @param first
+ *     The first changed pixel, as reported by the scalar implementation.
+ *
+ * @param last
+ *     The last changed pixel, as reported by the scalar implementation.
+ *
+ * @param min_x
+ *     Pointer to the index of the first changed pixel, which will be updated
+ *     if necessary.
+ *
+ * @param max_x
+ *     Pointer to the index of the last changed pixel, which will be updated
+ *     if necessary.
+ */
+static inline void guac_common_pixel_mark_range(int index, int changed,
+        int first, int last, int* min_x, int* max_x) {
+
+    if (!changed)
+        return;
+
+    if (index + first < *min_x) *min_x = index + first;
+    if (index + last > *max_x) *max_x = index + last;
+
+}
+
+/**
+ * SSE2 implementation of guac_common_pixel_transfer() for four pixels.
+ */
+__attribute__((target("sse2")))
+static inline __m128i guac_common_pixel_transfer_sse2(
+        guac_transfer_function op, __m128i src, __m128i dst) {
+
+    const __m128i alpha = _mm_set1_epi32((int) 0xFF000000);
+    const __m128i rgb = _mm_set1_epi32(0x00FFFFFF);
+
+    switch (op) {
+
+        case GUAC_TRANSFER_BINARY_BLACK:
+            return alpha;
+
+        case GUAC_TRANSFER_BINARY_WHITE:
+            return _mm_set1_epi32(-1);
+
+        case GUAC_TRANSFER_BINARY_SRC:
+            return src;
+
+        case GUAC_TRANSFER_BINARY_DEST:
+            return dst;
+
+        case GUAC_TRANSFER_BINARY_NSRC:
+            return _mm_xor_si128(src, rgb);
+
+        case GUAC_TRANSFER_BINARY_NDEST:
+            return _mm_xor_si128(dst, rgb);
+
+        case GUAC_TRANSFER_BINARY_AND:
+            return _mm_and_si128(dst, _mm_or_si128(alpha, src));
+
+        case GUAC_TRANSFER_BINARY_NAND:
+            return _mm_xor_si128(rgb,
+                    _mm_and_si128(dst, _mm_or_si128(alpha, src)));
+
+        case GUAC_TRANSFER_BINARY_OR:
+            return _mm_or_si128(dst, _mm_and_si128(rgb, src));
+
+        case GUAC_TRANSFER_BINARY_NOR:
+            return _mm_xor_si128(rgb,
+                    _mm_or_si128(dst, _mm_and_si128(rgb, src)));
+
+        case GUAC_TRANSFER_BINARY_XOR:
+            return _mm_xor_si128(dst, _mm_and_si128(rgb, src));
+
+        case GUAC_TRANSFER_BINARY_XNOR:
+            return _mm_xor_si128(rgb,
+                    _mm_xor_si128(dst, _mm_and_si128(rgb, src)));
+
+        case GUAC_TRANSFER_BINARY_NSRC_AND:
+            return _mm_and_si128(dst,
+                    _mm_or_si128(alpha, _mm_xor_si128(src, rgb)));
+
+        case GUAC_TRANSFER_BINARY_NSRC_NAND:
+            return _mm_xor_si128(rgb, _mm_and_si128(dst,
+                        _mm_or_si128(alpha, _mm_xor_si128(src, rgb))));
+
+        case GUAC_TRANSFER_BINARY_NSRC_OR:
+            return _mm_or_si128(dst, _mm_andnot_si128(src, rgb));
+
+        case GUAC_TRANSFER_BINARY_NSRC_NOR:
+            return _mm_xor_si128(rgb,
+                    _mm_or_si128(dst, _mm_andnot_si128(src, rgb)));
+
+    }
+
+    return dst;
+
+}
+
+/**
+ * SSE2 implementation of guac_common_pixel_argb_blend() for four pixels.
+ */
+__attribute__((target("sse2")))
+static inline __m128i guac_common_pixel_blend_sse2(__m128i dst, __m128i src) {
+
+    const __m128i zero = _mm_setzero_si128();
+    const __m128i max = _mm_set1_epi16(0xFF);
+
+    /* Widen components to 16 bits, two pixels per register */
+    __m128i src_lo = _mm_unpacklo_epi8(src, zero);
+    __m128i src_hi = _mm_unpackhi_epi8(src, zero);
+    __m128i dst_lo = _mm_unpacklo_epi8(dst, zero);
+    __m128i dst_hi = _mm_unpackhi_epi8(dst, zero);
+
+    /* Broadcast (0xFF - alpha) of each source pixel across its components */
+    __m128i inv_lo = _mm_sub_epi16(max, _mm_shufflehi_epi16(
+                _mm_shufflelo_epi16(src_lo, 0xFF), 0xFF));
+    __m128i inv_hi = _mm_sub_epi16(max, _mm_shufflehi_epi16(
+                _mm_shufflelo_epi16(src_hi, 0xFF), 0xFF));
+
+    /* src + dst * (0xFF - alpha), saturating at 0xFF */
+    __m128i sum_lo = _mm_adds_epu16(src_lo, _mm_mullo_epi16(dst_lo, inv_lo));
+    __m128i sum_hi = _mm_adds_epu16(src_hi, _mm_mullo_epi16(dst_hi, inv_hi));
+    sum_lo = _mm_sub_epi16(sum_lo, _mm_subs_epu16(sum_lo, max));
+    sum_hi = _mm_sub_epi16(sum_hi, _mm_subs_epu16(sum_hi, max));
+    __m128i blended = _mm_packus_epi16(sum_lo, sum_hi);
+
+    /* Source wins where source is opaque or destination is transparent */
+    __m128i src_alpha = _mm_srli_epi32(src, 24);
+    __m128i dst_alpha = _mm_srli_epi32(dst, 24);
+    __m128i use_src = _mm_or_si128(
+            _mm_cmpeq_epi32(src_alpha, _mm_set1_epi32(0xFF)),
+            _mm_cmpeq_epi32(dst_alpha, zero));
+
+    /* Destination wins where source is transparent (and source didn't win) */
+    __m128i use_dst = _mm_andnot_si128(use_src,
+            _mm_cmpeq_epi32(src_alpha, zero));
+
+    blended = _mm_or_si128(_mm_and_si128(use_src, src),
+            _mm_andnot_si128(use_src, blended));
+
+    return _mm_or_si128(_mm_and_si128(use_dst, dst),
+            _mm_andnot_si128(use_dst, blended));
+
+}
+
+/**
+ * Returns a bit mask of the 32-bit lanes which differ between the two given
+ * registers.
+ */
+__attribute__((target("sse2")))
+static inline unsigned int guac_common_pixel_diff_sse2(__m128i a, __m128i b) {
+    return ~_mm_movemask_ps(_mm_castsi128_ps(_mm_cmpeq_epi32(a, b))) & 0xF;
+}
+
+/**
+ * SSE2 implementation of guac_common_pixel_is_opaque().
+ */
+__attribute__((target("sse2")))
+static int guac_common_pixel_is_opaque_sse2(const uint32_t* row, int width) {
+
+    const __m128i alpha = _mm_set1_epi32((int) 0xFF000000);
+
+    int x = 0;
+    for (; x + 4 <= width; x += 4) {
+        __m128i pixels = _mm_loadu_si128((const __m128i*) (row + x));
+        if (guac_common_pixel_diff_sse2(_mm_and_si128(pixels, alpha), alpha))
+            return 0;
+    }
+
+    return guac_common_pixel_is_opaque_scalar(row + x, width - x);
+
+}
+
+/**
+ * SSE2 implementation of guac_common_pixel_put_row().
+ */
+__attribute__((target("sse2")))
+static int guac_common_pixel_put_row_sse2(uint32_t* dst, const uint32_t* src,
+        int width, int opaque, int* first, int* last) {
+
+    const __m128i alpha = _mm_set1_epi32((int) 0xFF000000);
+
+    int min_x = width;
+    int max_x = -1;
+
+    int x = 0;
+    for (; x + 4 <= width; x += 4) {
+
+        __m128i src_pixels = _mm_loadu_si128((const __m128i*) (src + x));
+        __m128i dst_pixels = _mm_loadu_si128((const __m128i*) (dst + x));
+
+        __m128i color = opaque
+            ? _mm_or_si128(src_pixels, alpha)
+            : guac_common_pixel_blend_sse2(dst_pixels, src_pixels);
+
+        unsigned int changed = guac_common_pixel_diff_sse2(color, dst_pixels);
+        if (changed) {
+            guac_common_pixel_mark(x, changed, &min_x, &max_x);
+            _mm_storeu_si128((__m128i*) (dst + x), color);
+        }
+
+    }
+
+    int tail_first, tail_last;
+    int tail_changed = guac_common_pixel_put_row_scalar(dst + x, src + x,
+            width - x, opaque, &tail_first, &tail_last);
+    guac_common_pixel_mark_range(x, tail_changed, tail_first, tail_last,
+            &min_x, &max_x);
+
+    *first = min_x;
+    *last = max_x;
+    return max_x >= 0;
+
+}
+
+/**
+ * SSE2 implementation of guac_common_pixel_fill_row().
+ */
+__attribute__((target("sse2")))
+static int guac_common_pixel_fill_row_sse2(uint32_t* dst, uint32_t color,
+        int width, int* first, int* last) {
+
+    const __m128i fill = _mm_set1_epi32((int) color);
+
+    int min_x = width;
+    int max_x = -1;
+
+    int x = 0;
+    for (; x + 4 <= width; x += 4) {
+
+        __m128i dst_pixels = _mm_loadu_si128((const __m128i*) (dst + x));
+
+        unsigned int changed = guac_common_pixel_diff_sse2(fill, dst_pixels);
+        if (changed) {
+            guac_common_pixel_mark(x, changed, &min_x, &max_x);
+            _mm_storeu_si128((__m128i*) (dst + x), fill);
+        }
+
+    }
+
+    int tail_first, tail_last;
+    int tail_changed = guac_common_pixel_fill_row_scalar(dst + x, color,
+            width - x, &tail_first, &tail_last);
+    guac_common_pixel_mark_range(x, tail_changed, tail_first, tail_last,
+            &min_x, &max_x);
+
+    *first = min_x;
+    *last = max_x;
+    return max_x >= 0;
+
+}
+
+/**
+ * SSE2 implementation of guac_common_pixel_transfer_row().
+ */
+__attribute__((target("sse2")))
+static int guac_common_pixel_transfer_row_sse2(guac_transfer_function op,
+        uint32_t* dst, const uint32_t* src, int width, int backwards,
+        int* first, int* last) {
+
+    int min_x = width;
+    int max_x = -1;
+
+    /* Pixels which are not part of a full block of four are handled by the
+     * scalar implementation, before or after the blocks depending on
+     * direction */
+    int blocks = width / 4 * 4;
+    int tail = width - blocks;
+    int start = backwards ? tail : 0;
+
+    int tail_first, tail_last, tail_changed;
+
+    if (!backwards) {
+        for (int x = start; x < start + blocks; x += 4) {
+
+            __m128i src_pixels = _mm_loadu_si128((const __m128i*) (src + x));
+            __m128i dst_pixels = _mm_loadu_si128((const __m128i*) (dst + x));
+            __m128i color = guac_common_pixel_transfer_sse2(op, src_pixels,
+                    dst_pixels);
+
+            unsigned int changed = guac_common_pixel_diff_sse2(color, dst_pixels);
+            if (changed) {
+                guac_common_pixel_mark(x, changed, &min_x, &max_x);
+                _mm_storeu_si128((__m128i*) (dst + x), color);
+            }
+
+        }
+
+        tail_changed = guac_common_pixel_transfer_row_scalar(op, dst + blocks,
+                src + blocks, tail, 0, &tail_first, &tail_last);
+        guac_common_pixel_mark_range(blocks, tail_changed, tail_first,
+                tail_last, &min_x, &max_x);
+    }
+
+    else {
+        for (int x = start + blocks - 4; x >= start; x -= 4) {
+
+            __m128i src_pixels = _mm_loadu_si128((const __m128i*) (src + x));
+            __m128i dst_pixels = _mm_loadu_si128((const __m128i*) (dst + x));
+            __m128i color = guac_common_pixel_transfer_sse2(op, src_pixels,
+                    dst_pixels);
+
+            unsigned int changed = guac_common_pixel_diff_sse2(color, dst_pixels);
+            if (changed) {
+                guac_common_pixel_mark(x, changed, &min_x, &max_x);
+                _mm_storeu_si128((__m128i*) (dst + x), color);
+            }
+
+        }
+
+        tail_changed = guac_common_pixel_transfer_row_scalar(op, dst, src,
+                tail, 1, &tail_first, &tail_last);
+        guac_common_pixel_mark_range(0, tail_changed, tail_first, tail_last,
+                &min_x, &max_x);
+    }
+
+    *first = min_x;
+    *last = max_x;
+    return max_x >= 0;
+
+}
+
+/**
+ * The SSE2 implementations of all row operations.
+ */
+static const guac_common_pixel_kernels guac_common_pixel_kernels_sse2 = {
+    .is_opaque    = guac_common_pixel_is_opaque_sse2,
+    .put_row      = guac_common_pixel_put_row_sse2,
+    .fill_row     = guac_common_pixel_fill_row_sse2,
+    .transfer_row = guac_common_pixel_transfer_row_sse2
+};
+
+/**
+ * AVX2 implementation of guac_common_pixel_transfer() for eight pixels.
+ */
+__attribute__((target("avx2")))
+static inline __m256i guac_common_pixel_transfer_avx2(
+        guac_transfer_function op, __m256i src, __m256i dst) {
+
+    const __m256i alpha = _mm256_set1_epi32((int) 0xFF000000);
+    const __m256i rgb = _mm256_set1_epi32(0x00FFFFFF);
+
+    switch (op) {
+
+        case GUAC_TRANSFER_BINARY_BLACK:
+            return alpha;
+
+        case GUAC_TRANSFER_BINARY_WHITE:
+            return _mm256_set1_epi32(-1);
+
+        case GUAC_TRANSFER_BINARY_SRC:
+            return src;
+
+        case GUAC_TRANSFER_BINARY_DEST:
+            return dst;
+
+        case GUAC_TRANSFER_BINARY_NSRC:
+            return _mm256_xor_si256(src, rgb);
+
+        case GUAC_TRANSFER_BINARY_NDEST:
+            return _mm256_xor_si256(dst, rgb);
+
+        case GUAC_TRANSFER_BINARY_AND:
+            return _mm256_and_si256(dst, _mm256_or_si256(alpha, src));
+
+        case GUAC_TRANSFER_BINARY_NAND:
+            return _mm256_xor_si256(rgb,
+                    _mm256_and_si256(dst, _mm256_or_si256(alpha, src)));
+
+        case GUAC_TRANSFER_BINARY_OR:
+            return _mm256_or_si256(dst, _mm256_and_si256(rgb, src));
+
+        case GUAC_TRANSFER_BINARY_NOR:
+            return _mm256_xor_si256(rgb,
+                    _mm256_or_si256(dst, _mm256_and_si256(rgb, src)));
+
+        case GUAC_TRANSFER_BINARY_XOR:
+            return _mm256_xor_si256(dst, _mm256_and_si256(rgb, src));
+
+        case GUAC_TRANSFER_BINARY_XNOR:
+            return _mm256_xor_si256(rgb,
+                    _mm256_xor_si256(dst, _mm256_and_si256(rgb, src)));
+
+        case GUAC_TRANSFER_BINARY_NSRC_AND:
+            return _mm256_and_si256(dst,
+                    _mm256_or_si256(alpha, _mm256_xor_si256(src, rgb)));
+
+        case GUAC_TRANSFER_BINARY_NSRC_NAND:
+            return _mm256_xor_si256(rgb, _mm256_and_si256(dst,
+                        _mm256_or_si256(alpha, _mm256_xor_si256(src, rgb))));
+
+        case GUAC_TRANSFER_BINARY_NSRC_OR:
+            return _mm256_or_si256(dst, _mm256_andnot_si256(src, rgb));
+
+        case GUAC_TRANSFER_BINARY_NSRC_NOR:
+            return _mm256_xor_si256(rgb,
+                    _mm256_or_si256(dst, _mm256_andnot_si256(src, rgb)));
+
+    }
+
+    return dst;
+
+}
+
+/**
+ * AVX2 implementation of guac_common_pixel_argb_blend() for eight pixels.
+ */
+__attribute__((target("avx2")))
+static inline __m256i guac_common_pixel_blend_avx2(__m256i dst, __m256i src) {
+
+    const __m256i zero = _mm256_setzero_si256();
+    const __m256i max = _mm256_set1_epi16(0xFF);
+
+    /* Widen components to 16 bits, two pixels per 128-bit lane */
+    __m256i src_lo = _mm256_unpacklo_epi8(src, zero);
+    __m256i src_hi = _mm256_unpackhi_epi8(src, zero);
+    __m256i dst_lo = _mm256_unpacklo_epi8(dst, zero);
+    __m256i dst_hi = _mm256_unpackhi_epi8(dst, zero);
+
+    /* Broadcast (0xFF - alpha) of each source pixel across its components */
+    __m256i inv_lo = _mm256_sub_epi16(max, _mm256_shufflehi_epi16(
+                _mm256_shufflelo_epi16(src_lo, 0xFF), 0xFF));
+    __m256i inv_hi = _mm256_sub_epi16(max, _mm256_shufflehi_epi16(
+                _mm256_shufflelo_epi16(src_hi, 0xFF), 0xFF));
+
+    /* src + dst * (0xFF - alpha), saturating at 0xFF */
+    __m256i sum_lo = _mm256_adds_epu16(src_lo,
+            _mm256_mullo_epi16(dst_lo, inv_lo));
+    __m256i sum_hi = _mm256_adds_epu16(src_hi,
+            _mm256_mullo_epi16(dst_hi, inv_hi));
+    sum_lo = _mm256_min_epu16(sum_lo, max);
+    sum_hi = _mm256_min_epu16(sum_hi, max);
+    __m256i blended = _mm256_packus_epi16(sum_lo, sum_hi);
+
+    /* Source wins where source is opaque or destination is transparent */
+    __m256i src_alpha = _mm256_srli_epi32(src, 24);
+    __m256i dst_alpha = _mm256_srli_epi32(dst, 24);
+    __m256i use_src = _mm256_or_si256(
+            _mm256_cmpeq_epi32(src_alpha, _mm256_set1_epi32(0xFF)),
+            _mm256_cmpeq_epi32(dst_alpha, zero));
+
+    /* Destination wins where source is transparent (and source didn't win) */
+    __m256i use_dst = _mm256_andnot_si256(use_src,
+            _mm256_cmpeq_epi32(src_alpha, zero));
+
+    blended = _mm256_blendv_epi8(blended, src, use_src);
+    return _mm256_blendv_epi8(blended, dst, use_dst);
+
+}
+
+/**
+ * Returns a bit mask of the 32-bit lanes which differ between the two given
+ * registers.
+ */
+__attribute__((target("avx2")))
+static inline unsigned int guac_common_pixel_diff_avx2(__m256i a, __m256i b) {
+    return ~_mm256_movemask_ps(_mm256_castsi256_ps(
+                _mm256_cmpeq_epi32(a, b))) & 0xFF;
+}
+
+/**
+ * AVX2 implementation of guac_common_pixel_is_opaque().
+ */
+__attribute__((target("avx2")))
+static int guac_common_pixel_is_opaque_avx2(const uint32_t* row, int width) {
+
+    const __m256i alpha = _mm256_set1_epi32((int) 0xFF000000);
+
+    int x = 0;
+    for (; x + 8 <= width; x += 8) {
+        __m256i pixels = _mm256_loadu_si256((const __m256i*) (row + x));
+        if (guac_common_pixel_diff_avx2(_mm256_and_si256(pixels, alpha), alpha))
+            return 0;
+    }
+
+    return guac_common_pixel_is_opaque_sse2(row + x, width - x);
+
+}
+
+/**
+ * AVX2 implementation of guac_common_pixel_put_row().
+ */
+__attribute__((target("avx2")))
+static int guac_common_pixel_put_row_avx2(uint32_t* dst, const uint32_t* src,
+        int width, int opaque, int* first, int* last) {
+
+    const __m256i alpha = _mm256_set1_epi32((int) 0xFF000000);
+
+    int min_x = width;
+    int max_x = -1;
+
+    int x = 0;
+    for (; x + 8 <= width; x += 8) {
+
+        __m256i src_pixels = _mm256_loadu_si256((const __m256i*) (src + x));
+        __m256i dst_pixels = _mm256_loadu_si256((const __m256i*) (dst + x));
+
+        __m256i color = opaque
+            ? _mm256_or_si256(src_pixels, alpha)
+            : guac_common_pixel_blend_avx2(dst_pixels, src_pixels);
+
+        unsigned int changed = guac_common_pixel_diff_avx2(color, dst_pixels);
+        if (changed) {
+            guac_common_pixel_mark(x, changed, &min_x, &max_x);
+            _mm256_storeu_si256((__m256i*) (dst + x), color);
+        }
+
+    }
+
+    int tail_first, tail_last;
+    int tail_changed = guac_common_pixel_put_row_sse2(dst + x, src + x,
+            width - x, opaque, &tail_first, &tail_last);
+    guac_common_pixel_mark_range(x, tail_changed, tail_first, tail_last,
+            &min_x, &max_x);
+
+    *first = min_x;
+    *last = max_x;
+    return max_x >= 0;
+
+}
+
+/**
+ * AVX2 implementation of guac_common_pixel_fill_row().
+ */
+__attribute__((target("avx2")))
+static int guac_common_pixel_fill_row_avx2(uint32_t* dst, uint32_t color,
+        int width, int* first, int* last) {
+
+    const __m256i fill = _mm256_set1_epi32((int) color);
+
+    int min_x = width;
+    int max_x = -1;
+
+    int x = 0;
+    for (; x + 8 <= width; x += 8) {
+
+        __m256i dst_pixels = _mm256_loadu_si256((const __m256i*) (dst + x));
+
+        unsigned int changed = guac_common_pixel_diff_avx2(fill, dst_pixels);
+        if (changed) {
+            guac_common_pixel_mark(x, changed, &min_x, &max_x);
+            _mm256_storeu_si256((__m256i*) (dst + x), fill);
+        }
+
+    }
+
+    int tail_first, tail_last;
+    int tail_changed = guac_common_pixel_fill_row_sse2(dst + x, color,
+            width - x, &tail_first, &tail_last);
+    guac_common_pixel_mark_range(x, tail_changed, tail_first, tail_last,
+            &min_x, &max_x);
+
+    *first = min_x;
+    *last = max_x;
+    return max_x >= 0;
+
+}
+
+/**
+ * AVX2 implementation of guac_common_pixel_transfer_row().
+ */
+__attribute__((target("avx2")))
+static int guac_common_pixel_transfer_row_avx2(guac_transfer_function op,
+        uint32_t* dst, const uint32_t* src, int width, int backwards,
+        int* first, int* last) {
+
+    int min_x = width;
+    int max_x = -1;
+
+    /* Pixels which are not part of a full block of eight are handled by the
+     * SSE2 implementation, before or after the blocks depending on
+     * direction */
+    int blocks = width / 8 * 8;
+    int tail = width - blocks;
+    int start = backwards ? tail : 0;
+
+    int tail_first, tail_last, tail_changed;
+
+    if (!backwards) {
+        for (int x = start; x < start + blocks; x += 8) {
+
+            __m256i src_pixels = _mm256_loadu_si256((const __m256i*) (src + x));
+            __m256i dst_pixels = _mm256_loadu_si256((const __m256i*) (dst + x));
+            __m256i color = guac_common_pixel_transfer_avx2(op, src_pixels,
+                    dst_pixels);
+
+            unsigned int changed = guac_common_pixel_diff_avx2(color, dst_pixels);
+            if (changed) {
+                guac_common_pixel_mark(x, changed, &min_x, &max_x);
+                _mm256_storeu_si256((__m256i*) (dst + x), color);
+            }
+
+        }
+
+        tail_changed = guac_common_pixel_transfer_row_sse2(op, dst + blocks,
+                src + blocks, tail, 0, &tail_first, &tail_last);
+        guac_common_pixel_mark_range(blocks, tail_changed, tail_first,
+                tail_last, &min_x, &max_x);
+    }
+
+    else {
+        for (int x = start + blocks - 8; x >= start; x -= 8) {
+
+            __m256i src_pixels = _mm256_loadu_si256((const __m256i*) (src + x));
+            __m256i dst_pixels = _mm256_loadu_si256((const __m256i*) (dst + x));
+            __m256i color = guac_common_pixel_transfer_avx2(op, src_pixels,
+                    dst_pixels);
+
+            unsigned int changed = guac_common_pixel_diff_avx2(color, dst_pixels);
+            if (changed) {
+                guac_common_pixel_mark(x, changed, &min_x, &max_x);
+                _mm256_storeu_si256((__m256i*) (dst + x), color);
+            }
+
+        }
+
+        tail_changed = guac_common_pixel_transfer_row_sse2(op, dst, src,
+                tail, 1, &tail_first, &tail_last);
+        guac_common_pixel_mark_range(0, tail_changed, tail_first, tail_last,
+                &min_x, &max_x);
+    }
+
+    *first = min_x;
+    *last = max_x;
+    return max_x >= 0;
+
+}
+
+/**
+ * The AVX2 implementations of all row operations.
+ */
+static const guac_common_pixel_kernels guac_common_pixel_kernels_avx2 = {
+    .is_opaque    = guac_common_pixel_is_opaque_avx2,
+    .put_row      = guac_common_pixel_put_row_avx2,
+    .fill_row     = guac_common_pixel_fill_row_avx2,
+    .transfer_row = guac_common_pixel_transfer_row_avx2
+};
+
+#endif
+
+/**
+ * The implementations of all row operations currently in use.
+ */
+static const guac_common_pixel_kernels* guac_common_pixel_kernels_current =
+    &guac_common_pixel_kernels_scalar;
+
+/**
+ * Guards the one-time selection of the fastest available implementation.
+ */
+static pthread_once_t guac_common_pixel_kernels_init = PTHREAD_ONCE_INIT;
+
+/**
+ * Selects the fastest implementation of all row operations supported by the
+ * current CPU. This function is invoked exactly once, via pthread_once().
+ */
+static void guac_common_pixel_select_kernels() {
+
+#ifdef HAVE_X86_SIMD
+    __builtin_cpu_init();
+
+    if (__builtin_cpu_supports("avx2"))
+        guac_common_pixel_kernels_current = &guac_common_pixel_kernels_avx2;
+
+    else if (__builtin_cpu_supports("sse2"))
+        guac_common_pixel_kernels_current = &guac_common_pixel_kernels_sse2;
+#endif
+
+}
+
+/**
+ * Returns the implementations of all row operations which should be used,
+ * selecting the fastest supported implementations if not yet selected.
+ *
+ * @return
+ *     The implementations of all row operations which should be used.
+ */
+static const guac_common_pixel_kernels* guac_common_pixel_get_kernels() {
+    pthread_once(&guac_common_pixel_kernels_init,
+            guac_common_pixel_select_kernels);
+    return guac_common_pixel_kernels_current;
+}
+
+int guac_common_pixel_set_implementation(
+        guac_common_pixel_implementation implementation) {
+
+    /* Ensure automatic selection cannot later override this choice */
+    guac_common_pixel_get_kernels();
+
+    switch (implementation) {
+
+        case GUAC_COMMON_PIXEL_SCALAR:
+            guac_common_pixel_kernels_current = &guac_common_pixel_kernels_scalar;
+            return 0;
+
+#ifdef HAVE_X86_SIMD
+        case GUAC_COMMON_PIXEL_SSE2:
+            if (!__builtin_cpu_supports("sse2"))
+                return 1;
+            guac_common_pixel_kernels_current = &guac_common_pixel_kernels_sse2;
+            return 0;
+
+        case GUAC_COMMON_PIXEL_AVX2:
+            if (!__builtin_cpu_supports("avx2"))
+                return 1;
+            guac_common_pixel_kernels_current = &guac_common_pixel_kernels_avx2;
+            return 0;
+#endif
+
+        default:
+            return 1;
+
+    }
+
+}
+
+int guac_common_pixel_is_opaque(const uint32_t* row, int width) {
+    return guac_common_pixel_get_kernels()->is_opaque(row, width);
+}
+
+int guac_common_pixel_put_row(uint32_t* dst, const uint32_t* src, int width,
+        int opaque, int* first, int* last) {
+    return guac_common_pixel_get_kernels()->put_row(dst, src, width, opaque,
+            first, last);
+}
+
+int guac_common_pixel_fill_row(uint32_t* dst, uint32_t color, int width,
+        int* first, int* last) {
+    return guac_common_pixel_get_kernels()->fill_row(dst, color, width,
+            first, last);
+}
+
+int guac_common_pixel_transfer_row(guac_transfer_function op, uint32_t* dst,
+        const uint32_t* src, int width, int backwards, int* first, int* last) {
+    return guac_common_pixel_get_kernels()->transfer_row(op, dst, src, width,
+            backwards, first, last);
+}
@@ -0,0 +1,704 @@
+/*
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ * KIND, either express or implied.  See the License for the
+ * specific language governing permissions and limitations
+ * under the License.
+ */
+
+#include "config.h"
+#include "common/rect.h"
+#include "common/region.h"
+
+#include <guacamole/mem.h>
+
+#include <string.h>
+
+/**
+ * The number of bands or spans to allocate space for when a region or band
+ * first requires storage.
+ */
+#define GUAC_COMMON_REGION_INITIAL_CAPACITY 16
+
+guac_common_region* guac_common_region_alloc() {
+    return guac_mem_zalloc(sizeof(guac_common_region));
+}
+
+void guac_common_region_free(guac_common_region* region) {
+
+    /* Free span storage of all bands, including unused bands */
+    for (int i = 0; i < region->band_capacity; i++)
+        guac_mem_free(region->bands[i].spans);
+
+    guac_mem_free(region->bands);
+    guac_mem_free(region);
+
+}
+
+void guac_common_region_clear(guac_common_region* region) {
+    region->band_count = 0;
+}
+
+int guac_common_region_is_empty(const guac_common_region* region) {
+    return region->band_count == 0;
+}
+
+/**
+ * Ensures the given band can store at least the given number of spans,
+ * reallocating its span storage if necessary.
+ *
+ * @param band
+ *     The band whose span storage should be checked.
+ *
+ * @param count
+ *     The number of spans which must fit within the band.
+ */
+static void guac_common_region_band_reserve(guac_common_region_band* band,
+        int count) {
+
+    if (count <= band->span_capacity)
+        return;
+
+    int capacity = band->span_capacity;
+    if (capacity == 0)
+        capacity = GUAC_COMMON_REGION_INITIAL_CAPACITY;
+
+    while (capacity < count)
+        capacity *= 2;
+
+    band->spans = guac_mem_realloc_or_die(band->spans, capacity,
+            sizeof(guac_common_region_span));
+    band->span_capacity = capacity;
+
+}
+
+/**
+ * Returns the index of the first span within the given band which ends at or
+ * after the given X coordinate (touching the coordinate counts). If no such
+ * span exists, the number of spans within the band is returned.
+ *
+ * @param band
+ *     The band to search.
+ *
+ * @param x
+ *     The X coordinate to search for.
+ *
+ * @return
+ *     The index of the first span ending at or after the given coordinate.
+ */
+static int guac_common_region_band_search(const guac_common_region_band* band,
+        int x) {
+
+    int low = 0;
+    int high = band->span_count;
+
+    while (low < high) {
+        int mid = low + (high - low) / 2;
+        const guac_common_region_span* span = &band->spans[mid];
+        if (span->x + span->width < x)
+            low = mid + 1;
+        else
+            high = mid;
+    }
+
+    return low;
+
+}
+
+/**
+ * Returns whether the given band contains a span having exactly the given
+ * horizontal extents.
+ *
+ * @param band
+ *     The band to search.
+ *
+ * @param span
+ *     The span to search for.
+ *
+ * @return
+ *     Non-zero if an identical span is present within the band, zero
+ *     otherwise.
+ */
+static int guac_common_region_band_contains(
+        const guac_common_region_band* band,
+        const guac_common_region_span* span) {
+
+    int index = guac_common_region_band_search(band, span->x);
+    return index < band->span_count
+        && band->spans[index].x == span->x
+        && band->spans[index].width == span->width;
+
+}
+
+/**
+ * Adds the given horizontal extents to the given band, merging any spans
+ * which overlap or touch the new span.
+ *
+ * @param band
+ *     The band to modify.
+ *
+ * @param x
+ *     The X coordinate of the leftmost pixel to add.
+ *
+ * @param width
+ *     The number of pixels to add.
+ */
+static void guac_common_region_band_add(guac_common_region_band* band,
+        int x, int width) {
+
+    int left = x;
+    int right = x + width;
+
+    /* Find all spans which overlap or touch the new span */
+    int first = guac_common_region_band_search(band, left);
+    int last = first;
+    while (last < band->span_count && band->spans[last].x <= right) {
+
+        guac_common_region_span* span = &band->spans[last];
+
+        if (span->x < left)
+            left = span->x;
+
+        if (span->x + span->width > right)
+            right = span->x + span->width;
+
+        last++;
+
+    }
+
+    /* Insert entirely new span if nothing overlaps */
+    if (first == last) {
+        guac_common_region_band_reserve(band, band->span_count + 1);
+        memmove(&band->spans[first + 1], &band->spans[first],
+                (band->span_count - first) * sizeof(guac_common_region_span));
+        band->span_count++;
+    }
+
+    /* Otherwise, replace all overlapping spans with their union */
+    else if (last - first > 1) {
+        memmove(&band->spans[first + 1], &band->spans[last],
+                (band->span_count - last) * sizeof(guac_common_region_span));
+        band->span_count -= last - first - 1;
+    }
+
+    band->spans[first].x = left;
+    band->spans[first].width = right - left;
+
+}
+
+/**
+ * Returns the index of the first span within the given band which overlaps
+ * the given horizontal extents (touching does not count). If no such span
+ * exists, the index of the first span beyond those extents is returned.
+ *
+ * @param band
+ *     The band to search.
+ *
+ * @param x
+ *     The X coordinate of the leftmost pixel of the extents.
+ *
+ * @return
+ *     The index of the first span which may overlap the given extents.
+ */
+static int guac_common_region_band_search_overlap(
+        const guac_common_region_band* band, int x) {
+
+    int index = guac_common_region_band_search(band, x);
+
+    /* Spans which end exactly where the extents begin merely touch */
+    if (index < band->span_count
+            && band->spans[index].x + band->spans[index].width == x)
+        index++;
+
+    return index;
+
+}
+
+/**
+ * Returns whether any span within the given band overlaps the given
+ * horizontal extents.
+ *
+ * @param band
+ *     The band to search.
+ *
+ * @param x
+ *     The X coordinate of the leftmost pixel of the extents.
+ *
+ * @param width
+ *     The width of the extents, in pixels.
+ *
+ * @return
+ *     Non-zero if any span overlaps the given extents, zero otherwise.
+ */
+static int guac_common_region_band_intersects(
+        const guac_common_region_band* band, int x, int width) {
+
+    int index = guac_common_region_band_search_overlap(band, x);
+    return index < band->span_count && band->spans[index].x < x + width;
+
+}
+
+/**
+ * Removes the given horizontal extents from the given band, trimming or
+ * splitting any spans which partially overlap those extents.
+ *
+ * @param band
+ *     The band to modify.
+ *
+ * @param x
+ *     The X coordinate of the leftmost pixel to remove.
+ *
+ * @param width
+ *     The number of pixels to remove.
+ */
+static void guac_common_region_band_remove(guac_common_region_band* band,
+        int x, int width) {
+
+    int left = x;
+    int right = x + width;
+
+    /* Find all spans which overlap the removed extents */
+    int first = guac_common_region_band_search_overlap(band, left);
+    int last = first;
+    while (last < band->span_count && band->spans[last].x < right)
+        last++;
+
+    if (first == last)
+        return;
+
+    /* Keep any parts of the outermost spans lying outside the extents */
+    guac_common_region_span remaining[2];
+    int remaining_count = 0;
+
+    const guac_common_region_span* leftmost = &band->spans[first];
+    if (leftmost->x < left) {
+        remaining[remaining_count].x = leftmost->x;
+        remaining[remaining_count].width = left - leftmost->x;
+        remaining_count++;
+    }
+
+    const guac_common_region_span* rightmost = &band->spans[last - 1];
+    if (rightmost->x + rightmost->width > right) {
+        remaining[remaining_count].x = right;
+        remaining[remaining_count].width =
+            rightmost->x + rightmost->width - right;
+        remaining_count++;
+    }
+
+    /* Replace all overlapping spans with whatever remains of them */
+    int count = band->span_count - (last - first) + remaining_count;
+    guac_common_region_band_reserve(band, count);
+    memmove(&band->spans[first + remaining_count], &band->spans[last],
+            (band->span_count - last) * sizeof(guac_common_region_span));
+    memcpy(&band->spans[first], remaining,
+            remaining_count * sizeof(guac_common_region_span));
+
+    band->span_count = count;
+
+}
+
+/**
+ * Returns whether the given bands are vertically adjacent and contain
+ * identical spans, and thus may be coalesced into a single band.
+ *
+ * @param upper
+ *     The upper of the two bands.
+ *
+ * @param lower
+ *     The lower of the two bands.
+ *
+ * @return
+ *     Non-zero if the bands may be coalesced, zero otherwise.
+ */
+static int guac_common_region_bands_match(const guac_common_region_band* upper,
+        const guac_common_region_band* lower) {
+
+    return upper->y + upper->height == lower->y
+        && upper->span_count == lower->span_count
+        && memcmp(upper->spans, lower->spans,
+                upper->span_count * sizeof(guac_common_region_span)) == 0;
+
+}
+
+/**
+ * Inserts a new, empty band at the given index within the given region,
+ * shifting all following bands down by one. Span storage left behind by
+ * previously-removed bands is reused when available.
+ *
+ * @param region
+ *     The region to modify.
+ *
+ * @param index
+ *     The index at which the new band should be inserted.
+ *
+ * @param y
+ *     The Y coordinate of the topmost row of the new band.
+ *
+ * @param height
+ *     The height of the new band, in pixels.
+ *
+ * @return
+ *     The newly-inserted band.
+ */
+static guac_common_region_band* guac_common_region_insert_band(
+        guac_common_region* region, int index, int y, int height) {
+
+    /* Grow band storage if necessary, zeroing any newly-allocated bands */
+    if (region->band_count == region->band_capacity) {
+
+        int capacity = region->band_capacity * 2;
+        if (capacity == 0)
+            capacity = GUAC_COMMON_REGION_INITIAL_CAPACITY;
+
+        region->bands = guac_mem_realloc_or_die(region->bands, capacity,
+                sizeof(guac_common_region_band));
+
+        memset(&region->bands[region->band_capacity], 0,
+                (capacity - region->band_capacity)
+                    * sizeof(guac_common_region_band));
+
+        region->band_capacity = capacity;
+
+    }
+
+    /* Move unused band (and its storage) into position */
+    guac_common_region_band spare = region->bands[region->band_count];
+    memmove(&region->bands[index + 1], &region->bands[index],
+            (region->band_count - index) * sizeof(guac_common_region_band));
+    region->band_count++;
+
+    guac_common_region_band* band = &region->bands[index];
+    *band = spare;
+    band->y = y;
+    band->height = height;
+    band->span_count = 0;
+
+    return band;
+
+}
+
+/**
+ * Removes the band at the given index from the given region, shifting all
+ * following bands up by one. The span storage of the removed band is retained
+ * for reuse.
+ *
+ * @param region
+ *     The region to modify.
+ *
+ * @param index
+ *     The index of the band to remove.
+ */
+static void guac_common_region_remove_band(guac_common_region* region,
+        int index) {
+
+    guac_common_region_band removed = region->bands[index];
+    memmove(&region->bands[index], &region->bands[index + 1],
+            (region->band_count - index - 1)
+                * sizeof(guac_common_region_band));
+
+    region->band_count--;
+    region->bands[region->band_count] = removed;
+
+}
+
+/**
+ * Splits the band at the given index into two bands at the given Y
+ * coordinate, which must lie strictly within that band. Both resulting bands
+ * contain the same spans as the original band.
+ *
+ * @param region
+ *     The region to modify.
+ *
+ * @param index
+ *     The index of the band to split.
+ *
+ * @param y
+ *     The Y coordinate of the topmost row of the lower of the two resulting
+ *     bands.
+ */
+static void guac_common_region_split_band(guac_common_region* region,
+        int index, int y) {
+
+    guac_common_region_band* upper = &region->bands[index];
+    int bottom = upper->y + upper->height;
+    upper->height = y - upper->y;
+
+    guac_common_region_band* lower = guac_common_region_insert_band(region,
+            index + 1, y, bottom - y);
+
+    /* Band storage may have moved during insertion */
+    upper = &region->bands[index];
+
+    guac_common_region_band_reserve(lower, upper->span_count);
+    memcpy(lower->spans, upper->spans,
+            upper->span_count * sizeof(guac_common_region_span));
+    lower->span_count = upper->span_count;
+
+}
+
+/**
+ * Returns the index of the first band within the given region which ends
+ * after the given Y coordinate. If no such band exists, the number of bands
+ * within the region is returned.
+ *
+ * @param region
+ *     The region to search.
+ *
+ * @param y
+ *     The Y coordinate to search for.
+ *
+ * @return
+ *     The index of the first band ending after the given coordinate.
+ */
+static int guac_common_region_search(const guac_common_region* region, int y) {
+
+    int low = 0;
+    int high = region->band_count;
+
+    while (low < high) {
+        int mid = low + (high - low) / 2;
+        const guac_common_region_band* band = &region->bands[mid];
+        if (band->y + band->height <= y)
+            low = mid + 1;
+        else
+            high = mid;
+    }
+
+    return low;
+
+}
+
+/**
+ * Coalesces all vertically-adjacent bands having identical spans within the
+ * given range of bands, including the bands immediately above and below
+ * that range.
+ *
+ * @param region
+ *     The region to modify.
+ *
+ * @param first
+ *     The index of the first band which may have changed.
+ *
+ * @param last
+ *     The index immediately following the last band which may have changed.
+ */
+static void guac_common_region_coalesce(guac_common_region* region,
+        int first, int last) {
+
+    if (first > 0)
+        first--;
+
+    for (int i = first; i < last && i + 1 < region->band_count;) {
+
+        guac_common_region_band* upper = &region->bands[i];
+        guac_common_region_band* lower = &region->bands[i + 1];
+
+        if (guac_common_region_bands_match(upper, lower)) {
+            upper->height += lower->height;
+            guac_common_region_remove_band(region, i + 1);
+            last--;
+        }
+        else
+            i++;
+
+    }
+
+}
+
+void guac_common_region_union_rect(guac_common_region* region,
+        const guac_common_rect* rect) {
+
+    /* Ignore empty rects */
+    if (rect->width <= 0 || rect->height <= 0)
+        return;
+
+    int top = rect->y;
+    int bottom = rect->y + rect->height;
+
+    int first = guac_common_region_search(region, top);
+    int index = first;
+    int current = top;
+
+    while (current < bottom) {
+
+        guac_common_region_band* band;
+
+        /* Add new band covering the remainder if no bands remain */
+        if (index == region->band_count
+                || region->bands[index].y >= bottom) {
+            band = guac_common_region_insert_band(region, index,
+                    current, bottom - current);
+        }
+
+        /* Add new band covering any gap before the next band */
+        else if (region->bands[index].y > current) {
+            band = guac_common_region_insert_band(region, index,
+                    current, region->bands[index].y - current);
+        }
+
+        /* Otherwise, trim existing band to fit within the rect */
+        else {
+
+            if (region->bands[index].y < current) {
+                guac_common_region_split_band(region, index, current);
+                index++;
+            }
+
+            band = &region->bands[index];
+            if (band->y + band->height > bottom) {
+                guac_common_region_split_band(region, index, bottom);
+                band = &region->bands[index];
+            }
+
+        }
+
+        guac_common_region_band_add(band, rect->x, rect->width);
+        current = band->y + band->height;
+        index++;
+
+    }
+
+    /* Coalesce any affected bands with their neighbors, including the
+     * unaffected bands immediately above and below */
+    guac_common_region_coalesce(region, first, index);
+
+}
+
+void guac_common_region_subtract_rect(guac_common_region* region,
+        const guac_common_rect* rect) {
+
+    /* Ignore empty rects */
+    if (rect->width <= 0 || rect->height <= 0)
+        return;
+
+    int top = rect->y;
+    int bottom = rect->y + rect->height;
+
+    int first = guac_common_region_search(region, top);
+    int index = first;
+
+    while (index < region->band_count && region->bands[index].y < bottom) {
+
+        /* Leave bands untouched if nothing would be removed */
+        if (!guac_common_region_band_intersects(&region->bands[index],
+                    rect->x, rect->width)) {
+            index++;
+            continue;
+        }
+
+        /* Trim band to fit within the rect */
+        if (region->bands[index].y < top) {
+            guac_common_region_split_band(region, index, top);
+            index++;
+        }
+
+        guac_common_region_band* band = &region->bands[index];
+        if (band->y + band->height > bottom) {
+            guac_common_region_split_band(region, index, bottom);
+            band = &region->bands[index];
+        }
+
+        guac_common_region_band_remove(band, rect->x, rect->width);
+
+        /* Bands must never be empty */
+        if (band->span_count == 0)
+            guac_common_region_remove_band(region, index);
+        else
+            index++;
+
+    }
+
+    /* Coalesce any affected bands with their neighbors */
+    guac_common_region_coalesce(region, first, index);
+
+}
+
+int guac_common_region_get_extents(const guac_common_region* region,
+        guac_common_rect* extents) {
+
+    if (region->band_count == 0)
+        return 0;
+
+    const guac_common_region_band* first = &region->bands[0];
+    const guac_common_region_band* last = &region->bands[region->band_count - 1];
+
+    int left = first->spans[0].x;
+    int right = left;
+
+    /* Only the first and last span of each band can affect the extents */
+    for (int i = 0; i < region->band_count; i++) {
+
+        const guac_common_region_band* band = &region->bands[i];
+        const guac_common_region_span* last_span =
+            &band->spans[band->span_count - 1];
+
+        if (band->spans[0].x < left)
+            left = band->spans[0].x;
+
+        if (last_span->x + last_span->width > right)
+            right = last_span->x + last_span->width;
+
+    }
+
+    guac_common_rect_init(extents, left, first->y, right - left,
+            last->y + last->height - first->y);
+
+    return 1;
+
+}
+
+void guac_common_region_foreach_rect(const guac_common_region* region,
+        guac_common_region_rect_callback* callback, void* data) {
+
+    for (int i = 0; i < region->band_count; i++) {
+
+        const guac_common_region_band* band = &region->bands[i];
+        const guac_common_region_band* previous = (i > 0) ? band - 1 : NULL;
+
+        /* Only consider the previous band if adjacent */
+        if (previous != NULL && previous->y + previous->height != band->y)
+            previous = NULL;
+
+        for (int j = 0; j < band->span_count; j++) {
+
+            const guac_common_region_span* span = &band->spans[j];
+
+            /* Skip spans already covered by a rect starting above */
+            if (previous != NULL
+                    && guac_common_region_band_contains(previous, span))
+                continue;
+
+            /* Extend rect downward through all adjacent bands containing an
+             * identical span */
+            int height = band->height;
+            for (int k = i + 1; k < region->band_count; k++) {
+
+                const guac_common_region_band* next = &region->bands[k];
+                if (next->y != band->y + height
+                        || !guac_common_region_band_contains(next, span))
+                    break;
+
+                height += next->height;
+
+            }
+
+            guac_common_rect rect;
+            guac_common_rect_init(&rect, span->x, band->y, span->width, height);
+            callback(&rect, data);
+
+        }
+
+    }
+
+}
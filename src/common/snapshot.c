@@ -0,0 +1,334 @@
+/*
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ * KIND, either express or implied.  See the License for the
+ * specific language governing permissions and limitations
+ * under the License.
+ */
+
+#include "config.h"
+#include "common/rect.h"
+#include "common/snapshot.h"
+
+#include <cairo/cairo.h>
+#include <guacamole/client.h>
+#include <guacamole/layer.h>
+#include <guacamole/mem.h>
+#include <guacamole/protocol.h>
+#include <guacamole/socket.h>
+#include <guacamole/stream.h>
+#include <guacamole/timestamp.h>
+
+#include <pthread.h>
+#include <stdint.h>
+#include <string.h>
+
+guac_common_snapshot* guac_common_snapshot_alloc(const unsigned char* buffer,
+        int stride, const guac_common_rect* rect) {
+
+    guac_common_snapshot* snapshot = guac_mem_zalloc(sizeof(guac_common_snapshot));
+    pthread_mutex_init(&snapshot->_lock, NULL);
+    pthread_cond_init(&snapshot->_encoded, NULL);
+    snapshot->_refcount = 1;
+
+    snapshot->rect = *rect;
+    snapshot->timestamp = guac_timestamp_current();
+
+    /* Copy pixels of requested area, noting whether any are transparent */
+    snapshot->stride = cairo_format_stride_for_width(CAIRO_FORMAT_ARGB32,
+            rect->width);
+    snapshot->buffer = guac_mem_alloc(rect->height, snapshot->stride);
+    snapshot->opaque = 1;
+
+    const unsigned char* src = buffer + rect->y * stride + rect->x * 4;
+    unsigned char* dst = snapshot->buffer;
+
+    for (int y = 0; y < rect->height; y++) {
+
+        memcpy(dst, src, rect->width * 4);
+
+        /* Check alpha only until the first non-opaque pixel is found */
+        if (snapshot->opaque) {
+            const uint32_t* pixel = (const uint32_t*) dst;
+            for (int x = 0; x < rect->width; x++) {
+                if ((*(pixel++) & 0xFF000000) != 0xFF000000) {
+                    snapshot->opaque = 0;
+                    break;
+                }
+            }
+        }
+
+        src += stride;
+        dst += snapshot->stride;
+
+    }
+
+    /* Split into horizontal bands of roughly equal size, such that each may
+     * be encoded independently */
+    int band_height = GUAC_COMMON_SNAPSHOT_BAND_PIXELS / rect->width;
+    if (band_height < 1)
+        band_height = 1;
+
+    snapshot->band_count = (rect->height + band_height - 1) / band_height;
+    snapshot->bands = guac_mem_zalloc(snapshot->band_count,
+            sizeof(guac_common_snapshot_band));
+
+    for (int i = 0; i < snapshot->band_count; i++) {
+
+        guac_common_snapshot_band* band = &snapshot->bands[i];
+        band->y = i * band_height;
+        band->height = band_height;
+
+        if (band->y + band->height > rect->height)
+            band->height = rect->height - band->y;
+
+    }
+
+    return snapshot;
+
+}
+
+guac_common_snapshot* guac_common_snapshot_retain(
+        guac_common_snapshot* snapshot) {
+
+    pthread_mutex_lock(&snapshot->_lock);
+    snapshot->_refcount++;
+    pthread_mutex_unlock(&snapshot->_lock);
+
+    return snapshot;
+
+}
+
+void guac_common_snapshot_release(guac_common_snapshot* snapshot) {
+
+    pthread_mutex_lock(&snapshot->_lock);
+    int remaining = --snapshot->_refcount;
+    pthread_mutex_unlock(&snapshot->_lock);
+
+    /* Free only once the final reference is released */
+    if (remaining > 0)
+        return;
+
+    for (int i = 0; i < snapshot->band_count; i++)
+        guac_mem_free(snapshot->bands[i].data);
+
+    pthread_cond_destroy(&snapshot->_encoded);
+    pthread_mutex_destroy(&snapshot->_lock);
+
+    guac_mem_free(snapshot->bands);
+    guac_mem_free(snapshot->buffer);
+    guac_mem_free(snapshot);
+
+}
+
+/**
+ * Cairo write function which appends the given PNG data to the data buffer
+ * of a guac_common_snapshot_band, growing that buffer as necessary.
+ *
+ * @param closure
+ *     The guac_common_snapshot_band receiving the PNG data.
+ *
+ * @param data
+ *     The PNG data to append.
+ *
+ * @param length
+ *     The number of bytes of PNG data to append.
+ *
+ * @return
+ *     CAIRO_STATUS_SUCCESS if the PNG data was appended, or
+ *     CAIRO_STATUS_NO_MEMORY if the data buffer could not be grown.
+ */
+static cairo_status_t guac_common_snapshot_write_png(void* closure,
+        const unsigned char* data, unsigned int length) {
+
+    guac_common_snapshot_band* band = (guac_common_snapshot_band*) closure;
+
+    /* Grow buffer geometrically to fit new data */
+    if (band->length + length > band->size) {
+
+        int size = band->size > 0 ? band->size : 4096;
+        while (size < band->length + length)
+            size *= 2;
+
+        /* Abort encoding if the buffer cannot be grown, leaving the
+         * existing buffer to be freed by the caller */
+        unsigned char* grown = guac_mem_realloc(band->data, size);
+        if (grown == NULL)
+            return CAIRO_STATUS_NO_MEMORY;
+
+        band->data = grown;
+        band->size = size;
+
+    }
+
+    memcpy(band->data + band->length, data, length);
+    band->length += length;
+
+    return CAIRO_STATUS_SUCCESS;
+
+}
+
+/**
+ * Encodes the given band of the given snapshot as PNG, storing the result
+ * within the band. If encoding fails, the band is left without data and will
+ * not be sent.
+ *
+ * @param snapshot
+ *     The snapshot containing the band.
+ *
+ * @param band
+ *     The band to encode.
+ */
+static void guac_common_snapshot_encode_band(guac_common_snapshot* snapshot,
+        guac_common_snapshot_band* band) {
+
+    /* Opaque snapshots need not waste space on an alpha channel */
+    cairo_format_t format = snapshot->opaque
+        ? CAIRO_FORMAT_RGB24 : CAIRO_FORMAT_ARGB32;
+
+    cairo_surface_t* surface = cairo_image_surface_create_for_data(
+            snapshot->buffer + band->y * snapshot->stride, format,
+            snapshot->rect.width, band->height, snapshot->stride);
+
+    if (cairo_surface_write_to_png_stream(surface,
+                guac_common_snapshot_write_png, band) != CAIRO_STATUS_SUCCESS) {
+        guac_mem_free(band->data);
+        band->length = 0;
+        band->size = 0;
+    }
+
+    cairo_surface_destroy(surface);
+
+}
+
+/**
+ * Repeatedly claims and encodes the next unencoded band of the given
+ * snapshot until no bands remain. This function is safe to run concurrently
+ * from multiple threads.
+ *
+ * @param data
+ *     The guac_common_snapshot to encode.
+ *
+ * @return
+ *     Always NULL.
+ */
+static void* guac_common_snapshot_encode_bands(void* data) {
+
+    guac_common_snapshot* snapshot = (guac_common_snapshot*) data;
+
+    for (;;) {
+
+        /* Claim next band, if any */
+        pthread_mutex_lock(&snapshot->_lock);
+        int index = snapshot->_next_band++;
+        pthread_mutex_unlock(&snapshot->_lock);
+
+        if (index >= snapshot->band_count)
+            break;
+
+        guac_common_snapshot_encode_band(snapshot, &snapshot->bands[index]);
+
+    }
+
+    return NULL;
+
+}
+
+/**
+ * Encodes all bands of the given snapshot, using up to
+ * GUAC_COMMON_SNAPSHOT_MAX_THREADS threads (including the current thread).
+ * This function must be invoked by only one thread at a time.
+ *
+ * @param snapshot
+ *     The snapshot to encode.
+ */
+static void guac_common_snapshot_encode(guac_common_snapshot* snapshot) {
+
+    pthread_t threads[GUAC_COMMON_SNAPSHOT_MAX_THREADS - 1];
+    int thread_count = 0;
+
+    /* Start helper threads only if there is more than one band to encode */
+    int wanted = snapshot->band_count - 1;
+    if (wanted > GUAC_COMMON_SNAPSHOT_MAX_THREADS - 1)
+        wanted = GUAC_COMMON_SNAPSHOT_MAX_THREADS - 1;
+
+    /* Failure to start a helper thread merely reduces parallelism */
+    while (thread_count < wanted && !pthread_create(&threads[thread_count],
+                NULL, guac_common_snapshot_encode_bands, snapshot))
+        thread_count++;
+
+    guac_common_snapshot_encode_bands(snapshot);
+
+    for (int i = 0; i < thread_count; i++)
+        pthread_join(threads[i], NULL);
+
+}
+
+void guac_common_snapshot_send(guac_common_snapshot* snapshot,
+        guac_client* client, guac_socket* socket, const guac_layer* layer) {
+
+    pthread_mutex_lock(&snapshot->_lock);
+
+    /* Wait for any in-progress encoding by another sender */
+    while (snapshot->_encoding)
+        pthread_cond_wait(&snapshot->_encoded, &snapshot->_lock);
+
+    /* Encode if no other sender has done so */
+    if (!snapshot->_encoded_complete) {
+
+        snapshot->_encoding = 1;
+        pthread_mutex_unlock(&snapshot->_lock);
+
+        guac_common_snapshot_encode(snapshot);
+
+        pthread_mutex_lock(&snapshot->_lock);
+        guac_mem_free(snapshot->buffer);
+        snapshot->_encoding = 0;
+        snapshot->_encoded_complete = 1;
+        pthread_cond_broadcast(&snapshot->_encoded);
+
+    }
+
+    pthread_mutex_unlock(&snapshot->_lock);
+
+    /* Encoded bands are never modified, and may be read without locking */
+    for (int i = 0; i < snapshot->band_count; i++) {
+
+        guac_common_snapshot_band* band = &snapshot->bands[i];
+        if (band->data == NULL)
+            continue;
+
+        int y = snapshot->rect.y + band->y;
+
+        /* Transparent pixels must replace, not blend with, existing content */
+        if (!snapshot->opaque) {
+            guac_protocol_send_rect(socket, layer, snapshot->rect.x, y,
+                    snapshot->rect.width, band->height);
+            guac_protocol_send_cfill(socket, GUAC_COMP_ROUT, layer,
+                    0x00, 0x00, 0x00, 0xFF);
+        }
+
+        guac_stream* stream = guac_client_alloc_stream(client);
+
+        guac_protocol_send_img(socket, stream, GUAC_COMP_OVER, layer,
+                "image/png", snapshot->rect.x, y);
+        guac_protocol_send_blobs(socket, stream, band->data, band->length);
+        guac_protocol_send_end(socket, stream);
+
+        guac_client_free_stream(client, stream);
+
+    }
+
+}
+
@@ -18,7 +18,10 @@
  */
 
 #include "config.h"
+#include "common/pixel.h"
 #include "common/rect.h"
+#include "common/region.h"
+#include "common/snapshot.h"
 #include "common/surface.h"
 
 #include <cairo/cairo.h>
@@ -104,12 +107,239 @@
  */
 #define GUAC_SURFACE_WEBP_BLOCK_SIZE 8
 
+/**
+ * If a rectangle being flushed contains only two colors, the rectangle will
+ * be sent as a solid fill of its most common color plus an image of the
+ * remaining pixels only if the bounding rectangle of those remaining pixels
+ * is no larger than 1/GUAC_SURFACE_FILL_SPLIT_FACTOR of the original area.
+ */
+#define GUAC_SURFACE_FILL_SPLIT_FACTOR 2
+
+/**
+ * The maximum number of distinct colors a rectangle may contain while still
+ * being considered synthetic content (text, UI elements, etc.) which should
+ * not be lossily compressed if it also contains dense edges.
+ */
+#define GUAC_SURFACE_SYNTHETIC_COLORS 64
+
+/**
+ * Rectangles which differ from their neighbors at least once every
+ * GUAC_SURFACE_SYNTHETIC_EDGE_FACTOR pixel comparisons are considered to have
+ * dense edges.
+ */
+#define GUAC_SURFACE_SYNTHETIC_EDGE_FACTOR 4
+
+/**
+ * The number of slots within the hash table used to count the distinct colors
+ * of a rectangle. This must be a power of two, and should be several times
+ * larger than GUAC_SURFACE_SYNTHETIC_COLORS to keep probe sequences short.
+ */
+#define GUAC_SURFACE_COLOR_TABLE_SIZE 256
+
+/**
+ * The framerate at or above which a heat map cell containing many colors is
+ * considered to contain video.
+ */
+#define GUAC_COMMON_SURFACE_VIDEO_FRAMERATE 10
+
+/**
+ * The minimum number of neighboring pixel comparisons a sample of a heat map
+ * cell must contain for that sample to affect the classification of the cell.
+ */
+#define GUAC_SURFACE_CLASSIFY_MIN_NEIGHBORS 64
+
+/**
+ * The weight given to the existing running averages of a heat map cell when
+ * a new sample is added, where each new sample has a weight of one.
+ */
+#define GUAC_SURFACE_CLASSIFY_HISTORY_WEIGHT 3
+
+/**
+ * The minimum number of heat map cells containing video which must be
+ * present within an area before that area is streamed as video.
+ */
+#define GUAC_SURFACE_VIDEO_MIN_CELLS 4
+
+/**
+ * The number of milliseconds since its last update after which a heat map
+ * cell is no longer considered to be actively changing.
+ */
+#define GUAC_SURFACE_VIDEO_IDLE_TIMEOUT 1000
+
+/**
+ * The minimum number of milliseconds between each reevaluation of whether a
+ * surface should be streamed as video.
+ */
+#define GUAC_SURFACE_VIDEO_EVALUATE_INTERVAL 500
+
+/**
+ * The maximum number of pixels which may be refreshed losslessly during any
+ * one flush, limiting the bandwidth consumed by lossless refresh.
+ */
+#define GUAC_SURFACE_REFRESH_MAX_PIXELS 65536
+
+/**
+ * The maximum processing lag, in milliseconds, at which lossless refresh may
+ * still occur. Lossless refresh is deferred while the client is lagging, as
+ * it would compete with the updates the client is already struggling to
+ * process.
+ */
+#define GUAC_SURFACE_REFRESH_MAX_LAG 20
+
+/**
+ * The inverse of the maximum fraction of a surface which may have changed
+ * since its cached snapshot was taken for that snapshot to still be reused
+ * for a joining user. Larger changes result in a new snapshot.
+ */
+#define GUAC_SURFACE_SNAPSHOT_MAX_DELTA 4
+
+/**
+ * The result of analyzing the contents of a rectangle within a surface,
+ * gathered in a single pass over its pixels by
+ * __guac_common_surface_analyze() and consumed by
+ * __guac_common_surface_choose_codec().
+ */
+typedef struct guac_common_surface_analysis {
+
+    /**
+     * Non-zero if all pixels within the rectangle are fully opaque.
+     */
+    int opaque;
+
+    /**
+     * Non-zero if all pixels within the rectangle are the same color.
+     */
+    int solid;
+
+    /**
+     * Non-zero if the rectangle contains exactly two colors, both fully
+     * opaque.
+     */
+    int two_color;
+
+    /**
+     * The color of the first pixel of the rectangle. If the rectangle is
+     * solid, this is the color of every pixel.
+     */
+    uint32_t color;
+
+    /**
+     * The most common color within the rectangle, if the rectangle contains
+     * exactly two colors.
+     */
+    uint32_t background;
+
+    /**
+     * The bounding rectangle of all pixels which are not the background
+     * color, if the rectangle contains exactly two colors.
+     */
+    guac_common_rect foreground_rect;
+
+    /**
+     * The number of pixels (ignoring alpha) which are identical to the pixel
+     * to their left.
+     */
+    int num_same;
+
+    /**
+     * The number of pixels (ignoring alpha) which differ from the pixel to
+     * their left, plus one.
+     */
+    int num_different;
+
+    /**
+     * The number of horizontal and vertical neighbor comparisons performed.
+     */
+    int num_neighbors;
+
+    /**
+     * The number of horizontal and vertical neighbor comparisons which found
+     * differing pixels.
+     */
+    int num_edges;
+
+    /**
+     * The number of distinct colors within the rectangle. Counting stops
+     * once GUAC_SURFACE_SYNTHETIC_COLORS is exceeded.
+     */
+    int num_colors;
+
+    /**
+     * A bitwise OR of (1 << content) for each kind of content found within
+     * the heat map cells intersecting the rectangle, if those cells were
+     * classified during analysis, zero otherwise.
+     */
+    unsigned int content;
+
+} guac_common_surface_analysis;
+
+/**
+ * The statistics gathered for the part of a single heat map cell within a
+ * rectangle being analyzed, used to classify the content of that cell
+ * during the same pass over the rectangle's pixels.
+ */
+typedef struct guac_common_surface_cell_analysis {
+
+    /**
+     * The neighbor, edge and color counts of the part of the cell analyzed
+     * so far. Only num_neighbors, num_edges and num_colors are used.
+     */
+    guac_common_surface_analysis analysis;
+
+    /**
+     * The open-addressed hash table of distinct colors seen so far within
+     * the cell.
+     */
+    uint32_t color_table[GUAC_SURFACE_COLOR_TABLE_SIZE];
+
+    /**
+     * Flags denoting which entries of color_table are occupied.
+     */
+    unsigned char color_used[GUAC_SURFACE_COLOR_TABLE_SIZE];
+
+} guac_common_surface_cell_analysis;
+
+/**
+ * The encodings which may be chosen for a rectangle of image data by
+ * __guac_common_surface_choose_codec().
+ */
+typedef enum guac_common_surface_codec {
+
+    /**
+     * The rectangle is a single color and may be sent as a solid fill.
+     */
+    GUAC_COMMON_SURFACE_CODEC_FILL,
+
+    /**
+     * The rectangle contains two colors and may be sent as a solid fill of
+     * the background color, followed by image data covering the foreground.
+     */
+    GUAC_COMMON_SURFACE_CODEC_SPLIT,
+
+    /**
+     * The rectangle should be sent as a WebP image.
+     */
+    GUAC_COMMON_SURFACE_CODEC_WEBP,
+
+    /**
+     * The rectangle should be sent as a JPEG image.
+     */
+    GUAC_COMMON_SURFACE_CODEC_JPEG,
+
+    /**
+     * The rectangle should be sent as a PNG image.
+     */
+    GUAC_COMMON_SURFACE_CODEC_PNG
+
+} guac_common_surface_codec;
+
 void guac_common_surface_set_multitouch(guac_common_surface* surface,
         int touches) {
 
     pthread_mutex_lock(&surface->_lock);
 
     surface->touches = touches;
+    surface->last_modified = guac_timestamp_current();
     guac_protocol_send_set_int(surface->socket, surface->layer,
             GUAC_PROTOCOL_LAYER_PARAMETER_MULTI_TOUCH, touches);
 
@@ -126,6 +356,15 @@ void guac_common_surface_set_lossless(guac_common_surface* surface,
 
 }
 
+void guac_common_surface_set_refresh_interval(guac_common_surface* surface,
+        int interval) {
+
+    pthread_mutex_lock(&surface->_lock);
+    surface->refresh_interval = interval;
+    pthread_mutex_unlock(&surface->_lock);
+
+}
+
 void guac_common_surface_move(guac_common_surface* surface, int x, int y) {
 
     pthread_mutex_lock(&surface->_lock);
@@ -133,6 +372,7 @@ void guac_common_surface_move(guac_common_surface* surface, int x, int y) {
     surface->x = x;
     surface->y = y;
     surface->location_dirty = 1;
+    surface->last_modified = guac_timestamp_current();
 
     pthread_mutex_unlock(&surface->_lock);
 
@@ -144,6 +384,7 @@ void guac_common_surface_stack(guac_common_surface* surface, int z) {
 
     surface->z = z;
     surface->location_dirty = 1;
+    surface->last_modified = guac_timestamp_current();
 
     pthread_mutex_unlock(&surface->_lock);
 
@@ -156,6 +397,7 @@ void guac_common_surface_set_parent(guac_common_surface* surface,
 
     surface->parent = parent;
     surface->location_dirty = 1;
+    surface->last_modified = guac_timestamp_current();
 
     pthread_mutex_unlock(&surface->_lock);
 
@@ -168,6 +410,7 @@ void guac_common_surface_set_opacity(guac_common_surface* surface,
 
     surface->opacity = opacity;
     surface->opacity_dirty = 1;
+    surface->last_modified = guac_timestamp_current();
 
     pthread_mutex_unlock(&surface->_lock);
 
@@ -233,53 +476,6 @@ static void __guac_common_clip_rect(guac_common_surface* surface,
 
 }
 
-/**
- * Returns whether a rectangle within the given surface contains only fully
- * opaque pixels.
- *
- * @param surface
- *     The surface to check.
- *
- * @param rect
- *     The rectangle to check.
- *
- * @return
- *     Non-zero if the rectangle contains only fully opaque pixels, zero
- *     otherwise.
- */
-static int __guac_common_surface_is_opaque(guac_common_surface* surface,
-        guac_common_rect* rect) {
-
-    int x, y;
-
-    int stride = surface ->stride;
-    unsigned char* buffer =
-        surface->buffer + (stride * rect->y) + (4 * rect->x);
-
-    /* For each row */
-    for (y = 0; y < rect->height; y++) {
-
-        /* Search for a non-opaque pixel */
-        uint32_t* current = (uint32_t*) buffer;
-        for (x=0; x < rect->width; x++) {
-
-            /* Rectangle is non-opaque if a single non-opaque pixel is found */
-            uint32_t color = *(current++);
-            if ((color & 0xFF000000) != 0xFF000000)
-                return 0;
-
-        }
-
-        /* Next row */
-        buffer += stride;
-
-    }
-
-    /* Rectangle is opaque */
-    return 1;
-
-}
-
 /**
  * Returns whether the given rectangle should be combined into the existing
  * dirty rectangle, to be eventually flushed as image data, or would be best
@@ -378,239 +574,302 @@ static void __guac_common_mark_dirty(guac_common_surface* surface, const guac_co
 }
 
 /**
- * Calculate the current average framerate for a given area on the surface.
+ * Returns the number of bytes required for the pixel buffer of a surface
+ * having the given height and stride.
  *
- * @param surface
- *     The surface on which the framerate will be calculated.
+ * @param height
+ *     The height of the surface, in pixels.
  *
- * @param rect
- *     The rect containing the area for which the average framerate will be
- *     calculated.
+ * @param stride
+ *     The number of bytes in each row of the surface.
  *
  * @return
- *     The average framerate of the given area, in frames per second.
+ *     The number of bytes required for the pixel buffer.
  */
-static unsigned int __guac_common_surface_calculate_framerate(
-        guac_common_surface* surface, const guac_common_rect* rect) {
+static size_t __guac_common_surface_buffer_size(int height, int stride) {
+    return guac_mem_ckd_mul_or_die(height, stride);
+}
 
-    int x, y;
+/**
+ * Returns the number of bytes required for the heat map of a surface having
+ * the given dimensions.
+ *
+ * @param width
+ *     The width of the surface, in pixels.
+ *
+ * @param height
+ *     The height of the surface, in pixels.
+ *
+ * @return
+ *     The number of bytes required for the heat map.
+ */
+static size_t __guac_common_surface_heat_map_size(int width, int height) {
+    return guac_mem_ckd_mul_or_die(GUAC_COMMON_SURFACE_HEAT_DIMENSION(width),
+            GUAC_COMMON_SURFACE_HEAT_DIMENSION(height),
+            sizeof(guac_common_surface_heat_cell));
+}
 
-    /* Calculate heat map dimensions */
-    size_t heat_width = GUAC_COMMON_SURFACE_HEAT_DIMENSION(surface->width);
+/**
+ * Notes that the contents of the given surface are about to be read or
+ * modified, restoring those contents first if they were evicted. The
+ * surface must be locked.
+ *
+ * @param surface
+ *     The surface about to be used.
+ */
+static void __guac_common_surface_use(guac_common_surface* surface) {
 
-    /* Calculate minimum X/Y coordinates intersecting given rect */
-    int min_x = rect->x / GUAC_COMMON_SURFACE_HEAT_CELL_SIZE;
-    int min_y = rect->y / GUAC_COMMON_SURFACE_HEAT_CELL_SIZE;
+    /* Usage matters only to surfaces which may be evicted */
+    if (surface->restore_handler == NULL)
+        return;
 
-    /* Calculate maximum X/Y coordinates intersecting given rect */
-    int max_x = min_x + (rect->width  - 1) / GUAC_COMMON_SURFACE_HEAT_CELL_SIZE;
-    int max_y = min_y + (rect->height - 1) / GUAC_COMMON_SURFACE_HEAT_CELL_SIZE;
+    surface->last_used = guac_timestamp_current();
 
-    unsigned int sum_framerate = 0;
-    unsigned int count = 0;
+    if (!surface->evicted)
+        return;
 
-    /* Get start of buffer at given coordinates */
-    const guac_common_surface_heat_cell* heat_row =
-        surface->heat_map + min_y * heat_width + min_x;
+    /* Regenerate evicted pixels */
+    surface->buffer = guac_common_surface_pool_zalloc(surface->pool,
+            __guac_common_surface_buffer_size(surface->height,
+                surface->stride));
 
-    /* Iterate over all the heat map cells for the area
-     * and calculate the average framerate */
-    for (y = min_y; y < max_y; y++) {
+    surface->restore_handler(surface->buffer, surface->width, surface->height,
+            surface->stride, surface->restore_data);
 
-        /* Get current row of heat map */
-        const guac_common_surface_heat_cell* heat_cell = heat_row;
+    surface->evicted = 0;
 
-        /* For each cell in subset of row */
-        for (x = min_x; x < max_x; x++) {
+}
 
-            /* Calculate indicies for latest and oldest history entries */
-            int oldest_entry = heat_cell->oldest_entry;
-            int latest_entry = oldest_entry - 1;
-            if (latest_entry < 0)
-                latest_entry = GUAC_COMMON_SURFACE_HEAT_CELL_HISTORY_SIZE - 1;
+/**
+ * Records that the contents of the heat map cells intersecting the given
+ * rectangle of the given surface were changed, or were sent only to users
+ * receiving live updates, at the given time. Users which stopped receiving
+ * live updates before that time will be sent those cells when resyncing.
+ *
+ * @param surface
+ *     The surface containing the heat map cells to be updated.
+ *
+ * @param rect
+ *     The rectangle containing the heat map cells to be updated. Any portion
+ *     of the rectangle outside the bounds of the surface is ignored.
+ *
+ * @param time
+ *     The time to record within each intersecting heat map cell.
+ */
+static void __guac_common_surface_stamp_rect(guac_common_surface* surface,
+        const guac_common_rect* rect, guac_timestamp time) {
 
-            /* Calculate elapsed time covering entire history for this cell */
-            int elapsed_time = heat_cell->history[latest_entry]
-                             - heat_cell->history[oldest_entry];
+    guac_common_rect bounded = *rect;
+    __guac_common_bound_rect(surface, &bounded, NULL, NULL);
 
-            /* Calculate and add framerate */
-            if (elapsed_time)
-                sum_framerate += GUAC_COMMON_SURFACE_HEAT_CELL_HISTORY_SIZE
-                    * 1000 / elapsed_time;
+    if (bounded.width <= 0 || bounded.height <= 0)
+        return;
 
-            /* Next heat map cell */
-            heat_cell++;
-            count++;
+    size_t heat_width = GUAC_COMMON_SURFACE_HEAT_DIMENSION(surface->width);
 
-        }
+    int min_x = bounded.x / GUAC_COMMON_SURFACE_HEAT_CELL_SIZE;
+    int min_y = bounded.y / GUAC_COMMON_SURFACE_HEAT_CELL_SIZE;
+    int max_x = (bounded.x + bounded.width  - 1)
+        / GUAC_COMMON_SURFACE_HEAT_CELL_SIZE;
+    int max_y = (bounded.y + bounded.height - 1)
+        / GUAC_COMMON_SURFACE_HEAT_CELL_SIZE;
 
-        /* Next heat map row */
-        heat_row += heat_width;
+    for (int y = min_y; y <= max_y; y++) {
 
-    }
+        guac_common_surface_heat_cell* heat_cell =
+            surface->heat_map + y * heat_width + min_x;
 
-    /* Calculate the average framerate over entire rect */
-    if (count)
-        return sum_framerate / count;
+        for (int x = min_x; x <= max_x; x++, heat_cell++)
+            heat_cell->last_modified = time;
 
-    return 0;
+    }
 
 }
 
- /**
- * Guesses whether a rectangle within a particular surface would be better
- * compressed as PNG or using a lossy format like JPEG. Positive values
- * indicate PNG is likely to be superior, while negative values indicate the
- * opposite.
- *
- * @param surface
- *     The surface containing the image data to check.
+/**
+ * Callback for guac_common_region_foreach_rect() which records that the
+ * contents of each rectangle of a region were sent only to users receiving
+ * live updates, as done by __guac_common_surface_stamp_rect().
  *
  * @param rect
- *     The rect to check within the given surface.
+ *     The rectangle to record.
  *
- * @return
- *     Positive values if PNG compression is likely to perform better than
- *     lossy alternatives, or negative values if PNG is likely to perform
- *     worse.
+ * @param data
+ *     The guac_common_surface containing the rectangle.
  */
-static int __guac_common_surface_png_optimality(guac_common_surface* surface,
-        const guac_common_rect* rect) {
-
-    int x, y;
-
-    int num_same = 0;
-    int num_different = 1;
+static void __guac_common_surface_stamp_region_rect(
+        const guac_common_rect* rect, void* data) {
 
-    /* Get image/buffer metrics */
-    int width = rect->width;
-    int height = rect->height;
-    int stride = surface->stride;
-
-    /* Get buffer from surface */
-    unsigned char* buffer = surface->buffer + rect->y * stride + rect->x * 4;
+    guac_common_surface* surface = (guac_common_surface*) data;
+    __guac_common_surface_stamp_rect(surface, rect, surface->last_modified);
 
-    /* Image must be at least 1x1 */
-    if (width < 1 || height < 1)
-        return 0;
+}
 
-    /* For each row */
-    for (y = 0; y < height; y++) {
+/**
+ * Records that the contents of the given rectangle of the given surface have
+ * changed, updating the modification time of the surface and of the
+ * affected heat map cells such that users not receiving live updates and any
+ * cached snapshot of the surface will be brought up to date.
+ *
+ * @param surface
+ *     The surface that has changed.
+ *
+ * @param rect
+ *     The rectangle of the update which changed the surface.
+ */
+static void __guac_common_surface_mark_modified(
+        guac_common_surface* surface, const guac_common_rect* rect) {
 
-        uint32_t* row = (uint32_t*) buffer;
-        uint32_t last_pixel = *(row++) | 0xFF000000;
+    /* Ignore empty rects */
+    if (rect->width <= 0 || rect->height <= 0)
+        return;
 
-        /* For each pixel in current row */
-        for (x = 1; x < width; x++) {
+    surface->last_modified = guac_timestamp_current();
+    __guac_common_surface_stamp_rect(surface, rect, surface->last_modified);
 
-            /* Get next pixel */
-            uint32_t current_pixel = *(row++) | 0xFF000000;
+    /* Nothing further to track if there is no snapshot */
+    if (surface->snapshot == NULL)
+        return;
 
-            /* Update same/different counts according to pixel value */
-            if (current_pixel == last_pixel)
-                num_same++;
-            else
-                num_different++;
+    if (surface->snapshot_dirty)
+        guac_common_rect_extend(&surface->snapshot_dirty_rect, rect);
 
-            last_pixel = current_pixel;
+    else {
+        surface->snapshot_dirty_rect = *rect;
+        surface->snapshot_dirty = 1;
+    }
 
-        }
+}
 
-        /* Advance to next row */
-        buffer += stride;
+/**
+ * Releases the cached snapshot of the given surface, if any.
+ *
+ * @param surface
+ *     The surface whose cached snapshot should be released.
+ */
+static void __guac_common_surface_drop_snapshot(guac_common_surface* surface) {
 
+    if (surface->snapshot != NULL) {
+        guac_common_snapshot_release(surface->snapshot);
+        surface->snapshot = NULL;
     }
 
-    /* Return rough approximation of optimality for PNG compression */
-    return 0x100 * num_same / num_different - 0x400;
+    surface->snapshot_dirty = 0;
 
 }
 
 /**
- * Returns whether the given rectangle would be optimally encoded as JPEG
- * rather than PNG.
+ * Returns whether the given rectangle intersects the area of the given
+ * surface which is currently being streamed as video.
  *
  * @param surface
- *     The surface to be queried.
+ *     The surface to check.
  *
  * @param rect
- *     The rectangle to check.
+ *     The rectangle to test against the video area of the surface.
  *
  * @return
- *     Non-zero if the rectangle would be optimally encoded as JPEG, zero
- *     otherwise.
+ *     Non-zero if the surface is streaming video and the rectangle intersects
+ *     the video area, zero otherwise.
  */
-static int __guac_common_surface_should_use_jpeg(guac_common_surface* surface,
-        const guac_common_rect* rect) {
+static int __guac_common_surface_video_intersects(
+        const guac_common_surface* surface, const guac_common_rect* rect) {
 
-    /* Do not use JPEG if lossless quality is required */
-    if (surface->lossless)
+    if (surface->video == NULL)
         return 0;
 
-    /* Calculate the average framerate for the given rect */
-    int framerate = __guac_common_surface_calculate_framerate(surface, rect);
+    /* Rectangles which merely share an edge do not intersect */
+    const guac_common_rect* video_rect = &surface->video_rect;
+    return rect->x < video_rect->x + video_rect->width
+        && video_rect->x < rect->x + rect->width
+        && rect->y < video_rect->y + video_rect->height
+        && video_rect->y < rect->y + rect->height;
+
+}
 
-    int rect_size = rect->width * rect->height;
+/**
+ * Marks the destination of a copy or transfer performed directly by the
+ * client as lossy if its source may contain lossy data. Destinations copied
+ * from lossless sources are left as they were, as the result of some
+ * transfer functions still depends on the (possibly lossy) destination.
+ *
+ * @param src
+ *     The surface being copied from.
+ *
+ * @param srect
+ *     The area of the source surface being copied.
+ *
+ * @param dst
+ *     The surface being copied to.
+ *
+ * @param drect
+ *     The area of the destination surface receiving the copy.
+ */
+static void __guac_common_surface_copy_lossy(const guac_common_surface* src,
+        const guac_common_rect* srect, guac_common_surface* dst,
+        const guac_common_rect* drect) {
+
+    /* Compare against the extents of the lossy region, erring on the side of
+     * refreshing unnecessarily */
+    guac_common_rect extents;
+    if (!guac_common_region_get_extents(src->lossy_region, &extents))
+        return;
 
-    /* JPEG is preferred if:
-     * - frame rate is high enough
-     * - image size is large enough
-     * - PNG is not more optimal based on image contents */
-    return framerate >= GUAC_COMMON_SURFACE_JPEG_FRAMERATE
-        && rect_size > GUAC_SURFACE_JPEG_MIN_BITMAP_SIZE
-        && __guac_common_surface_png_optimality(surface, rect) < 0;
+    if (srect->x < extents.x + extents.width
+            && extents.x < srect->x + srect->width
+            && srect->y < extents.y + extents.height
+            && extents.y < srect->y + srect->height)
+        guac_common_region_union_rect(dst->lossy_region, drect);
 
 }
 
 /**
- * Returns whether the given rectangle would be optimally encoded as WebP
- * rather than PNG.
+ * Calculates the current framerate of a single heat map cell from its update
+ * history.
  *
- * @param surface
- *     The surface to be queried.
- *
- * @param rect
- *     The rectangle to check.
+ * @param heat_cell
+ *     The heat map cell whose framerate should be calculated.
  *
  * @return
- *     Non-zero if the rectangle would be optimally encoded as WebP, zero
- *     otherwise.
+ *     The framerate of the given heat map cell, in frames per second, or
+ *     zero if the cell has not been updated enough times to determine its
+ *     framerate.
  */
-static int __guac_common_surface_should_use_webp(guac_common_surface* surface,
-        const guac_common_rect* rect) {
+static unsigned int __guac_common_surface_cell_framerate(
+        const guac_common_surface_heat_cell* heat_cell) {
 
-    /* Do not use WebP if not supported */
-    if (!guac_client_supports_webp(surface->client))
-        return 0;
+    /* Calculate indicies for latest and oldest history entries */
+    int oldest_entry = heat_cell->oldest_entry;
+    int latest_entry = oldest_entry - 1;
+    if (latest_entry < 0)
+        latest_entry = GUAC_COMMON_SURFACE_HEAT_CELL_HISTORY_SIZE - 1;
 
-    /* Calculate the average framerate for the given rect */
-    int framerate = __guac_common_surface_calculate_framerate(surface, rect);
+    /* Calculate elapsed time covering entire history for this cell */
+    int elapsed_time = heat_cell->history[latest_entry]
+                     - heat_cell->history[oldest_entry];
+
+    if (!elapsed_time)
+        return 0;
 
-    /* WebP is preferred if:
-     * - frame rate is high enough
-     * - PNG is not more optimal based on image contents */
-    return framerate >= GUAC_COMMON_SURFACE_JPEG_FRAMERATE
-        && __guac_common_surface_png_optimality(surface, rect) < 0;
+    return GUAC_COMMON_SURFACE_HEAT_CELL_HISTORY_SIZE * 1000 / elapsed_time;
 
 }
 
 /**
- * Updates the heat map cells which intersect the given rectangle using the
- * given timestamp. This timestamp, along with timestamps from past updates,
- * is used to calculate the framerate of each heat cell.
+ * Calculate the current average framerate for a given area on the surface.
  *
  * @param surface
- *     The surface containing the heat map cells to be updated.
+ *     The surface on which the framerate will be calculated.
  *
  * @param rect
- *     The rectangle containing the heat map cells to be updated.
+ *     The rect containing the area for which the average framerate will be
+ *     calculated.
  *
- * @param time
- *     The timestamp to use when updating the heat map cells which intersect
- *     the given rectangle.
+ * @return
+ *     The average framerate of the given area, in frames per second.
  */
-static void __guac_common_surface_touch_rect(guac_common_surface* surface,
-        guac_common_rect* rect, guac_timestamp time) {
+static unsigned int __guac_common_surface_calculate_framerate(
+        guac_common_surface* surface, const guac_common_rect* rect) {
 
     int x, y;
 
@@ -625,30 +884,29 @@ static void __guac_common_surface_touch_rect(guac_common_surface* surface,
     int max_x = min_x + (rect->width  - 1) / GUAC_COMMON_SURFACE_HEAT_CELL_SIZE;
     int max_y = min_y + (rect->height - 1) / GUAC_COMMON_SURFACE_HEAT_CELL_SIZE;
 
+    unsigned int sum_framerate = 0;
+    unsigned int count = 0;
+
     /* Get start of buffer at given coordinates */
-    guac_common_surface_heat_cell* heat_row =
+    const guac_common_surface_heat_cell* heat_row =
         surface->heat_map + min_y * heat_width + min_x;
 
-    /* Update all heat map cells which intersect with rectangle */
-    for (y = min_y; y <= max_y; y++) {
+    /* Iterate over all the heat map cells for the area
+     * and calculate the average framerate */
+    for (y = min_y; y < max_y; y++) {
 
         /* Get current row of heat map */
-        guac_common_surface_heat_cell* heat_cell = heat_row;
+        const guac_common_surface_heat_cell* heat_cell = heat_row;
 
         /* For each cell in subset of row */
-        for (x = min_x; x <= max_x; x++) {
-
-            /* Replace oldest entry with new timestamp */
-            heat_cell->history[heat_cell->oldest_entry] = time;
+        for (x = min_x; x < max_x; x++) {
 
-            /* Update to next oldest entry */
-            heat_cell->oldest_entry++;
-            if (heat_cell->oldest_entry >=
-                    GUAC_COMMON_SURFACE_HEAT_CELL_HISTORY_SIZE)
-                heat_cell->oldest_entry = 0;
+            /* Calculate and add framerate */
+            sum_framerate += __guac_common_surface_cell_framerate(heat_cell);
 
-            /* Advance to next heat map cell */
+            /* Next heat map cell */
             heat_cell++;
+            count++;
 
         }
 
@@ -657,393 +915,669 @@ static void __guac_common_surface_touch_rect(guac_common_surface* surface,
 
     }
 
+    /* Calculate the average framerate over entire rect */
+    if (count)
+        return sum_framerate / count;
+
+    return 0;
+
 }
 
 /**
- * Flushes the bitmap update currently described by the dirty rectangle within the
- * given surface to that surface's bitmap queue. There MUST be space within the
- * queue.
+ * Updates the running content statistics of the given heat map cell with the
+ * given analysis of (part of) that cell, reclassifying the cell's content
+ * accordingly. Analyses covering too few pixels are ignored.
  *
- * @param surface The surface to flush.
+ * @param heat_cell
+ *     The heat map cell to update.
+ *
+ * @param analysis
+ *     The analysis of the updated part of the cell.
  */
-static void __guac_common_surface_flush_to_queue(guac_common_surface* surface) {
+static void __guac_common_surface_classify_cell(
+        guac_common_surface_heat_cell* heat_cell,
+        const guac_common_surface_analysis* analysis) {
 
-    guac_common_surface_bitmap_rect* rect;
-
-    /* Do not flush if not dirty */
-    if (!surface->dirty)
+    if (analysis->num_neighbors < GUAC_SURFACE_CLASSIFY_MIN_NEIGHBORS)
         return;
 
-    /* Add new rect to queue */
-    rect = &(surface->bitmap_queue[surface->bitmap_queue_length++]);
-    rect->rect = surface->dirty_rect;
-    rect->flushed = 0;
+    int edge_density = 256 * analysis->num_edges / analysis->num_neighbors;
 
-    /* Surface now flushed */
-    surface->dirty = 0;
+    /* Fold sample into running averages, starting fresh for cells never
+     * before classified */
+    if (heat_cell->content == GUAC_COMMON_SURFACE_CONTENT_UNKNOWN) {
+        heat_cell->edge_density = edge_density;
+        heat_cell->color_count = analysis->num_colors;
+    }
+    else {
+        heat_cell->edge_density =
+            (heat_cell->edge_density * GUAC_SURFACE_CLASSIFY_HISTORY_WEIGHT
+             + edge_density) / (GUAC_SURFACE_CLASSIFY_HISTORY_WEIGHT + 1);
+        heat_cell->color_count =
+            (heat_cell->color_count * GUAC_SURFACE_CLASSIFY_HISTORY_WEIGHT
+             + analysis->num_colors) / (GUAC_SURFACE_CLASSIFY_HISTORY_WEIGHT + 1);
+    }
+
+    /* Many colors suggest natural imagery, which is video if updated often */
+    if (heat_cell->color_count > GUAC_SURFACE_SYNTHETIC_COLORS) {
+        if (__guac_common_surface_cell_framerate(heat_cell)
+                >= GUAC_COMMON_SURFACE_VIDEO_FRAMERATE)
+            heat_cell->content = GUAC_COMMON_SURFACE_CONTENT_VIDEO;
+        else
+            heat_cell->content = GUAC_COMMON_SURFACE_CONTENT_PHOTO;
+    }
+
+    /* Few colors suggest synthetic imagery, which is text if edges are
+     * dense */
+    else if (heat_cell->edge_density * GUAC_SURFACE_SYNTHETIC_EDGE_FACTOR
+            >= 256)
+        heat_cell->content = GUAC_COMMON_SURFACE_CONTENT_TEXT;
+
+    else
+        heat_cell->content = GUAC_COMMON_SURFACE_CONTENT_UI;
 
 }
 
 /**
- * Flushes the given surface, drawing any pending operations on the remote
- * display. Surface properties are not flushed.
+ * Returns whether the given kind of content is natural imagery which is best
+ * sent using lossy compression, as opposed to synthetic imagery which should
+ * remain lossless.
  *
- * @param surface
- *     The surface to flush.
+ * @param content
+ *     The kind of content to check.
+ *
+ * @return
+ *     Non-zero if the given kind of content is best sent using lossy
+ *     compression, zero otherwise.
  */
-static void __guac_common_surface_flush(guac_common_surface* surface);
+static int __guac_common_surface_is_lossy_content(
+        guac_common_surface_content content) {
+    return content == GUAC_COMMON_SURFACE_CONTENT_PHOTO
+        || content == GUAC_COMMON_SURFACE_CONTENT_VIDEO;
+}
 
 /**
- * Schedules a deferred flush of the given surface. This will not immediately
- * flush the surface to the client. Instead, the result of the flush is
- * added to a queue which is reinspected and combined (if possible) with other
- * deferred flushes during the call to guac_common_surface_flush().
+ * Records the given color within the given table of distinct colors, if not
+ * already present, incrementing the distinct color count of the given
+ * analysis accordingly. Once the distinct color count exceeds
+ * GUAC_SURFACE_SYNTHETIC_COLORS, no further colors are recorded.
  *
- * @param surface The surface to flush.
+ * @param analysis
+ *     The analysis whose distinct color count should be updated.
+ *
+ * @param table
+ *     The open-addressed hash table of distinct colors seen so far,
+ *     containing GUAC_SURFACE_COLOR_TABLE_SIZE entries.
+ *
+ * @param used
+ *     Flags denoting which entries of the given hash table are occupied.
+ *
+ * @param color
+ *     The color to record.
  */
-static void __guac_common_surface_flush_deferred(guac_common_surface* surface) {
+static void __guac_common_surface_count_color(
+        guac_common_surface_analysis* analysis, uint32_t* table,
+        unsigned char* used, uint32_t color) {
 
-    /* Do not flush if not dirty */
-    if (!surface->dirty)
+    if (analysis->num_colors > GUAC_SURFACE_SYNTHETIC_COLORS)
         return;
 
-    /* Flush if queue size has reached maximum (space is reserved for the final
-     * dirty rect, as __guac_common_surface_flush() MAY add an additional rect
-     * to the queue */
-    if (surface->bitmap_queue_length == GUAC_COMMON_SURFACE_QUEUE_SIZE-1)
-        __guac_common_surface_flush(surface);
+    /* Linear probe from the color's hash until the color or a free slot is
+     * found (the table can never fill, as counting stops well before) */
+    unsigned int index = (color * 2654435761u) >> 24;
+    while (used[index]) {
+
+        if (table[index] == color)
+            return;
+
+        index = (index + 1) & (GUAC_SURFACE_COLOR_TABLE_SIZE - 1);
+
+    }
 
-    /* Append dirty rect to queue */
-    __guac_common_surface_flush_to_queue(surface);
+    used[index] = 1;
+    table[index] = color;
+    analysis->num_colors++;
 
 }
 
 /**
- * Transfers a single uint32_t using the given transfer function.
+ * Resets the given per-cell statistics, such that the next heat map cell
+ * analyzed using those statistics starts fresh.
  *
- * @param op The transfer function to use.
- * @param src The source of the uint32_t value.
- * @param dst THe destination which will hold the result of the transfer.
- * @return Non-zero if the destination value was changed, zero otherwise.
+ * @param cells
+ *     The per-cell statistics to reset.
+ *
+ * @param count
+ *     The number of entries within the given array.
  */
-static int __guac_common_surface_transfer_int(guac_transfer_function op, uint32_t* src, uint32_t* dst) {
+static void __guac_common_surface_reset_cells(
+        guac_common_surface_cell_analysis* cells, int count) {
+
+    for (int i = 0; i < count; i++) {
+        cells[i].analysis.num_neighbors = 0;
+        cells[i].analysis.num_edges = 0;
+        cells[i].analysis.num_colors = 0;
+        memset(cells[i].color_used, 0, sizeof(cells[i].color_used));
+    }
 
-    uint32_t orig = *dst;
+}
 
-    switch (op) {
+/**
+ * Analyzes the contents of a rectangle within the given surface, gathering
+ * everything needed to choose how that rectangle should be encoded in a
+ * single pass over its pixels. If per-cell scratch space is provided, the
+ * content of every heat map cell intersecting the rectangle is classified
+ * from statistics gathered during that same pass.
+ *
+ * @param surface
+ *     The surface to analyze.
+ *
+ * @param rect
+ *     The rectangle to analyze. This rectangle must not be empty.
+ *
+ * @param analysis
+ *     The analysis structure to populate.
+ *
+ * @param cells
+ *     Scratch space for one guac_common_surface_cell_analysis per heat map
+ *     column intersecting the given rectangle, or NULL if heat map cells
+ *     should not be classified.
+ */
+static void __guac_common_surface_analyze(guac_common_surface* surface,
+        const guac_common_rect* rect, guac_common_surface_analysis* analysis,
+        guac_common_surface_cell_analysis* cells) {
 
-        case GUAC_TRANSFER_BINARY_BLACK:
-            *dst = 0xFF000000;
-            break;
+    int stride = surface->stride;
+    unsigned char* buffer =
+        surface->buffer + (surface->stride * rect->y) + (4 * rect->x);
 
-        case GUAC_TRANSFER_BINARY_WHITE:
-            *dst = 0xFFFFFFFF;
-            break;
+    uint32_t color_table[GUAC_SURFACE_COLOR_TABLE_SIZE];
+    unsigned char color_used[GUAC_SURFACE_COLOR_TABLE_SIZE] = { 0 };
 
-        case GUAC_TRANSFER_BINARY_SRC:
-            *dst = *src;
-            break;
+    uint32_t first = *((uint32_t*) buffer);
 
-        case GUAC_TRANSFER_BINARY_DEST:
-            /* NOP */
-            break;
+    /* The (up to) two colors present, how often each occurs, and the bounds
+     * of the pixels of each color (min X, min Y, max X, max Y) */
+    uint32_t colors[2] = { first, 0 };
+    int count[2] = { 0, 0 };
+    int bounds[2][4] = {
+        { rect->width, rect->height, 0, 0 },
+        { rect->width, rect->height, 0, 0 }
+    };
 
-        case GUAC_TRANSFER_BINARY_NSRC:
-            *dst = *src ^ 0x00FFFFFF;
-            break;
+    int num_colors = 1;
 
-        case GUAC_TRANSFER_BINARY_NDEST:
-            *dst = *dst ^ 0x00FFFFFF;
-            break;
+    analysis->opaque = 1;
+    analysis->solid = 1;
+    analysis->two_color = ((first & 0xFF000000) == 0xFF000000);
+    analysis->color = first;
+    analysis->num_same = 0;
+    analysis->num_different = 1;
+    analysis->num_neighbors = 0;
+    analysis->num_edges = 0;
+    analysis->num_colors = 0;
+    analysis->content = 0;
 
-        case GUAC_TRANSFER_BINARY_AND:
-            *dst = ((*dst) & (0xFF000000 | *src));
-            break;
+    __guac_common_surface_count_color(analysis, color_table, color_used,
+            first | 0xFF000000);
 
-        case GUAC_TRANSFER_BINARY_NAND:
-            *dst = ((*dst) & (0xFF000000 | *src)) ^ 0x00FFFFFF;
-            break;
+    /* Heat map cells intersecting the rect, if classifying */
+    size_t heat_width = GUAC_COMMON_SURFACE_HEAT_DIMENSION(surface->width);
+    int min_cell_x = rect->x / GUAC_COMMON_SURFACE_HEAT_CELL_SIZE;
+    int max_cell_x = (rect->x + rect->width - 1)
+        / GUAC_COMMON_SURFACE_HEAT_CELL_SIZE;
+    int cells_wide = max_cell_x - min_cell_x + 1;
 
-        case GUAC_TRANSFER_BINARY_OR:
-            *dst = ((*dst) | (0x00FFFFFF & *src));
-            break;
+    /* Offset of the first pixel of each row within its heat map cell */
+    int first_cell_offset = rect->x % GUAC_COMMON_SURFACE_HEAT_CELL_SIZE;
 
-        case GUAC_TRANSFER_BINARY_NOR:
-            *dst = ((*dst) | (0x00FFFFFF & *src)) ^ 0x00FFFFFF;
-            break;
+    if (cells != NULL)
+        __guac_common_surface_reset_cells(cells, cells_wide);
 
-        case GUAC_TRANSFER_BINARY_XOR:
-            *dst = ((*dst) ^ (0x00FFFFFF & *src));
-            break;
+    /* For each row */
+    for (int y = 0; y < rect->height; y++) {
 
-        case GUAC_TRANSFER_BINARY_XNOR:
-            *dst = ((*dst) ^ (0x00FFFFFF & *src)) ^ 0x00FFFFFF;
-            break;
+        uint32_t* row = (uint32_t*) buffer;
+        uint32_t* above = (uint32_t*) (y > 0 ? buffer - stride : buffer);
+        uint32_t last_pixel = row[0] | 0xFF000000;
 
-        case GUAC_TRANSFER_BINARY_NSRC_AND:
-            *dst = ((*dst) & (0xFF000000 | (*src ^ 0x00FFFFFF)));
-            break;
+        guac_common_surface_cell_analysis* cell = cells;
+        int cell_offset = first_cell_offset;
 
-        case GUAC_TRANSFER_BINARY_NSRC_NAND:
-            *dst = ((*dst) & (0xFF000000 | (*src ^ 0x00FFFFFF))) ^ 0x00FFFFFF;
-            break;
+        for (int x = 0; x < rect->width; x++) {
 
-        case GUAC_TRANSFER_BINARY_NSRC_OR:
-            *dst = ((*dst) | (0x00FFFFFF & (*src ^ 0x00FFFFFF)));
-            break;
+            uint32_t color = row[x];
+            uint32_t opaque_color = color | 0xFF000000;
 
-        case GUAC_TRANSFER_BINARY_NSRC_NOR:
-            *dst = ((*dst) | (0x00FFFFFF & (*src ^ 0x00FFFFFF))) ^ 0x00FFFFFF;
-            break;
+            if ((color & 0xFF000000) != 0xFF000000)
+                analysis->opaque = 0;
 
-    }
+            if (color != first)
+                analysis->solid = 0;
 
-    return *dst != orig;
+            /* Every cell starts with a color which must be counted */
+            if (cell != NULL) {
 
-}
+                if (cell_offset == GUAC_COMMON_SURFACE_HEAT_CELL_SIZE) {
+                    cell++;
+                    cell_offset = 0;
+                }
 
-/**
- * Assigns the given value to all pixels within a rectangle of the backing
- * surface of the given destination surface. The color of all pixels within the
- * rectangle, including the alpha component, is entirely replaced.
- *
- * @param dst
- *     The destination surface.
- *
- * @param rect
- *     The rectangle to draw.
- *
- * @param red
- *     The red component of the color value to assign to all pixels within the
- *     rectangle.
- *
- * @param green
- *     The green component of the color value to assign to all pixels within
- *     the rectangle.
- *
- * @param blue 
- *     The blue component of the color value to assign to all pixels within the
- *     rectangle.
- *
- * @param alpha 
- *     The alpha component of the color value to assign to all pixels within
- *     the rectangle.
- */
-static void __guac_common_surface_set(guac_common_surface* dst,
-        guac_common_rect* rect, int red, int green, int blue, int alpha) {
+                if (x == 0 || cell_offset == 0)
+                    __guac_common_surface_count_color(&cell->analysis,
+                            cell->color_table, cell->color_used,
+                            opaque_color);
 
-    int x, y;
+                cell_offset++;
 
-    int dst_stride;
-    unsigned char* dst_buffer;
+            }
 
-    uint32_t color = (alpha << 24) | (red << 16) | (green << 8) | blue;
+            /* Horizontal neighbor (also PNG optimality statistics) */
+            if (x > 0) {
 
-    int min_x = rect->width - 1;
-    int min_y = rect->height - 1;
-    int max_x = 0;
-    int max_y = 0;
+                analysis->num_neighbors++;
+                if (cell != NULL)
+                    cell->analysis.num_neighbors++;
 
-    dst_stride = dst->stride;
-    dst_buffer = dst->buffer + (dst_stride * rect->y) + (4 * rect->x);
+                if (opaque_color == last_pixel)
+                    analysis->num_same++;
 
-    /* For each row */
-    for (y=0; y < rect->height; y++) {
+                else {
+                    analysis->num_different++;
+                    analysis->num_edges++;
 
-        uint32_t* dst_current = (uint32_t*) dst_buffer;
+                    /* Only new runs can introduce new colors */
+                    __guac_common_surface_count_color(analysis, color_table,
+                            color_used, opaque_color);
 
-        /* Set row */
-        for (x=0; x < rect->width; x++) {
+                    if (cell != NULL) {
+                        cell->analysis.num_edges++;
+                        __guac_common_surface_count_color(&cell->analysis,
+                                cell->color_table, cell->color_used,
+                                opaque_color);
+                    }
+                }
+
+            }
 
-            uint32_t old_color = *dst_current;
+            /* Vertical neighbor */
+            if (y > 0) {
+
+                analysis->num_neighbors++;
+                if (cell != NULL)
+                    cell->analysis.num_neighbors++;
+
+                if (opaque_color != (above[x] | 0xFF000000)) {
+                    analysis->num_edges++;
+                    if (cell != NULL)
+                        cell->analysis.num_edges++;
+                }
 
-            if (old_color != color) {
-                if (x < min_x) min_x = x;
-                if (y < min_y) min_y = y;
-                if (x > max_x) max_x = x;
-                if (y > max_y) max_y = y;
-                *dst_current = color;
             }
 
-            dst_current++;
+            last_pixel = opaque_color;
+
+            /* Track whether the rect consists of exactly two opaque colors */
+            if (analysis->two_color) {
+
+                int index;
+
+                if (color == colors[0])
+                    index = 0;
+
+                else if (num_colors == 2 && color == colors[1])
+                    index = 1;
+
+                /* Record second color only if opaque and not yet seen */
+                else if (num_colors == 1
+                        && (color & 0xFF000000) == 0xFF000000) {
+                    colors[1] = color;
+                    num_colors = 2;
+                    index = 1;
+                }
+
+                /* Any third (or non-opaque) color rules out two colors */
+                else {
+                    analysis->two_color = 0;
+                    continue;
+                }
+
+                /* Update count and bounds for matching color */
+                int* color_bounds = bounds[index];
+                if (x < color_bounds[0]) color_bounds[0] = x;
+                if (y < color_bounds[1]) color_bounds[1] = y;
+                if (x > color_bounds[2]) color_bounds[2] = x;
+                if (y > color_bounds[3]) color_bounds[3] = y;
+                count[index]++;
+
+            }
+
+        }
+
+        /* Classify each cell once the last of its rows within the rect has
+         * been analyzed */
+        int surface_y = rect->y + y;
+        if (cells != NULL && (y == rect->height - 1
+                    || (surface_y + 1) % GUAC_COMMON_SURFACE_HEAT_CELL_SIZE == 0)) {
+
+            guac_common_surface_heat_cell* heat_cell = surface->heat_map
+                + (surface_y / GUAC_COMMON_SURFACE_HEAT_CELL_SIZE) * heat_width
+                + min_cell_x;
+
+            for (int i = 0; i < cells_wide; i++, heat_cell++) {
+                __guac_common_surface_classify_cell(heat_cell,
+                        &cells[i].analysis);
+                analysis->content |= 1 << heat_cell->content;
+            }
+
+            __guac_common_surface_reset_cells(cells, cells_wide);
+
         }
 
         /* Next row */
-        dst_buffer += dst_stride;
+        buffer += stride;
 
     }
 
-    /* Restrict destination rect to only updated pixels */
-    if (max_x >= min_x && max_y >= min_y) {
-        rect->x += min_x;
-        rect->y += min_y;
-        rect->width = max_x - min_x + 1;
-        rect->height = max_y - min_y + 1;
-    }
-    else {
-        rect->width = 0;
-        rect->height = 0;
+    /* Solid rectangles are not two-color rectangles */
+    if (num_colors != 2)
+        analysis->two_color = 0;
+
+    /* The most common color is the background */
+    if (analysis->two_color) {
+
+        int bg = (count[0] >= count[1]) ? 0 : 1;
+        int* fg_bounds = bounds[1 - bg];
+
+        analysis->background = colors[bg];
+        guac_common_rect_init(&analysis->foreground_rect,
+                rect->x + fg_bounds[0], rect->y + fg_bounds[1],
+                fg_bounds[2] - fg_bounds[0] + 1,
+                fg_bounds[3] - fg_bounds[1] + 1);
+
     }
 
 }
 
 /**
- * Applies the Porter-Duff "over" composite operator, blending the two given
- * color components using the given alpha value.
- *
- * @param dst
- *     The destination color component.
- *
- * @param src
- *     The source color component.
+ * Returns the kind of content which best represents all of the given kinds
+ * of content, for the purpose of choosing how to encode an update containing
+ * them. Video takes precedence over photographic content, which takes
+ * precedence over text, which takes precedence over UI elements.
  *
- * @param alpha
- *     The alpha value which applies to the blending operation.
+ * @param found
+ *     A bitwise OR of (1 << content) for each kind of content present, as
+ *     stored within the content field of a guac_common_surface_analysis.
  *
  * @return
- *     The result of applying the Porter-Duff "over" composite operator to the
- *     given source and destination components.
+ *     The kind of content which best represents all given kinds of content.
  */
-static int guac_common_surface_blend_component(int dst, int src, int alpha) {
+static guac_common_surface_content __guac_common_surface_dominant_content(
+        unsigned int found) {
+
+    if (found & (1 << GUAC_COMMON_SURFACE_CONTENT_VIDEO))
+        return GUAC_COMMON_SURFACE_CONTENT_VIDEO;
 
-    int blended = src + dst * (0xFF - alpha);
+    if (found & (1 << GUAC_COMMON_SURFACE_CONTENT_PHOTO))
+        return GUAC_COMMON_SURFACE_CONTENT_PHOTO;
 
-    /* Do not exceed maximum component value */
-    if (blended > 0xFF)
-        return 0xFF;
+    if (found & (1 << GUAC_COMMON_SURFACE_CONTENT_TEXT))
+        return GUAC_COMMON_SURFACE_CONTENT_TEXT;
 
-    return blended;
+    if (found & (1 << GUAC_COMMON_SURFACE_CONTENT_UI))
+        return GUAC_COMMON_SURFACE_CONTENT_UI;
+
+    return GUAC_COMMON_SURFACE_CONTENT_UNKNOWN;
 
 }
 
 /**
- * Applies the Porter-Duff "over" composite operator, blending each component
- * of the two given ARGB colors.
- *
- * @param dst
- *     The destination ARGB color.
+ * Returns a rough approximation of whether an analyzed rectangle would be
+ * better compressed as PNG or using a lossy format like JPEG. Positive values
+ * indicate PNG is likely to be superior, while negative values indicate the
+ * opposite.
  *
- * @param src
- *     The source ARGB color.
+ * @param analysis
+ *     The analysis of the rectangle to check.
  *
  * @return
- *     The result of applying the Porter-Duff "over" composite operator to the
- *     given source and destination colors.
+ *     Positive values if PNG compression is likely to perform better than
+ *     lossy alternatives, or negative values if PNG is likely to perform
+ *     worse.
  */
-static uint32_t guac_common_surface_argb_blend(uint32_t dst, uint32_t src) {
-
-    /* Separate destination ARGB color into its components */
-    int dst_a = (dst >> 24) & 0xFF;
-    int dst_r = (dst >> 16) & 0xFF;
-    int dst_g = (dst >>  8) & 0xFF;
-    int dst_b =  dst        & 0xFF;
-
-    /* Separate source ARGB color into its components */
-    int src_a = (src >> 24) & 0xFF;
-    int src_r = (src >> 16) & 0xFF;
-    int src_g = (src >>  8) & 0xFF;
-    int src_b =  src        & 0xFF;
+static int __guac_common_surface_png_optimality(
+        const guac_common_surface_analysis* analysis) {
+    return 0x100 * analysis->num_same / analysis->num_different - 0x400;
+}
 
-    /* If source is fully opaque (or destination is fully transparent), the
-     * blended result is the source */
-    if (src_a == 0xFF || dst_a == 0x00)
-        return src;
+/**
+ * Returns whether an analyzed rectangle appears to be synthetic content, such
+ * as text or UI elements, consisting of few colors and sharp edges. Lossy
+ * compression of such content produces highly visible artifacts.
+ *
+ * @param analysis
+ *     The analysis of the rectangle to check.
+ *
+ * @return
+ *     Non-zero if the rectangle appears to be synthetic content, zero
+ *     otherwise.
+ */
+static int __guac_common_surface_is_synthetic(
+        const guac_common_surface_analysis* analysis) {
 
-    /* If source is fully transparent, the blended result is the destination */
-    if (src_a == 0x00)
-        return dst;
+    return analysis->num_colors <= GUAC_SURFACE_SYNTHETIC_COLORS
+        && analysis->num_edges * GUAC_SURFACE_SYNTHETIC_EDGE_FACTOR
+            >= analysis->num_neighbors;
 
-    /* Otherwise, blend each ARGB component, assuming pre-multiplied alpha */
-    int r = guac_common_surface_blend_component(dst_r, src_r, src_a);
-    int g = guac_common_surface_blend_component(dst_g, src_g, src_a);
-    int b = guac_common_surface_blend_component(dst_b, src_b, src_a);
-    int a = guac_common_surface_blend_component(dst_a, src_a, src_a);
+}
 
-    /* Recombine blended components */
-    return (a << 24) | (r << 16) | (g << 8) | b;
+/**
+ * Chooses the encoding that should be used to send the given rectangle of the
+ * given surface, based on the prior analysis of that rectangle and the
+ * update frequency of the surrounding area.
+ *
+ * @param surface
+ *     The surface containing the rectangle.
+ *
+ * @param rect
+ *     The rectangle being encoded.
+ *
+ * @param analysis
+ *     The analysis of the rectangle, as produced by
+ *     __guac_common_surface_analyze().
+ *
+ * @param content
+ *     The kind of content within the rectangle, as determined by the
+ *     classification of the heat map cells it covers.
+ *
+ * @return
+ *     The encoding which should be used for the rectangle.
+ */
+static guac_common_surface_codec __guac_common_surface_choose_codec(
+        guac_common_surface* surface, const guac_common_rect* rect,
+        const guac_common_surface_analysis* analysis,
+        guac_common_surface_content content) {
+
+    /* Uniform rects need no image data at all */
+    if (analysis->solid && ((analysis->color & 0xFF000000) == 0xFF000000
+                || (analysis->color & 0xFF000000) == 0))
+        return GUAC_COMMON_SURFACE_CODEC_FILL;
+
+    /* Two-color rects can be sent as a fill plus a smaller image, so long as
+     * the image is sufficiently smaller */
+    if (analysis->two_color
+            && analysis->foreground_rect.width
+                * analysis->foreground_rect.height
+                * GUAC_SURFACE_FILL_SPLIT_FACTOR
+                <= rect->width * rect->height)
+        return GUAC_COMMON_SURFACE_CODEC_SPLIT;
+
+    /* Text and UI elements would visibly suffer from lossy compression */
+    if (content == GUAC_COMMON_SURFACE_CONTENT_TEXT
+            || content == GUAC_COMMON_SURFACE_CONTENT_UI)
+        return GUAC_COMMON_SURFACE_CODEC_PNG;
+
+    /* Lossy formats are otherwise considered only for content which PNG would
+     * not compress well, and which is either known to be photographic or
+     * video, or which is changing rapidly and does not appear synthetic */
+    if (__guac_common_surface_png_optimality(analysis) >= 0)
+        return GUAC_COMMON_SURFACE_CODEC_PNG;
+
+    if (content == GUAC_COMMON_SURFACE_CONTENT_UNKNOWN
+            && (__guac_common_surface_is_synthetic(analysis)
+                || __guac_common_surface_calculate_framerate(surface, rect)
+                    < GUAC_COMMON_SURFACE_JPEG_FRAMERATE))
+        return GUAC_COMMON_SURFACE_CODEC_PNG;
+
+    /* Prefer WebP when reasonable */
+    if (guac_client_supports_webp(surface->client))
+        return GUAC_COMMON_SURFACE_CODEC_WEBP;
+
+    /* If not WebP, JPEG is the next best (lossy) choice, but only if the
+     * image is opaque, large enough and lossless quality is not required */
+    if (analysis->opaque && !surface->lossless
+            && rect->width * rect->height > GUAC_SURFACE_JPEG_MIN_BITMAP_SIZE)
+        return GUAC_COMMON_SURFACE_CODEC_JPEG;
+
+    /* Use PNG if no lossy formats are appropriate */
+    return GUAC_COMMON_SURFACE_CODEC_PNG;
 
 }
 
 /**
- * Copies data from the given buffer to the surface at the given coordinates.
- * The dimensions and location of the destination rectangle will be altered
- * to remove as many unchanged pixels as possible.
+ * Updates the heat map cells which intersect the given rectangle using the
+ * given timestamp. This timestamp, along with timestamps from past updates,
+ * is used to calculate the framerate of each heat cell.
  *
- * @param src_buffer The buffer to copy.
- * @param src_stride The number of bytes in each row of the source buffer.
- * @param sx The X coordinate of the source rectangle.
- * @param sy The Y coordinate of the source rectangle.
- * @param dst The destination surface.
- * @param rect The destination rectangle.
- * @param opaque Non-zero if the source surface is opaque (its alpha channel
- *               should be ignored), zero otherwise.
+ * @param surface
+ *     The surface containing the heat map cells to be updated.
+ *
+ * @param rect
+ *     The rectangle containing the heat map cells to be updated.
+ *
+ * @param time
+ *     The timestamp to use when updating the heat map cells which intersect
+ *     the given rectangle.
  */
-static void __guac_common_surface_put(unsigned char* src_buffer, int src_stride,
-                                      int* sx, int* sy,
-                                      guac_common_surface* dst, guac_common_rect* rect,
-                                      int opaque) {
-
-    unsigned char* dst_buffer = dst->buffer;
-    int dst_stride = dst->stride;
+static void __guac_common_surface_touch_rect(guac_common_surface* surface,
+        guac_common_rect* rect, guac_timestamp time) {
 
     int x, y;
 
-    int min_x = rect->width;
-    int min_y = rect->height;
-    int max_x = 0;
-    int max_y = 0;
+    /* Calculate heat map dimensions */
+    size_t heat_width = GUAC_COMMON_SURFACE_HEAT_DIMENSION(surface->width);
 
-    int orig_x = rect->x;
-    int orig_y = rect->y;
+    /* Calculate minimum X/Y coordinates intersecting given rect */
+    int min_x = rect->x / GUAC_COMMON_SURFACE_HEAT_CELL_SIZE;
+    int min_y = rect->y / GUAC_COMMON_SURFACE_HEAT_CELL_SIZE;
 
-    src_buffer += src_stride * (*sy) + 4 * (*sx);
-    dst_buffer += (dst_stride * rect->y) + (4 * rect->x);
-
-    /* For each row */
-    for (y=0; y < rect->height; y++) {
-
-        uint32_t* src_current = (uint32_t*) src_buffer;
-        uint32_t* dst_current = (uint32_t*) dst_buffer;
+    /* Calculate maximum X/Y coordinates intersecting given rect */
+    int max_x = min_x + (rect->width  - 1) / GUAC_COMMON_SURFACE_HEAT_CELL_SIZE;
+    int max_y = min_y + (rect->height - 1) / GUAC_COMMON_SURFACE_HEAT_CELL_SIZE;
 
-        /* Copy row */
-        for (x=0; x < rect->width; x++) {
+    /* Get start of buffer at given coordinates */
+    guac_common_surface_heat_cell* heat_row =
+        surface->heat_map + min_y * heat_width + min_x;
 
-            uint32_t color;
+    /* Update all heat map cells which intersect with rectangle */
+    for (y = min_y; y <= max_y; y++) {
 
-            /* Get source and destination color values */
-            uint32_t src_color = *src_current;
-            uint32_t dst_color = *dst_current;
+        /* Get current row of heat map */
+        guac_common_surface_heat_cell* heat_cell = heat_row;
 
-            /* Ignore alpha channel if opaque */
-            if (opaque)
-                color = src_color | 0xFF000000;
+        /* For each cell in subset of row */
+        for (x = min_x; x <= max_x; x++) {
 
-            /* Otherwise, perform alpha blending operation */
-            else
-                color = guac_common_surface_argb_blend(dst_color, src_color);
+            /* Replace oldest entry with new timestamp */
+            heat_cell->history[heat_cell->oldest_entry] = time;
 
-            /* If the destination color is changing, update rectangle bounds
-             * and store the new color */
-            if (dst_color != color) {
-                if (x < min_x) min_x = x;
-                if (y < min_y) min_y = y;
-                if (x > max_x) max_x = x;
-                if (y > max_y) max_y = y;
-                *dst_current = color;
-            }
+            /* Update to next oldest entry */
+            heat_cell->oldest_entry++;
+            if (heat_cell->oldest_entry >=
+                    GUAC_COMMON_SURFACE_HEAT_CELL_HISTORY_SIZE)
+                heat_cell->oldest_entry = 0;
 
-            /* Advance to next pixel */
-            src_current++;
-            dst_current++;
+            /* Advance to next heat map cell */
+            heat_cell++;
 
         }
 
-        /* Next row */
-        src_buffer += src_stride;
-        dst_buffer += dst_stride;
+        /* Next heat map row */
+        heat_row += heat_width;
 
     }
 
+}
+
+/**
+ * Flushes the bitmap update currently described by the dirty rectangle within
+ * the given surface to that surface's region of deferred updates.
+ *
+ * @param surface
+ *     The surface to flush.
+ */
+static void __guac_common_surface_flush_to_region(guac_common_surface* surface) {
+
+    /* Do not flush if not dirty */
+    if (!surface->dirty)
+        return;
+
+    /* Add dirty rect to region */
+    guac_common_region_union_rect(surface->dirty_region, &surface->dirty_rect);
+
+    /* Surface now flushed */
+    surface->dirty = 0;
+
+}
+
+/**
+ * Flushes the given surface, drawing any pending operations on the remote
+ * display. Surface properties are not flushed.
+ *
+ * @param surface
+ *     The surface to flush.
+ */
+static void __guac_common_surface_flush(guac_common_surface* surface);
+
+/**
+ * Schedules a deferred flush of the given surface. This will not immediately
+ * flush the surface to the client. Instead, the result of the flush is
+ * added to a region which is reinspected and combined (if possible) with other
+ * deferred flushes during the call to guac_common_surface_flush().
+ *
+ * @param surface The surface to flush.
+ */
+static void __guac_common_surface_flush_deferred(guac_common_surface* surface) {
+
+    /* Append dirty rect to region */
+    __guac_common_surface_flush_to_region(surface);
+
+}
+
+/**
+ * Restricts the given rectangle to the given range of changed pixels, where
+ * that range is relative to the rectangle's upper-left corner. If no pixels
+ * changed (the maximum coordinates are less than the minimum coordinates), the
+ * rectangle is made empty.
+ *
+ * @param rect
+ *     The rectangle to restrict.
+ *
+ * @param min_x
+ *     The X coordinate of the leftmost changed pixel.
+ *
+ * @param min_y
+ *     The Y coordinate of the topmost changed pixel.
+ *
+ * @param max_x
+ *     The X coordinate of the rightmost changed pixel.
+ *
+ * @param max_y
+ *     The Y coordinate of the bottommost changed pixel.
+ */
+static void __guac_common_surface_restrict_rect(guac_common_rect* rect,
+        int min_x, int min_y, int max_x, int max_y) {
+
     /* Restrict destination rect to only updated pixels */
     if (max_x >= min_x && max_y >= min_y) {
         rect->x += min_x;
@@ -1056,6 +1590,126 @@ static void __guac_common_surface_put(unsigned char* src_buffer, int src_stride,
         rect->height = 0;
     }
 
+}
+
+/**
+ * Assigns the given value to all pixels within a rectangle of the backing
+ * surface of the given destination surface. The color of all pixels within the
+ * rectangle, including the alpha component, is entirely replaced.
+ *
+ * @param dst
+ *     The destination surface.
+ *
+ * @param rect
+ *     The rectangle to draw.
+ *
+ * @param red
+ *     The red component of the color value to assign to all pixels within the
+ *     rectangle.
+ *
+ * @param green
+ *     The green component of the color value to assign to all pixels within
+ *     the rectangle.
+ *
+ * @param blue 
+ *     The blue component of the color value to assign to all pixels within the
+ *     rectangle.
+ *
+ * @param alpha 
+ *     The alpha component of the color value to assign to all pixels within
+ *     the rectangle.
+ */
+static void __guac_common_surface_set(guac_common_surface* dst,
+        guac_common_rect* rect, int red, int green, int blue, int alpha) {
+
+    uint32_t color = (alpha << 24) | (red << 16) | (green << 8) | blue;
+
+    int min_x = rect->width;
+    int min_y = rect->height;
+    int max_x = -1;
+    int max_y = -1;
+
+    int dst_stride = dst->stride;
+    unsigned char* dst_buffer =
+        dst->buffer + (dst_stride * rect->y) + (4 * rect->x);
+
+    /* For each row */
+    for (int y = 0; y < rect->height; y++) {
+
+        /* Set row, noting which pixels actually changed */
+        int first, last;
+        if (guac_common_pixel_fill_row((uint32_t*) dst_buffer, color,
+                    rect->width, &first, &last)) {
+            if (first < min_x) min_x = first;
+            if (last > max_x) max_x = last;
+            if (y < min_y) min_y = y;
+            max_y = y;
+        }
+
+        /* Next row */
+        dst_buffer += dst_stride;
+
+    }
+
+    __guac_common_surface_restrict_rect(rect, min_x, min_y, max_x, max_y);
+
+}
+
+/**
+ * Copies data from the given buffer to the surface at the given coordinates.
+ * The dimensions and location of the destination rectangle will be altered
+ * to remove as many unchanged pixels as possible.
+ *
+ * @param src_buffer The buffer to copy.
+ * @param src_stride The number of bytes in each row of the source buffer.
+ * @param sx The X coordinate of the source rectangle.
+ * @param sy The Y coordinate of the source rectangle.
+ * @param dst The destination surface.
+ * @param rect The destination rectangle.
+ * @param opaque Non-zero if the source surface is opaque (its alpha channel
+ *               should be ignored), zero otherwise.
+ */
+static void __guac_common_surface_put(unsigned char* src_buffer, int src_stride,
+                                      int* sx, int* sy,
+                                      guac_common_surface* dst, guac_common_rect* rect,
+                                      int opaque) {
+
+    unsigned char* dst_buffer = dst->buffer;
+    int dst_stride = dst->stride;
+
+    int min_x = rect->width;
+    int min_y = rect->height;
+    int max_x = -1;
+    int max_y = -1;
+
+    int orig_x = rect->x;
+    int orig_y = rect->y;
+
+    src_buffer += src_stride * (*sy) + 4 * (*sx);
+    dst_buffer += (dst_stride * rect->y) + (4 * rect->x);
+
+    /* For each row */
+    for (int y = 0; y < rect->height; y++) {
+
+        /* Copy row, noting which pixels actually changed */
+        int first, last;
+        if (guac_common_pixel_put_row((uint32_t*) dst_buffer,
+                    (uint32_t*) src_buffer, rect->width, opaque,
+                    &first, &last)) {
+            if (first < min_x) min_x = first;
+            if (last > max_x) max_x = last;
+            if (y < min_y) min_y = y;
+            max_y = y;
+        }
+
+        /* Next row */
+        src_buffer += src_stride;
+        dst_buffer += dst_stride;
+
+    }
+
+    __guac_common_surface_restrict_rect(rect, min_x, min_y, max_x, max_y);
+
     /* Update source X/Y */
     *sx += rect->x - orig_x;
     *sy += rect->y - orig_y;
@@ -1132,57 +1786,44 @@ static void __guac_common_surface_transfer(guac_common_surface* src, int* sx, in
                                            guac_transfer_function op,
                                            guac_common_surface* dst, guac_common_rect* rect) {
 
-    unsigned char* src_buffer = src->buffer;
-    unsigned char* dst_buffer = dst->buffer;
+    unsigned char* src_buffer = src->buffer + src->stride * (*sy) + 4 * (*sx);
+    unsigned char* dst_buffer = dst->buffer + dst->stride * rect->y + 4 * rect->x;
 
-    int x, y;
-    int src_stride, dst_stride;
-    int step = 1;
+    int src_stride = src->stride;
+    int dst_stride = dst->stride;
+    int backwards = 0;
 
-    int min_x = rect->width - 1;
-    int min_y = rect->height - 1;
-    int max_x = 0;
-    int max_y = 0;
+    int min_x = rect->width;
+    int min_y = rect->height;
+    int max_x = -1;
+    int max_y = -1;
 
     int orig_x = rect->x;
     int orig_y = rect->y;
 
-    /* Copy forwards only if destination is in a different surface or is before source */
-    if (src != dst || rect->y < *sy || (rect->y == *sy && rect->x < *sx)) {
-        src_buffer += src->stride * (*sy) + 4 * (*sx);
-        dst_buffer += (dst->stride * rect->y) + (4 * rect->x);
-        src_stride = src->stride;
-        dst_stride = dst->stride;
-        step = 1;
-    }
-
-    /* Otherwise, copy backwards */
-    else {
-        src_buffer += src->stride * (*sy + rect->height - 1) + 4 * (*sx + rect->width - 1);
-        dst_buffer += dst->stride * (rect->y + rect->height - 1) + 4 * (rect->x + rect->width - 1);
-        src_stride = -src->stride;
-        dst_stride = -dst->stride;
-        step = -1;
+    /* Copy backwards (bottom-up, right-to-left) only if destination is in the
+     * same surface and is after source */
+    if (src == dst && !(rect->y < *sy || (rect->y == *sy && rect->x < *sx))) {
+        src_buffer += src_stride * (rect->height - 1);
+        dst_buffer += dst_stride * (rect->height - 1);
+        src_stride = -src_stride;
+        dst_stride = -dst_stride;
+        backwards = 1;
     }
 
     /* For each row */
-    for (y=0; y < rect->height; y++) {
-
-        uint32_t* src_current = (uint32_t*) src_buffer;
-        uint32_t* dst_current = (uint32_t*) dst_buffer;
-
-        /* Transfer each pixel in row */
-        for (x=0; x < rect->width; x++) {
-
-            if (__guac_common_surface_transfer_int(op, src_current, dst_current)) {
-                if (x < min_x) min_x = x;
-                if (y < min_y) min_y = y;
-                if (x > max_x) max_x = x;
-                if (y > max_y) max_y = y;
-            }
-
-            src_current += step;
-            dst_current += step;
+    for (int i = 0; i < rect->height; i++) {
+
+        /* Transfer each pixel in row, noting which pixels actually changed */
+        int first, last;
+        if (guac_common_pixel_transfer_row(op, (uint32_t*) dst_buffer,
+                    (uint32_t*) src_buffer, rect->width, backwards,
+                    &first, &last)) {
+            int y = backwards ? rect->height - 1 - i : i;
+            if (first < min_x) min_x = first;
+            if (last > max_x) max_x = last;
+            if (y < min_y) min_y = y;
+            if (y > max_y) max_y = y;
         }
 
         /* Next row */
@@ -1191,31 +1832,7 @@ static void __guac_common_surface_transfer(guac_common_surface* src, int* sx, in
 
     }
 
-    /* Translate X coordinate space of moving backwards */
-    if (step < 0) {
-        int old_max_x = max_x;
-        max_x = rect->width - 1 - min_x;
-        min_x = rect->width - 1 - old_max_x;
-    }
-
-    /* Translate Y coordinate space of moving backwards */
-    if (dst_stride < 0) {
-        int old_max_y = max_y;
-        max_y = rect->height - 1 - min_y;
-        min_y = rect->height - 1 - old_max_y;
-    }
-
-    /* Restrict destination rect to only updated pixels */
-    if (max_x >= min_x && max_y >= min_y) {
-        rect->x += min_x;
-        rect->y += min_y;
-        rect->width = max_x - min_x + 1;
-        rect->height = max_y - min_y + 1;
-    }
-    else {
-        rect->width = 0;
-        rect->height = 0;
-    }
+    __guac_common_surface_restrict_rect(rect, min_x, min_y, max_x, max_y);
 
     /* Update source X/Y */
     *sx += rect->x - orig_x;
@@ -1223,59 +1840,350 @@ static void __guac_common_surface_transfer(guac_common_surface* src, int* sx, in
 
 }
 
-guac_common_surface* guac_common_surface_alloc(guac_client* client,
-        guac_socket* socket, const guac_layer* layer, int w, int h) {
+/**
+ * Returns whether the given heat map cell contains video which is still
+ * actively changing at or above the given framerate.
+ *
+ * @param heat_cell
+ *     The heat map cell to check.
+ *
+ * @param now
+ *     The current time, in milliseconds.
+ *
+ * @param min_framerate
+ *     The minimum framerate, in frames per second, at which the cell must be
+ *     changing.
+ *
+ * @return
+ *     Non-zero if the cell contains actively-changing video, zero otherwise.
+ */
+static int __guac_common_surface_cell_is_video(
+        const guac_common_surface_heat_cell* heat_cell, guac_timestamp now,
+        unsigned int min_framerate) {
 
-    /* Calculate heat map dimensions */
-    size_t heat_width = GUAC_COMMON_SURFACE_HEAT_DIMENSION(w);
-    size_t heat_height = GUAC_COMMON_SURFACE_HEAT_DIMENSION(h);
+    if (heat_cell->content != GUAC_COMMON_SURFACE_CONTENT_VIDEO)
+        return 0;
 
-    /* Init surface */
-    guac_common_surface* surface = guac_mem_zalloc(sizeof(guac_common_surface));
-    surface->client = client;
-    surface->socket = socket;
-    surface->layer = layer;
-    surface->parent = GUAC_DEFAULT_LAYER;
-    surface->opacity = 0xFF;
-    surface->width = w;
-    surface->height = h;
+    /* Ignore cells which have since stopped changing */
+    int latest_entry = heat_cell->oldest_entry - 1;
+    if (latest_entry < 0)
+        latest_entry = GUAC_COMMON_SURFACE_HEAT_CELL_HISTORY_SIZE - 1;
 
-    pthread_mutex_init(&surface->_lock, NULL);
+    if (now - heat_cell->history[latest_entry] > GUAC_SURFACE_VIDEO_IDLE_TIMEOUT)
+        return 0;
 
-    /* Create corresponding Cairo surface */
-    surface->stride = cairo_format_stride_for_width(CAIRO_FORMAT_ARGB32, w);
-    surface->buffer = guac_mem_zalloc(h, surface->stride);
+    return __guac_common_surface_cell_framerate(heat_cell) >= min_framerate;
 
-    /* Create corresponding heat map */
-    surface->heat_map = guac_mem_zalloc(heat_width, heat_height,
-            sizeof(guac_common_surface_heat_cell));
+}
 
-    /* Reset clipping rect */
-    guac_common_surface_reset_clip(surface);
+/**
+ * Stops streaming the video area of the given surface as video, ending the
+ * video stream and disposing of the layer in which it played. If requested,
+ * the contents of the former video area are added to the surface's deferred
+ * updates such that they are sent as images with the next flush.
+ *
+ * @param surface
+ *     The surface whose video stream should be stopped. If the surface is not
+ *     streaming video, this function has no effect.
+ *
+ * @param redraw
+ *     Non-zero if the former video area should be redrawn as images, zero
+ *     otherwise.
+ */
+static void __guac_common_surface_stop_video(guac_common_surface* surface,
+        int redraw) {
 
-    /* Layers must initially exist */
-    if (layer->index >= 0) {
-        guac_protocol_send_size(socket, layer, w, h);
-        surface->realized = 1;
-    }
+    if (surface->video == NULL)
+        return;
 
-    /* Defer creation of buffers */
-    else
-        surface->realized = 0;
+    guac_video_stream_free(surface->video);
 
-    return surface;
-}
+    /* Users not currently receiving updates through the surface's socket may
+     * still have received the start of the video, and the layer index may
+     * later be reused, so the layer is disposed for all users */
+    guac_protocol_send_dispose(surface->client->socket, surface->video_layer);
+    guac_client_free_layer(surface->client, surface->video_layer);
 
-void guac_common_surface_free(guac_common_surface* surface) {
+    surface->video = NULL;
+    surface->video_layer = NULL;
+    surface->video_dirty = 0;
+
+    /* The underlying layer was not updated while video was playing */
+    if (redraw)
+        guac_common_region_union_rect(surface->dirty_region,
+                &surface->video_rect);
+
+}
+
+/**
+ * Attempts to begin streaming the given area of the given surface as video,
+ * allocating a new layer above the surface in which the video plays back. If
+ * video is not supported by all users, or the video stream cannot be
+ * created, the surface continues to be streamed as images.
+ *
+ * @param surface
+ *     The surface to begin streaming as video. The surface must not already
+ *     be streaming video.
+ *
+ * @param rect
+ *     The area of the surface to stream as video, which must lie entirely
+ *     within the surface and have even dimensions.
+ */
+static void __guac_common_surface_start_video(guac_common_surface* surface,
+        const guac_common_rect* rect) {
+
+    guac_client* client = surface->client;
+    guac_socket* socket = surface->socket;
+
+    if (!guac_client_supports_video(client))
+        return;
+
+    /* Video plays within its own layer, covering the area being streamed */
+    guac_layer* layer = guac_client_alloc_layer(client);
+    guac_protocol_send_size(socket, layer, rect->width, rect->height);
+    guac_protocol_send_move(socket, layer, surface->layer,
+            rect->x, rect->y, 0);
+
+    guac_video_stream* video = guac_video_stream_alloc(client, socket, layer,
+            rect->width, rect->height, GUAC_COMMON_SURFACE_VIDEO_FRAMERATE);
+
+    if (video == NULL) {
+        guac_protocol_send_dispose(socket, layer);
+        guac_client_free_layer(client, layer);
+        return;
+    }
+
+    surface->video = video;
+    surface->video_layer = layer;
+    surface->video_rect = *rect;
+
+    /* The first frame must contain the entire area */
+    surface->video_dirty = 1;
+
+}
+
+/**
+ * Reevaluates whether any part of the given surface should be streamed as
+ * video based on the content and framerate recorded within its heat map.
+ * Video is stopped once less than half of the video area is still changing
+ * like video, and started for the bounding box of all heat map cells
+ * containing video if there are enough such cells and they occupy at least
+ * half of that box. Evaluation occurs at most once every
+ * GUAC_SURFACE_VIDEO_EVALUATE_INTERVAL milliseconds.
+ *
+ * @param surface
+ *     The surface to evaluate.
+ */
+static void __guac_common_surface_update_video(guac_common_surface* surface) {
+
+    guac_timestamp now = guac_timestamp_current();
+    if (now - surface->video_evaluated < GUAC_SURFACE_VIDEO_EVALUATE_INTERVAL)
+        return;
+
+    surface->video_evaluated = now;
+
+    size_t heat_width = GUAC_COMMON_SURFACE_HEAT_DIMENSION(surface->width);
+
+    /* Stop video once the area is no longer behaving like video. A lower
+     * framerate threshold is used than for starting video, such that
+     * content hovering around the threshold does not flap between video and
+     * images. */
+    if (surface->video != NULL) {
+
+        const guac_common_rect* rect = &surface->video_rect;
+        int min_x = rect->x / GUAC_COMMON_SURFACE_HEAT_CELL_SIZE;
+        int min_y = rect->y / GUAC_COMMON_SURFACE_HEAT_CELL_SIZE;
+        int max_x = (rect->x + rect->width) / GUAC_COMMON_SURFACE_HEAT_CELL_SIZE;
+        int max_y = (rect->y + rect->height) / GUAC_COMMON_SURFACE_HEAT_CELL_SIZE;
+
+        int total = 0;
+        int video = 0;
+        for (int y = min_y; y < max_y; y++) {
+            const guac_common_surface_heat_cell* heat_cell =
+                surface->heat_map + y * heat_width + min_x;
+            for (int x = min_x; x < max_x; x++, heat_cell++) {
+                video += __guac_common_surface_cell_is_video(heat_cell, now,
+                        GUAC_COMMON_SURFACE_JPEG_FRAMERATE);
+                total++;
+            }
+        }
+
+        if (video * 2 < total)
+            __guac_common_surface_stop_video(surface, 1);
+
+        return;
+
+    }
+
+    /* Video cannot be played within off-screen buffers, and would violate
+     * any requirement for lossless updates */
+    if (surface->layer->index < 0 || surface->lossless)
+        return;
+
+    /* Only heat map cells lying entirely within the surface are considered,
+     * such that the video area always has even dimensions */
+    int cells_wide = surface->width / GUAC_COMMON_SURFACE_HEAT_CELL_SIZE;
+    int cells_high = surface->height / GUAC_COMMON_SURFACE_HEAT_CELL_SIZE;
+
+    int min_x = cells_wide;
+    int min_y = cells_high;
+    int max_x = -1;
+    int max_y = -1;
+    int video = 0;
+
+    /* Find bounding box of all cells containing video */
+    for (int y = 0; y < cells_high; y++) {
+        const guac_common_surface_heat_cell* heat_cell =
+            surface->heat_map + y * heat_width;
+        for (int x = 0; x < cells_wide; x++, heat_cell++) {
+
+            if (!__guac_common_surface_cell_is_video(heat_cell, now,
+                        GUAC_COMMON_SURFACE_VIDEO_FRAMERATE))
+                continue;
+
+            if (x < min_x) min_x = x;
+            if (x > max_x) max_x = x;
+            if (y < min_y) min_y = y;
+            if (y > max_y) max_y = y;
+            video++;
+
+        }
+    }
+
+    if (video < GUAC_SURFACE_VIDEO_MIN_CELLS)
+        return;
+
+    /* Do not stream unrelated content as video merely because it lies
+     * between separate areas of video */
+    int total = (max_x - min_x + 1) * (max_y - min_y + 1);
+    if (video * 2 < total)
+        return;
+
+    guac_common_rect rect;
+    guac_common_rect_init(&rect,
+            min_x * GUAC_COMMON_SURFACE_HEAT_CELL_SIZE,
+            min_y * GUAC_COMMON_SURFACE_HEAT_CELL_SIZE,
+            (max_x - min_x + 1) * GUAC_COMMON_SURFACE_HEAT_CELL_SIZE,
+            (max_y - min_y + 1) * GUAC_COMMON_SURFACE_HEAT_CELL_SIZE);
+
+    __guac_common_surface_start_video(surface, &rect);
+
+}
+
+/**
+ * Writes the current contents of the video area of the given surface as the
+ * next frame of its video stream, if that area has changed since the last
+ * frame was written. If the frame cannot be written, video is stopped and
+ * the area is sent as images instead.
+ *
+ * @param surface
+ *     The surface whose video stream should be updated.
+ */
+static void __guac_common_surface_flush_video(guac_common_surface* surface) {
+
+    if (surface->video == NULL || !surface->video_dirty)
+        return;
+
+    const guac_common_rect* rect = &surface->video_rect;
+
+    /* Wrap video area of surface within a Cairo surface */
+    unsigned char* buffer = surface->buffer + rect->y * surface->stride
+        + rect->x * 4;
+    cairo_surface_t* frame = cairo_image_surface_create_for_data(buffer,
+            CAIRO_FORMAT_RGB24, rect->width, rect->height, surface->stride);
+
+    if (guac_video_stream_write(surface->video, frame)) {
+        guac_client_log(surface->client, GUAC_LOG_DEBUG, "Video frame could "
+                "not be encoded. Falling back to images.");
+        __guac_common_surface_stop_video(surface, 1);
+    }
+
+    cairo_surface_destroy(frame);
+    surface->video_dirty = 0;
+
+}
+
+guac_common_surface* guac_common_surface_alloc(guac_client* client,
+        guac_socket* socket, const guac_layer* layer, int w, int h) {
+    return guac_common_surface_alloc_pooled(NULL, client, socket, layer, w, h);
+}
+
+guac_common_surface* guac_common_surface_alloc_pooled(
+        guac_common_surface_pool* pool, guac_client* client,
+        guac_socket* socket, const guac_layer* layer, int w, int h) {
+
+    /* Init surface */
+    guac_common_surface* surface = guac_mem_zalloc(sizeof(guac_common_surface));
+    surface->client = client;
+    surface->socket = socket;
+    surface->layer = layer;
+    surface->parent = GUAC_DEFAULT_LAYER;
+    surface->opacity = 0xFF;
+    surface->width = w;
+    surface->height = h;
+    surface->pool = pool;
+    surface->last_modified = guac_timestamp_current();
+
+    pthread_mutex_init(&surface->_lock, NULL);
+
+    /* Create corresponding Cairo surface */
+    surface->stride = cairo_format_stride_for_width(CAIRO_FORMAT_ARGB32, w);
+    surface->buffer = guac_common_surface_pool_zalloc(pool,
+            __guac_common_surface_buffer_size(h, surface->stride));
+
+    /* Create corresponding heat map */
+    surface->heat_map = guac_common_surface_pool_zalloc(pool,
+            __guac_common_surface_heat_map_size(w, h));
+
+    /* Deferred updates are initially empty */
+    surface->dirty_region = guac_common_region_alloc();
+    surface->budget_region = guac_common_region_alloc();
+    surface->content_region = guac_common_region_alloc();
+    surface->lossy_region = guac_common_region_alloc();
+    surface->refresh_interval = GUAC_COMMON_SURFACE_REFRESH_INTERVAL;
+
+    /* Reset clipping rect */
+    guac_common_surface_reset_clip(surface);
+
+    /* Layers must initially exist */
+    if (layer->index >= 0) {
+        guac_protocol_send_size(socket, layer, w, h);
+        surface->realized = 1;
+    }
+
+    /* Defer creation of buffers */
+    else
+        surface->realized = 0;
+
+    return surface;
+}
+
+void guac_common_surface_free(guac_common_surface* surface) {
+
+    /* End any video stream */
+    __guac_common_surface_stop_video(surface, 0);
 
     /* Only dispose of surface if it exists */
     if (surface->realized)
         guac_protocol_send_dispose(surface->socket, surface->layer);
 
+    __guac_common_surface_drop_snapshot(surface);
+
     pthread_mutex_destroy(&surface->_lock);
 
-    guac_mem_free(surface->heat_map);
-    guac_mem_free(surface->buffer);
+    guac_common_region_free(surface->dirty_region);
+    guac_common_region_free(surface->budget_region);
+    guac_common_region_free(surface->content_region);
+    guac_common_region_free(surface->lossy_region);
+
+    guac_common_surface_pool_release(surface->pool, surface->heat_map,
+            __guac_common_surface_heat_map_size(surface->width,
+                surface->height));
+
+    guac_common_surface_pool_release(surface->pool, surface->buffer,
+            __guac_common_surface_buffer_size(surface->height,
+                surface->stride));
+
     guac_mem_free(surface);
 
 }
@@ -1294,24 +2202,31 @@ void guac_common_surface_resize(guac_common_surface* surface, int w, int h) {
     unsigned char* old_buffer;
     int old_stride;
     guac_common_rect old_rect;
+    guac_common_rect bounds;
 
     int sx = 0;
     int sy = 0;
 
-    /* Calculate heat map dimensions */
-    size_t heat_width = GUAC_COMMON_SURFACE_HEAT_DIMENSION(w);
-    size_t heat_height = GUAC_COMMON_SURFACE_HEAT_DIMENSION(h);
+    /* Existing contents must be present to be preserved */
+    __guac_common_surface_use(surface);
+
+    /* The heat map which justified any video stream is about to be
+     * discarded */
+    __guac_common_surface_stop_video(surface, 1);
 
     /* Copy old surface data */
     old_buffer = surface->buffer;
     old_stride = surface->stride;
     guac_common_rect_init(&old_rect, 0, 0, surface->width, surface->height);
+    int old_width = surface->width;
+    int old_height = surface->height;
 
     /* Re-initialize at new size */
     surface->width  = w;
     surface->height = h;
     surface->stride = cairo_format_stride_for_width(CAIRO_FORMAT_ARGB32, w);
-    surface->buffer = guac_mem_zalloc(h, surface->stride);
+    surface->buffer = guac_common_surface_pool_zalloc(surface->pool,
+            __guac_common_surface_buffer_size(h, surface->stride));
     __guac_common_bound_rect(surface, &surface->clip_rect, NULL, NULL);
 
     /* Copy relevant old data */
@@ -1319,12 +2234,24 @@ void guac_common_surface_resize(guac_common_surface* surface, int w, int h) {
     __guac_common_surface_put(old_buffer, old_stride, &sx, &sy, surface, &old_rect, 1);
 
     /* Free old data */
-    guac_mem_free(old_buffer);
+    guac_common_surface_pool_release(surface->pool, old_buffer,
+            __guac_common_surface_buffer_size(old_height, old_stride));
+
+    /* Any cached snapshot no longer matches the surface */
+    __guac_common_surface_drop_snapshot(surface);
+    surface->last_modified = guac_timestamp_current();
 
     /* Allocate completely new heat map (can safely discard old stats) */
-    guac_mem_free(surface->heat_map);
-    surface->heat_map = guac_mem_zalloc(heat_width, heat_height,
-            sizeof(guac_common_surface_heat_cell));
+    guac_common_surface_pool_release(surface->pool, surface->heat_map,
+            __guac_common_surface_heat_map_size(old_width, old_height));
+    surface->heat_map = guac_common_surface_pool_zalloc(surface->pool,
+            __guac_common_surface_heat_map_size(w, h));
+
+    /* The new heat map has no record of which areas changed, so users not
+     * receiving live updates must be sent the surface in full */
+    guac_common_rect_init(&bounds, 0, 0, w, h);
+    __guac_common_surface_stamp_rect(surface, &bounds,
+            surface->last_modified);
 
     /* Resize dirty rect to fit new surface dimensions */
     if (surface->dirty) {
@@ -1345,6 +2272,7 @@ complete:
 void guac_common_surface_draw(guac_common_surface* surface, int x, int y, cairo_surface_t* src) {
 
     pthread_mutex_lock(&surface->_lock);
+    __guac_common_surface_use(surface);
 
     unsigned char* buffer = cairo_image_surface_get_data(src);
     cairo_format_t format = cairo_image_surface_get_format(src);
@@ -1368,6 +2296,8 @@ void guac_common_surface_draw(guac_common_surface* surface, int x, int y, cairo_
     if (rect.width <= 0 || rect.height <= 0)
         goto complete;
 
+    __guac_common_surface_mark_modified(surface, &rect);
+
     /* Update the heat map for the update rectangle. */
     guac_timestamp time = guac_timestamp_current();
     __guac_common_surface_touch_rect(surface, &rect, time);
@@ -1388,6 +2318,7 @@ void guac_common_surface_paint(guac_common_surface* surface, int x, int y,
         cairo_surface_t* src, int red, int green, int blue) {
 
     pthread_mutex_lock(&surface->_lock);
+    __guac_common_surface_use(surface);
 
     unsigned char* buffer = cairo_image_surface_get_data(src);
     int stride = cairo_image_surface_get_stride(src);
@@ -1407,6 +2338,7 @@ void guac_common_surface_paint(guac_common_surface* surface, int x, int y,
 
     /* Update backing surface */
     __guac_common_surface_fill_mask(buffer, stride, sx, sy, surface, &rect, red, green, blue);
+    __guac_common_surface_mark_modified(surface, &rect);
 
     /* Flush if not combining */
     if (!__guac_common_should_combine(surface, &rect, 0))
@@ -1428,6 +2360,9 @@ void guac_common_surface_copy(guac_common_surface* src, int sx, int sy,
     if (src != dst)
         pthread_mutex_lock(&src->_lock);
 
+    __guac_common_surface_use(dst);
+    __guac_common_surface_use(src);
+
     guac_socket* socket = dst->socket;
     const guac_layer* src_layer = src->layer;
     const guac_layer* dst_layer = dst->layer;
@@ -1460,17 +2395,27 @@ void guac_common_surface_copy(guac_common_surface* src, int sx, int sy,
             goto complete;
     }
 
+    /* The source layer does not contain the current contents of its video
+     * area, if any, so copies from that area must be sent as images */
+    guac_common_rect video_srect;
+    guac_common_rect_init(&video_srect, srect.x, srect.y,
+            drect.width, drect.height);
+
     /* Defer if combining */
-    if (__guac_common_should_combine(dst, &drect, 1))
+    if (__guac_common_should_combine(dst, &drect, 1)
+            || __guac_common_surface_video_intersects(src, &video_srect))
         __guac_common_mark_dirty(dst, &drect);
 
     /* Otherwise, flush and draw immediately */
     else {
         __guac_common_surface_flush(dst);
         __guac_common_surface_flush(src);
+        if (__guac_common_surface_video_intersects(dst, &drect))
+            dst->video_dirty = 1;
         guac_protocol_send_copy(socket, src_layer, srect.x, srect.y,
                 drect.width, drect.height, GUAC_COMP_OVER, dst_layer,
                 drect.x, drect.y);
+        __guac_common_surface_copy_lossy(src, &video_srect, dst, &drect);
         dst->realized = 1;
     }
 
@@ -1479,6 +2424,8 @@ void guac_common_surface_copy(guac_common_surface* src, int sx, int sy,
         __guac_common_surface_transfer(src, &srect.x, &srect.y,
                 GUAC_TRANSFER_BINARY_SRC, dst, &drect);
 
+    __guac_common_surface_mark_modified(dst, &drect);
+
 complete:
 
     /* Unlock both surfaces */
@@ -1496,6 +2443,9 @@ void guac_common_surface_transfer(guac_common_surface* src, int sx, int sy, int
     if (src != dst)
         pthread_mutex_lock(&src->_lock);
 
+    __guac_common_surface_use(dst);
+    __guac_common_surface_use(src);
+
     guac_socket* socket = dst->socket;
     const guac_layer* src_layer = src->layer;
     const guac_layer* dst_layer = dst->layer;
@@ -1527,16 +2477,26 @@ void guac_common_surface_transfer(guac_common_surface* src, int sx, int sy, int
             goto complete;
     }
 
+    /* The source layer does not contain the current contents of its video
+     * area, if any, so copies from that area must be sent as images */
+    guac_common_rect video_srect;
+    guac_common_rect_init(&video_srect, srect.x, srect.y,
+            drect.width, drect.height);
+
     /* Defer if combining */
-    if (__guac_common_should_combine(dst, &drect, 1))
+    if (__guac_common_should_combine(dst, &drect, 1)
+            || __guac_common_surface_video_intersects(src, &video_srect))
         __guac_common_mark_dirty(dst, &drect);
 
     /* Otherwise, flush and draw immediately */
     else {
         __guac_common_surface_flush(dst);
         __guac_common_surface_flush(src);
+        if (__guac_common_surface_video_intersects(dst, &drect))
+            dst->video_dirty = 1;
         guac_protocol_send_transfer(socket, src_layer, srect.x, srect.y,
                 drect.width, drect.height, op, dst_layer, drect.x, drect.y);
+        __guac_common_surface_copy_lossy(src, &video_srect, dst, &drect);
         dst->realized = 1;
     }
 
@@ -1544,6 +2504,8 @@ void guac_common_surface_transfer(guac_common_surface* src, int sx, int sy, int
     if (src == dst)
         __guac_common_surface_transfer(src, &srect.x, &srect.y, op, dst, &drect);
 
+    __guac_common_surface_mark_modified(dst, &drect);
+
 complete:
 
     /* Unlock both surfaces */
@@ -1557,6 +2519,7 @@ void guac_common_surface_set(guac_common_surface* surface,
         int x, int y, int w, int h, int red, int green, int blue, int alpha) {
 
     pthread_mutex_lock(&surface->_lock);
+    __guac_common_surface_use(surface);
 
     guac_socket* socket = surface->socket;
     const guac_layer* layer = surface->layer;
@@ -1574,6 +2537,8 @@ void guac_common_surface_set(guac_common_surface* surface,
     if (rect.width <= 0 || rect.height <= 0)
         goto complete;
 
+    __guac_common_surface_mark_modified(surface, &rect);
+
     /* Handle as normal draw if non-opaque */
     if (alpha != 0xFF) {
 
@@ -1593,8 +2558,11 @@ void guac_common_surface_set(guac_common_surface* surface,
     /* Otherwise, flush and draw immediately */
     else {
         __guac_common_surface_flush(surface);
+        if (__guac_common_surface_video_intersects(surface, &rect))
+            surface->video_dirty = 1;
         guac_protocol_send_rect(socket, layer, rect.x, rect.y, rect.width, rect.height);
         guac_protocol_send_cfill(socket, GUAC_COMP_OVER, layer, red, green, blue, alpha);
+        guac_common_region_subtract_rect(surface->lossy_region, &rect);
         surface->realized = 1;
     }
 
@@ -1675,367 +2643,1206 @@ static void __guac_common_surface_flush_to_png(guac_common_surface* surface,
             guac_protocol_send_cfill(socket, GUAC_COMP_ROUT, layer,
                     0x00, 0x00, 0x00, 0xFF);
 
-        }
+        }
+
+        /* Send PNG for rect */
+        guac_client_stream_png(surface->client, socket, GUAC_COMP_OVER,
+                layer, surface->dirty_rect.x, surface->dirty_rect.y, rect);
+
+        cairo_surface_destroy(rect);
+        surface->realized = 1;
+
+        /* Rect is now lossless */
+        guac_common_region_subtract_rect(surface->lossy_region,
+                &surface->dirty_rect);
+
+        /* Surface is no longer dirty */
+        surface->dirty = 0;
+
+    }
+
+}
+
+/**
+ * Flushes the bitmap update currently described by the dirty rectangle within
+ * the given surface directly via "rect" and "cfill" instructions, as the
+ * entire dirty rectangle is known to be the given solid color. No image
+ * stream is needed. The resulting instructions will be sent over the socket
+ * associated with the given surface.
+ *
+ * @param surface
+ *     The surface to flush.
+ *
+ * @param color
+ *     The ARGB color of every pixel within the dirty rectangle. This color
+ *     must be either fully opaque or fully transparent.
+ */
+static void __guac_common_surface_flush_to_fill(guac_common_surface* surface,
+        uint32_t color) {
+
+    if (surface->dirty) {
+
+        guac_socket* socket = surface->socket;
+        const guac_layer* layer = surface->layer;
+
+        guac_protocol_send_rect(socket, layer,
+                surface->dirty_rect.x, surface->dirty_rect.y,
+                surface->dirty_rect.width, surface->dirty_rect.height);
+
+        /* Fully-transparent fills simply clear the destination rect */
+        if ((color & 0xFF000000) == 0)
+            guac_protocol_send_cfill(socket, GUAC_COMP_ROUT, layer,
+                    0x00, 0x00, 0x00, 0xFF);
+
+        /* Otherwise draw the opaque color directly */
+        else
+            guac_protocol_send_cfill(socket, GUAC_COMP_OVER, layer,
+                    (color >> 16) & 0xFF, (color >> 8) & 0xFF, color & 0xFF,
+                    0xFF);
+
+        surface->realized = 1;
+
+        /* Rect is now lossless */
+        guac_common_region_subtract_rect(surface->lossy_region,
+                &surface->dirty_rect);
+
+        /* Surface is no longer dirty */
+        surface->dirty = 0;
+
+    }
+
+}
+
+/**
+ * Returns an appropriate quality between 0 and 100 for lossy encoding
+ * depending on the network conditions estimated for the users of the given
+ * client.
+ *
+ * @param client
+ *     The client for which the lossy quality is being calculated.
+ *
+ * @return
+ *     A value between 0 and 100 inclusive which seems appropriate for the
+ *     client based on round-trip time, delivery rate, and queueing delay
+ *     measurements.
+ */
+static int guac_common_surface_suggest_quality(guac_client* client) {
+    return guac_client_suggest_quality(client);
+}
+
+/**
+ * Flushes the bitmap update currently described by the dirty rectangle within
+ * the given surface directly via an "img" instruction as JPEG data. The
+ * resulting instructions will be sent over the socket associated with the
+ * given surface.
+ *
+ * @param surface
+ *     The surface to flush.
+ */
+static void __guac_common_surface_flush_to_jpeg(guac_common_surface* surface) {
+
+    if (surface->dirty) {
+
+        guac_socket* socket = surface->socket;
+        const guac_layer* layer = surface->layer;
+
+        guac_common_rect max;
+        guac_common_rect_init(&max, 0, 0, surface->width, surface->height);
+
+        /* Expand the dirty rect size to fit in a grid with cells equal to the
+         * minimum JPEG block size */
+        guac_common_rect_expand_to_grid(GUAC_SURFACE_JPEG_BLOCK_SIZE,
+                                        &surface->dirty_rect, &max);
+
+        /* Get Cairo surface for specified rect */
+        unsigned char* buffer = surface->buffer
+                              + surface->dirty_rect.y * surface->stride
+                              + surface->dirty_rect.x * 4;
+
+        cairo_surface_t* rect = cairo_image_surface_create_for_data(buffer,
+                CAIRO_FORMAT_RGB24, surface->dirty_rect.width,
+                surface->dirty_rect.height, surface->stride);
+
+        /* Send JPEG for rect */
+        guac_client_stream_jpeg(surface->client, socket, GUAC_COMP_OVER, layer,
+                surface->dirty_rect.x, surface->dirty_rect.y, rect,
+                guac_common_surface_suggest_quality(surface->client));
+
+        cairo_surface_destroy(rect);
+        surface->realized = 1;
+
+        /* Rect must eventually be refreshed losslessly */
+        guac_common_region_union_rect(surface->lossy_region,
+                &surface->dirty_rect);
+
+        /* Surface is no longer dirty */
+        surface->dirty = 0;
+
+    }
+
+}
+
+/**
+ * Flushes the bitmap update currently described by the dirty rectangle within
+ * the given surface directly via an "img" instruction as WebP data. The
+ * resulting instructions will be sent over the socket associated with the
+ * given surface.
+ *
+ * @param surface
+ *     The surface to flush.
+ *
+ * @param opaque
+ *     Whether the rectangle being flushed contains only fully-opaque pixels.
+ */
+static void __guac_common_surface_flush_to_webp(guac_common_surface* surface,
+        int opaque) {
+
+    if (surface->dirty) {
+
+        guac_socket* socket = surface->socket;
+        const guac_layer* layer = surface->layer;
+
+        guac_common_rect max;
+        guac_common_rect_init(&max, 0, 0, surface->width, surface->height);
+
+        /* Expand the dirty rect size to fit in a grid with cells equal to the
+         * minimum WebP block size */
+        guac_common_rect_expand_to_grid(GUAC_SURFACE_WEBP_BLOCK_SIZE,
+                                        &surface->dirty_rect, &max);
+
+        /* Get Cairo surface for specified rect */
+        unsigned char* buffer = surface->buffer
+                              + surface->dirty_rect.y * surface->stride
+                              + surface->dirty_rect.x * 4;
+
+        cairo_surface_t* rect;
+
+        /* Use RGB24 if the image is fully opaque */
+        if (opaque)
+            rect = cairo_image_surface_create_for_data(buffer,
+                    CAIRO_FORMAT_RGB24, surface->dirty_rect.width,
+                    surface->dirty_rect.height, surface->stride);
+
+        /* Otherwise ARGB32 is needed */
+        else
+            rect = cairo_image_surface_create_for_data(buffer,
+                    CAIRO_FORMAT_ARGB32, surface->dirty_rect.width,
+                    surface->dirty_rect.height, surface->stride);
+
+        /* Send WebP for rect */
+        guac_client_stream_webp(surface->client, socket, GUAC_COMP_OVER, layer,
+                surface->dirty_rect.x, surface->dirty_rect.y, rect,
+                guac_common_surface_suggest_quality(surface->client),
+                surface->lossless ? 1 : 0);
+
+        cairo_surface_destroy(rect);
+        surface->realized = 1;
+
+        /* Track whether rect must eventually be refreshed losslessly */
+        if (surface->lossless)
+            guac_common_region_subtract_rect(surface->lossy_region,
+                    &surface->dirty_rect);
+        else
+            guac_common_region_union_rect(surface->lossy_region,
+                    &surface->dirty_rect);
+
+        /* Surface is no longer dirty */
+        surface->dirty = 0;
+
+    }
+
+}
+
+/**
+ * Flushes the bitmap update currently described by the dirty rectangle within
+ * the given guac_common_surface, choosing the encoding best suited to its
+ * contents, which must all be of the given kind.
+ *
+ * @param surface
+ *     The surface whose dirty rectangle should be flushed.
+ *
+ * @param content
+ *     The kind of content within the dirty rectangle.
+ *
+ * @param initial
+ *     An existing analysis of the entire dirty rectangle, or NULL if the
+ *     dirty rectangle has not yet been analyzed.
+ */
+static void __guac_common_surface_flush_content(guac_common_surface* surface,
+        guac_common_surface_content content,
+        const guac_common_surface_analysis* initial) {
+
+    guac_common_surface_analysis analysis;
+    guac_common_surface_codec codec;
+
+    /* Reuse any existing analysis rather than reading the pixels again */
+    if (initial != NULL)
+        analysis = *initial;
+    else
+        __guac_common_surface_analyze(surface, &surface->dirty_rect,
+                &analysis, NULL);
+
+    for (;;) {
+
+        codec = __guac_common_surface_choose_codec(surface,
+                &surface->dirty_rect, &analysis, content);
+
+        /* Uniform rects need no image data at all */
+        if (codec == GUAC_COMMON_SURFACE_CODEC_FILL) {
+            __guac_common_surface_flush_to_fill(surface, analysis.color);
+            return;
+        }
+
+        /* For two-color rects, fill with the most common color and analyze
+         * only the (smaller) area covering the other color */
+        if (codec != GUAC_COMMON_SURFACE_CODEC_SPLIT)
+            break;
+
+        __guac_common_surface_flush_to_fill(surface, analysis.background);
+        __guac_common_mark_dirty(surface, &analysis.foreground_rect);
+        __guac_common_surface_analyze(surface, &surface->dirty_rect,
+                &analysis, NULL);
+
+    }
+
+    switch (codec) {
+
+        case GUAC_COMMON_SURFACE_CODEC_WEBP:
+            __guac_common_surface_flush_to_webp(surface, analysis.opaque);
+            break;
+
+        case GUAC_COMMON_SURFACE_CODEC_JPEG:
+            __guac_common_surface_flush_to_jpeg(surface);
+            break;
+
+        default:
+            __guac_common_surface_flush_to_png(surface, analysis.opaque);
+            break;
+
+    }
+
+}
+
+/**
+ * The state of an in-progress split of a bitmap update into parts having
+ * different kinds of content.
+ */
+typedef struct guac_common_surface_content_split {
+
+    /**
+     * The surface being flushed.
+     */
+    guac_common_surface* surface;
+
+    /**
+     * The kind of content representing the parts currently being flushed.
+     */
+    guac_common_surface_content content;
+
+} guac_common_surface_content_split;
+
+/**
+ * Callback for guac_common_region_foreach_rect() which flushes a single part
+ * of a bitmap update split by content. The data pointer must point to the
+ * guac_common_surface_content_split describing the split.
+ *
+ * @param rect
+ *     The part of the bitmap update to flush.
+ *
+ * @param data
+ *     The guac_common_surface_content_split describing the split.
+ */
+static void __guac_common_surface_flush_content_rect(
+        const guac_common_rect* rect, void* data) {
+
+    guac_common_surface_content_split* split =
+        (guac_common_surface_content_split*) data;
+
+    __guac_common_mark_dirty(split->surface, rect);
+    __guac_common_surface_flush_content(split->surface, split->content,
+            NULL);
+
+}
+
+/**
+ * Flushes the bitmap update currently described by the dirty rectangle within
+ * the given surface, choosing the most appropriate way to send that update
+ * based on its contents. Uniform updates are sent as solid fills, while all
+ * other updates are sent as image data using the best available format.
+ * Updates covering different kinds of content (text beside video, for
+ * example) are split so that each part is sent in the format suiting it.
+ *
+ * @param surface
+ *     The surface to flush.
+ */
+static void __guac_common_surface_flush_bitmap(guac_common_surface* surface) {
+
+    /* Classify the heat map cells covered by the update in the same pass
+     * that analyzes the update as a whole */
+    int cells_wide =
+          (surface->dirty_rect.x + surface->dirty_rect.width - 1)
+            / GUAC_COMMON_SURFACE_HEAT_CELL_SIZE
+        - surface->dirty_rect.x / GUAC_COMMON_SURFACE_HEAT_CELL_SIZE + 1;
+
+    guac_common_surface_cell_analysis* cells = guac_mem_arena_alloc(
+            sizeof(guac_common_surface_cell_analysis), cells_wide);
+
+    guac_common_surface_analysis analysis;
+    __guac_common_surface_analyze(surface, &surface->dirty_rect, &analysis,
+            cells);
+
+    guac_mem_arena_free(cells);
+
+    unsigned int found = analysis.content;
+
+    unsigned int lossy_mask = (1 << GUAC_COMMON_SURFACE_CONTENT_PHOTO)
+                            | (1 << GUAC_COMMON_SURFACE_CONTENT_VIDEO);
+
+    unsigned int lossless_mask = (1 << GUAC_COMMON_SURFACE_CONTENT_TEXT)
+                               | (1 << GUAC_COMMON_SURFACE_CONTENT_UI);
+
+    /* Flush as a single update unless the update covers both content best
+     * sent lossily and content which should remain lossless */
+    if (!(found & lossy_mask) || !(found & lossless_mask)) {
+        __guac_common_surface_flush_content(surface,
+                __guac_common_surface_dominant_content(found), &analysis);
+        return;
+    }
+
+    /* Otherwise, split the update along heat map cell boundaries, flushing
+     * the lossy and lossless parts separately */
+    guac_common_rect rect = surface->dirty_rect;
+    surface->dirty = 0;
+
+    size_t heat_width = GUAC_COMMON_SURFACE_HEAT_DIMENSION(surface->width);
+
+    int min_x = rect.x / GUAC_COMMON_SURFACE_HEAT_CELL_SIZE;
+    int min_y = rect.y / GUAC_COMMON_SURFACE_HEAT_CELL_SIZE;
+    int max_x = (rect.x + rect.width  - 1) / GUAC_COMMON_SURFACE_HEAT_CELL_SIZE;
+    int max_y = (rect.y + rect.height - 1) / GUAC_COMMON_SURFACE_HEAT_CELL_SIZE;
+
+    guac_common_surface_content_split split = { .surface = surface };
+
+    for (int lossy = 0; lossy <= 1; lossy++) {
+
+        guac_common_region_clear(surface->content_region);
+
+        /* Gather all parts of the update which should (or should not) be
+         * sent lossily. Unclassified cells remain lossless. */
+        for (int y = min_y; y <= max_y; y++) {
+
+            const guac_common_surface_heat_cell* heat_cell =
+                surface->heat_map + y * heat_width + min_x;
+
+            for (int x = min_x; x <= max_x; x++, heat_cell++) {
+
+                if (__guac_common_surface_is_lossy_content(heat_cell->content)
+                        != lossy)
+                    continue;
+
+                guac_common_rect cell;
+                guac_common_rect_init(&cell,
+                        x * GUAC_COMMON_SURFACE_HEAT_CELL_SIZE,
+                        y * GUAC_COMMON_SURFACE_HEAT_CELL_SIZE,
+                        GUAC_COMMON_SURFACE_HEAT_CELL_SIZE,
+                        GUAC_COMMON_SURFACE_HEAT_CELL_SIZE);
+                guac_common_rect_constrain(&cell, &rect);
+
+                guac_common_region_union_rect(surface->content_region, &cell);
+
+            }
+
+        }
+
+        split.content = __guac_common_surface_dominant_content(
+                found & (lossy ? lossy_mask : lossless_mask));
+
+        guac_common_region_foreach_rect(surface->content_region,
+                __guac_common_surface_flush_content_rect, &split);
+
+    }
+
+    guac_common_region_clear(surface->content_region);
+
+}
+
+/**
+ * Flushes only the properties of the given surface, such as layer location or
+ * opacity. Image state is not flushed. If the surface represents a buffer or
+ * the default layer, this function has no effect.
+ *
+ * @param surface
+ *     The surface to flush.
+ */
+static void __guac_common_surface_flush_properties(
+        guac_common_surface* surface) {
+
+    guac_socket* socket = surface->socket;
+
+    /* Only applicable to non-default visible layers */
+    if (surface->layer->index <= 0)
+        return;
+
+    /* Flush opacity */
+    if (surface->opacity_dirty) {
+        guac_protocol_send_shade(socket, surface->layer, surface->opacity);
+        surface->opacity_dirty = 0;
+    }
+
+    /* Flush location and hierarchy */
+    if (surface->location_dirty) {
+        guac_protocol_send_move(socket, surface->layer,
+                surface->parent, surface->x, surface->y, surface->z);
+        surface->location_dirty = 0;
+    }
+
+}
+
+/**
+ * Callback for guac_common_region_foreach_rect() which combines each deferred
+ * update with the surface's current dirty rectangle where cost estimates show
+ * a benefit, flushing the dirty rectangle as a bitmap otherwise. As the region
+ * provides updates ordered top to bottom and left to right, neighboring
+ * updates are considered for combination one after the other.
+ *
+ * @param rect
+ *     The deferred update being flushed.
+ *
+ * @param data
+ *     The guac_common_surface being flushed.
+ */
+static void __guac_common_surface_flush_rect(const guac_common_rect* rect,
+        void* data) {
+
+    guac_common_surface* surface = (guac_common_surface*) data;
+
+    /* Clip update within current bounds */
+    guac_common_rect bounded = *rect;
+    __guac_common_bound_rect(surface, &bounded, NULL, NULL);
+    if (bounded.width <= 0 || bounded.height <= 0)
+        return;
+
+    /* Any part of the update within the video area is carried by the next
+     * frame of video, leaving only the parts outside to be sent as images */
+    if (__guac_common_surface_video_intersects(surface, &bounded)) {
+
+        guac_common_rect outside;
+        while (guac_common_rect_clip_and_split(&bounded,
+                    &surface->video_rect, &outside))
+            __guac_common_surface_flush_rect(&outside, surface);
+
+        surface->video_dirty = 1;
+        return;
+
+    }
+
+    /* Flush the current update as bitmap if not combining */
+    if (surface->dirty && !__guac_common_should_combine(surface, &bounded, 0))
+        __guac_common_surface_flush_bitmap(surface);
+
+    __guac_common_mark_dirty(surface, &bounded);
+
+}
+
+/**
+ * The state of an in-progress lossless refresh of the lossy areas of a
+ * surface.
+ */
+typedef struct guac_common_surface_refresh {
+
+    /**
+     * The surface being refreshed.
+     */
+    guac_common_surface* surface;
+
+    /**
+     * The time at which the refresh began, in milliseconds.
+     */
+    guac_timestamp now;
+
+    /**
+     * The number of pixels which may still be refreshed during this flush.
+     */
+    int budget;
+
+} guac_common_surface_refresh;
+
+/**
+ * Callback for guac_common_region_foreach_rect() which adds the parts of a
+ * lossy area lying within idle heat map cells to the content region of the
+ * surface being refreshed. A heat map cell is idle if it has not been updated
+ * for at least the refresh interval of the surface. The data pointer must
+ * point to the guac_common_surface_refresh describing the refresh.
+ *
+ * @param rect
+ *     The lossy area to check.
+ *
+ * @param data
+ *     The guac_common_surface_refresh describing the refresh.
+ */
+static void __guac_common_surface_gather_idle_rect(
+        const guac_common_rect* rect, void* data) {
+
+    guac_common_surface_refresh* refresh = (guac_common_surface_refresh*) data;
+    guac_common_surface* surface = refresh->surface;
+
+    /* The lossy area may predate a resize */
+    guac_common_rect bounded = *rect;
+    __guac_common_bound_rect(surface, &bounded, NULL, NULL);
+    if (bounded.width <= 0 || bounded.height <= 0)
+        return;
+
+    size_t heat_width = GUAC_COMMON_SURFACE_HEAT_DIMENSION(surface->width);
+
+    int min_x = bounded.x / GUAC_COMMON_SURFACE_HEAT_CELL_SIZE;
+    int min_y = bounded.y / GUAC_COMMON_SURFACE_HEAT_CELL_SIZE;
+    int max_x = (bounded.x + bounded.width  - 1) / GUAC_COMMON_SURFACE_HEAT_CELL_SIZE;
+    int max_y = (bounded.y + bounded.height - 1) / GUAC_COMMON_SURFACE_HEAT_CELL_SIZE;
+
+    for (int y = min_y; y <= max_y; y++) {
+
+        const guac_common_surface_heat_cell* heat_cell =
+            surface->heat_map + y * heat_width + min_x;
+
+        for (int x = min_x; x <= max_x; x++, heat_cell++) {
+
+            int latest_entry = heat_cell->oldest_entry - 1;
+            if (latest_entry < 0)
+                latest_entry = GUAC_COMMON_SURFACE_HEAT_CELL_HISTORY_SIZE - 1;
+
+            /* Skip cells which are still changing */
+            if (refresh->now - heat_cell->history[latest_entry]
+                    < surface->refresh_interval)
+                continue;
+
+            guac_common_rect cell;
+            guac_common_rect_init(&cell,
+                    x * GUAC_COMMON_SURFACE_HEAT_CELL_SIZE,
+                    y * GUAC_COMMON_SURFACE_HEAT_CELL_SIZE,
+                    GUAC_COMMON_SURFACE_HEAT_CELL_SIZE,
+                    GUAC_COMMON_SURFACE_HEAT_CELL_SIZE);
+            guac_common_rect_constrain(&cell, &bounded);
+
+            guac_common_region_union_rect(surface->content_region, &cell);
+
+        }
+
+    }
+
+}
+
+/**
+ * Callback for guac_common_region_foreach_rect() which resends an idle lossy
+ * area losslessly, provided the bandwidth budget of the refresh allows. Areas
+ * larger than the remaining budget are only partially refreshed, with the
+ * remainder refreshed during later flushes. The data pointer must point to
+ * the guac_common_surface_refresh describing the refresh.
+ *
+ * @param rect
+ *     The idle lossy area to refresh.
+ *
+ * @param data
+ *     The guac_common_surface_refresh describing the refresh.
+ */
+static void __guac_common_surface_refresh_rect(const guac_common_rect* rect,
+        void* data) {
+
+    guac_common_surface_refresh* refresh = (guac_common_surface_refresh*) data;
+    guac_common_surface* surface = refresh->surface;
+
+    if (refresh->budget <= 0)
+        return;
+
+    /* Areas covered by video will be redrawn when video stops */
+    if (__guac_common_surface_video_intersects(surface, rect))
+        return;
+
+    /* Refresh only as many rows as the budget allows (but at least one) */
+    guac_common_rect part = *rect;
+    int rows = refresh->budget / part.width;
+    if (rows < 1)
+        rows = 1;
+
+    if (part.height > rows)
+        part.height = rows;
+
+    refresh->budget -= part.width * part.height;
+    __guac_common_surface_stamp_rect(surface, &part, refresh->now);
+
+    guac_common_surface_analysis analysis;
+    __guac_common_surface_analyze(surface, &part, &analysis, NULL);
+
+    __guac_common_mark_dirty(surface, &part);
+
+    if (analysis.solid)
+        __guac_common_surface_flush_to_fill(surface, analysis.color);
+    else
+        __guac_common_surface_flush_to_png(surface, analysis.opaque);
+
+}
+
+/**
+ * Resends losslessly any areas of the given surface which were last sent
+ * using lossy compression and have since remained unchanged for at least the
+ * surface's refresh interval. At most GUAC_SURFACE_REFRESH_MAX_PIXELS pixels
+ * are refreshed per call, and nothing is refreshed while the client is
+ * lagging. The surface must not be dirty.
+ *
+ * @param surface
+ *     The surface to refresh.
+ */
+static void __guac_common_surface_refresh_lossy(guac_common_surface* surface) {
+
+    if (surface->refresh_interval <= 0
+            || guac_common_region_is_empty(surface->lossy_region))
+        return;
 
-        /* Send PNG for rect */
-        guac_client_stream_png(surface->client, socket, GUAC_COMP_OVER,
-                layer, surface->dirty_rect.x, surface->dirty_rect.y, rect);
+    if (guac_client_get_processing_lag(surface->client)
+            > GUAC_SURFACE_REFRESH_MAX_LAG)
+        return;
 
-        cairo_surface_destroy(rect);
-        surface->realized = 1;
+    guac_common_surface_refresh refresh = {
+        .surface = surface,
+        .now = guac_timestamp_current(),
+        .budget = GUAC_SURFACE_REFRESH_MAX_PIXELS
+    };
 
-        /* Surface is no longer dirty */
-        surface->dirty = 0;
+    /* Gather idle lossy areas first, as refreshing modifies the lossy
+     * region */
+    guac_common_region_clear(surface->content_region);
+    guac_common_region_foreach_rect(surface->lossy_region,
+            __guac_common_surface_gather_idle_rect, &refresh);
 
-    }
+    guac_common_region_foreach_rect(surface->content_region,
+            __guac_common_surface_refresh_rect, &refresh);
+
+    guac_common_region_clear(surface->content_region);
+
+    /* Refreshes are sent only to live users. Mark the surface and the
+     * refreshed cells as modified such that paused users receive the
+     * refreshed contents when resyncing, rather than keeping the lossy
+     * contents indefinitely. */
+    if (refresh.budget < GUAC_SURFACE_REFRESH_MAX_PIXELS)
+        surface->last_modified = refresh.now;
 
 }
 
 /**
- * Returns an appropriate quality between 0 and 100 for lossy encoding
- * depending on the current processing lag calculated for the given client.
+ * The state of a flush of deferred updates which is limited to a number of
+ * bytes, shared with __guac_common_surface_flush_budgeted_rect() for each
+ * deferred update.
+ */
+typedef struct guac_common_surface_budget {
+
+    /**
+     * The surface being flushed.
+     */
+    guac_common_surface* surface;
+
+    /**
+     * The number of bytes written to the surface's socket when the flush
+     * began.
+     */
+    uint64_t start;
+
+    /**
+     * The number of bytes which may be written before further updates are
+     * left pending.
+     */
+    size_t budget;
+
+    /**
+     * Non-zero if updates at or below budget_resume_y are currently being
+     * flushed, zero if updates above budget_resume_y are being flushed.
+     */
+    int resumed;
+
+    /**
+     * Non-zero if any update has been left pending.
+     */
+    int exhausted;
+
+    /**
+     * The Y coordinate of the first update left pending.
+     */
+    int resume_y;
+
+} guac_common_surface_budget;
+
+/**
+ * Callback for guac_common_region_foreach_rect() which flushes the given
+ * deferred update like __guac_common_surface_flush_rect(), unless the byte
+ * budget of the flush has been exhausted, in which case the update is instead
+ * added to the surface's budget region to be sent later. Only the updates of
+ * the current pass of the flush (see the "resumed" member of
+ * guac_common_surface_budget) are considered.
  *
- * @param client
- *     The client for which the lossy quality is being calculated.
+ * @param rect
+ *     The deferred update to flush.
  *
- * @return
- *     A value between 0 and 100 inclusive which seems appropriate for the
- *     client based on lag measurements.
+ * @param data
+ *     A pointer to the guac_common_surface_budget of the current flush.
  */
-static int guac_common_surface_suggest_quality(guac_client* client) {
+static void __guac_common_surface_flush_budgeted_rect(
+        const guac_common_rect* rect, void* data) {
+
+    guac_common_surface_budget* budget = (guac_common_surface_budget*) data;
+    guac_common_surface* surface = budget->surface;
+
+    /* Ignore updates which belong to the other pass */
+    if ((rect->y >= surface->budget_resume_y) != budget->resumed)
+        return;
 
-    int lag = guac_client_get_processing_lag(client);
+    /* Leave remaining updates for a later flush once the budget is spent */
+    if (surface->socket->bytes_written - budget->start >= budget->budget) {
 
-    /* Scale quality linearly from 90 to 30 as lag varies from 20ms to 80ms */
-    int quality = 90 - (lag - 20);
+        if (!budget->exhausted) {
+            budget->exhausted = 1;
+            budget->resume_y = rect->y;
+        }
 
-    /* Do not exceed 90 for quality */
-    if (quality > 90)
-        return 90;
+        guac_common_region_union_rect(surface->budget_region, rect);
+        return;
 
-    /* Do not go below 30 for quality */
-    if (quality < 30)
-        return 30;
+    }
 
-    return quality;
+    __guac_common_surface_flush_rect(rect, surface);
 
 }
 
 /**
- * Flushes the bitmap update currently described by the dirty rectangle within
- * the given surface directly via an "img" instruction as JPEG data. The
- * resulting instructions will be sent over the socket associated with the
- * given surface.
+ * Flushes the given surface, drawing pending operations on the remote display
+ * until the given number of bytes have been written to the surface's socket.
+ * Any deferred updates which remain are left pending. Surface properties are
+ * not flushed.
  *
  * @param surface
  *     The surface to flush.
+ *
+ * @param budget
+ *     The number of bytes which may be written before further updates are
+ *     left pending, or SIZE_MAX if all pending updates should be sent.
+ *
+ * @return
+ *     Non-zero if any updates were left pending, zero otherwise.
  */
-static void __guac_common_surface_flush_to_jpeg(guac_common_surface* surface) {
+static int __guac_common_surface_flush_limited(guac_common_surface* surface,
+        size_t budget) {
 
-    if (surface->dirty) {
+    /* Flush final dirty rectangle to region */
+    __guac_common_surface_flush_to_region(surface);
 
-        guac_socket* socket = surface->socket;
-        const guac_layer* layer = surface->layer;
+    /* Start or stop streaming video as the content of the surface changes */
+    __guac_common_surface_update_video(surface);
 
-        guac_common_rect max;
-        guac_common_rect_init(&max, 0, 0, surface->width, surface->height);
+    guac_common_surface_budget state = {
+        .surface = surface,
+        .start = surface->socket->bytes_written,
+        .budget = budget
+    };
 
-        /* Expand the dirty rect size to fit in a grid with cells equal to the
-         * minimum JPEG block size */
-        guac_common_rect_expand_to_grid(GUAC_SURFACE_JPEG_BLOCK_SIZE,
-                                        &surface->dirty_rect, &max);
+    /* Combine and flush all deferred updates, starting with those left
+     * pending by the previous flush */
+    state.resumed = 1;
+    guac_common_region_foreach_rect(surface->dirty_region,
+            __guac_common_surface_flush_budgeted_rect, &state);
 
-        /* Get Cairo surface for specified rect */
-        unsigned char* buffer = surface->buffer
-                              + surface->dirty_rect.y * surface->stride
-                              + surface->dirty_rect.x * 4;
+    state.resumed = 0;
+    guac_common_region_foreach_rect(surface->dirty_region,
+            __guac_common_surface_flush_budgeted_rect, &state);
 
-        cairo_surface_t* rect = cairo_image_surface_create_for_data(buffer,
-                CAIRO_FORMAT_RGB24, surface->dirty_rect.width,
-                surface->dirty_rect.height, surface->stride);
+    /* Flush whatever update remains after combination */
+    if (surface->dirty)
+        __guac_common_surface_flush_bitmap(surface);
+
+    /* Flush complete, leaving only the updates which did not fit within the
+     * budget */
+    guac_common_region* pending = surface->budget_region;
+    surface->budget_region = surface->dirty_region;
+    surface->dirty_region = pending;
+    guac_common_region_clear(surface->budget_region);
+
+    surface->budget_resume_y = state.exhausted ? state.resume_y : 0;
+
+    /* Users which stop receiving live updates will not receive the pending
+     * updates when they are eventually sent, and must instead receive those
+     * areas when resyncing */
+    if (state.exhausted) {
+        surface->last_modified = guac_timestamp_current();
+        guac_common_region_foreach_rect(surface->dirty_region,
+                __guac_common_surface_stamp_region_rect, surface);
+    }
 
-        /* Send JPEG for rect */
-        guac_client_stream_jpeg(surface->client, socket, GUAC_COMP_OVER, layer,
-                surface->dirty_rect.x, surface->dirty_rect.y, rect,
-                guac_common_surface_suggest_quality(surface->client));
+    /* Send any changes within the video area as a single frame */
+    __guac_common_surface_flush_video(surface);
 
-        cairo_surface_destroy(rect);
-        surface->realized = 1;
+    /* Resend lossy areas losslessly once they stop changing, unless even the
+     * changes themselves could not all be sent */
+    if (!state.exhausted)
+        __guac_common_surface_refresh_lossy(surface);
 
-        /* Surface is no longer dirty */
-        surface->dirty = 0;
+    return state.exhausted;
 
-    }
+}
 
+static void __guac_common_surface_flush(guac_common_surface* surface) {
+    __guac_common_surface_flush_limited(surface, SIZE_MAX);
 }
 
-/**
- * Flushes the bitmap update currently described by the dirty rectangle within
- * the given surface directly via an "img" instruction as WebP data. The
- * resulting instructions will be sent over the socket associated with the
- * given surface.
- *
- * @param surface
- *     The surface to flush.
- *
- * @param opaque
- *     Whether the rectangle being flushed contains only fully-opaque pixels.
- */
-static void __guac_common_surface_flush_to_webp(guac_common_surface* surface,
-        int opaque) {
+void guac_common_surface_flush(guac_common_surface* surface) {
+    guac_common_surface_flush_limited(surface, SIZE_MAX);
+}
 
-    if (surface->dirty) {
+int guac_common_surface_flush_limited(guac_common_surface* surface,
+        size_t budget) {
 
-        guac_socket* socket = surface->socket;
-        const guac_layer* layer = surface->layer;
+    pthread_mutex_lock(&surface->_lock);
 
-        guac_common_rect max;
-        guac_common_rect_init(&max, 0, 0, surface->width, surface->height);
+    /* Flush any applicable layer properties */
+    __guac_common_surface_flush_properties(surface);
 
-        /* Expand the dirty rect size to fit in a grid with cells equal to the
-         * minimum WebP block size */
-        guac_common_rect_expand_to_grid(GUAC_SURFACE_WEBP_BLOCK_SIZE,
-                                        &surface->dirty_rect, &max);
+    /* Flush surface contents */
+    int pending = __guac_common_surface_flush_limited(surface, budget);
 
-        /* Get Cairo surface for specified rect */
-        unsigned char* buffer = surface->buffer
-                              + surface->dirty_rect.y * surface->stride
-                              + surface->dirty_rect.x * 4;
+    /* Release any cached snapshot which can no longer be reused */
+    if (surface->snapshot != NULL && guac_timestamp_current()
+            - surface->snapshot->timestamp >= GUAC_COMMON_SURFACE_SNAPSHOT_TTL)
+        __guac_common_surface_drop_snapshot(surface);
 
-        cairo_surface_t* rect;
+    pthread_mutex_unlock(&surface->_lock);
 
-        /* Use RGB24 if the image is fully opaque */
-        if (opaque)
-            rect = cairo_image_surface_create_for_data(buffer,
-                    CAIRO_FORMAT_RGB24, surface->dirty_rect.width,
-                    surface->dirty_rect.height, surface->stride);
+    return pending;
 
-        /* Otherwise ARGB32 is needed */
-        else
-            rect = cairo_image_surface_create_for_data(buffer,
-                    CAIRO_FORMAT_ARGB32, surface->dirty_rect.width,
-                    surface->dirty_rect.height, surface->stride);
+}
 
-        /* Send WebP for rect */
-        guac_client_stream_webp(surface->client, socket, GUAC_COMP_OVER, layer,
-                surface->dirty_rect.x, surface->dirty_rect.y, rect,
-                guac_common_surface_suggest_quality(surface->client),
-                surface->lossless ? 1 : 0);
+void guac_common_surface_set_restore_handler(guac_common_surface* surface,
+        guac_common_surface_restore_handler* handler, void* data) {
 
-        cairo_surface_destroy(rect);
-        surface->realized = 1;
+    pthread_mutex_lock(&surface->_lock);
 
-        /* Surface is no longer dirty */
-        surface->dirty = 0;
+    /* Surfaces which can no longer be evicted must not remain evicted */
+    if (handler == NULL)
+        __guac_common_surface_use(surface);
 
-    }
+    surface->restore_handler = handler;
+    surface->restore_data = data;
+    surface->last_used = guac_timestamp_current();
+
+    pthread_mutex_unlock(&surface->_lock);
 
 }
 
-/**
- * Comparator for instances of guac_common_surface_bitmap_rect, the elements
- * which make up a surface's bitmap buffer.
- *
- * @see qsort
- */
-static int __guac_common_surface_bitmap_rect_compare(const void* a, const void* b) {
+size_t guac_common_surface_evict(guac_common_surface* surface) {
+
+    size_t freed = 0;
+
+    pthread_mutex_lock(&surface->_lock);
+
+    /* Only surfaces whose contents can be regenerated may be evicted, and
+     * video is always encoded from the current pixels */
+    if (surface->restore_handler == NULL || surface->evicted
+            || surface->video != NULL)
+        goto complete;
 
-    guac_common_surface_bitmap_rect* ra = (guac_common_surface_bitmap_rect*) a;
-    guac_common_surface_bitmap_rect* rb = (guac_common_surface_bitmap_rect*) b;
+    /* Send any pending updates while their pixels still exist */
+    __guac_common_surface_flush(surface);
+
+    /* Lossy areas cannot be refreshed without their pixels */
+    guac_common_region_clear(surface->lossy_region);
+    __guac_common_surface_drop_snapshot(surface);
 
-    /* Order roughly top to bottom, left to right */
-    if (ra->rect.y != rb->rect.y) return ra->rect.y - rb->rect.y;
-    if (ra->rect.x != rb->rect.x) return ra->rect.x - rb->rect.x;
+    freed = __guac_common_surface_buffer_size(surface->height,
+            surface->stride);
 
-    /* Wider updates should come first (more likely to intersect later) */
-    if (ra->rect.width != rb->rect.width) return rb->rect.width - ra->rect.width;
+    guac_common_surface_pool_release(surface->pool, surface->buffer, freed);
+    surface->buffer = NULL;
+    surface->evicted = 1;
 
-    /* Shorter updates should come first (less likely to increase cost) */
-    return ra->rect.height - rb->rect.height;
+complete:
+    pthread_mutex_unlock(&surface->_lock);
+    return freed;
 
 }
 
 /**
- * Flushes only the properties of the given surface, such as layer location or
- * opacity. Image state is not flushed. If the surface represents a buffer or
- * the default layer, this function has no effect.
+ * Takes a snapshot of the entire contents of the given surface for a joining
+ * user, reusing the surface's cached snapshot where possible. If the cached
+ * snapshot is reused but the surface has changed since, a second, smaller
+ * snapshot covering those changes is also returned. The surface must be
+ * locked and non-empty.
  *
  * @param surface
- *     The surface to flush.
+ *     The surface to snapshot.
+ *
+ * @param snapshot
+ *     Storage for a new reference to the snapshot covering the entire
+ *     surface.
+ *
+ * @param delta
+ *     Storage for a snapshot of the area of the surface that has changed
+ *     since the returned full snapshot was taken, or NULL if the surface has
+ *     not changed.
  */
-static void __guac_common_surface_flush_properties(
-        guac_common_surface* surface) {
+static void __guac_common_surface_snapshot(guac_common_surface* surface,
+        guac_common_snapshot** snapshot, guac_common_snapshot** delta) {
 
-    guac_socket* socket = surface->socket;
+    guac_common_snapshot* cached = surface->snapshot;
+    *delta = NULL;
 
-    /* Only applicable to non-default visible layers */
-    if (surface->layer->index <= 0)
-        return;
+    /* Reuse recent snapshot if the changes since are small enough that
+     * sending them separately is cheaper than a new snapshot */
+    if (cached != NULL && guac_timestamp_current() - cached->timestamp
+            < GUAC_COMMON_SURFACE_SNAPSHOT_TTL) {
 
-    /* Flush opacity */
-    if (surface->opacity_dirty) {
-        guac_protocol_send_shade(socket, surface->layer, surface->opacity);
-        surface->opacity_dirty = 0;
-    }
+        if (!surface->snapshot_dirty) {
+            *snapshot = guac_common_snapshot_retain(cached);
+            return;
+        }
+
+        guac_common_rect* changed = &surface->snapshot_dirty_rect;
+        if (changed->width * changed->height * GUAC_SURFACE_SNAPSHOT_MAX_DELTA
+                <= surface->width * surface->height) {
+            *snapshot = guac_common_snapshot_retain(cached);
+            *delta = guac_common_snapshot_alloc(surface->buffer,
+                    surface->stride, changed);
+            return;
+        }
 
-    /* Flush location and hierarchy */
-    if (surface->location_dirty) {
-        guac_protocol_send_move(socket, surface->layer,
-                surface->parent, surface->x, surface->y, surface->z);
-        surface->location_dirty = 0;
     }
 
-}
+    /* Otherwise, replace cached snapshot with a new snapshot */
+    __guac_common_surface_drop_snapshot(surface);
 
-static void __guac_common_surface_flush(guac_common_surface* surface) {
+    guac_common_rect rect;
+    guac_common_rect_init(&rect, 0, 0, surface->width, surface->height);
 
-    /* Flush final dirty rectangle to queue. */
-    __guac_common_surface_flush_to_queue(surface);
+    surface->snapshot = guac_common_snapshot_alloc(surface->buffer,
+            surface->stride, &rect);
+    *snapshot = guac_common_snapshot_retain(surface->snapshot);
 
-    guac_common_surface_bitmap_rect* current = surface->bitmap_queue;
-    int i, j;
-    int original_queue_length;
-    int flushed = 0;
+}
 
-    original_queue_length = surface->bitmap_queue_length;
+/**
+ * Sends the size and layer properties of the given surface over the given
+ * socket. The surface must be locked.
+ *
+ * @param surface
+ *     The surface whose properties should be sent.
+ *
+ * @param socket
+ *     The socket over which the properties should be sent.
+ */
+static void __guac_common_surface_sync_properties(
+        guac_common_surface* surface, guac_socket* socket) {
 
-    /* Sort updates to make combination less costly */
-    qsort(surface->bitmap_queue, surface->bitmap_queue_length, sizeof(guac_common_surface_bitmap_rect),
-          __guac_common_surface_bitmap_rect_compare);
+    const guac_layer* layer = surface->layer;
 
-    /* Flush all rects in queue */
-    for (i=0; i < surface->bitmap_queue_length; i++) {
+    /* Synchronize layer-specific properties if applicable */
+    if (layer->index > 0) {
 
-        /* Get next unflushed candidate */
-        guac_common_surface_bitmap_rect* candidate = current;
-        if (!candidate->flushed) {
+        /* Synchronize opacity */
+        guac_protocol_send_shade(socket, layer, surface->opacity);
 
-            int combined = 0;
+        /* Synchronize location and hierarchy */
+        guac_protocol_send_move(socket, layer,
+                surface->parent, surface->x, surface->y, surface->z);
 
-            /* Build up rect as much as possible */
-            for (j=i; j < surface->bitmap_queue_length; j++) {
+    }
 
-                if (!candidate->flushed) {
+    /* Synchronize multi-touch support level */
+    else if (layer->index == 0)
+        guac_protocol_send_set_int(socket, layer,
+                GUAC_PROTOCOL_LAYER_PARAMETER_MULTI_TOUCH,
+                    surface->touches);
 
-                    /* Clip candidate within current bounds */
-                    __guac_common_bound_rect(surface, &candidate->rect, NULL, NULL);
-                    if (candidate->rect.width <= 0 || candidate->rect.height <= 0)
-                        candidate->flushed = 1;
+    /* Sync size */
+    guac_protocol_send_size(socket, layer,
+            surface->width, surface->height);
 
-                    /* Combine if reasonable */
-                    else if (__guac_common_should_combine(surface, &candidate->rect, 0) || !surface->dirty) {
-                        __guac_common_mark_dirty(surface, &candidate->rect);
-                        candidate->flushed = 1;
-                        combined++;
-                    }
+}
 
-                }
+void guac_common_surface_dup(guac_common_surface* surface,
+        guac_client* client, guac_socket* socket) {
 
-                candidate++;
+    const guac_layer* layer = surface->layer;
+    guac_common_snapshot* snapshot = NULL;
+    guac_common_snapshot* delta = NULL;
 
-            }
+    pthread_mutex_lock(&surface->_lock);
 
-            /* Re-add to queue if there's room and this update was modified or we expect others might be */
-            if ((combined > 1 || i < original_queue_length)
-                    && surface->bitmap_queue_length < GUAC_COMMON_SURFACE_QUEUE_SIZE)
-                __guac_common_surface_flush_to_queue(surface);
+    /* Do nothing if not realized */
+    if (!surface->realized)
+        goto complete;
 
-            /* Flush as bitmap otherwise */
-            else if (surface->dirty) {
+    /* The joining user is unaware of any existing video stream, so the
+     * video area must revert to images until video is started anew for all
+     * users. The full contents sent below already include that area. */
+    __guac_common_surface_stop_video(surface, 1);
 
-                flushed++;
+    __guac_common_surface_sync_properties(surface, socket);
 
-                int opaque = __guac_common_surface_is_opaque(surface,
-                            &surface->dirty_rect);
+    /* Copy contents of layer, if non-empty, deferring encoding until the
+     * surface is no longer locked */
+    if (surface->width > 0 && surface->height > 0) {
+        __guac_common_surface_use(surface);
+        __guac_common_surface_snapshot(surface, &snapshot, &delta);
+    }
 
-                /* Prefer WebP when reasonable */
-                if (__guac_common_surface_should_use_webp(surface,
-                            &surface->dirty_rect))
-                    __guac_common_surface_flush_to_webp(surface, opaque);
+complete:
+    pthread_mutex_unlock(&surface->_lock);
 
-                /* If not WebP, JPEG is the next best (lossy) choice */
-                else if (opaque && __guac_common_surface_should_use_jpeg(
-                            surface, &surface->dirty_rect))
-                    __guac_common_surface_flush_to_jpeg(surface);
+    /* Send contents of layer, followed by any changes since those contents
+     * were snapshotted */
+    if (snapshot != NULL) {
+        guac_common_snapshot_send(snapshot, client, socket, layer);
+        guac_common_snapshot_release(snapshot);
+    }
 
-                /* Use PNG if no lossy formats are appropriate */
-                else
-                    __guac_common_surface_flush_to_png(surface, opaque);
+    if (delta != NULL) {
+        guac_common_snapshot_send(delta, client, socket, layer);
+        guac_common_snapshot_release(delta);
+    }
 
-            }
+}
 
-        }
+/**
+ * The state of a resync of a single surface, accumulating snapshots of the
+ * areas of the surface that changed since a user stopped receiving live
+ * updates.
+ */
+typedef struct guac_common_surface_resync_state {
 
-        current++;
+    /**
+     * The surface being resynced. The surface must be locked.
+     */
+    guac_common_surface* surface;
 
-    }
+    /**
+     * Snapshots of each changed area of the surface.
+     */
+    guac_common_snapshot** snapshots;
 
-    /* Flush complete */
-    surface->bitmap_queue_length = 0;
+    /**
+     * The number of snapshots stored within the snapshots array.
+     */
+    int length;
 
-}
+    /**
+     * The number of snapshots which the snapshots array can hold before it
+     * must be grown.
+     */
+    int available;
 
-void guac_common_surface_flush(guac_common_surface* surface) {
+} guac_common_surface_resync_state;
 
-    pthread_mutex_lock(&surface->_lock);
+/**
+ * Callback for guac_common_region_foreach_rect() which takes a snapshot of
+ * each rectangle of the changed area of a surface being resynced.
+ *
+ * @param rect
+ *     The rectangle to snapshot.
+ *
+ * @param data
+ *     The guac_common_surface_resync_state of the resync.
+ */
+static void __guac_common_surface_resync_rect(const guac_common_rect* rect,
+        void* data) {
 
-    /* Flush any applicable layer properties */
-    __guac_common_surface_flush_properties(surface);
+    guac_common_surface_resync_state* state =
+        (guac_common_surface_resync_state*) data;
 
-    /* Flush surface contents */
-    __guac_common_surface_flush(surface);
+    guac_common_surface* surface = state->surface;
 
-    pthread_mutex_unlock(&surface->_lock);
+    if (state->length == state->available) {
+        state->available = state->available ? state->available * 2 : 8;
+        state->snapshots = guac_mem_realloc_or_die(state->snapshots,
+                sizeof(guac_common_snapshot*), state->available);
+    }
+
+    state->snapshots[state->length++] = guac_common_snapshot_alloc(
+            surface->buffer, surface->stride, rect);
 
 }
 
-void guac_common_surface_dup(guac_common_surface* surface,
-        guac_client* client, guac_socket* socket) {
+void guac_common_surface_resync(guac_common_surface* surface,
+        guac_client* client, guac_socket* socket, guac_timestamp since) {
+
+    const guac_layer* layer = surface->layer;
+    guac_common_surface_resync_state state = {
+        .surface = surface
+    };
 
     pthread_mutex_lock(&surface->_lock);
 
-    /* Do nothing if not realized */
-    if (!surface->realized)
+    /* Nothing to do if not realized or if the user is already up to date */
+    if (!surface->realized || surface->last_modified < since)
         goto complete;
 
-    /* Synchronize layer-specific properties if applicable */
-    if (surface->layer->index > 0) {
+    /* The resuming user missed part of any existing video stream, so the
+     * video area must revert to images until video is started anew */
+    __guac_common_surface_stop_video(surface, 1);
 
-        /* Synchronize opacity */
-        guac_protocol_send_shade(socket, surface->layer, surface->opacity);
+    __guac_common_surface_sync_properties(surface, socket);
 
-        /* Synchronize location and hierarchy */
-        guac_protocol_send_move(socket, surface->layer,
-                surface->parent, surface->x, surface->y, surface->z);
+    if (surface->width <= 0 || surface->height <= 0)
+        goto complete;
 
-    }
+    /* Gather the cells changed since the user stopped receiving updates,
+     * combining adjacent cells into as few rectangles as possible */
+    guac_common_region* changed = guac_common_region_alloc();
+    size_t heat_width = GUAC_COMMON_SURFACE_HEAT_DIMENSION(surface->width);
+    size_t heat_height = GUAC_COMMON_SURFACE_HEAT_DIMENSION(surface->height);
 
-    /* Synchronize multi-touch support level */
-    else if (surface->layer->index == 0)
-        guac_protocol_send_set_int(socket, surface->layer,
-                GUAC_PROTOCOL_LAYER_PARAMETER_MULTI_TOUCH,
-                    surface->touches);
+    for (size_t y = 0; y < heat_height; y++) {
 
-    /* Sync size to new socket */
-    guac_protocol_send_size(socket, surface->layer,
-            surface->width, surface->height);
+        guac_common_surface_heat_cell* heat_row =
+            surface->heat_map + y * heat_width;
 
-    /* Send contents of layer, if non-empty */
-    if (surface->width > 0 && surface->height > 0) {
+        for (size_t x = 0; x < heat_width; x++) {
 
-        /* Get entire surface */
-        cairo_surface_t* rect = cairo_image_surface_create_for_data(
-                surface->buffer, CAIRO_FORMAT_ARGB32,
-                surface->width, surface->height, surface->stride);
+            if (heat_row[x].last_modified < since)
+                continue;
 
-        /* Send PNG for rect */
-        guac_client_stream_png(client, socket, GUAC_COMP_OVER, surface->layer,
-                0, 0, rect);
-        cairo_surface_destroy(rect);
+            /* Extend across all adjacent changed cells within this row */
+            size_t end = x + 1;
+            while (end < heat_width && heat_row[end].last_modified >= since)
+                end++;
+
+            guac_common_rect rect;
+            guac_common_rect_init(&rect,
+                    x * GUAC_COMMON_SURFACE_HEAT_CELL_SIZE,
+                    y * GUAC_COMMON_SURFACE_HEAT_CELL_SIZE,
+                    (end - x) * GUAC_COMMON_SURFACE_HEAT_CELL_SIZE,
+                    GUAC_COMMON_SURFACE_HEAT_CELL_SIZE);
+
+            __guac_common_bound_rect(surface, &rect, NULL, NULL);
+            guac_common_region_union_rect(changed, &rect);
+
+            x = end;
 
+        }
+
+    }
+
+    /* Copy contents of changed areas, deferring encoding until the surface
+     * is no longer locked */
+    if (!guac_common_region_is_empty(changed)) {
+        __guac_common_surface_use(surface);
+        guac_common_region_foreach_rect(changed,
+                __guac_common_surface_resync_rect, &state);
     }
 
+    guac_common_region_free(changed);
+
 complete:
     pthread_mutex_unlock(&surface->_lock);
 
+    for (int i = 0; i < state.length; i++) {
+        guac_common_snapshot_send(state.snapshots[i], client, socket,
+                layer);
+        guac_common_snapshot_release(state.snapshots[i]);
+    }
+
+    guac_mem_free(state.snapshots);
+
 }
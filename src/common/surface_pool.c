@@ -0,0 +1,188 @@
+/*
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ * KIND, either express or implied.  See the License for the
+ * specific language governing permissions and limitations
+ * under the License.
+ */
+
+#include "config.h"
+#include "common/surface_pool.h"
+
+#include <guacamole/mem.h>
+
+#include <pthread.h>
+#include <stddef.h>
+#include <string.h>
+
+/**
+ * Determines the size class of an allocation of the given size.
+ *
+ * @param size
+ *     The number of bytes required.
+ *
+ * @param class_size
+ *     Storage for the number of bytes actually allocated for blocks of the
+ *     returned size class, or for the given size if the allocation is too
+ *     large to be pooled.
+ *
+ * @return
+ *     The index of the size class of the allocation, or -1 if the allocation
+ *     is too large to be pooled.
+ */
+static int guac_common_surface_pool_get_class(size_t size,
+        size_t* class_size) {
+
+    size_t min_size = (size_t) 1 << GUAC_COMMON_SURFACE_POOL_MIN_SHIFT;
+    if (size <= min_size) {
+        *class_size = min_size;
+        return 0;
+    }
+
+    /* Find the power of two immediately below the requested size */
+    int shift = GUAC_COMMON_SURFACE_POOL_MIN_SHIFT;
+    while (((size_t) 2 << shift) < size)
+        shift++;
+
+    /* Do not pool allocations beyond the largest size class */
+    if (shift >= GUAC_COMMON_SURFACE_POOL_MAX_SHIFT) {
+        *class_size = size;
+        return -1;
+    }
+
+    /* Round up to the nearest step between that power of two and the next */
+    size_t base = (size_t) 1 << shift;
+    size_t step = base / GUAC_COMMON_SURFACE_POOL_STEPS;
+    size_t steps = (size - base + step - 1) / step;
+
+    *class_size = base + steps * step;
+    return (shift - GUAC_COMMON_SURFACE_POOL_MIN_SHIFT)
+        * GUAC_COMMON_SURFACE_POOL_STEPS + steps;
+
+}
+
+guac_common_surface_pool* guac_common_surface_pool_alloc() {
+
+    guac_common_surface_pool* pool =
+        guac_mem_zalloc(sizeof(guac_common_surface_pool));
+
+    pthread_mutex_init(&pool->_lock, NULL);
+    return pool;
+
+}
+
+void guac_common_surface_pool_free(guac_common_surface_pool* pool) {
+
+    /* Return all retained blocks to the system */
+    for (int i = 0; i < GUAC_COMMON_SURFACE_POOL_CLASSES; i++) {
+        void* block = pool->_free_blocks[i];
+        while (block != NULL) {
+            void* next = *((void**) block);
+            guac_mem_free(block);
+            block = next;
+        }
+    }
+
+    pthread_mutex_destroy(&pool->_lock);
+    guac_mem_free(pool);
+
+}
+
+void* guac_common_surface_pool_zalloc(guac_common_surface_pool* pool,
+        size_t size) {
+
+    /* Pooling is optional */
+    if (pool == NULL)
+        return guac_mem_zalloc(size);
+
+    size_t class_size;
+    int class = guac_common_surface_pool_get_class(size, &class_size);
+
+    pthread_mutex_lock(&pool->_lock);
+
+    pool->used += class_size;
+
+    /* Reuse a free block of the same size class if possible */
+    void* block = NULL;
+    if (class >= 0 && pool->_free_blocks[class] != NULL) {
+        block = pool->_free_blocks[class];
+        pool->_free_blocks[class] = *((void**) block);
+        pool->retained -= class_size;
+    }
+
+    pthread_mutex_unlock(&pool->_lock);
+
+    /* Reused blocks must be cleared, as newly-allocated blocks would be */
+    if (block != NULL) {
+        memset(block, 0, size);
+        return block;
+    }
+
+    block = guac_mem_zalloc(class_size);
+
+    /* Do not account for allocations that did not happen */
+    if (block == NULL) {
+        pthread_mutex_lock(&pool->_lock);
+        pool->used -= class_size;
+        pthread_mutex_unlock(&pool->_lock);
+    }
+
+    return block;
+
+}
+
+void guac_common_surface_pool_release(guac_common_surface_pool* pool,
+        void* block, size_t size) {
+
+    if (block == NULL)
+        return;
+
+    /* Blocks allocated without a pool are simply freed */
+    if (pool == NULL) {
+        guac_mem_free(block);
+        return;
+    }
+
+    size_t class_size;
+    int class = guac_common_surface_pool_get_class(size, &class_size);
+
+    pthread_mutex_lock(&pool->_lock);
+
+    pool->used -= class_size;
+
+    /* Retain block for reuse unless the pool is already retaining enough */
+    if (class >= 0 && pool->retained + class_size
+            <= GUAC_COMMON_SURFACE_POOL_MAX_RETAINED) {
+        *((void**) block) = pool->_free_blocks[class];
+        pool->_free_blocks[class] = block;
+        pool->retained += class_size;
+        block = NULL;
+    }
+
+    pthread_mutex_unlock(&pool->_lock);
+
+    guac_mem_free(block);
+
+}
+
+size_t guac_common_surface_pool_get_used(guac_common_surface_pool* pool) {
+
+    pthread_mutex_lock(&pool->_lock);
+    size_t used = pool->used;
+    pthread_mutex_unlock(&pool->_lock);
+
+    return used;
+
+}
+
@@ -0,0 +1,53 @@
+/*
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ * KIND, either express or implied.  See the License for the
+ * specific language governing permissions and limitations
+ * under the License.
+ */
+
+#include "common/pixel.h"
+
+#include <CUnit/CUnit.h>
+#include <stdint.h>
+
+/**
+ * Test which verifies that guac_common_pixel_argb_blend() returns the source
+ * or destination unmodified when either is trivially the result of blending.
+ */
+void test_pixel__argb_blend_trivial() {
+
+    /* Opaque source replaces destination */
+    CU_ASSERT_EQUAL(0xFF123456, guac_common_pixel_argb_blend(0x80404040, 0xFF123456));
+
+    /* Anything replaces a fully transparent destination */
+    CU_ASSERT_EQUAL(0x40101010, guac_common_pixel_argb_blend(0x00ABCDEF, 0x40101010));
+
+    /* Fully transparent source leaves destination untouched */
+    CU_ASSERT_EQUAL(0x80404040, guac_common_pixel_argb_blend(0x80404040, 0x00000000));
+
+}
+
+/**
+ * Test which verifies that guac_common_pixel_argb_blend() clamps each blended
+ * component to the maximum component value.
+ */
+void test_pixel__argb_blend_clamp() {
+
+    /* Each component is src + dst * (0xFF - alpha), clamped to 0xFF */
+    CU_ASSERT_EQUAL(0xFFFFFFFF, guac_common_pixel_argb_blend(0x80030303, 0x80000000));
+    CU_ASSERT_EQUAL(0xFF030201, guac_common_pixel_argb_blend(0x01030201, 0xFE000000));
+
+}
+
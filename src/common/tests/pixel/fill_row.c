@@ -0,0 +1,79 @@
+/*
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ * KIND, either express or implied.  See the License for the
+ * specific language governing permissions and limitations
+ * under the License.
+ */
+
+#include "common/pixel.h"
+
+#include <CUnit/CUnit.h>
+#include <stdint.h>
+
+/**
+ * The implementations of guac_common_pixel_fill_row() to test. Any which are
+ * unsupported by the current CPU or build are skipped.
+ */
+static const guac_common_pixel_implementation implementations[] = {
+    GUAC_COMMON_PIXEL_SCALAR,
+    GUAC_COMMON_PIXEL_SSE2,
+    GUAC_COMMON_PIXEL_AVX2
+};
+
+/**
+ * Test which verifies that all implementations of
+ * guac_common_pixel_fill_row() fill the entire row and report exactly the
+ * range of pixels which changed.
+ */
+void test_pixel__fill_row() {
+
+    uint32_t row[37];
+
+    for (unsigned int i = 0; i < sizeof(implementations) / sizeof(implementations[0]); i++) {
+
+        if (guac_common_pixel_set_implementation(implementations[i]))
+            continue;
+
+        for (int width = 1; width <= 37; width++) {
+            for (int start = 0; start < width; start++) {
+                for (int end = start; end < width; end++) {
+
+                    /* Only pixels within [start, end] differ from the fill */
+                    for (int x = 0; x < width; x++)
+                        row[x] = (x >= start && x <= end) ? 0x00000000 : 0xFF336699;
+
+                    int first, last;
+                    CU_ASSERT_TRUE(guac_common_pixel_fill_row(row, 0xFF336699,
+                                width, &first, &last));
+                    CU_ASSERT_EQUAL(start, first);
+                    CU_ASSERT_EQUAL(end, last);
+
+                    for (int x = 0; x < width; x++)
+                        CU_ASSERT_EQUAL(0xFF336699, row[x]);
+
+                    /* Filling again changes nothing */
+                    CU_ASSERT_FALSE(guac_common_pixel_fill_row(row, 0xFF336699,
+                                width, &first, &last));
+
+                }
+            }
+        }
+
+    }
+
+    guac_common_pixel_set_implementation(GUAC_COMMON_PIXEL_SCALAR);
+
+}
+
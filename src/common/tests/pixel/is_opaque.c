@@ -0,0 +1,71 @@
+/*
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ * KIND, either express or implied.  See the License for the
+ * specific language governing permissions and limitations
+ * under the License.
+ */
+
+#include "common/pixel.h"
+
+#include <CUnit/CUnit.h>
+#include <stdint.h>
+
+/**
+ * The implementations of guac_common_pixel_is_opaque() to test. Any which are
+ * unsupported by the current CPU or build are skipped.
+ */
+static const guac_common_pixel_implementation implementations[] = {
+    GUAC_COMMON_PIXEL_SCALAR,
+    GUAC_COMMON_PIXEL_SSE2,
+    GUAC_COMMON_PIXEL_AVX2
+};
+
+/**
+ * Test which verifies that all implementations of
+ * guac_common_pixel_is_opaque() detect a single non-opaque pixel at any
+ * position within rows of any width.
+ */
+void test_pixel__is_opaque() {
+
+    uint32_t row[37];
+
+    for (unsigned int i = 0; i < sizeof(implementations) / sizeof(implementations[0]); i++) {
+
+        if (guac_common_pixel_set_implementation(implementations[i]))
+            continue;
+
+        for (int width = 0; width <= 37; width++) {
+
+            for (int x = 0; x < width; x++)
+                row[x] = 0xFF000000 | (x * 0x010203);
+
+            /* Opaque rows are opaque */
+            CU_ASSERT_TRUE(guac_common_pixel_is_opaque(row, width));
+
+            /* Any single non-opaque pixel makes the row non-opaque */
+            for (int x = 0; x < width; x++) {
+                row[x] = 0xFE000000;
+                CU_ASSERT_FALSE(guac_common_pixel_is_opaque(row, width));
+                row[x] = 0xFF000000;
+            }
+
+        }
+
+    }
+
+    guac_common_pixel_set_implementation(GUAC_COMMON_PIXEL_SCALAR);
+
+}
+
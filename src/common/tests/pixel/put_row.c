@@ -0,0 +1,108 @@
+/*
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ * KIND, either express or implied.  See the License for the
+ * specific language governing permissions and limitations
+ * under the License.
+ */
+
+#include "common/pixel.h"
+
+#include <CUnit/CUnit.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+/**
+ * The implementations of guac_common_pixel_put_row() to test against the
+ * scalar implementation. Any which are unsupported by the current CPU or build
+ * are skipped.
+ */
+static const guac_common_pixel_implementation implementations[] = {
+    GUAC_COMMON_PIXEL_SSE2,
+    GUAC_COMMON_PIXEL_AVX2
+};
+
+/**
+ * Returns a pseudo-random ARGB color, biased toward the alpha values which
+ * are handled specially by guac_common_pixel_argb_blend().
+ *
+ * @return
+ *     A pseudo-random ARGB color.
+ */
+static uint32_t random_color() {
+
+    uint32_t color = ((uint32_t) rand() << 16) ^ (uint32_t) rand();
+
+    switch (rand() % 4) {
+        case 0: return color | 0xFF000000;
+        case 1: return color & 0x00FFFFFF;
+        default: return color;
+    }
+
+}
+
+/**
+ * Test which verifies that all SIMD implementations of
+ * guac_common_pixel_put_row() produce exactly the same pixels and changed
+ * ranges as the scalar implementation, both with and without alpha blending.
+ */
+void test_pixel__put_row() {
+
+    uint32_t src[67];
+    uint32_t dst[67];
+    uint32_t expected[67];
+    uint32_t actual[67];
+
+    srand(1);
+
+    for (unsigned int i = 0; i < sizeof(implementations) / sizeof(implementations[0]); i++) {
+        for (int width = 0; width <= 67; width++) {
+            for (int opaque = 0; opaque <= 1; opaque++) {
+
+                for (int x = 0; x < width; x++) {
+                    src[x] = random_color();
+                    dst[x] = (rand() % 2) ? src[x] : random_color();
+                }
+
+                int expected_first = 0, expected_last = 0;
+                memcpy(expected, dst, sizeof(dst));
+                guac_common_pixel_set_implementation(GUAC_COMMON_PIXEL_SCALAR);
+                int expected_changed = guac_common_pixel_put_row(expected, src,
+                        width, opaque, &expected_first, &expected_last);
+
+                if (guac_common_pixel_set_implementation(implementations[i]))
+                    break;
+
+                int actual_first = 0, actual_last = 0;
+                memcpy(actual, dst, sizeof(dst));
+                int actual_changed = guac_common_pixel_put_row(actual, src,
+                        width, opaque, &actual_first, &actual_last);
+
+                CU_ASSERT_EQUAL(expected_changed, actual_changed);
+                CU_ASSERT_EQUAL(0, memcmp(expected, actual, sizeof(actual)));
+
+                if (expected_changed) {
+                    CU_ASSERT_EQUAL(expected_first, actual_first);
+                    CU_ASSERT_EQUAL(expected_last, actual_last);
+                }
+
+            }
+        }
+    }
+
+    guac_common_pixel_set_implementation(GUAC_COMMON_PIXEL_SCALAR);
+
+}
+
@@ -0,0 +1,140 @@
+/*
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ * KIND, either express or implied.  See the License for the
+ * specific language governing permissions and limitations
+ * under the License.
+ */
+
+#include "common/pixel.h"
+
+#include <CUnit/CUnit.h>
+#include <guacamole/protocol-types.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+/**
+ * The implementations of guac_common_pixel_transfer_row() to test against the
+ * scalar implementation. Any which are unsupported by the current CPU or build
+ * are skipped.
+ */
+static const guac_common_pixel_implementation implementations[] = {
+    GUAC_COMMON_PIXEL_SSE2,
+    GUAC_COMMON_PIXEL_AVX2
+};
+
+/**
+ * Applies the given transfer function to a row of the given width using first
+ * the scalar implementation and then the given implementation, verifying that
+ * both produce identical results. The source row is offset from the
+ * destination row within the same buffer, such that the rows overlap if the
+ * offset is small.
+ *
+ * @param implementation
+ *     The implementation to compare against the scalar implementation.
+ *
+ * @param op
+ *     The transfer function to apply.
+ *
+ * @param width
+ *     The width of the row.
+ *
+ * @param offset
+ *     The offset of the source row relative to the destination row, in
+ *     pixels. Rows are processed backwards if this offset is negative.
+ *
+ * @param buffer
+ *     The initial contents of the buffer containing both rows.
+ *
+ * @param length
+ *     The number of pixels within the buffer.
+ */
+static void verify_transfer_row(guac_common_pixel_implementation implementation,
+        guac_transfer_function op, int width, int offset,
+        const uint32_t* buffer, int length) {
+
+    uint32_t expected[length];
+    uint32_t actual[length];
+
+    /* Destination row begins in the middle of the buffer */
+    int dst = length / 2 - width / 2;
+    int backwards = offset < 0;
+
+    memcpy(expected, buffer, sizeof(expected));
+    guac_common_pixel_set_implementation(GUAC_COMMON_PIXEL_SCALAR);
+
+    int expected_first = 0, expected_last = 0;
+    int expected_changed = guac_common_pixel_transfer_row(op, expected + dst,
+            expected + dst + offset, width, backwards,
+            &expected_first, &expected_last);
+
+    memcpy(actual, buffer, sizeof(actual));
+    guac_common_pixel_set_implementation(implementation);
+
+    int actual_first = 0, actual_last = 0;
+    int actual_changed = guac_common_pixel_transfer_row(op, actual + dst,
+            actual + dst + offset, width, backwards,
+            &actual_first, &actual_last);
+
+    CU_ASSERT_EQUAL(expected_changed, actual_changed);
+    CU_ASSERT_EQUAL(0, memcmp(expected, actual, sizeof(actual)));
+
+    if (expected_changed) {
+        CU_ASSERT_EQUAL(expected_first, actual_first);
+        CU_ASSERT_EQUAL(expected_last, actual_last);
+    }
+
+}
+
+/**
+ * Test which verifies that all SIMD implementations of
+ * guac_common_pixel_transfer_row() produce exactly the same pixels and
+ * changed ranges as the scalar implementation for every transfer function,
+ * including when the source and destination rows overlap.
+ */
+void test_pixel__transfer_row() {
+
+    uint32_t buffer[128];
+    int offsets[] = { -40, -3, -1, 1, 5, 40 };
+
+    srand(1);
+
+    for (unsigned int i = 0; i < sizeof(implementations) / sizeof(implementations[0]); i++) {
+
+        if (guac_common_pixel_set_implementation(implementations[i]))
+            continue;
+
+        for (int op = GUAC_TRANSFER_BINARY_BLACK; op <= GUAC_TRANSFER_BINARY_WHITE; op++) {
+            for (int width = 0; width <= 37; width++) {
+                for (unsigned int j = 0; j < sizeof(offsets) / sizeof(offsets[0]); j++) {
+
+                    /* Mix of random pixels and pixels equal to their neighbors */
+                    for (int x = 0; x < 128; x++)
+                        buffer[x] = (x > 0 && rand() % 3 == 0) ? buffer[x - 1]
+                            : ((uint32_t) rand() << 16) ^ (uint32_t) rand();
+
+                    verify_transfer_row(implementations[i], op, width,
+                            offsets[j], buffer, 128);
+
+                }
+            }
+        }
+
+    }
+
+    guac_common_pixel_set_implementation(GUAC_COMMON_PIXEL_SCALAR);
+
+}
+
@@ -0,0 +1,103 @@
+/*
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ * KIND, either express or implied.  See the License for the
+ * specific language governing permissions and limitations
+ * under the License.
+ */
+
+
+#include "common/rect.h"
+#include "common/region.h"
+
+#include <CUnit/CUnit.h>
+
+/**
+ * The maximum number of rectangles recorded by record_rect().
+ */
+#define TEST_MAX_RECTS 16
+
+/**
+ * All rectangles received by record_rect(), in order of receipt.
+ */
+typedef struct test_rect_list {
+
+    /**
+     * The number of rectangles received.
+     */
+    int count;
+
+    /**
+     * The rectangles received.
+     */
+    guac_common_rect rects[TEST_MAX_RECTS];
+
+} test_rect_list;
+
+/**
+ * Callback for guac_common_region_foreach_rect() which appends each received
+ * rectangle to the test_rect_list provided as data.
+ *
+ * @param rect
+ *     The current rectangle.
+ *
+ * @param data
+ *     The test_rect_list to append to.
+ */
+static void record_rect(const guac_common_rect* rect, void* data) {
+
+    test_rect_list* list = (test_rect_list*) data;
+    if (list->count < TEST_MAX_RECTS)
+        list->rects[list->count] = *rect;
+
+    list->count++;
+
+}
+
+/**
+ * Test which verifies that guac_common_region_foreach_rect() provides
+ * rectangles in top-to-bottom, left-to-right order, extending each rectangle
+ * downward through adjacent bands containing identical spans.
+ */
+void test_region__foreach_rect() {
+
+    guac_common_rect rect;
+    guac_common_region* region = guac_common_region_alloc();
+    test_rect_list list = { 0 };
+
+    /* Tall rect on the left, short rect on the right (added first) */
+    guac_common_rect_init(&rect, 50, 10, 10, 10);
+    guac_common_region_union_rect(region, &rect);
+    guac_common_rect_init(&rect, 0, 0, 20, 40);
+    guac_common_region_union_rect(region, &rect);
+
+    guac_common_region_foreach_rect(region, record_rect, &list);
+
+    /* The tall rect must be provided whole despite being split into bands */
+    CU_ASSERT_EQUAL_FATAL(2, list.count);
+
+    CU_ASSERT_EQUAL(0,  list.rects[0].x);
+    CU_ASSERT_EQUAL(0,  list.rects[0].y);
+    CU_ASSERT_EQUAL(20, list.rects[0].width);
+    CU_ASSERT_EQUAL(40, list.rects[0].height);
+
+    CU_ASSERT_EQUAL(50, list.rects[1].x);
+    CU_ASSERT_EQUAL(10, list.rects[1].y);
+    CU_ASSERT_EQUAL(10, list.rects[1].width);
+    CU_ASSERT_EQUAL(10, list.rects[1].height);
+
+    guac_common_region_free(region);
+
+}
+
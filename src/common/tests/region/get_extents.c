@@ -0,0 +1,52 @@
+/*
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ * KIND, either express or implied.  See the License for the
+ * specific language governing permissions and limitations
+ * under the License.
+ */
+
+
+#include "common/rect.h"
+#include "common/region.h"
+
+#include <CUnit/CUnit.h>
+
+/**
+ * Test which verifies that guac_common_region_get_extents() returns the
+ * bounding rectangle of all rectangles added to the region.
+ */
+void test_region__get_extents() {
+
+    guac_common_rect rect;
+    guac_common_rect extents;
+    guac_common_region* region = guac_common_region_alloc();
+
+    CU_ASSERT_FALSE(guac_common_region_get_extents(region, &extents));
+
+    guac_common_rect_init(&rect, 30, 5, 10, 10);
+    guac_common_region_union_rect(region, &rect);
+    guac_common_rect_init(&rect, 5, 50, 10, 10);
+    guac_common_region_union_rect(region, &rect);
+
+    CU_ASSERT_TRUE(guac_common_region_get_extents(region, &extents));
+    CU_ASSERT_EQUAL(5,  extents.x);
+    CU_ASSERT_EQUAL(5,  extents.y);
+    CU_ASSERT_EQUAL(35, extents.width);
+    CU_ASSERT_EQUAL(55, extents.height);
+
+    guac_common_region_free(region);
+
+}
+
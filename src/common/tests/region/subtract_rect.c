@@ -0,0 +1,135 @@
+/*
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ * KIND, either express or implied.  See the License for the
+ * specific language governing permissions and limitations
+ * under the License.
+ */
+
+#include "common/rect.h"
+#include "common/region.h"
+
+#include <CUnit/CUnit.h>
+
+/**
+ * Test which verifies that guac_common_region_subtract_rect() removes a hole
+ * from the middle of a region, splitting bands and spans as necessary.
+ */
+void test_region__subtract_rect_hole() {
+
+    guac_common_rect rect;
+    guac_common_region* region = guac_common_region_alloc();
+
+    guac_common_rect_init(&rect, 0, 0, 30, 30);
+    guac_common_region_union_rect(region, &rect);
+    guac_common_rect_init(&rect, 10, 10, 10, 10);
+    guac_common_region_subtract_rect(region, &rect);
+
+    /* Expect three bands: [0, 10), [10, 20) with a hole, and [20, 30) */
+    CU_ASSERT_EQUAL_FATAL(3, region->band_count);
+
+    CU_ASSERT_EQUAL(0, region->bands[0].y);
+    CU_ASSERT_EQUAL(10, region->bands[0].height);
+    CU_ASSERT_EQUAL_FATAL(1, region->bands[0].span_count);
+    CU_ASSERT_EQUAL(0, region->bands[0].spans[0].x);
+    CU_ASSERT_EQUAL(30, region->bands[0].spans[0].width);
+
+    CU_ASSERT_EQUAL(10, region->bands[1].y);
+    CU_ASSERT_EQUAL(10, region->bands[1].height);
+    CU_ASSERT_EQUAL_FATAL(2, region->bands[1].span_count);
+    CU_ASSERT_EQUAL(0, region->bands[1].spans[0].x);
+    CU_ASSERT_EQUAL(10, region->bands[1].spans[0].width);
+    CU_ASSERT_EQUAL(20, region->bands[1].spans[1].x);
+    CU_ASSERT_EQUAL(10, region->bands[1].spans[1].width);
+
+    CU_ASSERT_EQUAL(20, region->bands[2].y);
+    CU_ASSERT_EQUAL(10, region->bands[2].height);
+    CU_ASSERT_EQUAL_FATAL(1, region->bands[2].span_count);
+    CU_ASSERT_EQUAL(0, region->bands[2].spans[0].x);
+    CU_ASSERT_EQUAL(30, region->bands[2].spans[0].width);
+
+    /* Filling the hole again must restore a single band */
+    guac_common_region_union_rect(region, &rect);
+    CU_ASSERT_EQUAL_FATAL(1, region->band_count);
+    CU_ASSERT_EQUAL(0, region->bands[0].y);
+    CU_ASSERT_EQUAL(30, region->bands[0].height);
+
+    guac_common_region_free(region);
+
+}
+
+/**
+ * Test which verifies that guac_common_region_subtract_rect() removes bands
+ * which become empty and coalesces the bands which remain.
+ */
+void test_region__subtract_rect_coalesce() {
+
+    guac_common_rect rect;
+    guac_common_region* region = guac_common_region_alloc();
+
+    /* Two overlapping rects produce three bands */
+    guac_common_rect_init(&rect, 0, 0, 10, 20);
+    guac_common_region_union_rect(region, &rect);
+    guac_common_rect_init(&rect, 20, 10, 10, 20);
+    guac_common_region_union_rect(region, &rect);
+    CU_ASSERT_EQUAL_FATAL(3, region->band_count);
+
+    /* Removing the left rect entirely leaves only the right rect */
+    guac_common_rect_init(&rect, 0, 0, 15, 30);
+    guac_common_region_subtract_rect(region, &rect);
+
+    CU_ASSERT_EQUAL_FATAL(1, region->band_count);
+    CU_ASSERT_EQUAL(10, region->bands[0].y);
+    CU_ASSERT_EQUAL(20, region->bands[0].height);
+    CU_ASSERT_EQUAL_FATAL(1, region->bands[0].span_count);
+    CU_ASSERT_EQUAL(20, region->bands[0].spans[0].x);
+    CU_ASSERT_EQUAL(10, region->bands[0].spans[0].width);
+
+    /* Removing everything leaves an empty region */
+    guac_common_rect_init(&rect, 0, 0, 100, 100);
+    guac_common_region_subtract_rect(region, &rect);
+    CU_ASSERT_TRUE(guac_common_region_is_empty(region));
+
+    guac_common_region_free(region);
+
+}
+
+/**
+ * Test which verifies that guac_common_region_subtract_rect() leaves the
+ * region unchanged when the removed rectangle merely touches it.
+ */
+void test_region__subtract_rect_touching() {
+
+    guac_common_rect rect;
+    guac_common_region* region = guac_common_region_alloc();
+
+    guac_common_rect_init(&rect, 10, 10, 10, 10);
+    guac_common_region_union_rect(region, &rect);
+
+    guac_common_rect_init(&rect, 20, 0, 10, 30);
+    guac_common_region_subtract_rect(region, &rect);
+    guac_common_rect_init(&rect, 0, 20, 30, 10);
+    guac_common_region_subtract_rect(region, &rect);
+
+    CU_ASSERT_EQUAL_FATAL(1, region->band_count);
+    CU_ASSERT_EQUAL(10, region->bands[0].y);
+    CU_ASSERT_EQUAL(10, region->bands[0].height);
+    CU_ASSERT_EQUAL_FATAL(1, region->bands[0].span_count);
+    CU_ASSERT_EQUAL(10, region->bands[0].spans[0].x);
+    CU_ASSERT_EQUAL(10, region->bands[0].spans[0].width);
+
+    guac_common_region_free(region);
+
+}
+
@@ -0,0 +1,136 @@
+/*
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ * KIND, either express or implied.  See the License for the
+ * specific language governing permissions and limitations
+ * under the License.
+ */
+
+
+#include "common/rect.h"
+#include "common/region.h"
+
+#include <CUnit/CUnit.h>
+
+/**
+ * Test which verifies that guac_common_region_union_rect() ignores empty
+ * rectangles.
+ */
+void test_region__union_rect_empty() {
+
+    guac_common_rect rect;
+    guac_common_region* region = guac_common_region_alloc();
+
+    CU_ASSERT_TRUE(guac_common_region_is_empty(region));
+
+    guac_common_rect_init(&rect, 10, 10, 0, 10);
+    guac_common_region_union_rect(region, &rect);
+    guac_common_rect_init(&rect, 10, 10, 10, -5);
+    guac_common_region_union_rect(region, &rect);
+
+    CU_ASSERT_TRUE(guac_common_region_is_empty(region));
+
+    guac_common_region_free(region);
+
+}
+
+/**
+ * Test which verifies that guac_common_region_union_rect() splits bands as
+ * necessary when rectangles partially overlap vertically.
+ */
+void test_region__union_rect_split() {
+
+    guac_common_rect rect;
+    guac_common_region* region = guac_common_region_alloc();
+
+    guac_common_rect_init(&rect, 0, 0, 10, 20);
+    guac_common_region_union_rect(region, &rect);
+    guac_common_rect_init(&rect, 20, 10, 10, 20);
+    guac_common_region_union_rect(region, &rect);
+
+    /* Expect three bands: [0, 10), [10, 20) and [20, 30) */
+    CU_ASSERT_EQUAL_FATAL(3, region->band_count);
+
+    CU_ASSERT_EQUAL(0, region->bands[0].y);
+    CU_ASSERT_EQUAL(10, region->bands[0].height);
+    CU_ASSERT_EQUAL(1, region->bands[0].span_count);
+
+    CU_ASSERT_EQUAL(10, region->bands[1].y);
+    CU_ASSERT_EQUAL(10, region->bands[1].height);
+    CU_ASSERT_EQUAL_FATAL(2, region->bands[1].span_count);
+    CU_ASSERT_EQUAL(0, region->bands[1].spans[0].x);
+    CU_ASSERT_EQUAL(10, region->bands[1].spans[0].width);
+    CU_ASSERT_EQUAL(20, region->bands[1].spans[1].x);
+    CU_ASSERT_EQUAL(10, region->bands[1].spans[1].width);
+
+    CU_ASSERT_EQUAL(20, region->bands[2].y);
+    CU_ASSERT_EQUAL(10, region->bands[2].height);
+    CU_ASSERT_EQUAL_FATAL(1, region->bands[2].span_count);
+    CU_ASSERT_EQUAL(20, region->bands[2].spans[0].x);
+
+    guac_common_region_free(region);
+
+}
+
+/**
+ * Test which verifies that guac_common_region_union_rect() merges spans which
+ * overlap or touch, and coalesces vertically-adjacent bands which become
+ * identical.
+ */
+void test_region__union_rect_merge() {
+
+    guac_common_rect rect;
+    guac_common_region* region = guac_common_region_alloc();
+
+    /* Three glyph-like rects on one line, the last touching the second */
+    guac_common_rect_init(&rect, 0, 0, 8, 16);
+    guac_common_region_union_rect(region, &rect);
+    guac_common_rect_init(&rect, 16, 0, 8, 16);
+    guac_common_region_union_rect(region, &rect);
+    guac_common_rect_init(&rect, 24, 0, 8, 16);
+    guac_common_region_union_rect(region, &rect);
+
+    CU_ASSERT_EQUAL_FATAL(1, region->band_count);
+    CU_ASSERT_EQUAL_FATAL(2, region->bands[0].span_count);
+    CU_ASSERT_EQUAL(16, region->bands[0].spans[1].x);
+    CU_ASSERT_EQUAL(16, region->bands[0].spans[1].width);
+
+    /* Filling the gap merges everything into one span */
+    guac_common_rect_init(&rect, 4, 4, 14, 4);
+    guac_common_region_union_rect(region, &rect);
+    guac_common_rect_init(&rect, 8, 0, 8, 16);
+    guac_common_region_union_rect(region, &rect);
+
+    CU_ASSERT_EQUAL_FATAL(1, region->band_count);
+    CU_ASSERT_EQUAL(0, region->bands[0].y);
+    CU_ASSERT_EQUAL(16, region->bands[0].height);
+    CU_ASSERT_EQUAL_FATAL(1, region->bands[0].span_count);
+    CU_ASSERT_EQUAL(0, region->bands[0].spans[0].x);
+    CU_ASSERT_EQUAL(32, region->bands[0].spans[0].width);
+
+    /* Identical line directly below is coalesced into the same band */
+    guac_common_rect_init(&rect, 0, 16, 32, 16);
+    guac_common_region_union_rect(region, &rect);
+
+    CU_ASSERT_EQUAL_FATAL(1, region->band_count);
+    CU_ASSERT_EQUAL(32, region->bands[0].height);
+
+    /* Clearing empties the region */
+    guac_common_region_clear(region);
+    CU_ASSERT_TRUE(guac_common_region_is_empty(region));
+
+    guac_common_region_free(region);
+
+}
+
@@ -0,0 +1,133 @@
+/*
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ * KIND, either express or implied.  See the License for the
+ * specific language governing permissions and limitations
+ * under the License.
+ */
+
+#include "common/rect.h"
+#include "common/snapshot.h"
+
+#include <CUnit/CUnit.h>
+#include <guacamole/mem.h>
+#include <stdint.h>
+
+/**
+ * The width of the buffer from which snapshots are taken in the tests below,
+ * in pixels.
+ */
+#define BUFFER_WIDTH 1100
+
+/**
+ * The height of the buffer from which snapshots are taken in the tests
+ * below, in pixels.
+ */
+#define BUFFER_HEIGHT 700
+
+/**
+ * Returns the color of the pixel at the given coordinates of the buffer from
+ * which snapshots are taken in the tests below.
+ *
+ * @param x
+ *     The X coordinate of the pixel.
+ *
+ * @param y
+ *     The Y coordinate of the pixel.
+ *
+ * @return
+ *     The 32-bit ARGB color of the pixel.
+ */
+static uint32_t expected_pixel(int x, int y) {
+    return 0xFF000000 | (x * 7 % 256) << 16 | (y * 13 % 256) << 8
+        | ((x + y) % 256);
+}
+
+/**
+ * Test which verifies that a snapshot copies exactly the pixels of the
+ * requested area, notes whether those pixels are opaque, and is split into
+ * bands which together cover the entire area.
+ */
+void test_snapshot__alloc() {
+
+    int stride = BUFFER_WIDTH * 4;
+    uint32_t* buffer = guac_mem_alloc(stride, BUFFER_HEIGHT);
+
+    for (int y = 0; y < BUFFER_HEIGHT; y++) {
+        for (int x = 0; x < BUFFER_WIDTH; x++)
+            buffer[y * BUFFER_WIDTH + x] = expected_pixel(x, y);
+    }
+
+    guac_common_rect rect;
+    guac_common_rect_init(&rect, 30, 20, 1024, 600);
+
+    guac_common_snapshot* snapshot = guac_common_snapshot_alloc(
+            (unsigned char*) buffer, stride, &rect);
+    CU_ASSERT_PTR_NOT_NULL_FATAL(snapshot);
+
+    CU_ASSERT_EQUAL(snapshot->rect.x, rect.x);
+    CU_ASSERT_EQUAL(snapshot->rect.y, rect.y);
+    CU_ASSERT_EQUAL(snapshot->rect.width, rect.width);
+    CU_ASSERT_EQUAL(snapshot->rect.height, rect.height);
+    CU_ASSERT_TRUE(snapshot->opaque);
+
+    /* Copied pixels must match the requested area of the original */
+    int mismatched = 0;
+    for (int y = 0; y < rect.height; y++) {
+        const uint32_t* row = (const uint32_t*)
+            (snapshot->buffer + y * snapshot->stride);
+        for (int x = 0; x < rect.width; x++) {
+            if (row[x] != expected_pixel(rect.x + x, rect.y + y))
+                mismatched++;
+        }
+    }
+
+    CU_ASSERT_EQUAL(mismatched, 0);
+
+    /* Bands must be contiguous, no larger than the band size, and cover the
+     * entire snapshot */
+    CU_ASSERT_FATAL(snapshot->band_count > 1);
+
+    int next_y = 0;
+    for (int i = 0; i < snapshot->band_count; i++) {
+        guac_common_snapshot_band* band = &snapshot->bands[i];
+        CU_ASSERT_EQUAL(band->y, next_y);
+        CU_ASSERT(band->height > 0);
+        CU_ASSERT(band->height * rect.width
+                <= GUAC_COMMON_SNAPSHOT_BAND_PIXELS);
+        CU_ASSERT_PTR_NULL(band->data);
+        next_y += band->height;
+    }
+
+    CU_ASSERT_EQUAL(next_y, rect.height);
+
+    guac_common_snapshot_release(snapshot);
+
+    /* Any transparent pixel makes the snapshot non-opaque */
+    buffer[(rect.y + 300) * BUFFER_WIDTH + rect.x + 500] = 0x00000000;
+
+    snapshot = guac_common_snapshot_alloc((unsigned char*) buffer, stride,
+            &rect);
+    CU_ASSERT_PTR_NOT_NULL_FATAL(snapshot);
+    CU_ASSERT_FALSE(snapshot->opaque);
+
+    /* Additional references keep the snapshot alive */
+    CU_ASSERT_PTR_EQUAL(guac_common_snapshot_retain(snapshot), snapshot);
+    guac_common_snapshot_release(snapshot);
+    CU_ASSERT_PTR_NOT_NULL(snapshot->buffer);
+    guac_common_snapshot_release(snapshot);
+
+    guac_mem_free(buffer);
+
+}
@@ -0,0 +1,282 @@
+/*
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ * KIND, either express or implied.  See the License for the
+ * specific language governing permissions and limitations
+ * under the License.
+ */
+
+#include "common/rect.h"
+#include "common/snapshot.h"
+
+#include <cairo/cairo.h>
+#include <CUnit/CUnit.h>
+#include <guacamole/client.h>
+#include <guacamole/mem.h>
+#include <guacamole/parser.h>
+#include <guacamole/protocol.h>
+#include <guacamole/socket.h>
+
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+/**
+ * The width of the snapshots sent within the tests below, in pixels.
+ */
+#define SNAPSHOT_WIDTH 1024
+
+/**
+ * The height of the snapshots sent within the tests below, in pixels. This
+ * is large enough that each snapshot is split into several bands.
+ */
+#define SNAPSHOT_HEIGHT 600
+
+/**
+ * The PNG data received for a single image, as read back by
+ * read_png().
+ */
+typedef struct received_png {
+
+    /**
+     * The received PNG data.
+     */
+    unsigned char* data;
+
+    /**
+     * The number of bytes of PNG data received.
+     */
+    size_t length;
+
+    /**
+     * The number of bytes of PNG data already read back.
+     */
+    size_t offset;
+
+} received_png;
+
+/**
+ * Cairo read function which reads back the PNG data of a received_png.
+ *
+ * @param closure
+ *     The received_png being read.
+ *
+ * @param data
+ *     The buffer which should receive the PNG data.
+ *
+ * @param length
+ *     The number of bytes of PNG data requested.
+ *
+ * @return
+ *     CAIRO_STATUS_SUCCESS if the requested data was read, or
+ *     CAIRO_STATUS_READ_ERROR if insufficient data remains.
+ */
+static cairo_status_t read_png(void* closure, unsigned char* data,
+        unsigned int length) {
+
+    received_png* png = (received_png*) closure;
+
+    if (png->length - png->offset < length)
+        return CAIRO_STATUS_READ_ERROR;
+
+    memcpy(data, png->data + png->offset, length);
+    png->offset += length;
+
+    return CAIRO_STATUS_SUCCESS;
+
+}
+
+/**
+ * Returns the color of the pixel at the given coordinates of the snapshots
+ * sent within the tests below.
+ *
+ * @param x
+ *     The X coordinate of the pixel.
+ *
+ * @param y
+ *     The Y coordinate of the pixel.
+ *
+ * @param opaque
+ *     Whether the snapshot is opaque. If false, a diagonal stripe of pixels
+ *     is fully transparent.
+ *
+ * @return
+ *     The 32-bit ARGB color of the pixel.
+ */
+static uint32_t expected_pixel(int x, int y, int opaque) {
+
+    if (!opaque && (x + y) % 64 < 8)
+        return 0x00000000;
+
+    return 0xFF000000 | (x * 7 % 256) << 16 | (y * 13 % 256) << 8
+        | ((x + y) % 256);
+
+}
+
+/**
+ * Sends a snapshot of test pixels over a guac_socket, reassembles the PNG
+ * data of each band from the "img" and "blob" instructions sent, and verifies
+ * that the decoded bands reproduce the original pixels at the original
+ * location.
+ *
+ * @param opaque
+ *     Whether the snapshot should consist only of opaque pixels.
+ */
+static void assert_round_trip(int opaque) {
+
+    int stride = SNAPSHOT_WIDTH * 4;
+    uint32_t* buffer = guac_mem_alloc(stride, SNAPSHOT_HEIGHT);
+
+    for (int y = 0; y < SNAPSHOT_HEIGHT; y++) {
+        for (int x = 0; x < SNAPSHOT_WIDTH; x++)
+            buffer[y * SNAPSHOT_WIDTH + x] = expected_pixel(x, y, opaque);
+    }
+
+    guac_common_rect rect;
+    guac_common_rect_init(&rect, 0, 0, SNAPSHOT_WIDTH, SNAPSHOT_HEIGHT);
+
+    guac_common_snapshot* snapshot = guac_common_snapshot_alloc(
+            (unsigned char*) buffer, stride, &rect);
+    CU_ASSERT_PTR_NOT_NULL_FATAL(snapshot);
+    CU_ASSERT_EQUAL(snapshot->opaque, opaque);
+
+    /* Send snapshot to a temporary file, offset within the layer */
+    snapshot->rect.x = 10;
+    snapshot->rect.y = 20;
+
+    char path[] = "/tmp/guac-snapshot-test-XXXXXX";
+    int fd = mkstemp(path);
+    CU_ASSERT_NOT_EQUAL_FATAL(fd, -1);
+    unlink(path);
+
+    int read_fd = dup(fd);
+    CU_ASSERT_NOT_EQUAL_FATAL(read_fd, -1);
+
+    guac_client* client = guac_client_alloc();
+    CU_ASSERT_PTR_NOT_NULL_FATAL(client);
+
+    guac_socket* socket = guac_socket_open(fd);
+    guac_common_snapshot_send(snapshot, client, socket, GUAC_DEFAULT_LAYER);
+    guac_socket_free(socket);
+
+    int band_count = snapshot->band_count;
+    guac_common_snapshot_release(snapshot);
+    guac_client_free(client);
+
+    /* Read back everything sent */
+    CU_ASSERT_EQUAL_FATAL(lseek(read_fd, 0, SEEK_SET), 0);
+    socket = guac_socket_open(read_fd);
+    guac_parser* parser = guac_parser_alloc();
+
+    received_png png = { 0 };
+    int images = 0;
+    int clears = 0;
+    int next_y = 0;
+    int mismatched = 0;
+
+    while (guac_parser_read(parser, socket, 1000000) == 0) {
+
+        /* Each image begins a new band */
+        if (strcmp(parser->opcode, "img") == 0) {
+            CU_ASSERT_EQUAL_FATAL(parser->argc, 6);
+            CU_ASSERT_STRING_EQUAL(parser->argv[3], "image/png");
+            CU_ASSERT_EQUAL(atoi(parser->argv[4]), 10);
+            CU_ASSERT_EQUAL(atoi(parser->argv[5]), 20 + next_y);
+            png.length = 0;
+        }
+
+        /* Transparent bands must first be cleared */
+        else if (strcmp(parser->opcode, "cfill") == 0)
+            clears++;
+
+        /* Append the decoded contents of each blob */
+        else if (strcmp(parser->opcode, "blob") == 0) {
+            CU_ASSERT_EQUAL_FATAL(parser->argc, 2);
+            int length = guac_protocol_decode_base64(parser->argv[1]);
+            png.data = guac_mem_realloc_or_die(png.data, png.length + length);
+            memcpy(png.data + png.length, parser->argv[1], length);
+            png.length += length;
+        }
+
+        /* Decode and verify each band once complete */
+        else if (strcmp(parser->opcode, "end") == 0) {
+
+            png.offset = 0;
+            cairo_surface_t* surface = cairo_image_surface_create_from_png_stream(
+                    read_png, &png);
+            CU_ASSERT_EQUAL_FATAL(cairo_surface_status(surface),
+                    CAIRO_STATUS_SUCCESS);
+
+            int width = cairo_image_surface_get_width(surface);
+            int height = cairo_image_surface_get_height(surface);
+            CU_ASSERT_EQUAL_FATAL(width, SNAPSHOT_WIDTH);
+            CU_ASSERT_FATAL(next_y + height <= SNAPSHOT_HEIGHT);
+
+            /* Opaque snapshots are encoded without an alpha channel */
+            uint32_t mask = opaque ? 0x00FFFFFF : 0xFFFFFFFF;
+            CU_ASSERT_EQUAL(cairo_image_surface_get_format(surface),
+                    opaque ? CAIRO_FORMAT_RGB24 : CAIRO_FORMAT_ARGB32);
+
+            unsigned char* data = cairo_image_surface_get_data(surface);
+            int band_stride = cairo_image_surface_get_stride(surface);
+
+            for (int y = 0; y < height; y++) {
+                const uint32_t* row = (const uint32_t*)
+                    (data + y * band_stride);
+                for (int x = 0; x < width; x++) {
+                    if ((row[x] & mask)
+                            != (expected_pixel(x, next_y + y, opaque) & mask))
+                        mismatched++;
+                }
+            }
+
+            cairo_surface_destroy(surface);
+            next_y += height;
+            images++;
+
+        }
+
+    }
+
+    /* Every band must have been sent, in order, covering the snapshot */
+    CU_ASSERT_EQUAL(images, band_count);
+    CU_ASSERT(images > 1);
+    CU_ASSERT_EQUAL(clears, opaque ? 0 : band_count);
+    CU_ASSERT_EQUAL(next_y, SNAPSHOT_HEIGHT);
+    CU_ASSERT_EQUAL(mismatched, 0);
+
+    guac_mem_free(png.data);
+    guac_parser_free(parser);
+    guac_socket_free(socket);
+    guac_mem_free(buffer);
+
+}
+
+/**
+ * Test which verifies that an opaque snapshot is sent as a series of PNG
+ * images which, once reassembled, reproduce the snapshotted pixels.
+ */
+void test_snapshot__send_opaque() {
+    assert_round_trip(1);
+}
+
+/**
+ * Test which verifies that a snapshot containing transparent pixels clears
+ * each band before sending that band as a PNG image with an alpha channel,
+ * and that the reassembled images reproduce the snapshotted pixels.
+ */
+void test_snapshot__send_transparent() {
+    assert_round_trip(0);
+}
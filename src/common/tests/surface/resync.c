@@ -0,0 +1,354 @@
+/*
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ * KIND, either express or implied.  See the License for the
+ * specific language governing permissions and limitations
+ * under the License.
+ */
+
+#include "common/rect.h"
+#include "common/surface.h"
+
+#include <cairo/cairo.h>
+#include <CUnit/CUnit.h>
+#include <guacamole/client.h>
+#include <guacamole/mem.h>
+#include <guacamole/parser.h>
+#include <guacamole/protocol.h>
+#include <guacamole/socket.h>
+#include <guacamole/timestamp.h>
+
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+/**
+ * The width of the surface resynced within the tests below, in pixels. This
+ * is exactly four heat map cells wide.
+ */
+#define SURFACE_WIDTH 256
+
+/**
+ * The height of the surface resynced within the tests below, in pixels. This
+ * is exactly three heat map cells high.
+ */
+#define SURFACE_HEIGHT 192
+
+/**
+ * The maximum number of images recorded by resync_images().
+ */
+#define MAX_IMAGES 16
+
+/**
+ * The updates sent by a single call to guac_common_surface_resync(), as read
+ * back by resync_images().
+ */
+typedef struct resync_result {
+
+    /**
+     * The number of "size" instructions sent.
+     */
+    int sizes;
+
+    /**
+     * The number of images sent.
+     */
+    int images;
+
+    /**
+     * The area of the surface covered by each image sent, in order.
+     */
+    guac_common_rect rects[MAX_IMAGES];
+
+} resync_result;
+
+/**
+ * The PNG data received for a single image, as read back by read_png().
+ */
+typedef struct received_png {
+
+    /**
+     * The received PNG data.
+     */
+    unsigned char* data;
+
+    /**
+     * The number of bytes of PNG data received.
+     */
+    size_t length;
+
+    /**
+     * The number of bytes of PNG data already read back.
+     */
+    size_t offset;
+
+} received_png;
+
+/**
+ * Cairo read function which reads back the PNG data of a received_png.
+ *
+ * @param closure
+ *     The received_png being read.
+ *
+ * @param data
+ *     The buffer which should receive the PNG data.
+ *
+ * @param length
+ *     The number of bytes of PNG data requested.
+ *
+ * @return
+ *     CAIRO_STATUS_SUCCESS if the requested data was read, or
+ *     CAIRO_STATUS_READ_ERROR if insufficient data remains.
+ */
+static cairo_status_t read_png(void* closure, unsigned char* data,
+        unsigned int length) {
+
+    received_png* png = (received_png*) closure;
+
+    if (png->length - png->offset < length)
+        return CAIRO_STATUS_READ_ERROR;
+
+    memcpy(data, png->data + png->offset, length);
+    png->offset += length;
+
+    return CAIRO_STATUS_SUCCESS;
+
+}
+
+/**
+ * Resyncs the given surface over a guac_socket as if to a user which stopped
+ * receiving live updates at the given time, recording the "size"
+ * instructions and the area covered by each image sent.
+ *
+ * @param surface
+ *     The surface to resync.
+ *
+ * @param client
+ *     The client that owns the surface.
+ *
+ * @param since
+ *     The time that the simulated user stopped receiving live updates.
+ *
+ * @param result
+ *     Storage for the updates sent.
+ */
+static void resync_images(guac_common_surface* surface, guac_client* client,
+        guac_timestamp since, resync_result* result) {
+
+    memset(result, 0, sizeof(resync_result));
+
+    char path[] = "/tmp/guac-resync-test-XXXXXX";
+    int fd = mkstemp(path);
+    CU_ASSERT_NOT_EQUAL_FATAL(fd, -1);
+    unlink(path);
+
+    int read_fd = dup(fd);
+    CU_ASSERT_NOT_EQUAL_FATAL(read_fd, -1);
+
+    guac_socket* socket = guac_socket_open(fd);
+    guac_common_surface_resync(surface, client, socket, since);
+    guac_socket_free(socket);
+
+    /* Read back everything sent */
+    CU_ASSERT_EQUAL_FATAL(lseek(read_fd, 0, SEEK_SET), 0);
+    socket = guac_socket_open(read_fd);
+    guac_parser* parser = guac_parser_alloc();
+
+    received_png png = { 0 };
+    guac_common_rect* rect = NULL;
+
+    while (guac_parser_read(parser, socket, 1000000) == 0) {
+
+        if (strcmp(parser->opcode, "size") == 0)
+            result->sizes++;
+
+        /* Each image begins at the location of its area */
+        else if (strcmp(parser->opcode, "img") == 0) {
+            CU_ASSERT_EQUAL_FATAL(parser->argc, 6);
+            CU_ASSERT_FATAL(result->images < MAX_IMAGES);
+            rect = &result->rects[result->images++];
+            rect->x = atoi(parser->argv[4]);
+            rect->y = atoi(parser->argv[5]);
+            png.length = 0;
+        }
+
+        /* Append the decoded contents of each blob */
+        else if (strcmp(parser->opcode, "blob") == 0) {
+            CU_ASSERT_EQUAL_FATAL(parser->argc, 2);
+            int length = guac_protocol_decode_base64(parser->argv[1]);
+            png.data = guac_mem_realloc_or_die(png.data, png.length + length);
+            memcpy(png.data + png.length, parser->argv[1], length);
+            png.length += length;
+        }
+
+        /* The size of each area is that of the decoded image */
+        else if (strcmp(parser->opcode, "end") == 0) {
+
+            CU_ASSERT_PTR_NOT_NULL_FATAL(rect);
+
+            png.offset = 0;
+            cairo_surface_t* image = cairo_image_surface_create_from_png_stream(
+                    read_png, &png);
+            CU_ASSERT_EQUAL_FATAL(cairo_surface_status(image),
+                    CAIRO_STATUS_SUCCESS);
+
+            rect->width = cairo_image_surface_get_width(image);
+            rect->height = cairo_image_surface_get_height(image);
+            cairo_surface_destroy(image);
+
+        }
+
+    }
+
+    guac_mem_free(png.data);
+    guac_parser_free(parser);
+    guac_socket_free(socket);
+
+}
+
+/**
+ * Returns whether the given rectangle has the given position and
+ * dimensions.
+ *
+ * @param rect
+ *     The rectangle to check.
+ *
+ * @param x
+ *     The expected X coordinate of the rectangle.
+ *
+ * @param y
+ *     The expected Y coordinate of the rectangle.
+ *
+ * @param width
+ *     The expected width of the rectangle.
+ *
+ * @param height
+ *     The expected height of the rectangle.
+ *
+ * @return
+ *     Non-zero if the rectangle matches, zero otherwise.
+ */
+static int rect_equals(const guac_common_rect* rect, int x, int y, int width,
+        int height) {
+    return rect->x == x && rect->y == y
+        && rect->width == width && rect->height == height;
+}
+
+/**
+ * Test which verifies that resyncing a surface sends only the heat map cells
+ * changed since the given time, that nothing is sent if the surface has not
+ * changed, and that the entire surface is sent if the time is unknown.
+ */
+void test_surface__resync() {
+
+    guac_client* client = guac_client_alloc();
+    CU_ASSERT_PTR_NOT_NULL_FATAL(client);
+
+    /* Live updates are discarded */
+    guac_socket* live = guac_socket_alloc();
+    guac_common_surface* surface = guac_common_surface_alloc(client, live,
+            GUAC_DEFAULT_LAYER, SURFACE_WIDTH, SURFACE_HEIGHT);
+    CU_ASSERT_PTR_NOT_NULL_FATAL(surface);
+
+    guac_common_surface_set(surface, 0, 0, SURFACE_WIDTH, SURFACE_HEIGHT,
+            0x00, 0x00, 0x00, 0xFF);
+    guac_common_surface_flush(surface);
+
+    /* Ensure later changes are strictly after the initial contents */
+    guac_timestamp_msleep(5);
+    guac_timestamp since = guac_timestamp_current();
+
+    resync_result result;
+
+    /* Nothing has changed yet */
+    resync_images(surface, client, since, &result);
+    CU_ASSERT_EQUAL(result.sizes, 0);
+    CU_ASSERT_EQUAL(result.images, 0);
+
+    /* Change parts of two cells which are not adjacent */
+    guac_common_surface_set(surface, 70, 70, 10, 10, 0xFF, 0x00, 0x00, 0xFF);
+    guac_common_surface_set(surface, 250, 190, 2, 2, 0x00, 0xFF, 0x00, 0xFF);
+    guac_common_surface_flush(surface);
+
+    resync_images(surface, client, since, &result);
+    CU_ASSERT_EQUAL(result.sizes, 1);
+    CU_ASSERT_EQUAL_FATAL(result.images, 2);
+    CU_ASSERT_TRUE(rect_equals(&result.rects[0], 64, 64, 64, 64));
+    CU_ASSERT_TRUE(rect_equals(&result.rects[1], 192, 128, 64, 64));
+
+    /* Without a known time, the entire surface is sent */
+    resync_images(surface, client, 0, &result);
+    CU_ASSERT_EQUAL(result.sizes, 1);
+
+    int area = 0;
+    for (int i = 0; i < result.images; i++)
+        area += result.rects[i].width * result.rects[i].height;
+
+    CU_ASSERT_EQUAL(area, SURFACE_WIDTH * SURFACE_HEIGHT);
+
+    guac_common_surface_free(surface);
+    guac_socket_free(live);
+    guac_client_free(client);
+
+}
+
+/**
+ * Test which verifies that changes spanning adjacent cells are resent as a
+ * single area, and that resizing a surface causes the entire surface to be
+ * resent.
+ */
+void test_surface__resync_adjacent() {
+
+    guac_client* client = guac_client_alloc();
+    CU_ASSERT_PTR_NOT_NULL_FATAL(client);
+
+    guac_socket* live = guac_socket_alloc();
+    guac_common_surface* surface = guac_common_surface_alloc(client, live,
+            GUAC_DEFAULT_LAYER, SURFACE_WIDTH, SURFACE_HEIGHT);
+    CU_ASSERT_PTR_NOT_NULL_FATAL(surface);
+
+    guac_common_surface_set(surface, 0, 0, SURFACE_WIDTH, SURFACE_HEIGHT,
+            0x00, 0x00, 0x00, 0xFF);
+    guac_common_surface_flush(surface);
+
+    guac_timestamp_msleep(5);
+    guac_timestamp since = guac_timestamp_current();
+
+    /* Change a rectangle spanning two cells horizontally */
+    guac_common_surface_set(surface, 60, 10, 10, 10, 0xFF, 0x00, 0x00, 0xFF);
+    guac_common_surface_flush(surface);
+
+    resync_result result;
+    resync_images(surface, client, since, &result);
+    CU_ASSERT_EQUAL_FATAL(result.images, 1);
+    CU_ASSERT_TRUE(rect_equals(&result.rects[0], 0, 0, 128, 64));
+
+    /* Resizing leaves no record of which areas changed */
+    guac_common_surface_resize(surface, SURFACE_WIDTH + 32, SURFACE_HEIGHT);
+    guac_common_surface_flush(surface);
+
+    resync_images(surface, client, since, &result);
+    CU_ASSERT_EQUAL(result.sizes, 1);
+
+    int area = 0;
+    for (int i = 0; i < result.images; i++)
+        area += result.rects[i].width * result.rects[i].height;
+
+    CU_ASSERT_EQUAL(area, (SURFACE_WIDTH + 32) * SURFACE_HEIGHT);
+
+    guac_common_surface_free(surface);
+    guac_socket_free(live);
+    guac_client_free(client);
+
+}
@@ -0,0 +1,88 @@
+/*
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ * KIND, either express or implied.  See the License for the
+ * specific language governing permissions and limitations
+ * under the License.
+ */
+
+
+#include "common/surface_pool.h"
+
+#include <CUnit/CUnit.h>
+#include <string.h>
+
+/**
+ * Test which verifies that guac_common_surface_pool accounts for each
+ * allocation by rounding it up to its size class, and no longer accounts for
+ * allocations once released.
+ */
+void test_surface_pool__accounting() {
+
+    guac_common_surface_pool* pool = guac_common_surface_pool_alloc();
+    CU_ASSERT_EQUAL(0, guac_common_surface_pool_get_used(pool));
+
+    /* Small allocations use the smallest size class */
+    void* small = guac_common_surface_pool_zalloc(pool, 10);
+    CU_ASSERT_PTR_NOT_NULL_FATAL(small);
+    CU_ASSERT_EQUAL(64, guac_common_surface_pool_get_used(pool));
+
+    /* Larger allocations round up to the next quarter power of two */
+    void* large = guac_common_surface_pool_zalloc(pool, 16385);
+    CU_ASSERT_PTR_NOT_NULL_FATAL(large);
+    CU_ASSERT_EQUAL(64 + 20480, guac_common_surface_pool_get_used(pool));
+
+    guac_common_surface_pool_release(pool, small, 10);
+    CU_ASSERT_EQUAL(20480, guac_common_surface_pool_get_used(pool));
+
+    guac_common_surface_pool_release(pool, large, 16385);
+    CU_ASSERT_EQUAL(0, guac_common_surface_pool_get_used(pool));
+
+    guac_common_surface_pool_free(pool);
+
+}
+
+/**
+ * Test which verifies that guac_common_surface_pool reuses released blocks for
+ * allocations of the same size class, clearing them first.
+ */
+void test_surface_pool__reuse() {
+
+    guac_common_surface_pool* pool = guac_common_surface_pool_alloc();
+
+    unsigned char* first = guac_common_surface_pool_zalloc(pool, 4000);
+    CU_ASSERT_PTR_NOT_NULL_FATAL(first);
+    memset(first, 0xFF, 4000);
+    guac_common_surface_pool_release(pool, first, 4000);
+
+    /* A different size within the same class reuses the released block */
+    unsigned char* second = guac_common_surface_pool_zalloc(pool, 3900);
+    CU_ASSERT_PTR_EQUAL(first, second);
+
+    /* Reused blocks must be zeroed like new blocks */
+    int cleared = 1;
+    for (int i = 0; i < 3900; i++) {
+        if (second[i] != 0) {
+            cleared = 0;
+            break;
+        }
+    }
+
+    CU_ASSERT_TRUE(cleared);
+
+    guac_common_surface_pool_release(pool, second, 3900);
+    guac_common_surface_pool_free(pool);
+
+}
+
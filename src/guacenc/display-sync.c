@@ -21,6 +21,7 @@
 #include "display.h"
 #include "layer.h"
 #include "log.h"
+#include "terminal.h"
 #include "video.h"
 
 #include <guacamole/client.h>
@@ -40,6 +41,18 @@ int guacenc_display_sync(guacenc_display* display, guac_timestamp timestamp) {
     /* Update timestamp of display */
     display->last_sync = timestamp;
 
+    /* Draw the contents of any recorded terminal to the default layer */
+    if (display->terminal != NULL) {
+
+        guacenc_layer* layer = guacenc_display_get_layer(display, 0);
+        if (layer == NULL)
+            return 1;
+
+        if (guacenc_terminal_render(display->terminal, layer->buffer))
+            return 1;
+
+    }
+
     /* Flatten display to default layer */
     if (guacenc_display_flatten(display))
         return 1;
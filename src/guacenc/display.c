@@ -132,6 +132,9 @@ int guacenc_display_free(guacenc_display* display) {
     /* Free cursor */
     guacenc_cursor_free(display->cursor);
 
+    /* Free terminal contents, if any */
+    guacenc_terminal_free(display->terminal);
+
     guac_mem_free(display);
     return retval;
 
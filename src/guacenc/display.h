@@ -25,6 +25,7 @@
 #include "cursor.h"
 #include "image-stream.h"
 #include "layer.h"
+#include "terminal.h"
 #include "video.h"
 
 #include <cairo/cairo.h>
@@ -89,6 +90,13 @@ typedef struct guacenc_display {
      */
     guac_timestamp last_sync;
 
+    /**
+     * The character cells of the terminal described by any terminal cell
+     * recording being encoded, rendered to the default layer upon each
+     * sync, or NULL if no "term-size" instruction has yet been read.
+     */
+    guacenc_terminal* terminal;
+
     /**
      * The video that this display is recording to.
      */
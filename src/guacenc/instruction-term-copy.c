@@ -0,0 +1,57 @@
+/*
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ * KIND, either express or implied.  See the License for the
+ * specific language governing permissions and limitations
+ * under the License.
+ */
+
+#include "config.h"
+#include "display.h"
+#include "log.h"
+#include "terminal.h"
+
+#include <guacamole/client.h>
+
+#include <stdlib.h>
+
+int guacenc_handle_term_copy(guacenc_display* display, int argc,
+        char** argv) {
+
+    /* Verify argument count */
+    if (argc < 4) {
+        guacenc_log(GUAC_LOG_WARNING, "\"term-copy\" instruction incomplete");
+        return 1;
+    }
+
+    /* Cells cannot be copied before terminal size is known */
+    if (display->terminal == NULL) {
+        guacenc_log(GUAC_LOG_WARNING, "\"term-copy\" instruction received "
+                "before \"term-size\"");
+        return 1;
+    }
+
+    /* Parse arguments */
+    int row = atoi(argv[0]);
+    int start_column = atoi(argv[1]);
+    int end_column = atoi(argv[2]);
+    int offset = atoi(argv[3]);
+
+    guacenc_terminal_copy_columns(display->terminal, row,
+            start_column, end_column, offset);
+
+    return 0;
+
+}
+
@@ -0,0 +1,55 @@
+/*
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ * KIND, either express or implied.  See the License for the
+ * specific language governing permissions and limitations
+ * under the License.
+ */
+
+#include "config.h"
+#include "display.h"
+#include "log.h"
+#include "terminal.h"
+
+#include <guacamole/client.h>
+
+#include <stdlib.h>
+
+int guacenc_handle_term_scroll(guacenc_display* display, int argc,
+        char** argv) {
+
+    /* Verify argument count */
+    if (argc < 3) {
+        guacenc_log(GUAC_LOG_WARNING, "\"term-scroll\" instruction incomplete");
+        return 1;
+    }
+
+    /* Rows cannot be copied before terminal size is known */
+    if (display->terminal == NULL) {
+        guacenc_log(GUAC_LOG_WARNING, "\"term-scroll\" instruction received "
+                "before \"term-size\"");
+        return 1;
+    }
+
+    /* Parse arguments */
+    int start_row = atoi(argv[0]);
+    int end_row = atoi(argv[1]);
+    int offset = atoi(argv[2]);
+
+    guacenc_terminal_copy_rows(display->terminal, start_row, end_row, offset);
+
+    return 0;
+
+}
+
@@ -0,0 +1,62 @@
+/*
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ * KIND, either express or implied.  See the License for the
+ * specific language governing permissions and limitations
+ * under the License.
+ */
+
+#include "config.h"
+#include "display.h"
+#include "log.h"
+#include "terminal.h"
+
+#include <guacamole/client.h>
+
+#include <stdlib.h>
+
+int guacenc_handle_term_size(guacenc_display* display, int argc,
+        char** argv) {
+
+    /* Verify argument count */
+    if (argc < 5) {
+        guacenc_log(GUAC_LOG_WARNING, "\"term-size\" instruction incomplete");
+        return 1;
+    }
+
+    /* Parse arguments */
+    int columns = atoi(argv[0]);
+    int rows = atoi(argv[1]);
+    int char_width = atoi(argv[2]);
+    int char_height = atoi(argv[3]);
+    int background = atoi(argv[4]);
+
+    /* A terminal without cells cannot be rendered */
+    if (columns <= 0 || rows <= 0 || char_width <= 0 || char_height <= 0) {
+        guacenc_log(GUAC_LOG_WARNING, "\"term-size\" instruction has "
+                "invalid dimensions (%ix%i cells of %ix%i pixels)",
+                columns, rows, char_width, char_height);
+        return 1;
+    }
+
+    /* Begin rendering terminal contents upon first size */
+    if (display->terminal == NULL)
+        display->terminal = guacenc_terminal_alloc();
+
+    guacenc_terminal_resize(display->terminal, columns, rows,
+            char_width, char_height, background);
+    return 0;
+
+}
+
@@ -0,0 +1,81 @@
+/*
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ * KIND, either express or implied.  See the License for the
+ * specific language governing permissions and limitations
+ * under the License.
+ */
+
+#include "config.h"
+#include "display.h"
+#include "log.h"
+#include "terminal.h"
+
+#include <guacamole/client.h>
+#include <guacamole/unicode.h>
+
+#include <stdlib.h>
+#include <string.h>
+
+int guacenc_handle_term_text(guacenc_display* display, int argc,
+        char** argv) {
+
+    /* Verify argument count */
+    if (argc < 7) {
+        guacenc_log(GUAC_LOG_WARNING, "\"term-text\" instruction incomplete");
+        return 1;
+    }
+
+    /* Text cannot be drawn before terminal size is known */
+    if (display->terminal == NULL) {
+        guacenc_log(GUAC_LOG_WARNING, "\"term-text\" instruction received "
+                "before \"term-size\"");
+        return 1;
+    }
+
+    /* Parse arguments */
+    int row = atoi(argv[0]);
+    int column = atoi(argv[1]);
+    int width = atoi(argv[2]);
+    int foreground = atoi(argv[3]);
+    int background = atoi(argv[4]);
+    int flags = atoi(argv[5]);
+    const char* text = argv[6];
+
+    if (width <= 0)
+        return 1;
+
+    /* Set each character of text, advancing by its width */
+    int length = strlen(text);
+    while (length > 0) {
+
+        int codepoint;
+        int bytes = guac_utf8_read(text, length, &codepoint);
+        if (bytes <= 0)
+            break;
+
+        guacenc_terminal_set(display->terminal, row, column,
+                column + width - 1, codepoint, width,
+                foreground, background, flags);
+
+        column += width;
+        text += bytes;
+        length -= bytes;
+
+    }
+
+    return 0;
+
+}
+
@@ -41,6 +41,14 @@ guacenc_instruction_handler_mapping guacenc_instruction_handler_map[] = {
     {"move",     guacenc_handle_move},
     {"shade",    guacenc_handle_shade},
     {"dispose",  guacenc_handle_dispose},
+
+    /* Terminal cell recordings */
+    {"term-size",   guacenc_handle_term_size},
+    {"term-text",   guacenc_handle_term_text},
+    {"term-fill",   guacenc_handle_term_fill},
+    {"term-copy",   guacenc_handle_term_copy},
+    {"term-scroll", guacenc_handle_term_scroll},
+
     {NULL,       NULL}
 };
 
@@ -169,5 +169,30 @@ guacenc_instruction_handler guacenc_handle_shade;
  */
 guacenc_instruction_handler guacenc_handle_dispose;
 
+/**
+ * Handler for the "term-size" instruction of terminal cell recordings.
+ */
+guacenc_instruction_handler guacenc_handle_term_size;
+
+/**
+ * Handler for the "term-text" instruction of terminal cell recordings.
+ */
+guacenc_instruction_handler guacenc_handle_term_text;
+
+/**
+ * Handler for the "term-fill" instruction of terminal cell recordings.
+ */
+guacenc_instruction_handler guacenc_handle_term_fill;
+
+/**
+ * Handler for the "term-copy" instruction of terminal cell recordings.
+ */
+guacenc_instruction_handler guacenc_handle_term_copy;
+
+/**
+ * Handler for the "term-scroll" instruction of terminal cell recordings.
+ */
+guacenc_instruction_handler guacenc_handle_term_scroll;
+
 #endif
 
@@ -0,0 +1,400 @@
+/*
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ * KIND, either express or implied.  See the License for the
+ * specific language governing permissions and limitations
+ * under the License.
+ */
+
+#include "config.h"
+#include "buffer.h"
+#include "terminal.h"
+
+#include <cairo/cairo.h>
+#include <guacamole/mem.h>
+#include <guacamole/unicode.h>
+
+#include <stdbool.h>
+#include <string.h>
+
+/**
+ * Restricts the given value to the given range, inclusive.
+ *
+ * @param value
+ *     The value to restrict.
+ *
+ * @param min
+ *     The minimum allowed value.
+ *
+ * @param max
+ *     The maximum allowed value.
+ *
+ * @return
+ *     The given value, restricted to the range min through max inclusive.
+ */
+static int guacenc_terminal_fit_to_range(int value, int min, int max) {
+
+    if (value < min) return min;
+    if (value > max) return max;
+
+    return value;
+
+}
+
+/**
+ * Sets the given cell to a blank space having the default background color
+ * of the given terminal.
+ *
+ * @param terminal
+ *     The terminal containing the cell.
+ *
+ * @param cell
+ *     The cell to clear.
+ */
+static void guacenc_terminal_clear_cell(guacenc_terminal* terminal,
+        guacenc_terminal_cell* cell) {
+
+    cell->codepoint = ' ';
+    cell->width = 1;
+    cell->foreground = terminal->background;
+    cell->background = terminal->background;
+    cell->flags = 0;
+    cell->dirty = true;
+
+}
+
+/**
+ * Marks the given range of cells within a row as changed.
+ *
+ * @param terminal
+ *     The terminal containing the cells.
+ *
+ * @param row
+ *     The row containing the cells.
+ *
+ * @param start_column
+ *     The first changed column, inclusive.
+ *
+ * @param end_column
+ *     The last changed column, inclusive.
+ */
+static void guacenc_terminal_mark_dirty(guacenc_terminal* terminal, int row,
+        int start_column, int end_column) {
+
+    guacenc_terminal_cell* cell =
+        &(terminal->cells[row * terminal->columns + start_column]);
+
+    for (int column = start_column; column <= end_column; column++)
+        (cell++)->dirty = true;
+
+    terminal->modified = true;
+
+}
+
+guacenc_terminal* guacenc_terminal_alloc() {
+    return guac_mem_zalloc(sizeof(guacenc_terminal));
+}
+
+void guacenc_terminal_free(guacenc_terminal* terminal) {
+
+    /* Ignore NULL terminal */
+    if (terminal == NULL)
+        return;
+
+    guac_mem_free(terminal->cells);
+    guac_mem_free(terminal);
+
+}
+
+void guacenc_terminal_resize(guacenc_terminal* terminal, int columns,
+        int rows, int char_width, int char_height, int background) {
+
+    if (columns < 0) columns = 0;
+    if (rows < 0) rows = 0;
+
+    terminal->background = background;
+
+    guacenc_terminal_cell* cells = guac_mem_alloc(sizeof(guacenc_terminal_cell),
+            columns, rows);
+
+    /* Preserve overlapping cells, clearing all others */
+    guacenc_terminal_cell* cell = cells;
+    for (int row = 0; row < rows; row++) {
+        for (int column = 0; column < columns; column++) {
+
+            if (row < terminal->rows && column < terminal->columns) {
+                *cell = terminal->cells[row * terminal->columns + column];
+                cell->dirty = true;
+            }
+            else
+                guacenc_terminal_clear_cell(terminal, cell);
+
+            cell++;
+
+        }
+    }
+
+    guac_mem_free(terminal->cells);
+    terminal->cells = cells;
+    terminal->columns = columns;
+    terminal->rows = rows;
+    terminal->char_width = char_width;
+    terminal->char_height = char_height;
+    terminal->modified = true;
+
+}
+
+void guacenc_terminal_set(guacenc_terminal* terminal, int row,
+        int start_column, int end_column, int codepoint, int width,
+        int foreground, int background, int flags) {
+
+    /* Ignore operations outside terminal bounds */
+    if (row < 0 || row >= terminal->rows || width <= 0
+            || end_column < start_column || end_column < 0
+            || start_column >= terminal->columns)
+        return;
+
+    /* Clip range to bounds, keeping characters aligned relative to the
+     * original start of the range */
+    int first_column = start_column;
+    start_column = guacenc_terminal_fit_to_range(start_column, 0, terminal->columns - 1);
+    end_column   = guacenc_terminal_fit_to_range(end_column,   0, terminal->columns - 1);
+
+    guacenc_terminal_cell* cells = &(terminal->cells[row * terminal->columns]);
+    for (int column = start_column; column <= end_column; column++) {
+
+        guacenc_terminal_cell* cell = &(cells[column]);
+        cell->foreground = foreground;
+        cell->background = background;
+        cell->flags = flags;
+
+        /* The first column of each character holds the character itself,
+         * with any remaining columns being occupied by that character. The
+         * original start of the range may lie far outside the terminal. */
+        if (((long long) column - first_column) % width == 0) {
+            cell->codepoint = codepoint;
+            cell->width = width;
+        }
+        else {
+            cell->codepoint = ' ';
+            cell->width = 0;
+        }
+
+    }
+
+    guacenc_terminal_mark_dirty(terminal, row, start_column, end_column);
+
+}
+
+void guacenc_terminal_copy_columns(guacenc_terminal* terminal, int row,
+        int start_column, int end_column, int offset) {
+
+    /* Ignore operations outside terminal bounds */
+    if (row < 0 || row >= terminal->rows)
+        return;
+
+    /* Nothing can remain within bounds if moved by the full width or more */
+    int last = terminal->columns - 1;
+    if (offset > last || offset < -last)
+        return;
+
+    /* Clip range such that both it and its destination lie within bounds,
+     * ignoring the operation if nothing remains */
+    if (start_column < 0) start_column = 0;
+    if (end_column > last) end_column = last;
+    if (end_column < start_column)
+        return;
+
+    if (start_column + offset < 0) start_column = -offset;
+    if (end_column + offset > last) end_column = last - offset;
+
+    if (end_column < start_column)
+        return;
+
+    guacenc_terminal_cell* cells = &(terminal->cells[row * terminal->columns]);
+    memmove(&(cells[start_column + offset]), &(cells[start_column]),
+            (end_column - start_column + 1) * sizeof(guacenc_terminal_cell));
+
+    guacenc_terminal_mark_dirty(terminal, row,
+            start_column + offset, end_column + offset);
+
+}
+
+void guacenc_terminal_copy_rows(guacenc_terminal* terminal,
+        int start_row, int end_row, int offset) {
+
+    /* Nothing can remain within bounds if moved by the full height or more */
+    int last = terminal->rows - 1;
+    if (offset > last || offset < -last)
+        return;
+
+    /* Clip range such that both it and its destination lie within bounds,
+     * ignoring the operation if nothing remains */
+    if (start_row < 0) start_row = 0;
+    if (end_row > last) end_row = last;
+    if (end_row < start_row)
+        return;
+
+    if (start_row + offset < 0) start_row = -offset;
+    if (end_row + offset > last) end_row = last - offset;
+
+    if (end_row < start_row)
+        return;
+
+    memmove(&(terminal->cells[(start_row + offset) * terminal->columns]),
+            &(terminal->cells[start_row * terminal->columns]),
+            (end_row - start_row + 1) * terminal->columns
+                * sizeof(guacenc_terminal_cell));
+
+    for (int row = start_row; row <= end_row; row++)
+        guacenc_terminal_mark_dirty(terminal, row + offset,
+                0, terminal->columns - 1);
+
+}
+
+/**
+ * Sets the source of the given Cairo context to the given 24-bit RGB color.
+ *
+ * @param cairo
+ *     The Cairo context to modify.
+ *
+ * @param rgb
+ *     The color to use, as a 24-bit RGB value.
+ */
+static void guacenc_terminal_set_source_rgb(cairo_t* cairo, int rgb) {
+    cairo_set_source_rgb(cairo,
+            ((rgb >> 16) & 0xFF) / 255.0,
+            ((rgb >> 8)  & 0xFF) / 255.0,
+            ( rgb        & 0xFF) / 255.0);
+}
+
+int guacenc_terminal_render(guacenc_terminal* terminal,
+        guacenc_buffer* buffer) {
+
+    int char_width = terminal->char_width;
+    int char_height = terminal->char_height;
+
+    /* Nothing to do if nothing has changed */
+    if (!terminal->modified)
+        return 0;
+
+    /* Ensure buffer exactly fits terminal */
+    int width = terminal->columns * char_width;
+    int height = terminal->rows * char_height;
+    if (buffer->width != width || buffer->height != height) {
+        if (guacenc_buffer_resize(buffer, width, height))
+            return 1;
+    }
+
+    cairo_t* cairo = buffer->cairo;
+    if (cairo == NULL) {
+        terminal->modified = false;
+        return 0;
+    }
+
+    cairo_save(cairo);
+    cairo_reset_clip(cairo);
+    cairo_set_operator(cairo, CAIRO_OPERATOR_SOURCE);
+
+    /* Scale font such that the full height of each glyph fits the cell */
+    cairo_font_extents_t extents;
+    cairo_select_font_face(cairo, GUACENC_TERMINAL_FONT_FAMILY,
+            CAIRO_FONT_SLANT_NORMAL, CAIRO_FONT_WEIGHT_NORMAL);
+    cairo_set_font_size(cairo, char_height);
+    cairo_font_extents(cairo, &extents);
+
+    double font_size = char_height;
+    if (extents.height > 0)
+        font_size = char_height * char_height / extents.height;
+
+    double ascent = extents.ascent * font_size / char_height;
+
+    guacenc_terminal_cell* cell = terminal->cells;
+    for (int row = 0; row < terminal->rows; row++) {
+
+        /* Cells covered by a wide character are drawn along with that
+         * character, while cells no longer covered are drawn as blanks */
+        guacenc_terminal_cell* cells = cell;
+        for (int column = terminal->columns - 1; column >= 0; column--) {
+
+            guacenc_terminal_cell* current = &(cells[column]);
+            if (!current->dirty || current->width != 0)
+                continue;
+
+            if (column > 0 && cells[column - 1].width == 2)
+                cells[column - 1].dirty = true;
+            else {
+                current->codepoint = ' ';
+                current->width = 1;
+            }
+
+        }
+
+        for (int column = 0; column < terminal->columns; column++, cell++) {
+
+            if (!cell->dirty)
+                continue;
+
+            cell->dirty = false;
+
+            if (cell->width == 0)
+                continue;
+
+            int x = column * char_width;
+            int y = row * char_height;
+
+            /* Background */
+            guacenc_terminal_set_source_rgb(cairo, cell->background);
+            cairo_rectangle(cairo, x, y, cell->width * char_width, char_height);
+            cairo_fill(cairo);
+
+            guacenc_terminal_set_source_rgb(cairo, cell->foreground);
+
+            /* Character, if not blank */
+            if (cell->codepoint != ' ') {
+
+                char text[5];
+                text[guac_utf8_write(cell->codepoint, text,
+                        sizeof(text) - 1)] = '\0';
+
+                cairo_select_font_face(cairo, GUACENC_TERMINAL_FONT_FAMILY,
+                        CAIRO_FONT_SLANT_NORMAL,
+                        (cell->flags & GUACENC_TERMINAL_BOLD)
+                            ? CAIRO_FONT_WEIGHT_BOLD
+                            : CAIRO_FONT_WEIGHT_NORMAL);
+                cairo_set_font_size(cairo, font_size);
+
+                cairo_move_to(cairo, x, y + ascent);
+                cairo_show_text(cairo, text);
+                cairo_new_path(cairo);
+
+            }
+
+            /* Underline */
+            if (cell->flags & GUACENC_TERMINAL_UNDERSCORE) {
+                cairo_rectangle(cairo, x, y + char_height - 1,
+                        cell->width * char_width, 1);
+                cairo_fill(cairo);
+            }
+
+        }
+    }
+
+    cairo_restore(cairo);
+
+    terminal->modified = false;
+    return 0;
+
+}
+
@@ -0,0 +1,265 @@
+/*
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ * KIND, either express or implied.  See the License for the
+ * specific language governing permissions and limitations
+ * under the License.
+ */
+
+#ifndef GUACENC_TERMINAL_H
+#define GUACENC_TERMINAL_H
+
+#include "config.h"
+#include "buffer.h"
+
+#include <stdbool.h>
+
+/**
+ * Flag set within the flags of a terminal cell if its text should be
+ * rendered in bold. This value must match GUAC_TERMINAL_CELL_RECORDING_BOLD.
+ */
+#define GUACENC_TERMINAL_BOLD 1
+
+/**
+ * Flag set within the flags of a terminal cell if its text should be
+ * underlined. This value must match GUAC_TERMINAL_CELL_RECORDING_UNDERSCORE.
+ */
+#define GUACENC_TERMINAL_UNDERSCORE 2
+
+/**
+ * The font family used to render the text of terminal cell recordings.
+ */
+#define GUACENC_TERMINAL_FONT_FAMILY "monospace"
+
+/**
+ * A single character cell of a terminal display.
+ */
+typedef struct guacenc_terminal_cell {
+
+    /**
+     * The Unicode codepoint of the character within this cell.
+     */
+    int codepoint;
+
+    /**
+     * The number of columns occupied by the character within this cell, or
+     * zero if this cell is occupied by the wide character to its left.
+     */
+    int width;
+
+    /**
+     * The color of the character, as a 24-bit RGB value.
+     */
+    int foreground;
+
+    /**
+     * The color behind the character, as a 24-bit RGB value.
+     */
+    int background;
+
+    /**
+     * Any combination of GUACENC_TERMINAL_BOLD and
+     * GUACENC_TERMINAL_UNDERSCORE.
+     */
+    int flags;
+
+    /**
+     * Whether this cell has changed since it was last rendered.
+     */
+    bool dirty;
+
+} guacenc_terminal_cell;
+
+/**
+ * The character cells of a terminal display, as described by the "term-*"
+ * instructions of a terminal cell recording.
+ */
+typedef struct guacenc_terminal {
+
+    /**
+     * The width of the terminal display, in characters.
+     */
+    int columns;
+
+    /**
+     * The height of the terminal display, in characters.
+     */
+    int rows;
+
+    /**
+     * The width of each character cell, in pixels.
+     */
+    int char_width;
+
+    /**
+     * The height of each character cell, in pixels.
+     */
+    int char_height;
+
+    /**
+     * The default background color of the terminal, as a 24-bit RGB value.
+     */
+    int background;
+
+    /**
+     * All character cells of the terminal display, row by row.
+     */
+    guacenc_terminal_cell* cells;
+
+    /**
+     * Whether any cell has changed since the terminal was last rendered.
+     */
+    bool modified;
+
+} guacenc_terminal;
+
+/**
+ * Allocates a new terminal having no rows or columns.
+ *
+ * @return
+ *     A newly-allocated terminal.
+ */
+guacenc_terminal* guacenc_terminal_alloc();
+
+/**
+ * Frees all memory associated with the given terminal. If the terminal
+ * provided is NULL, this function has no effect.
+ *
+ * @param terminal
+ *     The terminal to free, which may be NULL.
+ */
+void guacenc_terminal_free(guacenc_terminal* terminal);
+
+/**
+ * Resizes the given terminal, preserving the contents of any cells within
+ * both the old and new dimensions. Newly-exposed cells are blank.
+ *
+ * @param terminal
+ *     The terminal to resize.
+ *
+ * @param columns
+ *     The new width of the terminal, in characters.
+ *
+ * @param rows
+ *     The new height of the terminal, in characters.
+ *
+ * @param char_width
+ *     The width of each character cell, in pixels.
+ *
+ * @param char_height
+ *     The height of each character cell, in pixels.
+ *
+ * @param background
+ *     The default background color, as a 24-bit RGB value.
+ */
+void guacenc_terminal_resize(guacenc_terminal* terminal, int columns,
+        int rows, int char_width, int char_height, int background);
+
+/**
+ * Sets the given range of columns within a row to copies of the given
+ * character. Any part of the range outside the terminal is ignored.
+ *
+ * @param terminal
+ *     The terminal to modify.
+ *
+ * @param row
+ *     The row to modify.
+ *
+ * @param start_column
+ *     The first column to modify, inclusive.
+ *
+ * @param end_column
+ *     The last column to modify, inclusive.
+ *
+ * @param codepoint
+ *     The Unicode codepoint of the character.
+ *
+ * @param width
+ *     The number of columns occupied by each copy of the character.
+ *
+ * @param foreground
+ *     The color of the character, as a 24-bit RGB value.
+ *
+ * @param background
+ *     The color behind the character, as a 24-bit RGB value.
+ *
+ * @param flags
+ *     Any combination of GUACENC_TERMINAL_BOLD and
+ *     GUACENC_TERMINAL_UNDERSCORE.
+ */
+void guacenc_terminal_set(guacenc_terminal* terminal, int row,
+        int start_column, int end_column, int codepoint, int width,
+        int foreground, int background, int flags);
+
+/**
+ * Copies a range of columns within a row by the given offset. Only the
+ * columns which lie within the terminal both before and after being moved
+ * are copied.
+ *
+ * @param terminal
+ *     The terminal to modify.
+ *
+ * @param row
+ *     The row containing the columns to copy.
+ *
+ * @param start_column
+ *     The first column to copy, inclusive.
+ *
+ * @param end_column
+ *     The last column to copy, inclusive.
+ *
+ * @param offset
+ *     The number of columns to move the copied range by.
+ */
+void guacenc_terminal_copy_columns(guacenc_terminal* terminal, int row,
+        int start_column, int end_column, int offset);
+
+/**
+ * Copies a range of rows by the given offset. Only the rows which lie within
+ * the terminal both before and after being moved are copied.
+ *
+ * @param terminal
+ *     The terminal to modify.
+ *
+ * @param start_row
+ *     The first row to copy, inclusive.
+ *
+ * @param end_row
+ *     The last row to copy, inclusive.
+ *
+ * @param offset
+ *     The number of rows to move the copied range by.
+ */
+void guacenc_terminal_copy_rows(guacenc_terminal* terminal,
+        int start_row, int end_row, int offset);
+
+/**
+ * Draws all cells of the given terminal which have changed since the
+ * terminal was last rendered, resizing the given buffer to fit the terminal
+ * if necessary.
+ *
+ * @param terminal
+ *     The terminal to render.
+ *
+ * @param buffer
+ *     The buffer to draw the terminal within.
+ *
+ * @return
+ *     Zero if rendering succeeded, non-zero otherwise.
+ */
+int guacenc_terminal_render(guacenc_terminal* terminal,
+        guacenc_buffer* buffer);
+
+#endif
+
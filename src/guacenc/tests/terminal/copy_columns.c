@@ -0,0 +1,193 @@
+/*
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ * KIND, either express or implied.  See the License for the
+ * specific language governing permissions and limitations
+ * under the License.
+ */
+
+#include "terminal.h"
+
+#include <CUnit/CUnit.h>
+
+#include <limits.h>
+#include <stdbool.h>
+
+/**
+ * The width of the terminal used within the tests below, in characters.
+ */
+#define TEST_COLUMNS 10
+
+/**
+ * The height of the terminal used within the tests below, in characters.
+ */
+#define TEST_ROWS 3
+
+/**
+ * The row of the terminal containing the columns copied within the tests
+ * below.
+ */
+#define TEST_ROW 1
+
+/**
+ * Allocates a new terminal of TEST_COLUMNS by TEST_ROWS cells in which each
+ * column of TEST_ROW contains a distinct letter, starting with 'a', and none
+ * of the cells are marked as changed.
+ *
+ * @return
+ *     A newly-allocated terminal.
+ */
+static guacenc_terminal* alloc_terminal() {
+
+    guacenc_terminal* terminal = guacenc_terminal_alloc();
+    guacenc_terminal_resize(terminal, TEST_COLUMNS, TEST_ROWS, 8, 16, 0);
+
+    for (int column = 0; column < TEST_COLUMNS; column++)
+        guacenc_terminal_set(terminal, TEST_ROW, column, column, 'a' + column,
+                1, 0xFFFFFF, 0, 0);
+
+    for (int i = 0; i < TEST_COLUMNS * TEST_ROWS; i++)
+        terminal->cells[i].dirty = false;
+
+    terminal->modified = false;
+    return terminal;
+
+}
+
+/**
+ * Verifies that TEST_ROW of the given terminal contains the given letters,
+ * and that only the given range of its columns is marked as changed.
+ *
+ * @param terminal
+ *     The terminal to check.
+ *
+ * @param expected
+ *     The letters expected within each column of TEST_ROW.
+ *
+ * @param first_dirty
+ *     The first column expected to be marked as changed, inclusive.
+ *
+ * @param last_dirty
+ *     The last column expected to be marked as changed, inclusive. If less
+ *     than first_dirty, no column is expected to have changed.
+ */
+static void assert_row(guacenc_terminal* terminal, const char* expected,
+        int first_dirty, int last_dirty) {
+
+    guacenc_terminal_cell* cells = &terminal->cells[TEST_ROW * TEST_COLUMNS];
+
+    for (int column = 0; column < TEST_COLUMNS; column++) {
+        CU_ASSERT_EQUAL(cells[column].codepoint, expected[column]);
+        CU_ASSERT_EQUAL(cells[column].dirty,
+                column >= first_dirty && column <= last_dirty);
+    }
+
+    CU_ASSERT_EQUAL(terminal->modified, last_dirty >= first_dirty);
+
+}
+
+/**
+ * Test which verifies that columns may be copied in either direction within
+ * a row, including overlapping copies, marking only the destination as
+ * changed.
+ */
+void test_terminal__copy_columns() {
+
+    guacenc_terminal* terminal = alloc_terminal();
+    guacenc_terminal_copy_columns(terminal, TEST_ROW, 2, 4, 3);
+    assert_row(terminal, "abcdecdeij", 5, 7);
+    guacenc_terminal_free(terminal);
+
+    terminal = alloc_terminal();
+    guacenc_terminal_copy_columns(terminal, TEST_ROW, 5, 9, -4);
+    assert_row(terminal, "afghijghij", 1, 5);
+    guacenc_terminal_free(terminal);
+
+}
+
+/**
+ * Test which verifies that copies are clipped such that both the copied
+ * range and its destination lie within the terminal.
+ */
+void test_terminal__copy_columns_clip() {
+
+    /* Destination extends beyond the right edge */
+    guacenc_terminal* terminal = alloc_terminal();
+    guacenc_terminal_copy_columns(terminal, TEST_ROW, 0, 9, 2);
+    assert_row(terminal, "ababcdefgh", 2, 9);
+    guacenc_terminal_free(terminal);
+
+    /* Destination extends beyond the left edge */
+    terminal = alloc_terminal();
+    guacenc_terminal_copy_columns(terminal, TEST_ROW, 0, 9, -3);
+    assert_row(terminal, "defghijhij", 0, 6);
+    guacenc_terminal_free(terminal);
+
+    /* Source extends beyond both edges */
+    terminal = alloc_terminal();
+    guacenc_terminal_copy_columns(terminal, TEST_ROW, -5, 100, 1);
+    assert_row(terminal, "aabcdefghi", 1, 9);
+    guacenc_terminal_free(terminal);
+
+    /* Most extreme source range */
+    terminal = alloc_terminal();
+    guacenc_terminal_copy_columns(terminal, TEST_ROW, INT_MIN, INT_MAX, -1);
+    assert_row(terminal, "bcdefghijj", 0, 8);
+    guacenc_terminal_free(terminal);
+
+}
+
+/**
+ * Test which verifies that copies lying outside the terminal, having an
+ * empty range, or moving columns by the full width of the terminal or more,
+ * change nothing.
+ */
+void test_terminal__copy_columns_out_of_range() {
+
+    const int offsets[] = {
+        TEST_COLUMNS, -TEST_COLUMNS, 1000, -1000, INT_MAX, INT_MIN
+    };
+
+    for (int i = 0; i < sizeof(offsets) / sizeof(offsets[0]); i++) {
+        guacenc_terminal* terminal = alloc_terminal();
+        guacenc_terminal_copy_columns(terminal, TEST_ROW, 0, 9, offsets[i]);
+        guacenc_terminal_copy_columns(terminal, TEST_ROW, INT_MIN, INT_MAX,
+                offsets[i]);
+        assert_row(terminal, "abcdefghij", 0, -1);
+        guacenc_terminal_free(terminal);
+    }
+
+    guacenc_terminal* terminal = alloc_terminal();
+
+    /* Rows outside terminal */
+    guacenc_terminal_copy_columns(terminal, -1, 0, 9, 1);
+    guacenc_terminal_copy_columns(terminal, TEST_ROWS, 0, 9, 1);
+    guacenc_terminal_copy_columns(terminal, INT_MIN, 0, 9, 1);
+
+    /* Columns outside terminal */
+    guacenc_terminal_copy_columns(terminal, TEST_ROW, -10, -1, 1);
+    guacenc_terminal_copy_columns(terminal, TEST_ROW, TEST_COLUMNS, 20, -1);
+    guacenc_terminal_copy_columns(terminal, TEST_ROW, INT_MIN, -1, 5);
+    guacenc_terminal_copy_columns(terminal, TEST_ROW, TEST_COLUMNS, INT_MAX,
+            -5);
+
+    /* Empty range, and ranges emptied by clipping */
+    guacenc_terminal_copy_columns(terminal, TEST_ROW, 5, 4, 1);
+    guacenc_terminal_copy_columns(terminal, TEST_ROW, 0, 1, -2);
+    guacenc_terminal_copy_columns(terminal, TEST_ROW, 8, 9, 2);
+
+    assert_row(terminal, "abcdefghij", 0, -1);
+    guacenc_terminal_free(terminal);
+
+}
@@ -0,0 +1,178 @@
+/*
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ * KIND, either express or implied.  See the License for the
+ * specific language governing permissions and limitations
+ * under the License.
+ */
+
+#include "terminal.h"
+
+#include <CUnit/CUnit.h>
+
+#include <limits.h>
+#include <stdbool.h>
+
+/**
+ * The width of the terminal used within the tests below, in characters.
+ */
+#define TEST_COLUMNS 3
+
+/**
+ * The height of the terminal used within the tests below, in characters.
+ */
+#define TEST_ROWS 6
+
+/**
+ * Allocates a new terminal of TEST_COLUMNS by TEST_ROWS cells in which each
+ * row is filled with a distinct letter, starting with 'a', and none of the
+ * cells are marked as changed.
+ *
+ * @return
+ *     A newly-allocated terminal.
+ */
+static guacenc_terminal* alloc_terminal() {
+
+    guacenc_terminal* terminal = guacenc_terminal_alloc();
+    guacenc_terminal_resize(terminal, TEST_COLUMNS, TEST_ROWS, 8, 16, 0);
+
+    for (int row = 0; row < TEST_ROWS; row++)
+        guacenc_terminal_set(terminal, row, 0, TEST_COLUMNS - 1, 'a' + row,
+                1, 0xFFFFFF, 0, 0);
+
+    for (int i = 0; i < TEST_COLUMNS * TEST_ROWS; i++)
+        terminal->cells[i].dirty = false;
+
+    terminal->modified = false;
+    return terminal;
+
+}
+
+/**
+ * Verifies that each row of the given terminal is filled with the given
+ * letters, and that only the cells of the given range of rows are marked as
+ * changed.
+ *
+ * @param terminal
+ *     The terminal to check.
+ *
+ * @param expected
+ *     The letter expected to fill each row.
+ *
+ * @param first_dirty
+ *     The first row expected to be marked as changed, inclusive.
+ *
+ * @param last_dirty
+ *     The last row expected to be marked as changed, inclusive. If less than
+ *     first_dirty, no row is expected to have changed.
+ */
+static void assert_rows(guacenc_terminal* terminal, const char* expected,
+        int first_dirty, int last_dirty) {
+
+    for (int row = 0; row < TEST_ROWS; row++) {
+
+        guacenc_terminal_cell* cells = &terminal->cells[row * TEST_COLUMNS];
+        bool dirty = row >= first_dirty && row <= last_dirty;
+
+        for (int column = 0; column < TEST_COLUMNS; column++) {
+            CU_ASSERT_EQUAL(cells[column].codepoint, expected[row]);
+            CU_ASSERT_EQUAL(cells[column].dirty, dirty);
+        }
+
+    }
+
+    CU_ASSERT_EQUAL(terminal->modified, last_dirty >= first_dirty);
+
+}
+
+/**
+ * Test which verifies that rows may be copied in either direction, including
+ * overlapping copies, marking only the destination rows as changed.
+ */
+void test_terminal__copy_rows() {
+
+    guacenc_terminal* terminal = alloc_terminal();
+    guacenc_terminal_copy_rows(terminal, 1, 3, 1);
+    assert_rows(terminal, "abbcdf", 2, 4);
+    guacenc_terminal_free(terminal);
+
+    terminal = alloc_terminal();
+    guacenc_terminal_copy_rows(terminal, 2, 5, -2);
+    assert_rows(terminal, "cdefef", 0, 3);
+    guacenc_terminal_free(terminal);
+
+}
+
+/**
+ * Test which verifies that copies are clipped such that both the copied
+ * rows and their destination lie within the terminal, as when scrolling.
+ */
+void test_terminal__copy_rows_clip() {
+
+    /* Scrolling down moves rows beyond the bottom */
+    guacenc_terminal* terminal = alloc_terminal();
+    guacenc_terminal_copy_rows(terminal, 0, 5, 2);
+    assert_rows(terminal, "ababcd", 2, 5);
+    guacenc_terminal_free(terminal);
+
+    /* Scrolling up moves rows beyond the top */
+    terminal = alloc_terminal();
+    guacenc_terminal_copy_rows(terminal, 0, 5, -1);
+    assert_rows(terminal, "bcdeff", 0, 4);
+    guacenc_terminal_free(terminal);
+
+    /* Most extreme source range */
+    terminal = alloc_terminal();
+    guacenc_terminal_copy_rows(terminal, INT_MIN, INT_MAX, 3);
+    assert_rows(terminal, "abcabc", 3, 5);
+    guacenc_terminal_free(terminal);
+
+}
+
+/**
+ * Test which verifies that copies lying outside the terminal, having an
+ * empty range, or moving rows by the full height of the terminal or more,
+ * change nothing.
+ */
+void test_terminal__copy_rows_out_of_range() {
+
+    const int offsets[] = {
+        TEST_ROWS, -TEST_ROWS, 1000, -1000, INT_MAX, INT_MIN
+    };
+
+    for (int i = 0; i < sizeof(offsets) / sizeof(offsets[0]); i++) {
+        guacenc_terminal* terminal = alloc_terminal();
+        guacenc_terminal_copy_rows(terminal, 0, 5, offsets[i]);
+        guacenc_terminal_copy_rows(terminal, INT_MIN, INT_MAX, offsets[i]);
+        assert_rows(terminal, "abcdef", 0, -1);
+        guacenc_terminal_free(terminal);
+    }
+
+    guacenc_terminal* terminal = alloc_terminal();
+
+    /* Rows outside terminal */
+    guacenc_terminal_copy_rows(terminal, -10, -1, 1);
+    guacenc_terminal_copy_rows(terminal, TEST_ROWS, 20, -1);
+    guacenc_terminal_copy_rows(terminal, INT_MIN, -1, 2);
+    guacenc_terminal_copy_rows(terminal, TEST_ROWS, INT_MAX, -2);
+
+    /* Empty range, and ranges emptied by clipping */
+    guacenc_terminal_copy_rows(terminal, 3, 2, 1);
+    guacenc_terminal_copy_rows(terminal, 0, 1, -2);
+    guacenc_terminal_copy_rows(terminal, 4, 5, 2);
+
+    assert_rows(terminal, "abcdef", 0, -1);
+    guacenc_terminal_free(terminal);
+
+}
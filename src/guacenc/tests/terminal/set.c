@@ -0,0 +1,205 @@
+/*
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ * KIND, either express or implied.  See the License for the
+ * specific language governing permissions and limitations
+ * under the License.
+ */
+
+#include "terminal.h"
+
+#include <CUnit/CUnit.h>
+
+#include <limits.h>
+#include <stdbool.h>
+
+/**
+ * The width of the terminal used within the tests below, in characters.
+ */
+#define TEST_COLUMNS 10
+
+/**
+ * The height of the terminal used within the tests below, in characters.
+ */
+#define TEST_ROWS 4
+
+/**
+ * The default background color of the terminal used within the tests below.
+ */
+#define TEST_BACKGROUND 0x000000
+
+/**
+ * The foreground color of characters set within the tests below.
+ */
+#define TEST_FOREGROUND 0xFFFFFF
+
+/**
+ * Allocates a new blank terminal of TEST_COLUMNS by TEST_ROWS cells, none of
+ * which are marked as changed.
+ *
+ * @return
+ *     A newly-allocated terminal.
+ */
+static guacenc_terminal* alloc_terminal() {
+
+    guacenc_terminal* terminal = guacenc_terminal_alloc();
+    guacenc_terminal_resize(terminal, TEST_COLUMNS, TEST_ROWS, 8, 16,
+            TEST_BACKGROUND);
+
+    for (int i = 0; i < TEST_COLUMNS * TEST_ROWS; i++)
+        terminal->cells[i].dirty = false;
+
+    terminal->modified = false;
+    return terminal;
+
+}
+
+/**
+ * Returns whether any cell of the given terminal has changed since it was
+ * allocated with alloc_terminal().
+ *
+ * @param terminal
+ *     The terminal to check.
+ *
+ * @return
+ *     true if any cell has changed, false otherwise.
+ */
+static bool any_changed(guacenc_terminal* terminal) {
+
+    for (int i = 0; i < TEST_COLUMNS * TEST_ROWS; i++) {
+        guacenc_terminal_cell* cell = &terminal->cells[i];
+        if (cell->dirty || cell->codepoint != ' ' || cell->width != 1
+                || cell->foreground != TEST_BACKGROUND)
+            return true;
+    }
+
+    return terminal->modified;
+
+}
+
+/**
+ * Test which verifies that setting a range of columns lying entirely within
+ * the terminal sets each character and marks only those cells as changed.
+ */
+void test_terminal__set() {
+
+    guacenc_terminal* terminal = alloc_terminal();
+
+    guacenc_terminal_set(terminal, 1, 2, 4, 'x', 1, TEST_FOREGROUND,
+            TEST_BACKGROUND, GUACENC_TERMINAL_BOLD);
+
+    CU_ASSERT_TRUE(terminal->modified);
+
+    for (int column = 0; column < TEST_COLUMNS; column++) {
+
+        guacenc_terminal_cell* cell = &terminal->cells[TEST_COLUMNS + column];
+        bool set = column >= 2 && column <= 4;
+
+        CU_ASSERT_EQUAL(cell->dirty, set);
+        CU_ASSERT_EQUAL(cell->codepoint, set ? 'x' : ' ');
+        CU_ASSERT_EQUAL(cell->flags, set ? GUACENC_TERMINAL_BOLD : 0);
+        CU_ASSERT_EQUAL(cell->width, 1);
+
+    }
+
+    guacenc_terminal_free(terminal);
+
+}
+
+/**
+ * Test which verifies that ranges extending beyond either side of the
+ * terminal are clipped, with wide characters remaining aligned relative to
+ * the original start of the range.
+ */
+void test_terminal__set_clip() {
+
+    guacenc_terminal* terminal = alloc_terminal();
+
+    /* Columns -3 through 2 hold three wide characters starting at -3, -1
+     * and 1, such that column 0 is the second half of a character */
+    guacenc_terminal_set(terminal, 0, -3, 2, 'w', 2, TEST_FOREGROUND,
+            TEST_BACKGROUND, 0);
+
+    guacenc_terminal_cell* cells = terminal->cells;
+    CU_ASSERT_EQUAL(cells[0].width, 0);
+    CU_ASSERT_EQUAL(cells[1].codepoint, 'w');
+    CU_ASSERT_EQUAL(cells[1].width, 2);
+    CU_ASSERT_EQUAL(cells[2].width, 0);
+    CU_ASSERT_TRUE(cells[2].dirty);
+    CU_ASSERT_FALSE(cells[3].dirty);
+
+    /* Columns beyond the right edge are ignored */
+    guacenc_terminal_set(terminal, 0, 8, 20, 'y', 1, TEST_FOREGROUND,
+            TEST_BACKGROUND, 0);
+
+    CU_ASSERT_EQUAL(cells[7].codepoint, ' ');
+    CU_ASSERT_EQUAL(cells[8].codepoint, 'y');
+    CU_ASSERT_EQUAL(cells[9].codepoint, 'y');
+
+    /* The most extreme range covers every column, and the alignment of its
+     * characters must be calculated without overflow */
+    guacenc_terminal_set(terminal, 3, INT_MIN, INT_MAX, 'z', 3,
+            TEST_FOREGROUND, TEST_BACKGROUND, 0);
+
+    cells = &terminal->cells[3 * TEST_COLUMNS];
+    for (int column = 0; column < TEST_COLUMNS; column++) {
+        bool first = ((long long) column - INT_MIN) % 3 == 0;
+        CU_ASSERT_TRUE(cells[column].dirty);
+        CU_ASSERT_EQUAL(cells[column].width, first ? 3 : 0);
+        CU_ASSERT_EQUAL(cells[column].codepoint, first ? 'z' : ' ');
+    }
+
+    guacenc_terminal_free(terminal);
+
+}
+
+/**
+ * Test which verifies that operations lying entirely outside the terminal,
+ * or having an empty range or invalid width, change nothing.
+ */
+void test_terminal__set_out_of_range() {
+
+    guacenc_terminal* terminal = alloc_terminal();
+
+    /* Rows outside terminal */
+    guacenc_terminal_set(terminal, -1, 0, 9, 'x', 1, TEST_FOREGROUND,
+            TEST_BACKGROUND, 0);
+    guacenc_terminal_set(terminal, TEST_ROWS, 0, 9, 'x', 1, TEST_FOREGROUND,
+            TEST_BACKGROUND, 0);
+    guacenc_terminal_set(terminal, INT_MIN, 0, 9, 'x', 1, TEST_FOREGROUND,
+            TEST_BACKGROUND, 0);
+    guacenc_terminal_set(terminal, INT_MAX, 0, 9, 'x', 1, TEST_FOREGROUND,
+            TEST_BACKGROUND, 0);
+
+    /* Columns outside terminal */
+    guacenc_terminal_set(terminal, 0, -5, -1, 'x', 1, TEST_FOREGROUND,
+            TEST_BACKGROUND, 0);
+    guacenc_terminal_set(terminal, 0, TEST_COLUMNS, INT_MAX, 'x', 1,
+            TEST_FOREGROUND, TEST_BACKGROUND, 0);
+
+    /* Empty range */
+    guacenc_terminal_set(terminal, 0, 5, 4, 'x', 1, TEST_FOREGROUND,
+            TEST_BACKGROUND, 0);
+
+    /* Invalid widths */
+    guacenc_terminal_set(terminal, 0, 0, 9, 'x', 0, TEST_FOREGROUND,
+            TEST_BACKGROUND, 0);
+    guacenc_terminal_set(terminal, 0, 0, 9, 'x', -1, TEST_FOREGROUND,
+            TEST_BACKGROUND, 0);
+
+    CU_ASSERT_FALSE(any_changed(terminal));
+
+    guacenc_terminal_free(terminal);
+
+}
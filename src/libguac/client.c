@@ -24,11 +24,13 @@
 #include "encode-webp.h"
 #include "guacamole/mem.h"
 #include "guacamole/client.h"
+#include "guacamole/congestion.h"
 #include "guacamole/error.h"
 #include "guacamole/layer.h"
 #include "guacamole/plugin.h"
 #include "guacamole/pool.h"
 #include "guacamole/protocol.h"
+#include "guacamole/rate-limit.h"
 #include "guacamole/rwlock.h"
 #include "guacamole/socket.h"
 #include "guacamole/stream.h"
@@ -371,6 +373,11 @@ void guac_client_free(guac_client* client) {
     guac_rwlock_destroy(&(client->__users_lock));
     guac_rwlock_destroy(&(client->__pending_users_lock));
 
+    /* Release the connection-wide rate limit, which may still be
+     * referenced by sockets of users that have not yet been freed */
+    if (client->rate_limit != NULL)
+        guac_rate_limit_free(client->rate_limit);
+
     guac_mem_free(client->connection_id);
     guac_mem_free(client);
 }
@@ -550,6 +557,12 @@ int guac_client_add_user(guac_client* client, guac_user* user, int argc, char**
 
     if (retval == 0) {
 
+        /* Apply any limit on the rate of the connection as a whole. This must
+         * happen before the user is added to the pending users, after which
+         * other threads may write to the user's socket. */
+        if (client->rate_limit != NULL)
+            guac_socket_add_rate_limit(user->socket, client->rate_limit);
+
         /*
          * Add the user to the list of pending users, to have their connection
          * state synchronized asynchronously.
@@ -701,16 +714,53 @@ int guac_client_end_frame(guac_client* client) {
     return guac_client_end_multiple_frames(client, 0);
 }
 
+/**
+ * Callback for guac_client_foreach_user() which records that the frame ending
+ * with the most recently sent "sync" instruction has been sent to the given
+ * user, such that its acknowledgement can later be matched against the
+ * number of bytes sent.
+ *
+ * @param user
+ *     The user that was sent the frame.
+ *
+ * @param data
+ *     A pointer to the guac_timestamp of the "sync" instruction which ended
+ *     the frame.
+ *
+ * @return
+ *     Always NULL.
+ */
+static void* __record_frame_sent(guac_user* user, void* data) {
+
+    guac_timestamp* timestamp = (guac_timestamp*) data;
+
+    guac_congestion_frame_sent(user->congestion, *timestamp,
+            user->socket->bytes_written);
+
+    return NULL;
+
+}
+
 int guac_client_end_multiple_frames(guac_client* client, int frames) {
 
+    /* Temporary buffers used while producing the frame are no longer needed */
+    guac_mem_arena_reset();
+
     /* Update and send timestamp */
-    client->last_sent_timestamp = guac_timestamp_current();
+    guac_timestamp timestamp = guac_timestamp_current();
+    client->last_sent_timestamp = timestamp;
 
     /* Log received timestamp and calculated lag (at TRACE level only) */
     guac_client_log(client, GUAC_LOG_TRACE, "Server completed "
-            "frame %" PRIu64 "ms (%i logical frames)", client->last_sent_timestamp, frames);
+            "frame %" PRIu64 "ms (%i logical frames)", timestamp, frames);
+
+    if (guac_protocol_send_sync(client->socket, timestamp, frames))
+        return 1;
 
-    return guac_protocol_send_sync(client->socket, client->last_sent_timestamp, frames);
+    /* Track the size of each frame for the sake of estimating the delivery
+     * rate of each user's connection */
+    guac_client_foreach_user(client, __record_frame_sent, &timestamp);
+    return 0;
 
 }
 
@@ -824,6 +874,11 @@ static void* __calculate_lag(guac_user* user, void* data) {
 
     int* processing_lag = (int*) data;
 
+    /* Users which are lagging are paced separately and must not slow
+     * updates for all other users */
+    if (user->lagging)
+        return NULL;
+
     /* Simply find maximum */
     if (user->processing_lag > *processing_lag)
         *processing_lag = user->processing_lag;
@@ -843,6 +898,177 @@ int guac_client_get_processing_lag(guac_client* client) {
 
 }
 
+/**
+ * Callback for guac_client_foreach_user() which lowers the given quality to
+ * the quality suggested for the given user, if lower. Lagging users are
+ * ignored.
+ *
+ * @param user
+ *     The user whose suggested quality should be considered.
+ *
+ * @param data
+ *     Pointer to an int containing the lowest quality suggested thus far.
+ *
+ * @return
+ *     Always NULL.
+ */
+static void* __suggest_quality(guac_user* user, void* data) {
+
+    int* quality = (int*) data;
+
+    /* Lagging users are paced separately */
+    if (user->lagging)
+        return NULL;
+
+    int user_quality = guac_congestion_suggest_quality(user->congestion);
+
+    /* Lower quality further as the user's rate limit is approached, such
+     * that updates shrink rather than being paused */
+    int fill = guac_socket_get_rate_fill(user->socket);
+    int limited_quality = GUAC_CONGESTION_MIN_QUALITY
+        + (GUAC_CONGESTION_MAX_QUALITY - GUAC_CONGESTION_MIN_QUALITY)
+        * fill / 100;
+
+    if (limited_quality < user_quality)
+        user_quality = limited_quality;
+
+    if (user_quality < *quality)
+        *quality = user_quality;
+
+    return NULL;
+
+}
+
+int guac_client_suggest_quality(guac_client* client) {
+
+    int quality = GUAC_CONGESTION_MAX_QUALITY;
+
+    /* Use the lowest quality that any user's connection can sustain */
+    guac_client_foreach_user(client, __suggest_quality, &quality);
+
+    return quality;
+
+}
+
+/**
+ * Callback for guac_client_foreach_user() which raises the given frame
+ * duration to the frame duration suggested for the given user, if higher.
+ * Lagging users are ignored.
+ *
+ * @param user
+ *     The user whose suggested frame duration should be considered.
+ *
+ * @param data
+ *     Pointer to an int containing the longest frame duration suggested thus
+ *     far, in milliseconds.
+ *
+ * @return
+ *     Always NULL.
+ */
+static void* __suggest_frame_duration(guac_user* user, void* data) {
+
+    int* duration = (int*) data;
+
+    /* Lagging users are paced separately */
+    if (user->lagging)
+        return NULL;
+
+    int user_duration = guac_congestion_suggest_frame_duration(
+            user->congestion, *duration);
+    if (user_duration > *duration)
+        *duration = user_duration;
+
+    return NULL;
+
+}
+
+int guac_client_suggest_frame_duration(guac_client* client,
+        int min_duration) {
+
+    int duration = min_duration;
+
+    /* Use the longest frame duration needed by any user's connection */
+    guac_client_foreach_user(client, __suggest_frame_duration, &duration);
+
+    return duration;
+
+}
+
+/**
+ * The state of a call to guac_client_get_frame_budget(), shared with
+ * __get_frame_budget() for each user.
+ */
+typedef struct guac_client_frame_budget {
+
+    /**
+     * The duration of the frame, in milliseconds.
+     */
+    int frame_duration;
+
+    /**
+     * The smallest frame budget found thus far, in bytes, or zero if no
+     * budget is yet known.
+     */
+    int budget;
+
+} guac_client_frame_budget;
+
+/**
+ * Callback for guac_client_foreach_user() which lowers the given frame
+ * budget to the frame budget of the given user, if lower. Lagging users and
+ * users whose delivery rate is not yet known are ignored.
+ *
+ * @param user
+ *     The user whose frame budget should be considered.
+ *
+ * @param data
+ *     Pointer to the guac_client_frame_budget of the current call to
+ *     guac_client_get_frame_budget().
+ *
+ * @return
+ *     Always NULL.
+ */
+static void* __get_frame_budget(guac_user* user, void* data) {
+
+    guac_client_frame_budget* frame = (guac_client_frame_budget*) data;
+
+    /* Lagging users are paced separately */
+    if (user->lagging)
+        return NULL;
+
+    int user_budget = guac_congestion_get_frame_budget(user->congestion,
+            frame->frame_duration);
+    if (user_budget > 0 && (frame->budget == 0 || user_budget < frame->budget))
+        frame->budget = user_budget;
+
+    return NULL;
+
+}
+
+int guac_client_get_frame_budget(guac_client* client, int frame_duration) {
+
+    guac_client_frame_budget frame = {
+        .frame_duration = frame_duration,
+        .budget = 0
+    };
+
+    /* Use the smallest budget of any user's connection */
+    guac_client_foreach_user(client, __get_frame_budget, &frame);
+
+    return frame.budget;
+
+}
+
+void guac_client_set_rate_limit(guac_client* client, int rate) {
+
+    /* Users added from this point forward will share the new limit */
+    if (client->rate_limit == NULL)
+        client->rate_limit = guac_rate_limit_alloc(rate);
+    else
+        guac_rate_limit_set_rate(client->rate_limit, rate);
+
+}
+
 void guac_client_stream_argv(guac_client* client, guac_socket* socket,
         const char* mimetype, const char* name, const char* value) {
 
@@ -894,8 +1120,12 @@ void guac_client_stream_jpeg(guac_client* client, guac_socket* socket,
     /* Declare stream as containing image data */
     guac_protocol_send_img(socket, stream, mode, layer, "image/jpeg", x, y);
 
-    /* Write JPEG data */
-    guac_jpeg_write(socket, stream, surface, quality);
+    /* Write JPEG data, trading color detail and DCT accuracy for size and
+     * speed as lag increases */
+    int lag = guac_client_get_processing_lag(client);
+    guac_jpeg_write(socket, stream, surface, quality,
+            guac_jpeg_suggest_subsampling(lag),
+            guac_jpeg_suggest_dct_method(lag));
 
     /* Terminate stream */
     guac_protocol_send_end(socket, stream);
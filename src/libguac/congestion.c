@@ -0,0 +1,311 @@
+/*
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ * KIND, either express or implied.  See the License for the
+ * specific language governing permissions and limitations
+ * under the License.
+ */
+
+#include "config.h"
+
+#include "guacamole/congestion.h"
+#include "guacamole/mem.h"
+#include "guacamole/timestamp.h"
+
+#include <limits.h>
+#include <pthread.h>
+#include <stdint.h>
+#include <stdlib.h>
+
+guac_congestion* guac_congestion_alloc() {
+
+    guac_congestion* congestion = guac_mem_zalloc(sizeof(guac_congestion));
+
+    /* Assume the best until measured otherwise */
+    congestion->quality = GUAC_CONGESTION_MAX_QUALITY;
+
+    pthread_mutex_init(&(congestion->__lock), NULL);
+    return congestion;
+
+}
+
+void guac_congestion_free(guac_congestion* congestion) {
+    pthread_mutex_destroy(&(congestion->__lock));
+    guac_mem_free(congestion);
+}
+
+void guac_congestion_frame_sent(guac_congestion* congestion,
+        guac_timestamp timestamp, uint64_t bytes) {
+
+    pthread_mutex_lock(&(congestion->__lock));
+
+    guac_congestion_frame* frame = &(congestion->__frames[
+            congestion->__frames_sent % GUAC_CONGESTION_HISTORY_SIZE]);
+
+    frame->timestamp = timestamp;
+    frame->bytes = bytes;
+    congestion->__frames_sent++;
+
+    pthread_mutex_unlock(&(congestion->__lock));
+
+}
+
+/**
+ * Updates the round-trip time and queueing delay of the given congestion
+ * estimate using the given round-trip time measurement. Smoothing follows
+ * the retransmission timer calculation of RFC 6298. The congestion estimate
+ * must be locked.
+ *
+ * @param congestion
+ *     The congestion estimate to update.
+ *
+ * @param rtt
+ *     The measured round-trip time, in milliseconds.
+ *
+ * @param received
+ *     The local time at which the measurement was taken.
+ */
+static void guac_congestion_update_rtt(guac_congestion* congestion, int rtt,
+        guac_timestamp received) {
+
+    /* First measurement */
+    if (congestion->smoothed_rtt == 0) {
+        congestion->smoothed_rtt = rtt;
+        congestion->rtt_variance = rtt / 2;
+    }
+
+    else {
+        congestion->rtt_variance = (3 * congestion->rtt_variance
+                + abs(congestion->smoothed_rtt - rtt)) / 4;
+        congestion->smoothed_rtt = (7 * congestion->smoothed_rtt + rtt) / 8;
+    }
+
+    /* Track minimum over a sliding window, remeasuring once expired */
+    if (congestion->__min_rtt_measured == 0 || rtt <= congestion->min_rtt
+            || received - congestion->__min_rtt_measured
+                > GUAC_CONGESTION_MIN_RTT_WINDOW) {
+        congestion->min_rtt = rtt;
+        congestion->__min_rtt_measured = received;
+    }
+
+    /* Anything beyond the minimum is time spent waiting in queues */
+    congestion->queue_delay = congestion->smoothed_rtt - congestion->min_rtt;
+    if (congestion->queue_delay < 0)
+        congestion->queue_delay = 0;
+
+}
+
+/**
+ * Updates the delivery rate of the given congestion estimate using the given
+ * delivery rate measurement. The estimate is the highest rate measured within
+ * the current and previous windows of GUAC_CONGESTION_RATE_WINDOW
+ * milliseconds, such that it falls only as higher measurements age out,
+ * regardless of how many frames have since been acknowledged. The congestion
+ * estimate must be locked.
+ *
+ * @param congestion
+ *     The congestion estimate to update.
+ *
+ * @param rate
+ *     The measured delivery rate, in bytes per second.
+ *
+ * @param received
+ *     The local time at which the measurement was taken.
+ */
+static void guac_congestion_update_rate(guac_congestion* congestion, int rate,
+        guac_timestamp received) {
+
+    guac_timestamp elapsed = received - congestion->__rate_window_start;
+
+    /* Begin a new window once the current window has ended, forgetting the
+     * current window too if no rate was measured for an entire window */
+    if (congestion->__rate_window_start == 0
+            || elapsed >= GUAC_CONGESTION_RATE_WINDOW) {
+
+        if (congestion->__rate_window_start != 0
+                && elapsed < GUAC_CONGESTION_RATE_WINDOW * 2)
+            congestion->__rate_previous_max = congestion->__rate_window_max;
+        else
+            congestion->__rate_previous_max = 0;
+
+        congestion->__rate_window_start = received;
+        congestion->__rate_window_max = 0;
+
+    }
+
+    if (rate > congestion->__rate_window_max)
+        congestion->__rate_window_max = rate;
+
+    congestion->delivery_rate = congestion->__rate_window_max;
+    if (congestion->__rate_previous_max > congestion->delivery_rate)
+        congestion->delivery_rate = congestion->__rate_previous_max;
+
+}
+
+/**
+ * Locates the frame having the given timestamp among the recently sent
+ * frames of the given congestion estimate. The congestion estimate must be
+ * locked.
+ *
+ * @param congestion
+ *     The congestion estimate to search.
+ *
+ * @param timestamp
+ *     The timestamp of the frame to locate.
+ *
+ * @return
+ *     The number of frames sent as of the located frame, as counted by
+ *     __frames_sent, or zero if no such frame is remembered.
+ */
+static uint64_t guac_congestion_find_frame(guac_congestion* congestion,
+        guac_timestamp timestamp) {
+
+    uint64_t sent = congestion->__frames_sent;
+    uint64_t oldest = 0;
+    if (sent > GUAC_CONGESTION_HISTORY_SIZE)
+        oldest = sent - GUAC_CONGESTION_HISTORY_SIZE;
+
+    /* Frames are acknowledged in order, so search from the newest */
+    for (; sent > oldest; sent--) {
+        guac_congestion_frame* frame = &(congestion->__frames[
+                (sent - 1) % GUAC_CONGESTION_HISTORY_SIZE]);
+        if (frame->timestamp == timestamp)
+            return sent;
+    }
+
+    return 0;
+
+}
+
+void guac_congestion_frame_acknowledged(guac_congestion* congestion,
+        guac_timestamp timestamp, guac_timestamp received) {
+
+    pthread_mutex_lock(&(congestion->__lock));
+
+    int rtt = received - timestamp;
+    if (rtt < 0)
+        rtt = 0;
+
+    guac_congestion_update_rtt(congestion, rtt, received);
+
+    /* Measure delivery rate from the bytes acknowledged since the previous
+     * acknowledgement, if this frame was sent to this user */
+    uint64_t frames = guac_congestion_find_frame(congestion, timestamp);
+    if (frames > congestion->__frames_acknowledged) {
+
+        uint64_t bytes = congestion->__frames[
+            (frames - 1) % GUAC_CONGESTION_HISTORY_SIZE].bytes;
+
+        if (congestion->__frames_acknowledged != 0
+                && bytes > congestion->__bytes_acknowledged) {
+
+            uint64_t delivered = bytes - congestion->__bytes_acknowledged;
+            int interval = received - congestion->__last_acknowledged;
+            if (interval < 1)
+                interval = 1;
+
+            uint64_t frame_size = delivered
+                / (frames - congestion->__frames_acknowledged);
+            if (frame_size > INT_MAX)
+                frame_size = INT_MAX;
+
+            congestion->frame_size = frame_size;
+
+            int64_t rate = (int64_t) delivered * 1000 / interval;
+            if (rate > INT_MAX)
+                rate = INT_MAX;
+
+            guac_congestion_update_rate(congestion, rate, received);
+
+        }
+
+        congestion->__frames_acknowledged = frames;
+        congestion->__bytes_acknowledged = bytes;
+        congestion->__last_acknowledged = received;
+
+    }
+
+    /* Back off multiplicatively, at most once per round trip, while data is
+     * queueing, and otherwise recover gradually */
+    if (congestion->queue_delay > GUAC_CONGESTION_MAX_QUEUE_DELAY) {
+        if (received - congestion->__last_reduction
+                >= congestion->smoothed_rtt) {
+            congestion->quality = congestion->quality * 3 / 4;
+            if (congestion->quality < GUAC_CONGESTION_MIN_QUALITY)
+                congestion->quality = GUAC_CONGESTION_MIN_QUALITY;
+            congestion->__last_reduction = received;
+        }
+    }
+
+    else if (congestion->queue_delay < GUAC_CONGESTION_MAX_QUEUE_DELAY / 2
+            && congestion->quality < GUAC_CONGESTION_MAX_QUALITY)
+        congestion->quality++;
+
+    pthread_mutex_unlock(&(congestion->__lock));
+
+}
+
+int guac_congestion_suggest_quality(guac_congestion* congestion) {
+
+    pthread_mutex_lock(&(congestion->__lock));
+    int quality = congestion->quality;
+    pthread_mutex_unlock(&(congestion->__lock));
+
+    return quality;
+
+}
+
+int guac_congestion_get_frame_budget(guac_congestion* congestion,
+        int frame_duration) {
+
+    pthread_mutex_lock(&(congestion->__lock));
+    int64_t budget = (int64_t) congestion->delivery_rate
+        * GUAC_CONGESTION_RATE_PROBE_GAIN / 100 * frame_duration / 1000;
+    pthread_mutex_unlock(&(congestion->__lock));
+
+    if (budget > INT_MAX)
+        budget = INT_MAX;
+
+    return budget;
+
+}
+
+int guac_congestion_suggest_frame_duration(guac_congestion* congestion,
+        int min_duration) {
+
+    pthread_mutex_lock(&(congestion->__lock));
+
+    int duration = 0;
+
+    /* Allow each frame to be delivered before the next is sent */
+    if (congestion->delivery_rate > 0)
+        duration = (int64_t) congestion->frame_size * 1000
+            / congestion->delivery_rate;
+
+    /* Allow any excess queued data to drain */
+    if (congestion->queue_delay > GUAC_CONGESTION_MAX_QUEUE_DELAY)
+        duration += congestion->queue_delay - GUAC_CONGESTION_MAX_QUEUE_DELAY;
+
+    pthread_mutex_unlock(&(congestion->__lock));
+
+    if (duration > GUAC_CONGESTION_MAX_FRAME_DURATION)
+        duration = GUAC_CONGESTION_MAX_FRAME_DURATION;
+
+    if (duration < min_duration)
+        duration = min_duration;
+
+    return duration;
+
+}
+
@@ -30,6 +30,7 @@
 #include <jpeglib.h>
 
 #include <inttypes.h>
+#include <pthread.h>
 #include <stdint.h>
 #include <stdlib.h>
 #include <string.h>
@@ -64,6 +65,42 @@ typedef struct guac_jpeg_destination_mgr {
 
 } guac_jpeg_destination_mgr;
 
+/**
+ * A libjpeg compressor which is allocated once per thread and reused for
+ * every JPEG encoded by that thread, avoiding the cost of creating and
+ * configuring a new compressor for each image.
+ */
+typedef struct guac_jpeg_compressor {
+
+    /**
+     * The libjpeg compression structure. This structure is created once and
+     * returned to its idle state after each image is compressed.
+     */
+    struct jpeg_compress_struct cinfo;
+
+    /**
+     * The libjpeg error manager associated with cinfo.
+     */
+    struct jpeg_error_mgr jerr;
+
+    /**
+     * The quality for which the quantization tables of cinfo were most
+     * recently configured, or -1 if they have not yet been configured.
+     */
+    int quality;
+
+} guac_jpeg_compressor;
+
+/**
+ * Key under which the guac_jpeg_compressor of the current thread is stored.
+ */
+static pthread_key_t guac_jpeg_compressor_key;
+
+/**
+ * Guards the one-time creation of guac_jpeg_compressor_key.
+ */
+static pthread_once_t guac_jpeg_compressor_key_init = PTHREAD_ONCE_INIT;
+
 /**
  * Initializes the destination structure of the given compression structure.
  *
@@ -165,8 +202,101 @@ static void jpeg_guac_dest(j_compress_ptr cinfo, guac_socket* socket,
 
 }
 
+/**
+ * Frees the given guac_jpeg_compressor, including its underlying libjpeg
+ * compressor. This function is invoked automatically when the thread that
+ * owns the compressor exits.
+ *
+ * @param data
+ *     The guac_jpeg_compressor to free.
+ */
+static void guac_jpeg_compressor_free(void* data) {
+
+    guac_jpeg_compressor* compressor = (guac_jpeg_compressor*) data;
+
+    jpeg_destroy_compress(&compressor->cinfo);
+    guac_mem_free(compressor);
+
+}
+
+/**
+ * Creates the key under which each thread's guac_jpeg_compressor is stored,
+ * freeing that compressor automatically when its thread exits.
+ */
+static void guac_jpeg_compressor_alloc_key() {
+    pthread_key_create(&guac_jpeg_compressor_key, guac_jpeg_compressor_free);
+}
+
+/**
+ * Returns the guac_jpeg_compressor of the current thread, creating and
+ * configuring a new compressor if this thread has not yet encoded any JPEG
+ * images.
+ *
+ * @return
+ *     The guac_jpeg_compressor of the current thread.
+ */
+static guac_jpeg_compressor* guac_jpeg_get_compressor() {
+
+    pthread_once(&guac_jpeg_compressor_key_init,
+            guac_jpeg_compressor_alloc_key);
+
+    guac_jpeg_compressor* compressor =
+        pthread_getspecific(guac_jpeg_compressor_key);
+
+    if (compressor != NULL)
+        return compressor;
+
+    compressor = guac_mem_zalloc(sizeof(guac_jpeg_compressor));
+    compressor->quality = -1;
+
+    struct jpeg_compress_struct* cinfo = &compressor->cinfo;
+    cinfo->err = jpeg_std_error(&compressor->jerr);
+    jpeg_create_compress(cinfo);
+
+#ifdef JCS_EXTENSIONS
+    /* The Turbo JPEG extensions allows us to use the Cairo surface
+     * (BGRx) as input without converting it */
+    cinfo->input_components = 4;
+    cinfo->in_color_space = JCS_EXT_BGRX;
+#else
+    /* Standard JPEG supports RGB as input so we will have to convert
+     * the contents of the Cairo surface from (BGRx) to RGB */
+    cinfo->input_components = 3;
+    cinfo->in_color_space = JCS_RGB;
+#endif
+
+    /* Defaults depend only on the input colorspace, which never changes */
+    jpeg_set_defaults(cinfo);
+
+    pthread_setspecific(guac_jpeg_compressor_key, compressor);
+    return compressor;
+
+}
+
+guac_jpeg_subsampling guac_jpeg_suggest_subsampling(int lag) {
+
+    if (lag < GUAC_JPEG_LOW_LAG)
+        return GUAC_JPEG_SUBSAMPLING_444;
+
+    if (lag < GUAC_JPEG_MODERATE_LAG)
+        return GUAC_JPEG_SUBSAMPLING_422;
+
+    return GUAC_JPEG_SUBSAMPLING_420;
+
+}
+
+guac_jpeg_dct_method guac_jpeg_suggest_dct_method(int lag) {
+
+    if (lag >= GUAC_JPEG_HIGH_LAG)
+        return GUAC_JPEG_DCT_FAST;
+
+    return GUAC_JPEG_DCT_ACCURATE;
+
+}
+
 int guac_jpeg_write(guac_socket* socket, guac_stream* stream,
-        cairo_surface_t* surface, int quality) {
+        cairo_surface_t* surface, int quality,
+        guac_jpeg_subsampling subsampling, guac_jpeg_dct_method dct_method) {
 
     /* Get image surface properties and data */
     cairo_format_t format = cairo_image_surface_get_format(surface);
@@ -186,46 +316,48 @@ int guac_jpeg_write(guac_socket* socket, guac_stream* stream,
     /* Flush pending operations to surface */
     cairo_surface_flush(surface);
 
-    /* Prepare JPEG bits */
-    struct jpeg_compress_struct cinfo;
-    struct jpeg_error_mgr jerr;
-    cinfo.err = jpeg_std_error(&jerr);
-    jpeg_create_compress(&cinfo);
+    /* Reuse this thread's compressor */
+    guac_jpeg_compressor* compressor = guac_jpeg_get_compressor();
+    struct jpeg_compress_struct* cinfo = &compressor->cinfo;
 
     /* Write JPEG directly to given stream */
-    jpeg_guac_dest(&cinfo, socket, stream);
+    jpeg_guac_dest(cinfo, socket, stream);
 
-    cinfo.image_width = width; /* image width and height, in pixels */
-    cinfo.image_height = height;
-    cinfo.arith_code = TRUE;
+    cinfo->image_width = width; /* image width and height, in pixels */
+    cinfo->image_height = height;
 
-#ifdef JCS_EXTENSIONS
-    /* The Turbo JPEG extensions allows us to use the Cairo surface
-     * (BGRx) as input without converting it */
-    cinfo.input_components = 4;
-    cinfo.in_color_space = JCS_EXT_BGRX;
-#else
-    /* Standard JPEG supports RGB as input so we will have to convert
-     * the contents of the Cairo surface from (BGRx) to RGB */
-    cinfo.input_components = 3;
-    cinfo.in_color_space = JCS_RGB;
+    /* Rebuild quantization tables only if quality has changed */
+    if (quality != compressor->quality) {
+        jpeg_set_quality(cinfo, quality, TRUE /* limit to baseline-JPEG values */);
+        compressor->quality = quality;
+    }
+
+    /* Chroma subsampling is controlled by the sampling factors of the luma
+     * component relative to the (unsubsampled) chroma components */
+    cinfo->comp_info[0].h_samp_factor =
+        (subsampling == GUAC_JPEG_SUBSAMPLING_444) ? 1 : 2;
+    cinfo->comp_info[0].v_samp_factor =
+        (subsampling == GUAC_JPEG_SUBSAMPLING_420) ? 2 : 1;
 
-    /* Create a buffer for the write scan line which is where we will
-     * put the converted pixels (BGRx -> RGB) */
-    unsigned char *scanline_data = guac_mem_zalloc(cinfo.image_width, cinfo.input_components);
+    cinfo->dct_method =
+        (dct_method == GUAC_JPEG_DCT_FAST) ? JDCT_FASTEST : JDCT_ISLOW;
+
+#ifndef JCS_EXTENSIONS
+    /* Allocate the buffer for the write scan line from this thread's frame
+     * arena, which is where we will put the converted pixels (BGRx -> RGB) */
+    unsigned char* scanline_data = guac_mem_arena_alloc(width,
+            cinfo->input_components);
 #endif
 
     /* Initialize the JPEG compressor */
-    jpeg_set_defaults(&cinfo);
-    jpeg_set_quality(&cinfo, quality, TRUE /* limit to baseline-JPEG values */);
-    jpeg_start_compress(&cinfo, TRUE);
+    jpeg_start_compress(cinfo, TRUE);
 
     JSAMPROW row_pointer[1]; /* pointer to a single row */
 
     /* Write scanlines to be used in JPEG compression */
-    while (cinfo.next_scanline < cinfo.image_height) {
+    while (cinfo->next_scanline < cinfo->image_height) {
 
-        int row_offset = stride * cinfo.next_scanline;
+        int row_offset = stride * cinfo->next_scanline;
 
 #ifdef JCS_EXTENSIONS
         /* In Turbo JPEG we can use the raw BGRx scanline  */
@@ -249,19 +381,16 @@ int guac_jpeg_write(guac_socket* socket, guac_stream* stream,
         row_pointer[0] = scanline_data;
 #endif
 
-        jpeg_write_scanlines(&cinfo, row_pointer, 1);
+        jpeg_write_scanlines(cinfo, row_pointer, 1);
     }
 
+    /* Finalize compression, leaving the compressor ready for reuse */
+    jpeg_finish_compress(cinfo);
+
 #ifndef JCS_EXTENSIONS
-    guac_mem_free(scanline_data);
+    guac_mem_arena_free(scanline_data);
 #endif
 
-    /* Finalize compression */
-    jpeg_finish_compress(&cinfo);
-
-    /* Clean up */
-    jpeg_destroy_compress(&cinfo);
     return 0;
 
 }
-
@@ -27,9 +27,99 @@
 
 #include <cairo/cairo.h>
 
+/**
+ * The processing lag, in milliseconds, below which JPEG images are encoded
+ * without chroma subsampling.
+ */
+#define GUAC_JPEG_LOW_LAG 20
+
+/**
+ * The processing lag, in milliseconds, at or above which JPEG images are
+ * encoded with full 4:2:0 chroma subsampling.
+ */
+#define GUAC_JPEG_MODERATE_LAG 50
+
+/**
+ * The processing lag, in milliseconds, at or above which JPEG images are
+ * encoded using the fastest available DCT.
+ */
+#define GUAC_JPEG_HIGH_LAG 80
+
+/**
+ * The chroma subsampling to apply when encoding a JPEG image. Heavier
+ * subsampling produces smaller images at the cost of color detail.
+ */
+typedef enum guac_jpeg_subsampling {
+
+    /**
+     * No chroma subsampling. Color detail is fully preserved.
+     */
+    GUAC_JPEG_SUBSAMPLING_444,
+
+    /**
+     * Chroma is sampled at half horizontal resolution.
+     */
+    GUAC_JPEG_SUBSAMPLING_422,
+
+    /**
+     * Chroma is sampled at half horizontal and half vertical resolution.
+     */
+    GUAC_JPEG_SUBSAMPLING_420
+
+} guac_jpeg_subsampling;
+
+/**
+ * The discrete cosine transform implementation to use when encoding a JPEG
+ * image.
+ */
+typedef enum guac_jpeg_dct_method {
+
+    /**
+     * The accurate integer DCT. This is the libjpeg default.
+     */
+    GUAC_JPEG_DCT_ACCURATE,
+
+    /**
+     * The fastest available DCT, trading a small amount of accuracy for
+     * encoding speed.
+     */
+    GUAC_JPEG_DCT_FAST
+
+} guac_jpeg_dct_method;
+
+/**
+ * Returns the chroma subsampling which should be used for JPEG images sent
+ * to a client experiencing the given processing lag. Subsampling increases
+ * with lag, as lag indicates that the client cannot keep up with the data
+ * being sent.
+ *
+ * @param lag
+ *     The processing lag of the client, in milliseconds.
+ *
+ * @return
+ *     The chroma subsampling to use.
+ */
+guac_jpeg_subsampling guac_jpeg_suggest_subsampling(int lag);
+
+/**
+ * Returns the DCT method which should be used for JPEG images sent to a
+ * client experiencing the given processing lag. The fast DCT is used only
+ * under high lag, when JPEG images are being sent continuously and encoding
+ * time matters most.
+ *
+ * @param lag
+ *     The processing lag of the client, in milliseconds.
+ *
+ * @return
+ *     The DCT method to use.
+ */
+guac_jpeg_dct_method guac_jpeg_suggest_dct_method(int lag);
+
 /**
  * Encodes the given surface as a JPEG, and sends the resulting data over the
- * given stream and socket as blobs.
+ * given stream and socket as blobs. The libjpeg compressor used for encoding
+ * is allocated once per thread and reused for all subsequent images encoded
+ * by that thread.
  *
  * @param socket
  *     The socket to send JPEG blobs over.
@@ -42,12 +132,19 @@
  *
  * @param quality
  *     JPEG image quality.
- * 
+ *
+ * @param subsampling
+ *     The chroma subsampling to apply.
+ *
+ * @param dct_method
+ *     The DCT implementation to use.
+ *
  * @return
  *     Zero if the encoding operation is successful, non-zero otherwise.
  */
 int guac_jpeg_write(guac_socket* socket, guac_stream* stream,
-        cairo_surface_t* surface, int quality);
+        cairo_surface_t* surface, int quality,
+        guac_jpeg_subsampling subsampling, guac_jpeg_dct_method dct_method);
 
 #endif
 
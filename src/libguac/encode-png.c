@@ -342,12 +342,17 @@ int guac_png_write(guac_socket* socket, guac_stream* stream,
             guac_png_write_handler,
             guac_png_flush_handler);
 
+    /* Allocate PNG rows from this thread's frame arena. If libpng fails
+     * while writing, these are reclaimed when the arena is next reset. */
+    png_rows = (png_byte**) guac_mem_arena_alloc(sizeof(png_byte*), height);
+    png_byte* png_data = (png_byte*) guac_mem_arena_alloc(sizeof(png_byte),
+            width, height);
+
     /* Copy data from surface into PNG data */
-    png_rows = (png_byte**) guac_mem_alloc(sizeof(png_byte*), height);
     for (y=0; y<height; y++) {
 
-        /* Allocate new PNG row */
-        png_byte* row = (png_byte*) guac_mem_alloc(sizeof(png_byte), width);
+        /* Point to next PNG row */
+        png_byte* row = png_data + (size_t) y * width;
         png_rows[y] = row;
 
         /* Copy data from surface into current row */
@@ -392,10 +397,10 @@ int guac_png_write(guac_socket* socket, guac_stream* stream,
     /* Free palette */
     guac_palette_free(palette);
 
-    /* Free PNG data */
-    for (y=0; y<height; y++)
-        guac_mem_free(png_rows[y]);
-    guac_mem_free(png_rows);
+    /* Free PNG data (in reverse order of allocation, such that the arena
+     * space can be immediately reused) */
+    guac_mem_arena_free(png_data);
+    guac_mem_arena_free(png_rows);
 
     /* Ensure all data is written */
     guac_png_flush_data(&write_state);
@@ -21,6 +21,7 @@
 
 #include "encode-webp.h"
 #include "guacamole/error.h"
+#include "guacamole/mem.h"
 #include "guacamole/protocol.h"
 #include "guacamole/stream.h"
 #include "palette.h"
@@ -30,9 +31,41 @@
 
 #include <assert.h>
 #include <inttypes.h>
+#include <pthread.h>
 #include <stdint.h>
 #include <stdlib.h>
 #include <string.h>
+#include <sys/time.h>
+
+#ifdef HAVE_CLOCK_GETTIME
+#include <time.h>
+#endif
+
+/**
+ * The compression method (0=fast/larger, 6=slow/smaller) used by default,
+ * while WebP encoding remains within its CPU budget.
+ */
+#define GUAC_WEBP_DEFAULT_METHOD 2
+
+/**
+ * The slowest compression method that will be used when WebP encoding is
+ * consuming well under its CPU budget.
+ */
+#define GUAC_WEBP_MAX_METHOD 4
+
+/**
+ * The percentage of elapsed time that each thread may spend encoding WebP
+ * images before the compression method is made faster. If less than half
+ * this percentage is used, the compression method is made slower (and more
+ * effective).
+ */
+#define GUAC_WEBP_CPU_BUDGET 25
+
+/**
+ * The duration of each interval over which the time spent encoding WebP
+ * images is compared against the CPU budget, in microseconds.
+ */
+#define GUAC_WEBP_BUDGET_INTERVAL 250000
 
 /**
  * Structure which describes the current state of the WebP image writer.
@@ -61,6 +94,58 @@ typedef struct guac_webp_stream_writer {
 
 } guac_webp_stream_writer;
 
+/**
+ * WebP encoding state which is allocated once per thread and reused for every
+ * WebP encoded by that thread.
+ */
+typedef struct guac_webp_encoder {
+
+    /**
+     * The picture receiving the image data of each image prior to encoding.
+     */
+    WebPPicture picture;
+
+    /**
+     * Buffer of 32-bit ARGB pixels used as the source of lossless images,
+     * which must be encoded from ARGB rather than YUV. This buffer grows as
+     * needed and is never shrunk.
+     */
+    uint32_t* argb;
+
+    /**
+     * The number of pixels that the argb buffer can hold.
+     */
+    size_t argb_size;
+
+    /**
+     * The compression method currently used for all images, ranging from 0
+     * (fastest) to GUAC_WEBP_MAX_METHOD.
+     */
+    int method;
+
+    /**
+     * The start of the current CPU budget interval, in microseconds.
+     */
+    uint64_t interval_start;
+
+    /**
+     * The total time spent encoding WebP images during the current CPU budget
+     * interval, in microseconds.
+     */
+    uint64_t interval_encode_time;
+
+} guac_webp_encoder;
+
+/**
+ * Key under which the guac_webp_encoder of the current thread is stored.
+ */
+static pthread_key_t guac_webp_encoder_key;
+
+/**
+ * Guards the one-time creation of guac_webp_encoder_key.
+ */
+static pthread_once_t guac_webp_encoder_key_init = PTHREAD_ONCE_INIT;
+
 /**
  * Writes the contents of the WebP stream writer as a blob to its associated
  * socket.
@@ -162,14 +247,203 @@ static int guac_webp_stream_write(const uint8_t* data, size_t data_size,
     return 1;
 }
 
+/**
+ * Returns the current time in microseconds. The returned value is
+ * monotonically increasing if the platform supports it, and is only
+ * meaningful relative to other values returned by this function.
+ *
+ * @return
+ *     The current time, in microseconds.
+ */
+static uint64_t guac_webp_current_usec() {
+
+#ifdef HAVE_CLOCK_GETTIME
+
+    struct timespec current;
+
+#ifdef CLOCK_MONOTONIC
+    clock_gettime(CLOCK_MONOTONIC, &current);
+#else
+    clock_gettime(CLOCK_REALTIME, &current);
+#endif
+
+    return (uint64_t) current.tv_sec * 1000000 + current.tv_nsec / 1000;
+
+#else
+
+    struct timeval current;
+    gettimeofday(&current, NULL);
+
+    return (uint64_t) current.tv_sec * 1000000 + current.tv_usec;
+
+#endif
+
+}
+
+/**
+ * Frees the given guac_webp_encoder, including any picture data. This
+ * function is invoked automatically when the thread that owns the encoder
+ * exits.
+ *
+ * @param data
+ *     The guac_webp_encoder to free.
+ */
+static void guac_webp_encoder_free(void* data) {
+
+    guac_webp_encoder* encoder = (guac_webp_encoder*) data;
+
+    /* The ARGB buffer is owned by the encoder, not the picture */
+    encoder->picture.argb = NULL;
+    WebPPictureFree(&encoder->picture);
+
+    guac_mem_free(encoder->argb);
+    guac_mem_free(encoder);
+
+}
+
+/**
+ * Creates the key under which each thread's guac_webp_encoder is stored,
+ * freeing that encoder automatically when its thread exits.
+ */
+static void guac_webp_encoder_alloc_key() {
+    pthread_key_create(&guac_webp_encoder_key, guac_webp_encoder_free);
+}
+
+/**
+ * Returns the guac_webp_encoder of the current thread, creating a new
+ * encoder if this thread has not yet encoded any WebP images.
+ *
+ * @return
+ *     The guac_webp_encoder of the current thread, or NULL if the encoder
+ *     could not be created.
+ */
+static guac_webp_encoder* guac_webp_get_encoder() {
+
+    pthread_once(&guac_webp_encoder_key_init, guac_webp_encoder_alloc_key);
+
+    guac_webp_encoder* encoder = pthread_getspecific(guac_webp_encoder_key);
+    if (encoder != NULL)
+        return encoder;
+
+    encoder = guac_mem_zalloc(sizeof(guac_webp_encoder));
+    if (!WebPPictureInit(&encoder->picture)) {
+        guac_mem_free(encoder);
+        return NULL;
+    }
+
+    encoder->method = GUAC_WEBP_DEFAULT_METHOD;
+    encoder->interval_start = guac_webp_current_usec();
+
+    pthread_setspecific(guac_webp_encoder_key, encoder);
+    return encoder;
+
+}
+
+/**
+ * Records the time taken to encode an image, adjusting the compression method
+ * of the given encoder once per GUAC_WEBP_BUDGET_INTERVAL such that the time
+ * spent encoding stays within GUAC_WEBP_CPU_BUDGET percent of elapsed time.
+ *
+ * @param encoder
+ *     The encoder that encoded the image.
+ *
+ * @param start
+ *     The time that encoding began, in microseconds.
+ *
+ * @param end
+ *     The time that encoding completed, in microseconds.
+ */
+static void guac_webp_encoder_update_budget(guac_webp_encoder* encoder,
+        uint64_t start, uint64_t end) {
+
+    encoder->interval_encode_time += end - start;
+
+    uint64_t elapsed = end - encoder->interval_start;
+    if (elapsed < GUAC_WEBP_BUDGET_INTERVAL)
+        return;
+
+    uint64_t usage = encoder->interval_encode_time * 100 / elapsed;
+
+    /* Hurry if over budget */
+    if (usage > GUAC_WEBP_CPU_BUDGET) {
+        if (encoder->method > 0)
+            encoder->method--;
+    }
+
+    /* Spend spare time on better compression */
+    else if (usage * 2 < GUAC_WEBP_CPU_BUDGET) {
+        if (encoder->method < GUAC_WEBP_MAX_METHOD)
+            encoder->method++;
+    }
+
+    encoder->interval_start = end;
+    encoder->interval_encode_time = 0;
+
+}
+
+/**
+ * Copies the given image data into the ARGB buffer of the given encoder,
+ * growing that buffer if necessary, and points the encoder's picture at the
+ * copied data.
+ *
+ * @param encoder
+ *     The encoder whose picture should receive the image data.
+ *
+ * @param data
+ *     The image data to copy, in Cairo's native 32-bit format.
+ *
+ * @param width
+ *     The width of the image, in pixels.
+ *
+ * @param height
+ *     The height of the image, in pixels.
+ *
+ * @param stride
+ *     The number of bytes in each row of image data.
+ *
+ * @param opaque
+ *     Non-zero if the alpha channel of the image data should be ignored,
+ *     treating every pixel as opaque.
+ */
+static void guac_webp_encoder_set_argb(guac_webp_encoder* encoder,
+        const unsigned char* data, int width, int height, int stride,
+        int opaque) {
+
+    size_t size = guac_mem_ckd_mul_or_die(width, height);
+    if (size > encoder->argb_size) {
+        guac_mem_free(encoder->argb);
+        encoder->argb = guac_mem_alloc(size, sizeof(uint32_t));
+        encoder->argb_size = size;
+    }
+
+    /* Cairo's native pixel format matches the ARGB format used by WebP */
+    uint32_t* argb_output = encoder->argb;
+    for (int y = 0; y < height; y++) {
+
+        const uint32_t* src = (const uint32_t*) data;
+
+        if (opaque) {
+            for (int x = 0; x < width; x++)
+                argb_output[x] = src[x] | 0xFF000000;
+        }
+        else
+            memcpy(argb_output, src, width * sizeof(uint32_t));
+
+        data += stride;
+        argb_output += width;
+
+    }
+
+    encoder->picture.use_argb = 1;
+    encoder->picture.argb = encoder->argb;
+    encoder->picture.argb_stride = width;
+
+}
+
 int guac_webp_write(guac_socket* socket, guac_stream* stream,
         cairo_surface_t* surface, int quality, int lossless) {
 
     guac_webp_stream_writer writer;
-    WebPPicture picture;
-    uint32_t* argb_output;
-
-    int x, y;
 
     int width = cairo_image_surface_get_width(surface);
     int height = cairo_image_surface_get_height(surface);
@@ -186,6 +460,10 @@ int guac_webp_write(guac_socket* socket, guac_stream* stream,
     /* Flush pending operations to surface */
     cairo_surface_flush(surface);
 
+    guac_webp_encoder* encoder = guac_webp_get_encoder();
+    if (encoder == NULL)
+        return -1;
+
     /* Configure WebP compression bits */
     WebPConfig config;
     if (!WebPConfigPreset(&config, WEBP_PRESET_DEFAULT, quality))
@@ -195,70 +473,65 @@ int guac_webp_write(guac_socket* socket, guac_stream* stream,
     config.lossless = lossless;
     config.quality = quality;
     config.thread_level = 1; /* Multi threaded */
-    config.method = 2; /* Compression method (0=fast/larger, 6=slow/smaller) */
+    config.method = encoder->method;
+
+    /* For lossless images, quality dictates compression effort, which is
+     * scaled down along with the method when over budget */
+    if (lossless && encoder->method < GUAC_WEBP_DEFAULT_METHOD)
+        config.quality = quality * (encoder->method + 1)
+                       / (GUAC_WEBP_DEFAULT_METHOD + 1);
 
     /* Validate configuration */
     if (!WebPValidateConfig(&config)) {
         return -1;
     }
 
-    /* Set up WebP picture */
-    if (!WebPPictureInit(&picture)) {
-        return -1;
-    }
-    picture.use_argb = 1;
-    picture.width = width;
-    picture.height = height;
+    uint64_t start = guac_webp_current_usec();
 
-    /* Allocate and init writer */
-    if (!WebPPictureAlloc(&picture)) {
-        return -1;
-    }
-    picture.writer = guac_webp_stream_write;
-    picture.custom_ptr = &writer;
+    /* Set up WebP picture */
+    WebPPicture* picture = &encoder->picture;
+    picture->width = width;
+    picture->height = height;
+    picture->writer = guac_webp_stream_write;
+    picture->custom_ptr = &writer;
     guac_webp_stream_writer_init(&writer, socket, stream);
 
-    /* Copy image data into WebP picture */
-    argb_output = picture.argb;
-    for (y = 0; y < height; y++) {
-
-        /* Get pixels at start of each row */
-        uint32_t* src = (uint32_t*) data;
-        uint32_t* dst = argb_output;
-
-        /* For each pixel in row */
-        for (x = 0; x < width; x++) {
-
-            /* Pull pixel data, removing alpha channel if necessary */
-            uint32_t src_pixel = *src;
-            if (format != CAIRO_FORMAT_ARGB32)
-                src_pixel |= 0xFF000000;
-
-            /* Store converted pixel data */
-            *dst = src_pixel;
-
-            /* Next pixel */
-            src++;
-            dst++;
-
-        }
-
-        /* Next row */
-        data += stride;
-        argb_output += picture.argb_stride;
-
+    /* Lossy images are encoded from YUV, which libwebp can produce directly
+     * from Cairo's in-memory BGRx/BGRA layout in a single pass. That layout
+     * is xRGB on big-endian systems, which libwebp cannot import. */
+#ifdef WORDS_BIGENDIAN
+    int import_yuv = 0;
+#else
+    int import_yuv = !lossless;
+#endif
+
+    int imported = 1;
+    if (import_yuv) {
+        picture->use_argb = 0;
+        picture->argb = NULL;
+        if (format == CAIRO_FORMAT_ARGB32)
+            imported = WebPPictureImportBGRA(picture, data, stride);
+        else
+            imported = WebPPictureImportBGRX(picture, data, stride);
     }
 
+    /* All other images are encoded from the reusable ARGB buffer */
+    else
+        guac_webp_encoder_set_argb(encoder, data, width, height, stride,
+                format != CAIRO_FORMAT_ARGB32);
+
     /* Encode image */
-    const int result = WebPEncode(&config, &picture) ? 0 : -1;
+    const int result = imported && WebPEncode(&config, picture) ? 0 : -1;
 
-    /* Free picture */
-    WebPPictureFree(&picture);
+    /* Do not retain references to data outside the encoder */
+    picture->writer = NULL;
+    picture->custom_ptr = NULL;
 
     /* Ensure all data is written */
     guac_webp_flush_data(&writer);
 
+    guac_webp_encoder_update_budget(encoder, start, guac_webp_current_usec());
+
     return result;
 
 }
-
@@ -29,7 +29,10 @@
 
 /**
  * Encodes the given surface as a WebP, and sends the resulting data over the
- * given stream and socket as blobs.
+ * given stream and socket as blobs. Encoding state is allocated once per
+ * thread and reused for all subsequent images encoded by that thread. The
+ * compression method used is automatically made faster or slower such that
+ * each thread spends a bounded fraction of its time encoding WebP images.
  *
  * @param socket
  *     The socket to send WebP blobs over.
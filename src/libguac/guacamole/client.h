@@ -28,6 +28,7 @@
 
 #include "client-fntypes.h"
 #include "client-types.h"
+#include "rate-limit-types.h"
 #include "client-constants.h"
 #include "layer-types.h"
 #include "object-types.h"
@@ -87,6 +88,13 @@ struct guac_client {
      */
     guac_timestamp last_sent_timestamp;
 
+    /**
+     * The token bucket limiting the combined rate at which data is written to
+     * all users of this client, or NULL if that rate is not limited. This is
+     * set with guac_client_set_rate_limit().
+     */
+    guac_rate_limit* rate_limit;
+
     /**
      * Handler for freeing data when the client is being unloaded.
      *
@@ -592,6 +600,9 @@ void* guac_client_for_user(guac_client* client, guac_user* user,
  * contain the current timestamp. The last_sent_timestamp member of guac_client
  * will be updated accordingly.
  *
+ * As the frame is complete, the frame arena of the calling thread is also
+ * reset via guac_mem_arena_reset().
+ *
  * If an error occurs sending the instruction, a non-zero value is
  * returned, and guac_error is set appropriately.
  *
@@ -611,6 +622,9 @@ int guac_client_end_frame(guac_client* client);
  * considered in creating that frame.  The last_sent_timestamp member of
  * guac_client will be updated accordingly.
  *
+ * As the frame is complete, the frame arena of the calling thread is also
+ * reset via guac_mem_arena_reset().
+ *
  * If an error occurs sending the instruction, a non-zero value is
  * returned, and guac_error is set appropriately.
  *
@@ -645,6 +659,8 @@ int guac_client_load_plugin(guac_client* client, const char* protocol);
  * Calculates and returns the approximate processing lag experienced by the
  * pool of users. The processing lag is the difference in time between server
  * and client due purely to data processing and excluding network delays.
+ * Users which are lagging (see the "lagging" member of guac_user) are paced
+ * separately and are not considered.
  *
  * @param client
  *     The guac_client to calculate the processing lag of.
@@ -655,6 +671,78 @@ int guac_client_load_plugin(guac_client* client, const char* protocol);
  */
 int guac_client_get_processing_lag(guac_client* client);
 
+/**
+ * Returns the quality which should be used for lossy encoding of updates
+ * sent to all users, based on the round-trip time, delivery rate, and
+ * queueing delay estimated for each user's connection. Users which are
+ * lagging (see the "lagging" member of guac_user) are paced separately and
+ * are not considered.
+ *
+ * @param client
+ *     The guac_client whose users will receive the encoded updates.
+ *
+ * @return
+ *     A value between GUAC_CONGESTION_MIN_QUALITY and
+ *     GUAC_CONGESTION_MAX_QUALITY inclusive which can be sustained by the
+ *     connection of every user considered.
+ */
+int guac_client_suggest_quality(guac_client* client);
+
+/**
+ * Returns the duration which each frame sent to all users should have, such
+ * that each frame can be delivered to every user before the next is sent and
+ * latency remains bounded. Users which are lagging (see the "lagging" member
+ * of guac_user) are paced separately and are not considered.
+ *
+ * @param client
+ *     The guac_client whose users will receive the frames.
+ *
+ * @param min_duration
+ *     The shortest acceptable frame duration, in milliseconds. This will
+ *     typically be the usual frame duration of the protocol in use.
+ *
+ * @return
+ *     The suggested frame duration, in milliseconds, which will be no shorter
+ *     than min_duration.
+ */
+int guac_client_suggest_frame_duration(guac_client* client,
+        int min_duration);
+
+/**
+ * Returns the number of bytes which may be sent to all users within a frame of
+ * the given duration, based on the delivery rate estimated for each user's
+ * connection (see guac_congestion_get_frame_budget()). Users which are
+ * lagging (see the "lagging" member of guac_user) are paced separately and
+ * are not considered, nor are users whose delivery rate is not yet known.
+ *
+ * @param client
+ *     The guac_client whose users will receive the frame.
+ *
+ * @param frame_duration
+ *     The duration of the frame, in milliseconds.
+ *
+ * @return
+ *     The maximum number of bytes which should be sent within a frame of the
+ *     given duration, or zero if the delivery rate of no user is yet known.
+ */
+int guac_client_get_frame_budget(guac_client* client, int frame_duration);
+
+/**
+ * Limits the combined rate at which data is written to all users of the given
+ * guac_client, including users which join later. If the rate is already
+ * limited, the existing limit is changed to the given rate. The limit must be
+ * first applied before any users other than the owner join, typically from
+ * within the join handler of the owner.
+ *
+ * @param client
+ *     The guac_client whose outbound data should be limited.
+ *
+ * @param rate
+ *     The number of bytes per second which may be written across all users
+ *     of the given client.
+ */
+void guac_client_set_rate_limit(guac_client* client, int rate);
+
 /**
  * Sends a request to the owner of the given guac_client for parameters required
  * to continue the connection started by the client. The function returns zero
@@ -893,6 +981,22 @@ int guac_client_owner_notify_leave(guac_client* client, guac_user* quitter);
  */
 int guac_client_supports_webp(guac_client* client);
 
+/**
+ * Returns whether live video streaming is supported by libguac and by all
+ * users of the given client. Video streaming requires libguac to have been
+ * built against libavcodec, libavformat, libavutil and libswscale, and
+ * requires each user to have declared support for at least one video format
+ * for which an encoder is available.
+ *
+ * @param client
+ *     The Guacamole client whose users should be checked.
+ *
+ * @return
+ *     Non-zero if live video streaming is supported for all users of the
+ *     given client, zero otherwise.
+ */
+int guac_client_supports_video(guac_client* client);
+
 /**
  * The default Guacamole client layer, layer 0.
  */
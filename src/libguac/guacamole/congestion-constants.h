@@ -0,0 +1,82 @@
+/*
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ * KIND, either express or implied.  See the License for the
+ * specific language governing permissions and limitations
+ * under the License.
+ */
+
+#ifndef __GUAC_CONGESTION_CONSTANTS_H
+#define __GUAC_CONGESTION_CONSTANTS_H
+
+/**
+ * Constants related to estimating the network conditions between the server
+ * and each user.
+ *
+ * @file congestion-constants.h
+ */
+
+/**
+ * The number of most-recently sent frames remembered for the sake of matching
+ * acknowledgements against the number of bytes sent.
+ */
+#define GUAC_CONGESTION_HISTORY_SIZE 64
+
+/**
+ * The number of milliseconds after which the minimum round-trip time is
+ * forgotten and measured anew, such that route changes are eventually
+ * reflected.
+ */
+#define GUAC_CONGESTION_MIN_RTT_WINDOW 10000
+
+/**
+ * The number of milliseconds for which the highest measured delivery rate is
+ * remembered. Measurements are forgotten once between one and two such
+ * windows old, such that the estimate decays with time rather than with the
+ * number of frames acknowledged.
+ */
+#define GUAC_CONGESTION_RATE_WINDOW 5000
+
+/**
+ * The gain applied to the estimated delivery rate when determining how many
+ * bytes may be sent within a frame, as a percentage. As the delivery rate is
+ * measured from traffic limited by that same budget, budgeting for more than
+ * the measured rate allows the estimate to grow to the available bandwidth.
+ */
+#define GUAC_CONGESTION_RATE_PROBE_GAIN 125
+
+/**
+ * The amount of queueing delay, in milliseconds, beyond which the connection
+ * is considered congested. The suggested quality is reduced and frames are
+ * lengthened while queueing delay exceeds this value.
+ */
+#define GUAC_CONGESTION_MAX_QUEUE_DELAY 100
+
+/**
+ * The highest quality ever suggested for lossy encoding.
+ */
+#define GUAC_CONGESTION_MAX_QUALITY 90
+
+/**
+ * The lowest quality ever suggested for lossy encoding.
+ */
+#define GUAC_CONGESTION_MIN_QUALITY 30
+
+/**
+ * The longest frame duration ever suggested, in milliseconds.
+ */
+#define GUAC_CONGESTION_MAX_FRAME_DURATION 1000
+
+#endif
+
@@ -0,0 +1,38 @@
+/*
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ * KIND, either express or implied.  See the License for the
+ * specific language governing permissions and limitations
+ * under the License.
+ */
+
+#ifndef __GUAC_CONGESTION_TYPES_H
+#define __GUAC_CONGESTION_TYPES_H
+
+/**
+ * Type definitions related to estimating the network conditions between the
+ * server and each user.
+ *
+ * @file congestion-types.h
+ */
+
+/**
+ * An estimate of the round-trip time, delivery rate, and queueing delay of
+ * the connection to a single user, derived from the "sync" instructions
+ * acknowledged by that user.
+ */
+typedef struct guac_congestion guac_congestion;
+
+#endif
+
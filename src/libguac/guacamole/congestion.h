@@ -0,0 +1,279 @@
+/*
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ * KIND, either express or implied.  See the License for the
+ * specific language governing permissions and limitations
+ * under the License.
+ */
+
+#ifndef __GUAC_CONGESTION_H
+#define __GUAC_CONGESTION_H
+
+/**
+ * Provides functions for estimating the network conditions between the server
+ * and a user, and for choosing encoding quality and frame durations which keep
+ * latency bounded under those conditions. Each frame sent is matched against
+ * its acknowledging "sync" instruction, yielding a smoothed round-trip time,
+ * the rate at which data is delivered, and the delay introduced by data
+ * queued along the way.
+ *
+ * @file congestion.h
+ */
+
+#include "congestion-constants.h"
+#include "congestion-types.h"
+#include "timestamp-types.h"
+
+#include <pthread.h>
+#include <stdint.h>
+
+/**
+ * A single frame sent to a user, as recorded by guac_congestion_frame_sent().
+ */
+typedef struct guac_congestion_frame {
+
+    /**
+     * The timestamp of the "sync" instruction which ended the frame.
+     */
+    guac_timestamp timestamp;
+
+    /**
+     * The total number of bytes written to the user's socket, including the
+     * frame itself, at the time the frame ended.
+     */
+    uint64_t bytes;
+
+} guac_congestion_frame;
+
+struct guac_congestion {
+
+    /**
+     * Lock which is acquired whenever the estimate is updated or read.
+     */
+    pthread_mutex_t __lock;
+
+    /**
+     * Circular buffer of the most recently sent frames.
+     */
+    guac_congestion_frame __frames[GUAC_CONGESTION_HISTORY_SIZE];
+
+    /**
+     * The total number of frames ever recorded as sent. The most recent frame
+     * is stored at index (__frames_sent - 1) % GUAC_CONGESTION_HISTORY_SIZE.
+     */
+    uint64_t __frames_sent;
+
+    /**
+     * The total number of frames, counted as for __frames_sent, which had
+     * been sent as of the most recently acknowledged frame, or zero if no
+     * frame has yet been acknowledged.
+     */
+    uint64_t __frames_acknowledged;
+
+    /**
+     * The total number of bytes, as recorded for the most recently
+     * acknowledged frame, which are known to have been delivered.
+     */
+    uint64_t __bytes_acknowledged;
+
+    /**
+     * The local time at which the most recent acknowledgement was received.
+     */
+    guac_timestamp __last_acknowledged;
+
+    /**
+     * The local time at which the current minimum round-trip time was
+     * measured.
+     */
+    guac_timestamp __min_rtt_measured;
+
+    /**
+     * The local time at which the suggested quality was last reduced.
+     */
+    guac_timestamp __last_reduction;
+
+    /**
+     * The local time at which the current delivery rate window began, or
+     * zero if no delivery rate has yet been measured.
+     */
+    guac_timestamp __rate_window_start;
+
+    /**
+     * The highest delivery rate measured within the current window, in bytes
+     * per second.
+     */
+    int __rate_window_max;
+
+    /**
+     * The highest delivery rate measured within the window preceding the
+     * current window, in bytes per second, or zero if no rate was measured
+     * during that window.
+     */
+    int __rate_previous_max;
+
+    /**
+     * The smoothed round-trip time, in milliseconds, or zero if no frame has
+     * yet been acknowledged.
+     */
+    int smoothed_rtt;
+
+    /**
+     * The smoothed mean deviation of the round-trip time, in milliseconds.
+     */
+    int rtt_variance;
+
+    /**
+     * The lowest round-trip time measured within the last
+     * GUAC_CONGESTION_MIN_RTT_WINDOW milliseconds. This approximates the
+     * round-trip time of the connection when no data is queued.
+     */
+    int min_rtt;
+
+    /**
+     * The estimated number of milliseconds that data currently spends queued
+     * between the server and the user, beyond the minimum round-trip time.
+     */
+    int queue_delay;
+
+    /**
+     * The estimated rate at which data can be delivered to the user, in bytes
+     * per second, or zero if not yet known. This is the highest delivery rate
+     * measured within the current and previous GUAC_CONGESTION_RATE_WINDOW,
+     * such that frames which did not fully use the connection do not lower
+     * the estimate.
+     */
+    int delivery_rate;
+
+    /**
+     * The average size, in bytes, of the frames covered by the most recent
+     * acknowledgement, or zero if not yet known.
+     */
+    int frame_size;
+
+    /**
+     * The quality currently suggested for lossy encoding, between
+     * GUAC_CONGESTION_MIN_QUALITY and GUAC_CONGESTION_MAX_QUALITY inclusive.
+     */
+    int quality;
+
+};
+
+/**
+ * Allocates a new congestion estimate for a connection about which nothing
+ * is yet known.
+ *
+ * @return
+ *     A newly-allocated guac_congestion, which must eventually be freed with
+ *     guac_congestion_free().
+ */
+guac_congestion* guac_congestion_alloc();
+
+/**
+ * Frees the given congestion estimate.
+ *
+ * @param congestion
+ *     The guac_congestion to free.
+ */
+void guac_congestion_free(guac_congestion* congestion);
+
+/**
+ * Records that a frame ending with a "sync" instruction having the given
+ * timestamp has been written to the user's socket.
+ *
+ * @param congestion
+ *     The congestion estimate of the user receiving the frame.
+ *
+ * @param timestamp
+ *     The timestamp of the "sync" instruction which ended the frame.
+ *
+ * @param bytes
+ *     The total number of bytes written to the user's socket thus far,
+ *     including the frame.
+ */
+void guac_congestion_frame_sent(guac_congestion* congestion,
+        guac_timestamp timestamp, uint64_t bytes);
+
+/**
+ * Updates the given congestion estimate with the acknowledgement of the frame
+ * having the given timestamp, received from the user at the given time.
+ *
+ * @param congestion
+ *     The congestion estimate of the user acknowledging the frame.
+ *
+ * @param timestamp
+ *     The timestamp of the "sync" instruction received from the user.
+ *
+ * @param received
+ *     The local time at which the acknowledgement was received.
+ */
+void guac_congestion_frame_acknowledged(guac_congestion* congestion,
+        guac_timestamp timestamp, guac_timestamp received);
+
+/**
+ * Returns the quality which should be used for lossy encoding of updates
+ * sent to the user. Quality is reduced multiplicatively, at most once per
+ * round trip, while queueing delay exceeds GUAC_CONGESTION_MAX_QUEUE_DELAY,
+ * and otherwise recovers gradually, such that quality converges rather than
+ * oscillating with each measurement.
+ *
+ * @param congestion
+ *     The congestion estimate of the user.
+ *
+ * @return
+ *     A value between GUAC_CONGESTION_MIN_QUALITY and
+ *     GUAC_CONGESTION_MAX_QUALITY inclusive.
+ */
+int guac_congestion_suggest_quality(guac_congestion* congestion);
+
+/**
+ * Returns the number of bytes which may be sent to the user within a frame of
+ * the given duration. The budget exceeds the estimated delivery rate by
+ * GUAC_CONGESTION_RATE_PROBE_GAIN, such that frames limited by the budget
+ * still probe for additional bandwidth, while queueing delay caused by any
+ * excess is corrected by lengthening frames.
+ *
+ * @param congestion
+ *     The congestion estimate of the user.
+ *
+ * @param frame_duration
+ *     The duration of the frame, in milliseconds.
+ *
+ * @return
+ *     The maximum number of bytes which should be sent within a frame of the
+ *     given duration, or zero if the delivery rate is not yet known.
+ */
+int guac_congestion_get_frame_budget(guac_congestion* congestion,
+        int frame_duration);
+
+/**
+ * Returns the duration which frames sent to the user should have, such that
+ * each frame can be delivered before the next is sent and any data already
+ * queued has time to drain.
+ *
+ * @param congestion
+ *     The congestion estimate of the user.
+ *
+ * @param min_duration
+ *     The shortest acceptable frame duration, in milliseconds.
+ *
+ * @return
+ *     The suggested frame duration, in milliseconds, which will be at least
+ *     min_duration and at most GUAC_CONGESTION_MAX_FRAME_DURATION unless
+ *     min_duration is larger.
+ */
+int guac_congestion_suggest_frame_duration(guac_congestion* congestion,
+        int min_duration);
+
+#endif
+
@@ -409,5 +409,63 @@
  */
 #define guac_mem_free_const(mem) PRIV_guac_mem_free((void*) (mem))
 
-#endif
+/**
+ * Allocates a contiguous block of temporary memory with the specified size
+ * from the frame arena of the calling thread, returning a pointer to the first
+ * byte of that block of memory. If multiple sizes are provided, these sizes
+ * are multiplied together to produce the final size of the new block. If
+ * memory of the specified size cannot be allocated, or if multiplying the
+ * sizes would result in integer overflow, guac_error is set appropriately and
+ * NULL is returned.
+ *
+ * Arena memory is intended for the short-lived buffers needed while handling
+ * a single update, such as image conversion and encoding buffers, and is
+ * carved from large chunks that are reused from frame to frame rather than
+ * being requested from the system allocator each time. The returned block
+ * remains valid only until it is freed with guac_mem_arena_free() or until
+ * guac_mem_arena_reset() is next invoked by the same thread, whichever comes
+ * first. It MUST NOT be passed to another thread, nor freed with
+ * guac_mem_free() or free().
+ *
+ * @param ...
+ *     A series of one or more size_t values that should be multiplied together
+ *     to produce the desired block size. At least one value MUST be provided.
+ *
+ * @returns
+ *     A pointer to the first byte of the allocated block of memory, or NULL if
+ *     such a block could not be allocated. If a block of memory could not be
+ *     allocated, guac_error is set appropriately.
+ */
+#define guac_mem_arena_alloc(...) \
+    PRIV_guac_mem_arena_alloc(                                                \
+        sizeof((const size_t[]) { __VA_ARGS__ }) / sizeof(const size_t),      \
+        (const size_t[]) { __VA_ARGS__ }                                      \
+    )
 
+/**
+ * Frees the arena memory block at the given pointer, which MUST have been
+ * allocated with guac_mem_arena_alloc() by the calling thread since that
+ * thread last invoked guac_mem_arena_reset(). The given pointer is set to NULL
+ * after freeing. If the provided pointer is NULL, this macro has no effect.
+ *
+ * Blocks freed in the reverse order of their allocation are returned to the
+ * arena immediately and may be reused by the next allocation. Memory of any
+ * other block is reclaimed when the arena is next reset.
+ *
+ * @param mem
+ *     A pointer to the memory to be freed.
+ */
+#define guac_mem_arena_free(mem) \
+    (PRIV_guac_mem_arena_free(mem), (mem) = NULL, (void) 0)
+
+/**
+ * Resets the frame arena of the calling thread, reclaiming all memory
+ * allocated from that arena with guac_mem_arena_alloc(). Any pointers to such
+ * memory are invalidated. This function is invoked automatically at each
+ * frame boundary by guac_client_end_frame() and
+ * guac_client_end_multiple_frames(), and has no effect if the calling thread
+ * has not allocated any arena memory.
+ */
+void guac_mem_arena_reset();
+
+#endif
@@ -313,5 +313,43 @@ void* PRIV_guac_mem_realloc_or_die(void* mem, size_t factor_count, const size_t*
  */
 void PRIV_guac_mem_free(void* mem);
 
-#endif
+/**
+ * Allocates a contiguous block of temporary memory with the specified size
+ * from the frame arena of the calling thread, returning a pointer to the first
+ * byte of that block of memory. If multiple sizes are provided, these sizes
+ * are multiplied together to produce the final size of the new block. If
+ * memory of the specified size cannot be allocated, or if multiplying the
+ * sizes would result in integer overflow, guac_error is set appropriately and
+ * NULL is returned.
+ *
+ * The pointer returned by PRIV_guac_mem_arena_alloc() MUST only be freed with
+ * a subsequent call to guac_mem_arena_free() or PRIV_guac_mem_arena_free()
+ * from the same thread, or implicitly via guac_mem_arena_reset().
+ *
+ * @param factor_count
+ *     The number of factors to multiply together to produce the desired block
+ *     size.
+ *
+ * @param factors
+ *     An array of one or more size_t values that should be multiplied together
+ *     to produce the desired block size. At least one value MUST be provided.
+ *
+ * @returns
+ *     A pointer to the first byte of the allocated block of memory, or NULL if
+ *     such a block could not be allocated. If a block of memory could not be
+ *     allocated, guac_error is set appropriately.
+ */
+void* PRIV_guac_mem_arena_alloc(size_t factor_count, const size_t* factors);
+
+/**
+ * Frees the arena memory block at the given pointer, which MUST have been
+ * allocated with guac_mem_arena_alloc() or PRIV_guac_mem_arena_alloc() by the
+ * calling thread. If the provided pointer is NULL, this function has no
+ * effect.
+ *
+ * @param mem
+ *     A pointer to the memory to be freed.
+ */
+void PRIV_guac_mem_arena_free(void* mem);
 
+#endif
@@ -0,0 +1,43 @@
+/*
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ * KIND, either express or implied.  See the License for the
+ * specific language governing permissions and limitations
+ * under the License.
+ */
+
+#ifndef __GUAC_RATE_LIMIT_CONSTANTS_H
+#define __GUAC_RATE_LIMIT_CONSTANTS_H
+
+/**
+ * Constants related to limiting the rate at which data is written to sockets.
+ *
+ * @file rate-limit-constants.h
+ */
+
+/**
+ * The number of milliseconds worth of data, at the configured rate, which
+ * may be written in a single burst after a socket has been idle.
+ */
+#define GUAC_RATE_LIMIT_BURST 250
+
+/**
+ * The largest rate, in kilobits per second, which may be requested for a
+ * rate limit, such that the equivalent rate in bytes per second (125 bytes
+ * per kilobit) remains within the range of an int.
+ */
+#define GUAC_RATE_LIMIT_MAX_KBPS 17179869
+
+#endif
+
@@ -0,0 +1,165 @@
+/*
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ * KIND, either express or implied.  See the License for the
+ * specific language governing permissions and limitations
+ * under the License.
+ */
+
+#ifndef __GUAC_RATE_LIMIT_H
+#define __GUAC_RATE_LIMIT_H
+
+/**
+ * Provides a token bucket which limits the rate at which data is written to
+ * one or more sockets. A single bucket may be shared by many sockets, such as
+ * the sockets of all users of a connection, limiting the combined rate of
+ * those sockets. Writes are never delayed by the bucket itself. Producers of
+ * data instead check how full the bucket is and coalesce their output while
+ * it is empty, pacing output at the configured rate.
+ *
+ * @file rate-limit.h
+ */
+
+#include "rate-limit-constants.h"
+#include "rate-limit-types.h"
+#include "timestamp-types.h"
+
+#include <pthread.h>
+#include <stddef.h>
+#include <stdint.h>
+
+struct guac_rate_limit {
+
+    /**
+     * Lock which is acquired whenever the bucket is updated or read.
+     */
+    pthread_mutex_t __lock;
+
+    /**
+     * The number of references to this bucket. The bucket is freed once all
+     * references have been released with guac_rate_limit_free().
+     */
+    int __refcount;
+
+    /**
+     * The number of bytes which may be written per second.
+     */
+    int rate;
+
+    /**
+     * The number of bytes which may currently be written without exceeding
+     * the rate. This may be negative if writes have exceeded the available
+     * tokens, in which case no further data should be written until the
+     * deficit has been refilled.
+     */
+    int64_t __tokens;
+
+    /**
+     * The time at which tokens were last added to the bucket.
+     */
+    guac_timestamp __last_refill;
+
+};
+
+/**
+ * Allocates a new token bucket limiting writes to the given rate. The bucket
+ * is initially full.
+ *
+ * @param rate
+ *     The number of bytes which may be written per second.
+ *
+ * @return
+ *     A newly-allocated guac_rate_limit having a single reference, which
+ *     must eventually be released with guac_rate_limit_free().
+ */
+guac_rate_limit* guac_rate_limit_alloc(int rate);
+
+/**
+ * Acquires an additional reference to the given token bucket.
+ *
+ * @param limit
+ *     The guac_rate_limit to acquire a reference to.
+ *
+ * @return
+ *     The given guac_rate_limit.
+ */
+guac_rate_limit* guac_rate_limit_retain(guac_rate_limit* limit);
+
+/**
+ * Releases a reference to the given token bucket, freeing the bucket once all
+ * references have been released.
+ *
+ * @param limit
+ *     The guac_rate_limit to release.
+ */
+void guac_rate_limit_free(guac_rate_limit* limit);
+
+/**
+ * Changes the rate at which the given token bucket refills.
+ *
+ * @param limit
+ *     The guac_rate_limit to modify.
+ *
+ * @param rate
+ *     The number of bytes which may be written per second.
+ */
+void guac_rate_limit_set_rate(guac_rate_limit* limit, int rate);
+
+/**
+ * Removes the given number of bytes worth of tokens from the given token
+ * bucket, returning how long it will take for the bucket to refill any
+ * resulting deficit.
+ *
+ * @param limit
+ *     The guac_rate_limit to remove tokens from.
+ *
+ * @param length
+ *     The number of bytes being written.
+ *
+ * @return
+ *     The number of milliseconds until the bucket again holds tokens, or zero
+ *     if tokens remain after the write.
+ */
+int guac_rate_limit_consume(guac_rate_limit* limit, size_t length);
+
+/**
+ * Returns the number of bytes which may currently be written without
+ * exceeding the configured rate. This value is negative if previous writes
+ * have exceeded the available tokens.
+ *
+ * @param limit
+ *     The guac_rate_limit to test.
+ *
+ * @return
+ *     The number of bytes which may be written without exceeding the
+ *     configured rate.
+ */
+int guac_rate_limit_get_available(guac_rate_limit* limit);
+
+/**
+ * Returns how full the given token bucket currently is, as a percentage of
+ * the tokens that the bucket holds when full.
+ *
+ * @param limit
+ *     The guac_rate_limit to test.
+ *
+ * @return
+ *     A value between 0 and 100 inclusive, where 100 indicates that a full
+ *     burst may be written and 0 indicates that any write would exceed the
+ *     configured rate.
+ */
+int guac_rate_limit_get_fill(guac_rate_limit* limit);
+
+#endif
+
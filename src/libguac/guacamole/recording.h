@@ -21,6 +21,7 @@
 #define GUAC_RECORDING_H
 
 #include <guacamole/client.h>
+#include <guacamole/writer-types.h>
 
 /**
  * Provides functions and structures to be use for session recording.
@@ -55,12 +56,24 @@
  */
 typedef struct guac_recording {
 
+    /**
+     * The client associated with this recording.
+     */
+    guac_client* client;
+
     /**
      * The guac_socket which writes directly to the recording file, rather than
      * to any particular user.
      */
     guac_socket* socket;
 
+    /**
+     * The guac_writer which queues all data written to the recording socket
+     * and writes that data to the recording file from a background thread.
+     * This writer is owned by the recording socket.
+     */
+    guac_writer* writer;
+
     /**
      * Non-zero if output which is broadcast to each connected client
      * (graphics, streams, etc.) should be included in the session recording,
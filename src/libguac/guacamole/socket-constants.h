@@ -37,6 +37,11 @@
  */
 #define GUAC_SOCKET_KEEP_ALIVE_INTERVAL 5000
 
+/**
+ * The maximum number of rate limits which may apply to a single guac_socket.
+ */
+#define GUAC_SOCKET_MAX_RATE_LIMITS 4
+
 /**
  * The number of bytes of data to buffer prior to bulk conversion to base64.
  */
@@ -27,10 +27,13 @@
  */
 
 #include "client-types.h"
+#include "rate-limit-types.h"
 #include "socket-constants.h"
 #include "socket-fntypes.h"
 #include "socket-types.h"
 #include "timestamp-types.h"
+#include "user-types.h"
+#include "writer-types.h"
 
 #include <pthread.h>
 #include <stdint.h>
@@ -92,6 +95,23 @@ struct guac_socket {
      */
     guac_timestamp last_write_timestamp;
 
+    /**
+     * The total number of bytes which have been written to this guac_socket
+     * since it was allocated.
+     */
+    uint64_t bytes_written;
+
+    /**
+     * The token buckets limiting the rate at which data may be written to
+     * this guac_socket. Each write consumes tokens from all of these limits.
+     */
+    guac_rate_limit* __rate_limits[GUAC_SOCKET_MAX_RATE_LIMITS];
+
+    /**
+     * The number of rate limits within __rate_limits.
+     */
+    int __rate_limit_count;
+
     /**
      * The number of bytes present in the base64 "ready" buffer.
      */
@@ -146,6 +166,49 @@ void guac_socket_free(guac_socket* socket);
  */
 void guac_socket_require_keep_alive(guac_socket* socket);
 
+/**
+ * Limits the rate at which data is written to the given socket using the
+ * given token bucket. All data written to the socket consumes tokens from the
+ * bucket, but writes are never delayed. Producers of data are instead
+ * expected to check the bucket (see guac_socket_get_rate_fill()) and produce
+ * less data, or coalesce their output, while it is empty. The same token
+ * bucket may be shared by several sockets, limiting their combined rate, and
+ * several token buckets may apply to the same socket. The socket acquires its
+ * own reference to the token bucket, which is released when the socket is
+ * freed.
+ *
+ * Rate limits should be added before data is written to the socket by any
+ * other thread.
+ *
+ * @param socket
+ *     The guac_socket to limit.
+ *
+ * @param limit
+ *     The token bucket to apply to all data written to the socket.
+ *
+ * @return
+ *     Zero if the rate limit was added, non-zero if the socket is already
+ *     subject to the maximum number of rate limits.
+ */
+int guac_socket_add_rate_limit(guac_socket* socket, guac_rate_limit* limit);
+
+/**
+ * Returns how much data may currently be written to the given socket without
+ * exceeding its rate limits, as a percentage of the data that the most
+ * restrictive of its rate limits allows in a single burst. Callers producing
+ * data for the socket can use this value to reduce the amount of data
+ * produced, rather than queueing data faster than the limits allow.
+ *
+ * @param socket
+ *     The guac_socket to test.
+ *
+ * @return
+ *     A value between 0 and 100 inclusive, where 0 indicates that any data
+ *     written would exceed a rate limit. If the socket is not rate limited,
+ *     this is always 100.
+ */
+int guac_socket_get_rate_fill(guac_socket* socket);
+
 /**
  * Marks the beginning of a Guacamole protocol instruction.
  *
@@ -233,6 +296,34 @@ guac_socket* guac_socket_nest(guac_socket* parent, int index);
  */
 guac_socket* guac_socket_tee(guac_socket* primary, guac_socket* secondary);
 
+/**
+ * Allocates and initializes a new write-only guac_socket which queues all
+ * data written to it within the given guac_writer, such that the data is
+ * written to storage by a background thread rather than by the thread
+ * writing to the socket. Each instruction is queued as a whole once that
+ * instruction has been written (see guac_socket_instruction_end()). If the
+ * queue of the writer cannot hold an instruction, that entire instruction is
+ * dropped, preserving the validity of the Guacamole protocol data which is
+ * written. If writing to storage fails, nothing further is written, such
+ * that only the final instruction written may be incomplete. Flushing the
+ * socket queues any partially-written data but does
+ * not force that data to be written immediately, leaving the writer to batch
+ * data into whole blocks. Attempts to read from the socket will fail.
+ *
+ * The guac_writer is owned by the returned guac_socket. When the guac_socket
+ * is freed, all queued data is written, the guac_writer is freed, and the
+ * file descriptor of the guac_writer is closed.
+ *
+ * @param writer
+ *     The guac_writer which should queue and write all data written to the
+ *     returned guac_socket.
+ *
+ * @return
+ *     A newly allocated guac_socket object which writes through the given
+ *     guac_writer.
+ */
+guac_socket* guac_socket_open_writer(guac_writer* writer);
+
 /**
  * Allocates and initializes a new guac_socket which duplicates all
  * instructions written across the sockets of each connected user of the
@@ -285,6 +376,66 @@ guac_socket* guac_socket_broadcast(guac_client* client);
  */
 guac_socket* guac_socket_broadcast_pending(guac_client* client);
 
+/**
+ * Allocates and initializes a new guac_socket which duplicates all
+ * instructions written across the sockets of each connected, non-pending
+ * user of the given guac_client which is not lagging (see the "lagging"
+ * member of guac_user). Such a socket allows users which cannot keep up to
+ * be brought up to date separately, at their own pace, without slowing
+ * updates for all other users. Behavior is otherwise identical to
+ * guac_socket_broadcast().
+ *
+ * @param client
+ *     The client associated with the group of connected users across which
+ *     duplicates of all instructions should be written.
+ *
+ * @return
+ *     A write-only guac_socket object which broadcasts copies of all
+ *     instructions written across all non-pending connected users of the given
+ *     guac_client that are not lagging, or NULL if an error occurs while
+ *     allocating the guac_socket object.
+ */
+guac_socket* guac_socket_broadcast_live(guac_client* client);
+
+/**
+ * Sets whether the given user is lagging, and thus whether instructions
+ * written to the given socket are duplicated to that user. The change takes
+ * effect between instructions, never in the middle of an instruction
+ * currently being written to the given socket.
+ *
+ * @param socket
+ *     A socket returned by guac_socket_broadcast_live().
+ *
+ * @param user
+ *     The user to modify.
+ *
+ * @param lagging
+ *     Non-zero if the user is lagging and should no longer receive
+ *     instructions written to the given socket, zero if the user should
+ *     receive those instructions.
+ */
+void guac_socket_broadcast_set_lagging(guac_socket* socket, guac_user* user,
+        int lagging);
+
+/**
+ * Sets the socket which should receive a copy of every instruction written to
+ * the given broadcast socket, regardless of which users are currently
+ * receiving those instructions. This is intended for the socket of a session
+ * recording, which must contain all output even while users are lagging. The
+ * given socket is not freed when the broadcast socket is freed, and must
+ * remain valid until the broadcast socket is freed or this function is
+ * invoked again.
+ *
+ * @param socket
+ *     A socket returned by guac_socket_broadcast_live().
+ *
+ * @param recording
+ *     The socket which should receive a copy of all instructions written to
+ *     the given broadcast socket, or NULL if no such copy should be written.
+ */
+void guac_socket_broadcast_set_recording(guac_socket* socket,
+        guac_socket* recording);
+
 /**
  * Writes the given unsigned int to the given guac_socket object. The data
  * written may be buffered until the buffer is flushed automatically or
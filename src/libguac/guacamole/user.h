@@ -29,6 +29,7 @@
  */
 
 #include "client-types.h"
+#include "congestion-types.h"
 #include "layer-types.h"
 #include "pool-types.h"
 #include "socket-types.h"
@@ -183,6 +184,23 @@ struct guac_user {
      */
     int processing_lag;
 
+    /**
+     * Non-zero if this user is too far behind to receive live updates, or may
+     * not currently receive further data due to its rate limits, and is
+     * instead being brought up to date separately, at its own pace. Lagging
+     * users do not receive instructions written to sockets returned by
+     * guac_socket_broadcast_live(), and are not considered by
+     * guac_client_get_processing_lag(). This must be modified only through
+     * guac_socket_broadcast_set_lagging().
+     */
+    int lagging;
+
+    /**
+     * An estimate of the round-trip time, delivery rate, and queueing delay
+     * of the connection to this user, updated as each frame is acknowledged.
+     */
+    guac_congestion* congestion;
+
     /**
      * Information structure containing properties exposed by the remote
      * user during the initial handshake process.
@@ -635,6 +653,20 @@ void guac_user_free_stream(guac_user* user, guac_stream* stream);
  */
 void guac_user_stop(guac_user* user);
 
+/**
+ * Limits the rate at which data is written to the given user. This limit
+ * applies in addition to any limit on the connection as a whole set with
+ * guac_client_set_rate_limit(). This function should be invoked at most once
+ * for each user, typically from within the join handler.
+ *
+ * @param user
+ *     The user whose outbound data should be limited.
+ *
+ * @param rate
+ *     The number of bytes per second which may be written to the user.
+ */
+void guac_user_set_rate_limit(guac_user* user, int rate);
+
 /**
  * Signals the given user to stop gracefully, while also signalling via the
  * Guacamole protocol that an error has occurred. Note that this is a completely
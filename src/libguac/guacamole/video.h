@@ -0,0 +1,106 @@
+/*
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ * KIND, either express or implied.  See the License for the
+ * specific language governing permissions and limitations
+ * under the License.
+ */
+
+#ifndef __GUAC_VIDEO_H
+#define __GUAC_VIDEO_H
+
+/**
+ * Provides functions for streaming live video, encoded using an inter-frame
+ * video codec, as an alternative to streaming independent images.
+ *
+ * @file video.h
+ */
+
+#include "client-types.h"
+#include "layer-types.h"
+#include "socket-types.h"
+#include "video-types.h"
+
+#include <cairo/cairo.h>
+
+/**
+ * Allocates a new live video stream which plays back within the given layer,
+ * sending the corresponding "video" instruction over the given socket. The
+ * video format used is the first format built into libguac that all users of
+ * the given client support, falling back to the next such format if the
+ * encoder for a format cannot be opened. Each frame written to the stream
+ * must have exactly the dimensions given here.
+ *
+ * If a new user joins the connection after the video stream is created, that
+ * user will not be aware of the existence of the video stream. Callers should
+ * free and reallocate the stream when users join.
+ *
+ * @param client
+ *     The guac_client for which the video stream is being allocated.
+ *
+ * @param socket
+ *     The socket over which the video stream should be sent. This will
+ *     typically be the broadcast socket of the given client.
+ *
+ * @param layer
+ *     The layer within which the video should play back.
+ *
+ * @param width
+ *     The width of each frame of video, in pixels.
+ *
+ * @param height
+ *     The height of each frame of video, in pixels.
+ *
+ * @param framerate
+ *     The nominal framerate of the video, in frames per second. Frames may be
+ *     written less often than this, with each frame timestamped according to
+ *     the time it was written.
+ *
+ * @return
+ *     A newly-allocated guac_video_stream, or NULL if live video streaming is
+ *     not supported or the stream could not be created.
+ */
+guac_video_stream* guac_video_stream_alloc(guac_client* client,
+        guac_socket* socket, const guac_layer* layer, int width, int height,
+        int framerate);
+
+/**
+ * Encodes the given image as the next frame of the given video stream,
+ * sending any resulting video data to all users. The image must be in either
+ * CAIRO_FORMAT_RGB24 or CAIRO_FORMAT_ARGB32 format, with the alpha channel
+ * ignored, and must have the dimensions given when the stream was allocated.
+ *
+ * @param video
+ *     The video stream to write to.
+ *
+ * @param frame
+ *     The image to encode as the next frame of video.
+ *
+ * @return
+ *     Zero if the frame was encoded successfully, non-zero otherwise.
+ */
+int guac_video_stream_write(guac_video_stream* video, cairo_surface_t* frame);
+
+/**
+ * Ends the given video stream, sending any remaining video data and an "end"
+ * instruction, and frees all associated resources. The layer the video was
+ * playing within is not affected.
+ *
+ * @param video
+ *     The video stream to end and free.
+ */
+void guac_video_stream_free(guac_video_stream* video);
+
+#endif
+
@@ -0,0 +1,68 @@
+/*
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ * KIND, either express or implied.  See the License for the
+ * specific language governing permissions and limitations
+ * under the License.
+ */
+
+#ifndef __GUAC_WRITER_CONSTANTS_H
+#define __GUAC_WRITER_CONSTANTS_H
+
+/**
+ * Constants related to writing files in the background.
+ *
+ * @file writer-constants.h
+ */
+
+/**
+ * The size of each block written by a guac_writer, in bytes. Writes are
+ * batched such that each write ends on a multiple of this size relative to
+ * the start of the file, except when the queue is being flushed.
+ */
+#define GUAC_WRITER_BLOCK_SIZE 65536
+
+/**
+ * The default maximum number of bytes which may be queued by a guac_writer
+ * before further writes are dropped.
+ */
+#define GUAC_WRITER_DEFAULT_QUEUE_SIZE 4194304
+
+/**
+ * The maximum number of milliseconds that queued data smaller than a full
+ * block may wait before being written anyway.
+ */
+#define GUAC_WRITER_MAX_DELAY 1000
+
+/**
+ * The maximum number of distinct times at which queued data was queued that
+ * a guac_writer tracks. Data queued once this many times are tracked is
+ * considered to have been queued at the most recent time tracked, such that
+ * it is written no later than GUAC_WRITER_MAX_DELAY after it was queued.
+ */
+#define GUAC_WRITER_MAX_MARKS 16
+
+/**
+ * Sync interval which disables explicit calls to fsync(), leaving the
+ * operating system to decide when written data reaches storage.
+ */
+#define GUAC_WRITER_SYNC_NEVER -1
+
+/**
+ * Sync interval which calls fsync() after every batch of data is written.
+ */
+#define GUAC_WRITER_SYNC_ALWAYS 0
+
+#endif
+
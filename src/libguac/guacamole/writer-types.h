@@ -0,0 +1,42 @@
+/*
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ * KIND, either express or implied.  See the License for the
+ * specific language governing permissions and limitations
+ * under the License.
+ */
+
+#ifndef __GUAC_WRITER_TYPES_H
+#define __GUAC_WRITER_TYPES_H
+
+/**
+ * Type definitions related to writing files in the background.
+ *
+ * @file writer-types.h
+ */
+
+/**
+ * A bounded queue of data which is written to a file descriptor by a
+ * dedicated background thread.
+ */
+typedef struct guac_writer guac_writer;
+
+/**
+ * The time at which data starting at a particular offset was queued within a
+ * guac_writer.
+ */
+typedef struct guac_writer_mark guac_writer_mark;
+
+#endif
+
@@ -0,0 +1,284 @@
+/*
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ * KIND, either express or implied.  See the License for the
+ * specific language governing permissions and limitations
+ * under the License.
+ */
+
+#ifndef __GUAC_WRITER_H
+#define __GUAC_WRITER_H
+
+/**
+ * Provides a writer which queues data in memory and writes that data to a
+ * file descriptor from a dedicated background thread, such that slow
+ * storage never blocks the thread producing the data. The queue is bounded;
+ * if storage falls far enough behind that a write would not fit, that write
+ * is dropped in its entirety and counted, rather than blocking. If writing to
+ * storage fails, the writer stops writing altogether and drops all remaining
+ * data, such that the file is never continued beyond the point of failure.
+ *
+ * @file writer.h
+ */
+
+#include "timestamp-types.h"
+#include "writer-constants.h"
+#include "writer-types.h"
+
+#include <pthread.h>
+#include <stddef.h>
+#include <stdint.h>
+
+struct guac_writer_mark {
+
+    /**
+     * The offset within the file of the first byte queued at this time,
+     * relative to the point at which the writer began writing.
+     */
+    uint64_t offset;
+
+    /**
+     * The time at which the data was queued.
+     */
+    guac_timestamp timestamp;
+
+};
+
+struct guac_writer {
+
+    /**
+     * The file descriptor to which queued data is written. This file
+     * descriptor is not owned by the writer and is not closed when the
+     * writer is freed.
+     */
+    int fd;
+
+    /**
+     * Lock which is acquired whenever the queue or statistics of this writer
+     * are read or modified.
+     */
+    pthread_mutex_t __lock;
+
+    /**
+     * Condition which is signalled when data has been queued or the
+     * background thread has been asked to flush or stop.
+     */
+    pthread_cond_t __queued;
+
+    /**
+     * The background thread which writes queued data to the file
+     * descriptor.
+     */
+    pthread_t __writer_thread;
+
+    /**
+     * Circular buffer of data which has not yet been written.
+     */
+    char* __queue;
+
+    /**
+     * The size of the circular buffer, in bytes.
+     */
+    size_t __queue_size;
+
+    /**
+     * The offset of the oldest queued byte within the circular buffer.
+     */
+    size_t __queue_start;
+
+    /**
+     * The number of bytes currently queued.
+     */
+    size_t __queue_length;
+
+    /**
+     * Non-zero if all queued data should be written as soon as possible,
+     * regardless of block alignment.
+     */
+    int __flush_requested;
+
+    /**
+     * Non-zero if the background thread should write all remaining data and
+     * then stop.
+     */
+    int __stop_requested;
+
+    /**
+     * Non-zero if writing to the file descriptor has failed. Once writing has
+     * failed, nothing further is written and all queued or subsequently
+     * written data is dropped.
+     */
+    int __failed;
+
+
+    /**
+     * The number of milliseconds to allow between calls to fsync() while
+     * unsynced data remains, GUAC_WRITER_SYNC_ALWAYS to call fsync() after
+     * every batch, or GUAC_WRITER_SYNC_NEVER to never call fsync().
+     */
+    int sync_interval;
+
+    /**
+     * The times at which the currently-queued data was queued, oldest first.
+     * The first mark always describes the oldest queued byte, though its
+     * offset may precede that byte if the data queued at that time has been
+     * partially written.
+     */
+    guac_writer_mark __marks[GUAC_WRITER_MAX_MARKS];
+
+    /**
+     * The number of marks within __marks, which is zero if and only if no
+     * data is queued.
+     */
+    int __mark_count;
+
+    /**
+     * The time of the last call to fsync(), or the time the writer was
+     * created if fsync() has not yet been called.
+     */
+    guac_timestamp __last_sync;
+
+    /**
+     * The offset within the file of the next byte to be written, relative to
+     * the point at which this writer began writing.
+     */
+    uint64_t __offset;
+
+    /**
+     * The total number of bytes written to the file descriptor.
+     */
+    uint64_t bytes_written;
+
+    /**
+     * The total number of bytes dropped, either because the queue was full
+     * or because writing to the file descriptor failed. Bytes which were
+     * written before writing failed are not counted.
+     */
+    uint64_t bytes_dropped;
+
+    /**
+     * The total number of calls to guac_writer_write() whose data was
+     * dropped because the queue was full or because writing had already
+     * failed.
+     */
+    uint64_t writes_dropped;
+
+};
+
+/**
+ * Allocates a new guac_writer which writes to the given file descriptor
+ * from a new background thread.
+ *
+ * @param fd
+ *     The file descriptor to write to. This file descriptor is not closed
+ *     when the writer is freed.
+ *
+ * @param queue_size
+ *     The maximum number of bytes which may be queued, such as
+ *     GUAC_WRITER_DEFAULT_QUEUE_SIZE.
+ *
+ * @param sync_interval
+ *     The minimum number of milliseconds between calls to fsync() while
+ *     unsynced data remains, GUAC_WRITER_SYNC_ALWAYS to call fsync() after
+ *     every batch of data written, or GUAC_WRITER_SYNC_NEVER to never call
+ *     fsync().
+ *
+ * @return
+ *     A newly-allocated guac_writer, or NULL if the background thread could
+ *     not be created.
+ */
+guac_writer* guac_writer_alloc(int fd, size_t queue_size, int sync_interval);
+
+/**
+ * Queues the given data for writing. If the data does not fit within the
+ * free space of the queue, or if writing to the file descriptor has already
+ * failed, none of the data is queued and the drop is recorded within the
+ * writer's statistics. This function never waits for
+ * data to be written.
+ *
+ * @param writer
+ *     The guac_writer to queue data within.
+ *
+ * @param buffer
+ *     The data to write.
+ *
+ * @param length
+ *     The number of bytes of data to write.
+ *
+ * @return
+ *     Zero if the data was queued, non-zero if it was dropped.
+ */
+int guac_writer_write(guac_writer* writer, const void* buffer, size_t length);
+
+/**
+ * Returns the number of bytes which may currently be queued without being
+ * dropped. As the background thread only ever frees space, a thread which is
+ * the sole writer may rely on at least this much space remaining available.
+ *
+ * @param writer
+ *     The guac_writer to check.
+ *
+ * @return
+ *     The number of bytes of free space within the queue.
+ */
+size_t guac_writer_available(guac_writer* writer);
+
+/**
+ * Requests that all currently-queued data be written as soon as possible,
+ * even if it does not fill a block. This function does not wait for the
+ * data to be written.
+ *
+ * @param writer
+ *     The guac_writer to flush.
+ */
+void guac_writer_flush(guac_writer* writer);
+
+/**
+ * Returns the total number of bytes dropped by the given writer so far,
+ * whether because its queue was full or because writing to its file
+ * descriptor failed.
+ *
+ * @param writer
+ *     The guac_writer to check.
+ *
+ * @return
+ *     The total number of bytes dropped.
+ */
+uint64_t guac_writer_get_dropped(guac_writer* writer);
+
+/**
+ * Writes all remaining queued data, calling fsync() if required by the sync
+ * interval of the writer, and stops the background thread, waiting for that
+ * thread to finish. Any further writes are dropped. The statistics of the
+ * writer remain available until the writer is freed. Stopping a writer more
+ * than once has no effect.
+ *
+ * @param writer
+ *     The guac_writer to stop.
+ */
+void guac_writer_stop(guac_writer* writer);
+
+/**
+ * Stops the given writer if it has not already been stopped (see
+ * guac_writer_stop()) and frees the writer. The file descriptor of the
+ * writer is not closed. If the provided writer is NULL, this function has no
+ * effect.
+ *
+ * @param writer
+ *     The guac_writer to free.
+ */
+void guac_writer_free(guac_writer* writer);
+
+#endif
+
@@ -0,0 +1,370 @@
+/*
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ * KIND, either express or implied.  See the License for the
+ * specific language governing permissions and limitations
+ * under the License.
+ */
+
+#include "config.h"
+
+#include "guacamole/error.h"
+#include "guacamole/mem.h"
+#include "guacamole/private/mem.h"
+
+#include <stddef.h>
+#include <stdlib.h>
+
+#ifdef HAVE_LIBPTHREAD
+#include <pthread.h>
+#endif
+
+/**
+ * The alignment of every block returned by guac_mem_arena_alloc(), in bytes.
+ * This is sufficient for any of the primitive types stored in the temporary
+ * image and scanline buffers the arena exists to serve.
+ */
+#define GUAC_MEM_ARENA_ALIGNMENT 16
+
+/**
+ * The minimum size of each chunk of memory requested by an arena from the
+ * system allocator, in bytes.
+ */
+#define GUAC_MEM_ARENA_CHUNK_SIZE 262144
+
+/**
+ * The maximum amount of memory that an arena will keep allocated across
+ * calls to guac_mem_arena_reset(), in bytes. Arenas which grew beyond this
+ * size during a frame (a full-screen update of a very large display, for
+ * example) return their memory to the system allocator when reset.
+ */
+#define GUAC_MEM_ARENA_MAX_RETAINED 67108864
+
+/**
+ * Rounds the given size up to the nearest multiple of
+ * GUAC_MEM_ARENA_ALIGNMENT.
+ */
+#define GUAC_MEM_ARENA_ALIGN(size) \
+    (((size) + GUAC_MEM_ARENA_ALIGNMENT - 1) & ~((size_t) GUAC_MEM_ARENA_ALIGNMENT - 1))
+
+/**
+ * A single contiguous chunk of memory from which arena allocations are
+ * carved. The memory available for allocation immediately follows this
+ * structure, beginning at an offset of GUAC_MEM_ARENA_CHUNK_HEADER_SIZE.
+ */
+typedef struct guac_mem_arena_chunk {
+
+    /**
+     * The chunk that was current before this chunk was allocated, or NULL if
+     * this is the first chunk of its arena.
+     */
+    struct guac_mem_arena_chunk* next;
+
+    /**
+     * The number of bytes available for allocation within this chunk.
+     */
+    size_t size;
+
+    /**
+     * The number of bytes within this chunk that have already been
+     * allocated, including the headers of each allocation.
+     */
+    size_t used;
+
+    /**
+     * The most recent allocation within this chunk that has not yet been
+     * freed, or NULL if no such allocation exists. Only this allocation can be
+     * returned to the chunk by guac_mem_arena_free().
+     */
+    unsigned char* top;
+
+} guac_mem_arena_chunk;
+
+/**
+ * The state of a chunk prior to a particular allocation, stored immediately
+ * before that allocation such that freeing allocations in the reverse order
+ * of their allocation rewinds the chunk completely.
+ */
+typedef struct guac_mem_arena_header {
+
+    /**
+     * The value of the "used" member of the containing chunk prior to the
+     * allocation.
+     */
+    size_t used;
+
+    /**
+     * The value of the "top" member of the containing chunk prior to the
+     * allocation.
+     */
+    unsigned char* top;
+
+} guac_mem_arena_header;
+
+/**
+ * The number of bytes reserved at the beginning of each chunk for the
+ * guac_mem_arena_chunk structure.
+ */
+#define GUAC_MEM_ARENA_CHUNK_HEADER_SIZE \
+    GUAC_MEM_ARENA_ALIGN(sizeof(guac_mem_arena_chunk))
+
+/**
+ * The number of bytes reserved before each allocation for the
+ * guac_mem_arena_header structure.
+ */
+#define GUAC_MEM_ARENA_HEADER_SIZE \
+    GUAC_MEM_ARENA_ALIGN(sizeof(guac_mem_arena_header))
+
+/**
+ * The temporary allocation arena of a single thread.
+ */
+typedef struct guac_mem_arena {
+
+    /**
+     * The chunk from which new allocations are currently being made, or NULL
+     * if no chunk has yet been allocated since the arena was last reset.
+     */
+    guac_mem_arena_chunk* current;
+
+    /**
+     * The total number of bytes available for allocation across all chunks
+     * of this arena.
+     */
+    size_t total;
+
+    /**
+     * The minimum size of the next chunk allocated for this arena, in bytes.
+     * This is set when an arena consisting of several chunks is reset, such
+     * that the following frame can be served by a single chunk.
+     */
+    size_t reserve;
+
+} guac_mem_arena;
+
+/**
+ * Frees all chunks of the given arena, leaving the arena empty.
+ *
+ * @param arena
+ *     The arena whose chunks should be freed.
+ */
+static void guac_mem_arena_free_chunks(guac_mem_arena* arena) {
+
+    guac_mem_arena_chunk* chunk = arena->current;
+    while (chunk != NULL) {
+        guac_mem_arena_chunk* next = chunk->next;
+        PRIV_guac_mem_free(chunk);
+        chunk = next;
+    }
+
+    arena->current = NULL;
+    arena->total = 0;
+
+}
+
+/**
+ * Frees the given arena and all of its chunks. This function is invoked
+ * automatically when the thread that owns the arena exits.
+ *
+ * @param data
+ *     The guac_mem_arena to free.
+ */
+static void guac_mem_arena_destroy(void* data) {
+
+    guac_mem_arena* arena = (guac_mem_arena*) data;
+
+    guac_mem_arena_free_chunks(arena);
+    guac_mem_free(arena);
+
+}
+
+#ifdef HAVE_LIBPTHREAD
+
+/**
+ * Key under which the guac_mem_arena of the current thread is stored.
+ */
+static pthread_key_t guac_mem_arena_key;
+
+/**
+ * Guard ensuring guac_mem_arena_key is created only once.
+ */
+static pthread_once_t guac_mem_arena_key_init = PTHREAD_ONCE_INIT;
+
+/**
+ * Creates the key under which each thread's guac_mem_arena is stored, freeing
+ * that arena automatically when its thread exits.
+ */
+static void guac_mem_arena_alloc_key() {
+    pthread_key_create(&guac_mem_arena_key, guac_mem_arena_destroy);
+}
+
+/**
+ * Returns the guac_mem_arena of the current thread, if any.
+ *
+ * @return
+ *     The guac_mem_arena of the current thread, or NULL if this thread has
+ *     not yet allocated any memory from an arena.
+ */
+static guac_mem_arena* guac_mem_arena_get() {
+
+    pthread_once(&guac_mem_arena_key_init, guac_mem_arena_alloc_key);
+    return (guac_mem_arena*) pthread_getspecific(guac_mem_arena_key);
+
+}
+
+/**
+ * Associates the given arena with the current thread.
+ *
+ * @param arena
+ *     The arena to associate with the current thread.
+ */
+static void guac_mem_arena_set(guac_mem_arena* arena) {
+    pthread_setspecific(guac_mem_arena_key, arena);
+}
+
+#else
+
+/* Default (not-threadsafe) implementation */
+static guac_mem_arena* guac_mem_arena_unsafe_storage;
+
+static guac_mem_arena* guac_mem_arena_get() {
+    return guac_mem_arena_unsafe_storage;
+}
+
+static void guac_mem_arena_set(guac_mem_arena* arena) {
+    guac_mem_arena_unsafe_storage = arena;
+}
+
+#endif
+
+void* PRIV_guac_mem_arena_alloc(size_t factor_count, const size_t* factors) {
+
+    size_t size = 0;
+
+    if (PRIV_guac_mem_ckd_mul(&size, factor_count, factors)) {
+        guac_error = GUAC_STATUS_NO_MEMORY;
+        return NULL;
+    }
+    else if (size == 0)
+        return NULL;
+
+    /* Fail if padding the allocation, or allocating a chunk dedicated to it,
+     * would exceed SIZE_MAX */
+    size_t padded;
+    if (guac_mem_ckd_add(&padded, size, GUAC_MEM_ARENA_ALIGNMENT - 1,
+                GUAC_MEM_ARENA_HEADER_SIZE, GUAC_MEM_ARENA_CHUNK_HEADER_SIZE)) {
+        guac_error = GUAC_STATUS_NO_MEMORY;
+        return NULL;
+    }
+
+    /* Each allocation is preceded by the state needed to free it, with both
+     * padded to maintain alignment */
+    size_t needed = GUAC_MEM_ARENA_ALIGN(size) + GUAC_MEM_ARENA_HEADER_SIZE;
+
+    /* Allocate this thread's arena upon first use */
+    guac_mem_arena* arena = guac_mem_arena_get();
+    if (arena == NULL) {
+
+        arena = guac_mem_zalloc(sizeof(guac_mem_arena));
+        if (arena == NULL)
+            return NULL;
+
+        guac_mem_arena_set(arena);
+
+    }
+
+    /* Start a new chunk if the current chunk cannot fit this allocation. Any
+     * previous chunk is retained, as it may still contain live allocations. */
+    guac_mem_arena_chunk* chunk = arena->current;
+    if (chunk == NULL || chunk->size - chunk->used < needed) {
+
+        size_t chunk_size = GUAC_MEM_ARENA_CHUNK_SIZE;
+        if (chunk_size < arena->reserve)
+            chunk_size = arena->reserve;
+        if (chunk_size < needed)
+            chunk_size = needed;
+
+        chunk = guac_mem_alloc(GUAC_MEM_ARENA_CHUNK_HEADER_SIZE + chunk_size);
+        if (chunk == NULL)
+            return NULL;
+
+        chunk->next = arena->current;
+        chunk->size = chunk_size;
+        chunk->used = 0;
+        chunk->top = NULL;
+
+        arena->current = chunk;
+        arena->total += chunk_size;
+
+    }
+
+    unsigned char* data = (unsigned char*) chunk
+        + GUAC_MEM_ARENA_CHUNK_HEADER_SIZE + chunk->used;
+
+    /* Record the state required to rewind this allocation */
+    guac_mem_arena_header* header = (guac_mem_arena_header*) data;
+    header->used = chunk->used;
+    header->top = chunk->top;
+
+    chunk->top = data + GUAC_MEM_ARENA_HEADER_SIZE;
+    chunk->used += needed;
+
+    return chunk->top;
+
+}
+
+void PRIV_guac_mem_arena_free(void* mem) {
+
+    if (mem == NULL)
+        return;
+
+    guac_mem_arena* arena = guac_mem_arena_get();
+    if (arena == NULL)
+        return;
+
+    /* Rewind the current chunk only if the given block is the most recent
+     * allocation. All other blocks are reclaimed when the arena is reset. */
+    guac_mem_arena_chunk* chunk = arena->current;
+    if (chunk != NULL && chunk->top == mem) {
+        guac_mem_arena_header* header = (guac_mem_arena_header*)
+            ((unsigned char*) mem - GUAC_MEM_ARENA_HEADER_SIZE);
+        chunk->used = header->used;
+        chunk->top = header->top;
+    }
+
+}
+
+void guac_mem_arena_reset() {
+
+    guac_mem_arena* arena = guac_mem_arena_get();
+    if (arena == NULL || arena->current == NULL)
+        return;
+
+    guac_mem_arena_chunk* chunk = arena->current;
+
+    /* Reuse a sole chunk as-is, provided it is not unreasonably large */
+    if (chunk->next == NULL && chunk->size <= GUAC_MEM_ARENA_MAX_RETAINED) {
+        chunk->used = 0;
+        chunk->top = NULL;
+        return;
+    }
+
+    /* Otherwise, replace all chunks with a single chunk large enough to
+     * satisfy an identical frame, allocated upon next use */
+    arena->reserve = arena->total;
+    if (arena->reserve > GUAC_MEM_ARENA_MAX_RETAINED)
+        arena->reserve = GUAC_MEM_ARENA_MAX_RETAINED;
+
+    guac_mem_arena_free_chunks(arena);
+
+}
@@ -0,0 +1,179 @@
+/*
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ * KIND, either express or implied.  See the License for the
+ * specific language governing permissions and limitations
+ * under the License.
+ */
+
+#include "config.h"
+
+#include "guacamole/mem.h"
+#include "guacamole/rate-limit.h"
+#include "guacamole/timestamp.h"
+
+#include <pthread.h>
+#include <stddef.h>
+#include <stdint.h>
+
+/**
+ * Returns the number of tokens held by the given token bucket when full.
+ *
+ * @param rate
+ *     The rate of the token bucket, in bytes per second.
+ *
+ * @return
+ *     The capacity of a token bucket having the given rate, in bytes.
+ */
+static int64_t guac_rate_limit_capacity(int rate) {
+    return (int64_t) rate * GUAC_RATE_LIMIT_BURST / 1000;
+}
+
+/**
+ * Adds any tokens accumulated since the last refill to the given token
+ * bucket, up to its capacity. The bucket must be locked.
+ *
+ * @param limit
+ *     The guac_rate_limit to refill.
+ */
+static void guac_rate_limit_refill(guac_rate_limit* limit) {
+
+    guac_timestamp now = guac_timestamp_current();
+    guac_timestamp elapsed = now - limit->__last_refill;
+    if (elapsed <= 0)
+        return;
+
+    /* Leave partial tokens to accumulate until the next refill */
+    int64_t added = (int64_t) limit->rate * elapsed / 1000;
+    if (added <= 0)
+        return;
+
+    limit->__tokens += added;
+    limit->__last_refill = now;
+
+    int64_t capacity = guac_rate_limit_capacity(limit->rate);
+    if (limit->__tokens > capacity)
+        limit->__tokens = capacity;
+
+}
+
+guac_rate_limit* guac_rate_limit_alloc(int rate) {
+
+    guac_rate_limit* limit = guac_mem_zalloc(sizeof(guac_rate_limit));
+
+    pthread_mutex_init(&(limit->__lock), NULL);
+    limit->__refcount = 1;
+    limit->rate = rate;
+    limit->__tokens = guac_rate_limit_capacity(rate);
+    limit->__last_refill = guac_timestamp_current();
+
+    return limit;
+
+}
+
+guac_rate_limit* guac_rate_limit_retain(guac_rate_limit* limit) {
+
+    pthread_mutex_lock(&(limit->__lock));
+    limit->__refcount++;
+    pthread_mutex_unlock(&(limit->__lock));
+
+    return limit;
+
+}
+
+void guac_rate_limit_free(guac_rate_limit* limit) {
+
+    pthread_mutex_lock(&(limit->__lock));
+    int refcount = --limit->__refcount;
+    pthread_mutex_unlock(&(limit->__lock));
+
+    if (refcount > 0)
+        return;
+
+    pthread_mutex_destroy(&(limit->__lock));
+    guac_mem_free(limit);
+
+}
+
+void guac_rate_limit_set_rate(guac_rate_limit* limit, int rate) {
+
+    pthread_mutex_lock(&(limit->__lock));
+
+    /* Account for tokens accumulated at the old rate */
+    guac_rate_limit_refill(limit);
+    limit->rate = rate;
+
+    int64_t capacity = guac_rate_limit_capacity(rate);
+    if (limit->__tokens > capacity)
+        limit->__tokens = capacity;
+
+    pthread_mutex_unlock(&(limit->__lock));
+
+}
+
+int guac_rate_limit_consume(guac_rate_limit* limit, size_t length) {
+
+    int delay = 0;
+
+    pthread_mutex_lock(&(limit->__lock));
+
+    guac_rate_limit_refill(limit);
+    limit->__tokens -= length;
+
+    /* Delay until the deficit would have been refilled */
+    if (limit->__tokens < 0 && limit->rate > 0)
+        delay = (-limit->__tokens * 1000 + limit->rate - 1) / limit->rate;
+
+    pthread_mutex_unlock(&(limit->__lock));
+
+    return delay;
+
+}
+
+int guac_rate_limit_get_available(guac_rate_limit* limit) {
+
+    pthread_mutex_lock(&(limit->__lock));
+
+    guac_rate_limit_refill(limit);
+    int64_t available = limit->__tokens;
+
+    pthread_mutex_unlock(&(limit->__lock));
+
+    if (available > INT32_MAX)
+        return INT32_MAX;
+
+    if (available < INT32_MIN)
+        return INT32_MIN;
+
+    return available;
+
+}
+
+int guac_rate_limit_get_fill(guac_rate_limit* limit) {
+
+    pthread_mutex_lock(&(limit->__lock));
+
+    guac_rate_limit_refill(limit);
+    int64_t available = limit->__tokens;
+    int64_t capacity = guac_rate_limit_capacity(limit->rate);
+
+    pthread_mutex_unlock(&(limit->__lock));
+
+    if (available <= 0 || capacity <= 0)
+        return 0;
+
+    return available * 100 / capacity;
+
+}
+
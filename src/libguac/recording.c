@@ -23,6 +23,7 @@
 #include "guacamole/recording.h"
 #include "guacamole/socket.h"
 #include "guacamole/timestamp.h"
+#include "guacamole/writer.h"
 
 #ifdef __MINGW32__
 #include <direct.h>
@@ -32,6 +33,7 @@
 #include <sys/types.h>
 #include <errno.h>
 #include <fcntl.h>
+#include <inttypes.h>
 #include <stdlib.h>
 #include <stdio.h>
 #include <string.h>
@@ -169,9 +171,23 @@ guac_recording* guac_recording_create(guac_client* client,
         return NULL;
     }
 
+    /* Queue writes to the recording file such that slow storage does not
+     * block the connection */
+    guac_writer* writer = guac_writer_alloc(fd,
+            GUAC_WRITER_DEFAULT_QUEUE_SIZE, GUAC_WRITER_SYNC_NEVER);
+    if (writer == NULL) {
+        guac_client_log(client, GUAC_LOG_ERROR,
+                "Creation of recording failed: Unable to start writer "
+                "thread.");
+        close(fd);
+        return NULL;
+    }
+
     /* Create recording structure with reference to underlying socket */
     guac_recording* recording = guac_mem_alloc(sizeof(guac_recording));
-    recording->socket = guac_socket_open(fd);
+    recording->client = client;
+    recording->writer = writer;
+    recording->socket = guac_socket_open_writer(writer);
     recording->include_output = include_output;
     recording->include_mouse = include_mouse;
     recording->include_touch = include_touch;
@@ -193,6 +209,22 @@ guac_recording* guac_recording_create(guac_client* client,
 
 void guac_recording_free(guac_recording* recording) {
 
+    /* If not including broadcast output, the output socket is not associated
+     * with the client and can be fully written now, such that any final
+     * drops are included in the count below */
+    if (!recording->include_output) {
+        guac_socket_flush(recording->socket);
+        guac_writer_stop(recording->writer);
+    }
+
+    /* Warn if any part of the recording could not be written */
+    uint64_t dropped = guac_writer_get_dropped(recording->writer);
+    if (dropped > 0)
+        guac_client_log(recording->client, GUAC_LOG_WARNING, "%" PRIu64
+                " bytes of session recording data were dropped because "
+                "the recording could not be written quickly enough.",
+                dropped);
+
     /* If not including broadcast output, the output socket is not associated
      * with the client, and must be freed manually */
     if (!recording->include_output)
@@ -68,6 +68,13 @@ typedef struct guac_socket_broadcast_data {
      */
     guac_socket_broadcast_handler* broadcast_handler;
 
+    /**
+     * The socket which receives a copy of all data written, regardless of
+     * which users receive that data, or NULL if there is no such socket. This
+     * socket is not owned by the broadcast socket.
+     */
+    guac_socket* recording;
+
 } guac_socket_broadcast_data;
 
 /**
@@ -172,6 +179,10 @@ static ssize_t __guac_socket_broadcast_write_handler(guac_socket* socket,
     /* Broadcast chunk to the users */
     data->broadcast_handler(data->client, __write_chunk_callback, &chunk);
 
+    /* Copy chunk to any recording */
+    if (data->recording != NULL)
+        guac_socket_write(data->recording, buf, count);
+
     return count;
 
 }
@@ -221,6 +232,10 @@ static ssize_t __guac_socket_broadcast_flush_handler(guac_socket* socket) {
     /* Flush the users */
     data->broadcast_handler(data->client, __flush_callback, NULL);
 
+    /* Flush any recording */
+    if (data->recording != NULL)
+        guac_socket_flush(data->recording);
+
     return 0;
 
 }
@@ -269,6 +284,10 @@ static void __guac_socket_broadcast_lock_handler(guac_socket* socket) {
     /* Lock sockets of the users */
     data->broadcast_handler(data->client, __lock_callback, NULL);
 
+    /* Lock any recording */
+    if (data->recording != NULL)
+        guac_socket_instruction_begin(data->recording);
+
 }
 
 /**
@@ -307,6 +326,10 @@ static void __guac_socket_broadcast_unlock_handler(guac_socket* socket) {
     guac_socket_broadcast_data* data =
         (guac_socket_broadcast_data*) socket->data;
 
+    /* Unlock any recording */
+    if (data->recording != NULL)
+        guac_socket_instruction_end(data->recording);
+
     /* Unlock sockets of all users */
     data->broadcast_handler(data->client, __unlock_callback, NULL);
 
@@ -366,6 +389,74 @@ static int __guac_socket_broadcast_free_handler(guac_socket* socket) {
 
 }
 
+/**
+ * The user callback and associated data which should be invoked only for
+ * users that are not lagging.
+ */
+typedef struct __live_user_callback {
+
+    /**
+     * The callback to invoke for each user that is not lagging.
+     */
+    guac_user_callback* callback;
+
+    /**
+     * The arbitrary data to pass to the callback.
+     */
+    void* data;
+
+} __live_user_callback;
+
+/**
+ * Callback which invokes the callback within the given __live_user_callback
+ * for the given user, unless that user is lagging.
+ *
+ * @param user
+ *     The user to invoke the callback for.
+ *
+ * @param data
+ *     The __live_user_callback describing the callback to invoke.
+ *
+ * @return
+ *     The value returned by the callback, or NULL if the user is lagging.
+ */
+static void* __live_user_filter(guac_user* user, void* data) {
+
+    __live_user_callback* live_callback = (__live_user_callback*) data;
+
+    /* Skip users which are receiving updates at their own pace */
+    if (user->lagging)
+        return NULL;
+
+    return live_callback->callback(user, live_callback->data);
+
+}
+
+/**
+ * Broadcast handler which invokes the given callback for all connected,
+ * non-pending users of the given client which are not lagging.
+ *
+ * @param client
+ *     The client whose users should be iterated.
+ *
+ * @param callback
+ *     The callback to invoke for each user that is not lagging.
+ *
+ * @param data
+ *     Arbitrary data to pass to the callback.
+ */
+static void __guac_client_foreach_live_user(guac_client* client,
+        guac_user_callback* callback, void* data) {
+
+    __live_user_callback live_callback = {
+        .callback = callback,
+        .data = data
+    };
+
+    guac_client_foreach_user(client, __live_user_filter, &live_callback);
+
+}
+
 /**
  * Construct and return a socket that will broadcast to the users given by
  * by the provided broadcast handler.
@@ -392,6 +483,7 @@ static guac_socket* __guac_socket_init(
 
     /* Set the provided broadcast handler */
     data->broadcast_handler = broadcast_handler;
+    data->recording = NULL;
 
     /* Store client as socket data */
     data->client = client;
@@ -430,3 +522,37 @@ guac_socket* guac_socket_broadcast_pending(guac_client* client) {
 
 }
 
+guac_socket* guac_socket_broadcast_live(guac_client* client) {
+
+    /* Broadcast to all connected non-pending users which are not lagging */
+    return __guac_socket_init(client, __guac_client_foreach_live_user);
+
+}
+
+void guac_socket_broadcast_set_lagging(guac_socket* socket, guac_user* user,
+        int lagging) {
+
+    guac_socket_broadcast_data* data =
+        (guac_socket_broadcast_data*) socket->data;
+
+    /* Users must not be added to or removed from the broadcast in the middle
+     * of an instruction, as each user locked at the start of an instruction
+     * must be unlocked at its end */
+    pthread_mutex_lock(&(data->socket_lock));
+    user->lagging = lagging;
+    pthread_mutex_unlock(&(data->socket_lock));
+
+}
+
+void guac_socket_broadcast_set_recording(guac_socket* socket,
+        guac_socket* recording) {
+
+    guac_socket_broadcast_data* data =
+        (guac_socket_broadcast_data*) socket->data;
+
+    /* Change recording only between instructions */
+    pthread_mutex_lock(&(data->socket_lock));
+    data->recording = recording;
+    pthread_mutex_unlock(&(data->socket_lock));
+
+}
@@ -0,0 +1,200 @@
+/*
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ * KIND, either express or implied.  See the License for the
+ * specific language governing permissions and limitations
+ * under the License.
+ */
+
+#include "config.h"
+
+#include "guacamole/mem.h"
+#include "guacamole/socket.h"
+#include "guacamole/writer.h"
+
+#include <pthread.h>
+#include <stddef.h>
+#include <string.h>
+#include <unistd.h>
+
+/**
+ * Data specific to a guac_socket which writes through a guac_writer.
+ */
+typedef struct guac_socket_writer_data {
+
+    /**
+     * The guac_writer which queues and writes all data written to the
+     * socket.
+     */
+    guac_writer* writer;
+
+    /**
+     * Lock which is acquired when an instruction is being written, and
+     * released when the instruction is finished being written.
+     */
+    pthread_mutex_t socket_lock;
+
+    /**
+     * Lock which protects access to the instruction buffer.
+     */
+    pthread_mutex_t buffer_lock;
+
+    /**
+     * Buffer of data which has been written but not yet queued within the
+     * guac_writer, typically the partially-written current instruction.
+     */
+    char* buffer;
+
+    /**
+     * The number of bytes currently stored within the buffer.
+     */
+    size_t length;
+
+    /**
+     * The number of bytes allocated for the buffer.
+     */
+    size_t size;
+
+} guac_socket_writer_data;
+
+/**
+ * Queues all buffered data within the guac_writer of the given socket as a
+ * single write, such that the data is either written or dropped as a whole.
+ *
+ * @param data
+ *     The data of the guac_socket whose buffered data should be queued.
+ */
+static void guac_socket_writer_commit(guac_socket_writer_data* data) {
+
+    pthread_mutex_lock(&(data->buffer_lock));
+
+    if (data->length > 0) {
+        guac_writer_write(data->writer, data->buffer, data->length);
+        data->length = 0;
+    }
+
+    pthread_mutex_unlock(&(data->buffer_lock));
+
+}
+
+static ssize_t guac_socket_writer_write_handler(guac_socket* socket,
+        const void* buf, size_t count) {
+
+    guac_socket_writer_data* data = (guac_socket_writer_data*) socket->data;
+
+    pthread_mutex_lock(&(data->buffer_lock));
+
+    /* Expand buffer as necessary to hold the entire instruction */
+    if (data->length + count > data->size) {
+
+        size_t size = data->size * 2;
+        while (size < data->length + count)
+            size *= 2;
+
+        data->buffer = guac_mem_realloc_or_die(data->buffer, size);
+        data->size = size;
+
+    }
+
+    memcpy(data->buffer + data->length, buf, count);
+    data->length += count;
+
+    pthread_mutex_unlock(&(data->buffer_lock));
+
+    return count;
+
+}
+
+static ssize_t guac_socket_writer_flush_handler(guac_socket* socket) {
+
+    guac_socket_writer_data* data = (guac_socket_writer_data*) socket->data;
+
+    /* Queue any data written outside of an instruction. Queued data is
+     * written by the writer in whole blocks, or once it has waited for too
+     * long, rather than with each flush, as recordings are flushed with
+     * every frame. */
+    guac_socket_writer_commit(data);
+
+    return 0;
+
+}
+
+static void guac_socket_writer_lock_handler(guac_socket* socket) {
+
+    guac_socket_writer_data* data = (guac_socket_writer_data*) socket->data;
+
+    /* Acquire exclusive access to socket */
+    pthread_mutex_lock(&(data->socket_lock));
+
+}
+
+static void guac_socket_writer_unlock_handler(guac_socket* socket) {
+
+    guac_socket_writer_data* data = (guac_socket_writer_data*) socket->data;
+
+    /* Queue the now-complete instruction */
+    guac_socket_writer_commit(data);
+
+    /* Relinquish exclusive access to socket */
+    pthread_mutex_unlock(&(data->socket_lock));
+
+}
+
+static int guac_socket_writer_free_handler(guac_socket* socket) {
+
+    guac_socket_writer_data* data = (guac_socket_writer_data*) socket->data;
+
+    /* Write everything remaining before closing the file */
+    guac_socket_writer_commit(data);
+
+    int fd = data->writer->fd;
+    guac_writer_free(data->writer);
+    close(fd);
+
+    pthread_mutex_destroy(&(data->socket_lock));
+    pthread_mutex_destroy(&(data->buffer_lock));
+
+    guac_mem_free(data->buffer);
+    guac_mem_free(data);
+    return 0;
+
+}
+
+guac_socket* guac_socket_open_writer(guac_writer* writer) {
+
+    guac_socket_writer_data* data =
+        guac_mem_alloc(sizeof(guac_socket_writer_data));
+
+    data->writer = writer;
+    data->size = GUAC_SOCKET_OUTPUT_BUFFER_SIZE;
+    data->buffer = guac_mem_alloc(data->size);
+    data->length = 0;
+
+    pthread_mutex_init(&(data->socket_lock), NULL);
+    pthread_mutex_init(&(data->buffer_lock), NULL);
+
+    guac_socket* socket = guac_socket_alloc();
+    socket->data = data;
+
+    /* Assign handlers */
+    socket->write_handler  = guac_socket_writer_write_handler;
+    socket->flush_handler  = guac_socket_writer_flush_handler;
+    socket->lock_handler   = guac_socket_writer_lock_handler;
+    socket->unlock_handler = guac_socket_writer_unlock_handler;
+    socket->free_handler   = guac_socket_writer_free_handler;
+
+    return socket;
+
+}
+
@@ -22,6 +22,7 @@
 #include "guacamole/mem.h"
 #include "guacamole/error.h"
 #include "guacamole/protocol.h"
+#include "guacamole/rate-limit.h"
 #include "guacamole/socket.h"
 #include "guacamole/timestamp.h"
 
@@ -83,14 +84,26 @@ static void* __guac_socket_keep_alive_thread(void* data) {
 static ssize_t __guac_socket_write(guac_socket* socket,
         const void* buf, size_t count) {
 
+    /* Account for data written against all rate limits. Writes are never
+     * delayed here, as the socket may be written while locks shared with
+     * other users are held. Producers instead check how much may be written
+     * (see guac_socket_get_rate_fill()) and coalesce their output. */
+    for (int i = 0; i < socket->__rate_limit_count; i++)
+        guac_rate_limit_consume(socket->__rate_limits[i], count);
+
     /* Update timestamp of last write */
     socket->last_write_timestamp = guac_timestamp_current();
 
     /* If handler defined, call it. */
-    if (socket->write_handler)
-        return socket->write_handler(socket, buf, count);
+    if (socket->write_handler) {
+        ssize_t written = socket->write_handler(socket, buf, count);
+        if (written > 0)
+            socket->bytes_written += written;
+        return written;
+    }
 
     /* Otherwise, pretend everything was written. */
+    socket->bytes_written += count;
     return count;
 
 }
@@ -155,6 +168,10 @@ guac_socket* guac_socket_alloc() {
     socket->data = NULL;
     socket->state = GUAC_SOCKET_OPEN;
     socket->last_write_timestamp = guac_timestamp_current();
+    socket->bytes_written = 0;
+
+    /* No rate limits by default */
+    socket->__rate_limit_count = 0;
 
     /* No keep alive ping by default */
     socket->__keep_alive_enabled = 0;
@@ -214,9 +231,42 @@ void guac_socket_free(guac_socket* socket) {
         pthread_join(socket->__keep_alive_thread, NULL);
     }
 
+    /* Release all rate limits */
+    for (int i = 0; i < socket->__rate_limit_count; i++)
+        guac_rate_limit_free(socket->__rate_limits[i]);
+
     guac_mem_free(socket);
 }
 
+int guac_socket_add_rate_limit(guac_socket* socket, guac_rate_limit* limit) {
+
+    if (socket->__rate_limit_count == GUAC_SOCKET_MAX_RATE_LIMITS)
+        return 1;
+
+    socket->__rate_limits[socket->__rate_limit_count] =
+        guac_rate_limit_retain(limit);
+
+    /* Only apply the limit once it has been stored */
+    socket->__rate_limit_count++;
+    return 0;
+
+}
+
+int guac_socket_get_rate_fill(guac_socket* socket) {
+
+    int fill = 100;
+
+    /* The most restrictive limit determines how much may be written */
+    for (int i = 0; i < socket->__rate_limit_count; i++) {
+        int limit_fill = guac_rate_limit_get_fill(socket->__rate_limits[i]);
+        if (limit_fill < fill)
+            fill = limit_fill;
+    }
+
+    return fill;
+
+}
+
 ssize_t guac_socket_write_int(guac_socket* socket, int64_t i) {
 
     char buffer[128];
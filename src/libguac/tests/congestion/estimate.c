@@ -0,0 +1,251 @@
+/*
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ * KIND, either express or implied.  See the License for the
+ * specific language governing permissions and limitations
+ * under the License.
+ */
+
+#include <CUnit/CUnit.h>
+#include <guacamole/congestion.h>
+
+#include <limits.h>
+#include <stdint.h>
+
+/**
+ * The size of each frame sent within the tests below, in bytes.
+ */
+#define FRAME_SIZE 10000
+
+/**
+ * The interval between each frame sent within the tests below, in
+ * milliseconds.
+ */
+#define FRAME_INTERVAL 50
+
+/**
+ * Test which verifies that the round-trip time and delivery rate are derived
+ * from the bytes sent within each acknowledged frame, and that a connection
+ * without queueing delay retains the highest quality and the minimum frame
+ * duration.
+ */
+void test_congestion__delivery_rate() {
+
+    guac_congestion* congestion = guac_congestion_alloc();
+    CU_ASSERT_PTR_NOT_NULL_FATAL(congestion);
+
+    /* Nothing is known before any frame is acknowledged */
+    CU_ASSERT_EQUAL(guac_congestion_get_frame_budget(congestion, 100), 0);
+    CU_ASSERT_EQUAL(guac_congestion_suggest_frame_duration(congestion, 60), 60);
+
+    /* Send frames at a steady rate, each acknowledged after 20 ms */
+    uint64_t bytes = 0;
+    for (int i = 1; i <= 20; i++) {
+        guac_timestamp sent = 1000 + i * FRAME_INTERVAL;
+        bytes += FRAME_SIZE;
+        guac_congestion_frame_sent(congestion, sent, bytes);
+        guac_congestion_frame_acknowledged(congestion, sent, sent + 20);
+    }
+
+    CU_ASSERT_EQUAL(congestion->smoothed_rtt, 20);
+    CU_ASSERT_EQUAL(congestion->min_rtt, 20);
+    CU_ASSERT_EQUAL(congestion->queue_delay, 0);
+    CU_ASSERT_EQUAL(congestion->frame_size, FRAME_SIZE);
+    CU_ASSERT_EQUAL(congestion->delivery_rate,
+            FRAME_SIZE * 1000 / FRAME_INTERVAL);
+
+    /* Twice the frame interval allows twice the frame size, plus headroom
+     * for probing */
+    CU_ASSERT_EQUAL(guac_congestion_get_frame_budget(congestion,
+                FRAME_INTERVAL * 2),
+            FRAME_SIZE * 2 * GUAC_CONGESTION_RATE_PROBE_GAIN / 100);
+
+    CU_ASSERT_EQUAL(guac_congestion_suggest_quality(congestion),
+            GUAC_CONGESTION_MAX_QUALITY);
+    CU_ASSERT_EQUAL(guac_congestion_suggest_frame_duration(congestion, 60), 60);
+
+    guac_congestion_free(congestion);
+
+}
+
+/**
+ * Test which verifies that growing round-trip times are detected as queueing
+ * delay, lowering the suggested quality no more than once per round trip and
+ * lengthening the suggested frame duration, and that quality recovers once
+ * the queue has drained.
+ */
+void test_congestion__queueing() {
+
+    guac_congestion* congestion = guac_congestion_alloc();
+    CU_ASSERT_PTR_NOT_NULL_FATAL(congestion);
+
+    uint64_t bytes = 0;
+    guac_timestamp sent = 1000;
+
+    /* Establish baseline round-trip time */
+    for (int i = 0; i < 10; i++) {
+        sent += FRAME_INTERVAL;
+        bytes += FRAME_SIZE;
+        guac_congestion_frame_sent(congestion, sent, bytes);
+        guac_congestion_frame_acknowledged(congestion, sent, sent + 20);
+    }
+
+    /* Data begins to queue, increasing the round-trip time well beyond the
+     * baseline */
+    int reductions = 0;
+    int previous_quality = guac_congestion_suggest_quality(congestion);
+    for (int i = 0; i < 10; i++) {
+
+        sent += FRAME_INTERVAL;
+        bytes += FRAME_SIZE;
+        guac_congestion_frame_sent(congestion, sent, bytes);
+        guac_congestion_frame_acknowledged(congestion, sent, sent + 600);
+
+        int quality = guac_congestion_suggest_quality(congestion);
+        CU_ASSERT(quality <= previous_quality);
+        if (quality < previous_quality)
+            reductions++;
+        previous_quality = quality;
+
+    }
+
+    CU_ASSERT(congestion->queue_delay > GUAC_CONGESTION_MAX_QUEUE_DELAY);
+    CU_ASSERT(previous_quality < GUAC_CONGESTION_MAX_QUALITY);
+    CU_ASSERT(previous_quality >= GUAC_CONGESTION_MIN_QUALITY);
+
+    /* At most one reduction per round trip (each round trip spans many
+     * frames here) */
+    CU_ASSERT(reductions >= 1);
+    CU_ASSERT(reductions < 10);
+
+    /* Frames are lengthened to allow the queue to drain */
+    CU_ASSERT(guac_congestion_suggest_frame_duration(congestion, 60) > 60);
+
+    /* Quality recovers once the queue has drained */
+    for (int i = 0; i < 200; i++) {
+        sent += FRAME_INTERVAL;
+        bytes += FRAME_SIZE;
+        guac_congestion_frame_sent(congestion, sent, bytes);
+        guac_congestion_frame_acknowledged(congestion, sent, sent + 20);
+    }
+
+    CU_ASSERT_EQUAL(guac_congestion_suggest_quality(congestion),
+            GUAC_CONGESTION_MAX_QUALITY);
+    CU_ASSERT_EQUAL(guac_congestion_suggest_frame_duration(congestion, 60), 60);
+
+    guac_congestion_free(congestion);
+
+}
+
+/**
+ * Test which verifies that the delivery rate estimate is kept through a run
+ * of small frames shorter than GUAC_CONGESTION_RATE_WINDOW, falls only once
+ * the higher measurements have aged out, and climbs back to the capacity of
+ * the connection when frames are limited by the frame budget alone.
+ */
+void test_congestion__delivery_rate_recovery() {
+
+    guac_congestion* congestion = guac_congestion_alloc();
+    CU_ASSERT_PTR_NOT_NULL_FATAL(congestion);
+
+    int capacity = FRAME_SIZE * 1000 / FRAME_INTERVAL;
+
+    uint64_t bytes = 0;
+    guac_timestamp sent = 1000;
+
+    /* Establish delivery rate */
+    for (int i = 0; i < 10; i++) {
+        sent += FRAME_INTERVAL;
+        bytes += FRAME_SIZE;
+        guac_congestion_frame_sent(congestion, sent, bytes);
+        guac_congestion_frame_acknowledged(congestion, sent, sent + 20);
+    }
+
+    CU_ASSERT_EQUAL_FATAL(congestion->delivery_rate, capacity);
+
+    /* Many small frames within the same window do not lower the estimate */
+    int small_frames = GUAC_CONGESTION_RATE_WINDOW / FRAME_INTERVAL / 2;
+    for (int i = 0; i < small_frames; i++) {
+        sent += FRAME_INTERVAL;
+        bytes += 100;
+        guac_congestion_frame_sent(congestion, sent, bytes);
+        guac_congestion_frame_acknowledged(congestion, sent, sent + 20);
+    }
+
+    CU_ASSERT_EQUAL(congestion->delivery_rate, capacity);
+
+    /* The estimate falls once the earlier measurements have aged out */
+    small_frames = GUAC_CONGESTION_RATE_WINDOW * 2 / FRAME_INTERVAL;
+    for (int i = 0; i < small_frames; i++) {
+        sent += FRAME_INTERVAL;
+        bytes += 100;
+        guac_congestion_frame_sent(congestion, sent, bytes);
+        guac_congestion_frame_acknowledged(congestion, sent, sent + 20);
+    }
+
+    CU_ASSERT_EQUAL(congestion->delivery_rate, 100 * 1000 / FRAME_INTERVAL);
+
+    /* Send as much as the budget allows, up to the capacity of the
+     * connection, until the estimate has recovered */
+    int frames = 0;
+    while (congestion->delivery_rate < capacity && frames < 100) {
+
+        int budget = guac_congestion_get_frame_budget(congestion,
+                FRAME_INTERVAL);
+        if (budget > FRAME_SIZE)
+            budget = FRAME_SIZE;
+
+        sent += FRAME_INTERVAL;
+        bytes += budget;
+        guac_congestion_frame_sent(congestion, sent, bytes);
+        guac_congestion_frame_acknowledged(congestion, sent, sent + 20);
+        frames++;
+
+    }
+
+    CU_ASSERT_EQUAL(congestion->delivery_rate, capacity);
+    CU_ASSERT(frames < 30);
+
+    guac_congestion_free(congestion);
+
+}
+
+/**
+ * Test which verifies that delivery rates and frame budgets too large to be
+ * represented by an int are clamped rather than overflowing.
+ */
+void test_congestion__delivery_rate_overflow() {
+
+    guac_congestion* congestion = guac_congestion_alloc();
+    CU_ASSERT_PTR_NOT_NULL_FATAL(congestion);
+
+    uint64_t bytes = 0;
+    guac_timestamp sent = 1000;
+
+    /* Roughly 4 GB acknowledged within each millisecond */
+    for (int i = 0; i < 3; i++) {
+        sent++;
+        bytes += UINT64_C(4000000000);
+        guac_congestion_frame_sent(congestion, sent, bytes);
+        guac_congestion_frame_acknowledged(congestion, sent, sent);
+    }
+
+    CU_ASSERT_EQUAL(congestion->delivery_rate, INT_MAX);
+    CU_ASSERT_EQUAL(congestion->frame_size, INT_MAX);
+    CU_ASSERT_EQUAL(guac_congestion_get_frame_budget(congestion,
+                GUAC_CONGESTION_MAX_FRAME_DURATION), INT_MAX);
+
+    guac_congestion_free(congestion);
+
+}
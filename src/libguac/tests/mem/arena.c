@@ -0,0 +1,134 @@
+/*
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ * KIND, either express or implied.  See the License for the
+ * specific language governing permissions and limitations
+ * under the License.
+ */
+
+#include <CUnit/CUnit.h>
+#include <guacamole/mem.h>
+#include <stdint.h>
+#include <string.h>
+
+/**
+ * Test which verifies that guac_mem_arena_alloc() returns NULL for inputs
+ * involving a zero value or whose product would overflow a size_t.
+ */
+void test_mem__arena_alloc_fail() {
+
+    CU_ASSERT_PTR_NULL(guac_mem_arena_alloc(0));
+    CU_ASSERT_PTR_NULL(guac_mem_arena_alloc(3, 2, 0));
+    CU_ASSERT_PTR_NULL(guac_mem_arena_alloc(SIZE_MAX, 2));
+    CU_ASSERT_PTR_NULL(guac_mem_arena_alloc(SIZE_MAX));
+
+    guac_mem_arena_reset();
+
+}
+
+/**
+ * Test which verifies that blocks allocated with guac_mem_arena_alloc() are
+ * distinct, aligned, and usable in their entirety, including blocks larger
+ * than the chunks normally requested by the arena.
+ */
+void test_mem__arena_alloc_success() {
+
+    unsigned char* a = guac_mem_arena_alloc(123);
+    unsigned char* b = guac_mem_arena_alloc(456, 789);
+    unsigned char* c = guac_mem_arena_alloc(4096, 4096);
+
+    CU_ASSERT_PTR_NOT_NULL_FATAL(a);
+    CU_ASSERT_PTR_NOT_NULL_FATAL(b);
+    CU_ASSERT_PTR_NOT_NULL_FATAL(c);
+
+    CU_ASSERT_EQUAL((uintptr_t) a % 16, 0);
+    CU_ASSERT_EQUAL((uintptr_t) b % 16, 0);
+    CU_ASSERT_EQUAL((uintptr_t) c % 16, 0);
+
+    /* Blocks must not overlap */
+    memset(a, 0xAA, 123);
+    memset(b, 0xBB, 456 * 789);
+    memset(c, 0xCC, 4096 * 4096);
+    CU_ASSERT_EQUAL(a[122], 0xAA);
+    CU_ASSERT_EQUAL(b[0], 0xBB);
+    CU_ASSERT_EQUAL(b[456 * 789 - 1], 0xBB);
+    CU_ASSERT_EQUAL(c[0], 0xCC);
+
+    guac_mem_arena_reset();
+
+}
+
+/**
+ * Test which verifies that blocks freed with guac_mem_arena_free() in the
+ * reverse order of their allocation are immediately reused, and that
+ * guac_mem_arena_free() sets the provided pointer to NULL.
+ */
+void test_mem__arena_free() {
+
+    void* a = guac_mem_arena_alloc(1000);
+    void* b = guac_mem_arena_alloc(2000);
+    CU_ASSERT_PTR_NOT_NULL_FATAL(a);
+    CU_ASSERT_PTR_NOT_NULL_FATAL(b);
+
+    void* first = a;
+    void* second = b;
+
+    /* Freeing blocks out of order has no immediate effect */
+    guac_mem_arena_free(a);
+    CU_ASSERT_PTR_NULL(a);
+    a = guac_mem_arena_alloc(1000);
+    CU_ASSERT_PTR_NOT_EQUAL(a, first);
+
+    /* Freeing blocks in reverse order rewinds the arena */
+    guac_mem_arena_free(a);
+    guac_mem_arena_free(b);
+    CU_ASSERT_PTR_NULL(b);
+    b = guac_mem_arena_alloc(2000);
+    CU_ASSERT_PTR_EQUAL(b, second);
+
+    /* Freeing NULL does nothing */
+    void* ptr = NULL;
+    guac_mem_arena_free(ptr);
+
+    guac_mem_arena_reset();
+
+}
+
+/**
+ * Test which verifies that guac_mem_arena_reset() reclaims all outstanding
+ * arena memory, such that a frame which allocates the same blocks as the
+ * previous frame reuses the same memory.
+ */
+void test_mem__arena_reset() {
+
+    /* Grow the arena well beyond a single chunk */
+    void* first = guac_mem_arena_alloc(100);
+    for (int i = 0; i < 64; i++)
+        CU_ASSERT_PTR_NOT_NULL(guac_mem_arena_alloc(65536));
+
+    guac_mem_arena_reset();
+
+    /* The entire previous frame now fits within a single chunk */
+    first = guac_mem_arena_alloc(100);
+    for (int i = 0; i < 64; i++)
+        CU_ASSERT_PTR_NOT_NULL(guac_mem_arena_alloc(65536));
+
+    guac_mem_arena_reset();
+    CU_ASSERT_PTR_EQUAL(guac_mem_arena_alloc(100), first);
+
+    /* Resetting repeatedly is harmless */
+    guac_mem_arena_reset();
+    guac_mem_arena_reset();
+
+}
@@ -0,0 +1,92 @@
+/*
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ * KIND, either express or implied.  See the License for the
+ * specific language governing permissions and limitations
+ * under the License.
+ */
+
+#include <CUnit/CUnit.h>
+#include <guacamole/rate-limit.h>
+
+/**
+ * The rate of the token buckets tested below, in bytes per second.
+ */
+#define RATE 100000
+
+/**
+ * The number of bytes a token bucket having the rate tested below holds when
+ * full.
+ */
+#define CAPACITY (RATE * GUAC_RATE_LIMIT_BURST / 1000)
+
+/**
+ * Test which verifies that writes within the burst allowed by a full token
+ * bucket are not delayed, and that the fill percentage reflects the tokens
+ * consumed.
+ */
+void test_rate_limit__burst() {
+
+    guac_rate_limit* limit = guac_rate_limit_alloc(RATE);
+    CU_ASSERT_PTR_NOT_NULL_FATAL(limit);
+
+    /* Bucket is initially full */
+    CU_ASSERT_EQUAL(guac_rate_limit_get_fill(limit), 100);
+
+    /* Half the capacity may be written without delay */
+    CU_ASSERT_EQUAL(guac_rate_limit_consume(limit, CAPACITY / 2), 0);
+    CU_ASSERT(guac_rate_limit_get_fill(limit) >= 50);
+    CU_ASSERT(guac_rate_limit_get_fill(limit) < 100);
+
+    /* As may the remaining half */
+    CU_ASSERT_EQUAL(guac_rate_limit_consume(limit, CAPACITY / 2), 0);
+    CU_ASSERT(guac_rate_limit_get_available(limit) < CAPACITY / 2);
+
+    guac_rate_limit_free(limit);
+
+}
+
+/**
+ * Test which verifies that writes beyond the tokens available are delayed
+ * for the time the bucket needs to refill the deficit, and that a bucket
+ * shared by several references remains valid until every reference has been
+ * released.
+ */
+void test_rate_limit__deficit() {
+
+    guac_rate_limit* limit = guac_rate_limit_alloc(RATE);
+    CU_ASSERT_PTR_NOT_NULL_FATAL(limit);
+
+    /* A second reference, as would be held by a socket */
+    CU_ASSERT_PTR_EQUAL(guac_rate_limit_retain(limit), limit);
+    guac_rate_limit_free(limit);
+
+    /* Exceeding the capacity by one second's worth of data requires roughly
+     * one second of delay */
+    int delay = guac_rate_limit_consume(limit, CAPACITY + RATE);
+    CU_ASSERT(delay > 900);
+    CU_ASSERT(delay <= 1000);
+
+    /* Nothing further may be written without delay */
+    CU_ASSERT_EQUAL(guac_rate_limit_get_fill(limit), 0);
+    CU_ASSERT(guac_rate_limit_get_available(limit) < 0);
+
+    /* Lowering the rate lengthens the delay of further writes */
+    guac_rate_limit_set_rate(limit, RATE / 2);
+    CU_ASSERT(guac_rate_limit_consume(limit, RATE / 2) > delay);
+
+    guac_rate_limit_free(limit);
+
+}
+
@@ -0,0 +1,200 @@
+/*
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ * KIND, either express or implied.  See the License for the
+ * specific language governing permissions and limitations
+ * under the License.
+ */
+
+#include "video-format.h"
+
+#include <CUnit/CUnit.h>
+#include <guacamole/client.h>
+#include <guacamole/video.h>
+#include <string.h>
+
+/**
+ * The video formats used by the tests below, in order of preference.
+ */
+static const guac_video_format test_formats[] = {
+    { "video/a", "container-a", "codec-a", "", "" },
+    { "video/b", "container-b", "codec-b", "", "" },
+    { "video/c", "container-c", "codec-c", "", "" },
+    { NULL }
+};
+
+/**
+ * The number of times that test_users_support_format() has been invoked
+ * since the last test began.
+ */
+static int support_checks;
+
+/**
+ * guac_video_encoder_check which reports every encoder as available.
+ */
+static int all_encoders(const char* codec) {
+    return 1;
+}
+
+/**
+ * guac_video_encoder_check which reports no encoder as available.
+ */
+static int no_encoders(const char* codec) {
+    return 0;
+}
+
+/**
+ * guac_video_encoder_check which reports every encoder except that of the
+ * first test format as available.
+ */
+static int missing_first_encoder(const char* codec) {
+    return strcmp(codec, "codec-a") != 0;
+}
+
+/**
+ * guac_video_format_check which reports whether all of a set of simulated
+ * users support the given format, where each user is represented by the
+ * NULL-terminated list of video mimetypes they declared.
+ *
+ * @param format
+ *     The video format to check.
+ *
+ * @param data
+ *     A NULL-terminated array of NULL-terminated mimetype lists, one per
+ *     simulated user.
+ *
+ * @return
+ *     Non-zero if all simulated users support the given format, zero
+ *     otherwise.
+ */
+static int test_users_support_format(const guac_video_format* format,
+        void* data) {
+
+    support_checks++;
+
+    for (const char*** user = (const char***) data; *user != NULL; user++) {
+        if (!guac_video_mimetypes_support_format(*user, format))
+            return 0;
+    }
+
+    return 1;
+
+}
+
+/**
+ * Test which verifies that the most preferred format is selected if all
+ * users support it and its encoder is available.
+ */
+void test_video__select_format_preferred() {
+
+    const char* user_a[] = { "video/c", "video/b", "video/a", NULL };
+    const char* user_b[] = { "video/a", "video/b", NULL };
+    const char** users[] = { user_a, user_b, NULL };
+
+    support_checks = 0;
+    CU_ASSERT_PTR_EQUAL(guac_video_select_format(test_formats, all_encoders,
+                test_users_support_format, users), &test_formats[0]);
+    CU_ASSERT_EQUAL(support_checks, 1);
+
+}
+
+/**
+ * Test which verifies that formats whose encoder is not available are skipped
+ * without consulting users, falling back to the next format.
+ */
+void test_video__select_format_encoder_fallback() {
+
+    const char* user_a[] = { "video/a", "video/b", NULL };
+    const char** users[] = { user_a, NULL };
+
+    support_checks = 0;
+    CU_ASSERT_PTR_EQUAL(guac_video_select_format(test_formats,
+                missing_first_encoder, test_users_support_format, users),
+            &test_formats[1]);
+    CU_ASSERT_EQUAL(support_checks, 1);
+
+    /* Without any encoders, nothing is selected and no user is checked */
+    support_checks = 0;
+    CU_ASSERT_PTR_NULL(guac_video_select_format(test_formats, no_encoders,
+                test_users_support_format, users));
+    CU_ASSERT_EQUAL(support_checks, 0);
+
+}
+
+/**
+ * Test which verifies that only formats supported by every user are
+ * selected, and that nothing is selected if the users share no format.
+ */
+void test_video__select_format_user_fallback() {
+
+    const char* user_a[] = { "video/a", "video/c", NULL };
+    const char* user_b[] = { "video/b", "video/c", NULL };
+    const char* user_c[] = { "video/b", NULL };
+
+    const char** common[] = { user_a, user_b, NULL };
+    CU_ASSERT_PTR_EQUAL(guac_video_select_format(test_formats, all_encoders,
+                test_users_support_format, common), &test_formats[2]);
+
+    const char** disjoint[] = { user_a, user_c, NULL };
+    CU_ASSERT_PTR_NULL(guac_video_select_format(test_formats, all_encoders,
+                test_users_support_format, disjoint));
+
+}
+
+/**
+ * Test which verifies that selection may resume after a format which could
+ * not be used, as done when the encoder of a selected format fails to open,
+ * and that the end of the list is handled.
+ */
+void test_video__select_format_resume() {
+
+    const char* user_a[] = { "video/a", "video/c", NULL };
+    const char** users[] = { user_a, NULL };
+
+    const guac_video_format* format = guac_video_select_format(test_formats,
+            all_encoders, test_users_support_format, users);
+    CU_ASSERT_PTR_EQUAL_FATAL(format, &test_formats[0]);
+
+    format = guac_video_select_format(format + 1, all_encoders,
+            test_users_support_format, users);
+    CU_ASSERT_PTR_EQUAL_FATAL(format, &test_formats[2]);
+
+    format = guac_video_select_format(format + 1, all_encoders,
+            test_users_support_format, users);
+    CU_ASSERT_PTR_NULL(format);
+
+}
+
+/**
+ * Test which verifies that a client without users supports no video formats,
+ * such that video streams are never allocated and callers fall back to
+ * images, regardless of whether libguac was built with video support.
+ */
+void test_video__select_format_no_users() {
+
+    guac_client* client = guac_client_alloc();
+    CU_ASSERT_PTR_NOT_NULL_FATAL(client);
+
+    CU_ASSERT_FALSE(guac_video_client_supports_format(&test_formats[0],
+                client));
+    CU_ASSERT_PTR_NULL(guac_video_select_format(guac_video_formats,
+                all_encoders, guac_video_client_supports_format, client));
+
+    CU_ASSERT_FALSE(guac_client_supports_video(client));
+    CU_ASSERT_PTR_NULL(guac_video_stream_alloc(client, client->socket,
+                GUAC_DEFAULT_LAYER, 64, 64, 30));
+
+    guac_client_free(client);
+
+}
@@ -0,0 +1,86 @@
+/*
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ * KIND, either express or implied.  See the License for the
+ * specific language governing permissions and limitations
+ * under the License.
+ */
+
+#include "video-format.h"
+
+#include <CUnit/CUnit.h>
+#include <stdio.h>
+#include <string.h>
+
+/**
+ * The video format used by the tests below, having a mimetype with
+ * parameters.
+ */
+static const guac_video_format test_format = {
+    "video/webm; codecs=\"vp8\"", "webm", "libvpx", "", ""
+};
+
+/**
+ * Test which verifies that a video format is supported only if its exact
+ * mimetype or its base mimetype is declared.
+ */
+void test_video__supports_format() {
+
+    const char* exact[] = { "video/mp4", "video/webm; codecs=\"vp8\"", NULL };
+    const char* base[] = { "video/webm", NULL };
+    const char* other_codec[] = { "video/webm; codecs=\"vp9\"", NULL };
+    const char* prefix[] = { "video/web", "video/webm2", NULL };
+    const char* none[] = { NULL };
+
+    CU_ASSERT_TRUE(guac_video_mimetypes_support_format(exact, &test_format));
+    CU_ASSERT_TRUE(guac_video_mimetypes_support_format(base, &test_format));
+    CU_ASSERT_FALSE(guac_video_mimetypes_support_format(other_codec,
+                &test_format));
+    CU_ASSERT_FALSE(guac_video_mimetypes_support_format(prefix,
+                &test_format));
+    CU_ASSERT_FALSE(guac_video_mimetypes_support_format(none, &test_format));
+
+}
+
+/**
+ * Test which verifies that a user which has not declared any video mimetypes
+ * supports no video formats.
+ */
+void test_video__supports_format_undeclared() {
+    CU_ASSERT_FALSE(guac_video_mimetypes_support_format(NULL, &test_format));
+}
+
+/**
+ * Test which verifies that every video format built into libguac can be
+ * selected through its own mimetype and through its base mimetype.
+ */
+void test_video__supports_format_builtin() {
+
+    for (const guac_video_format* format = guac_video_formats;
+            format->mimetype != NULL; format++) {
+
+        const char* exact[] = { format->mimetype, NULL };
+        CU_ASSERT_TRUE(guac_video_mimetypes_support_format(exact, format));
+
+        /* Strip all parameters to produce the base mimetype */
+        char base_mimetype[64];
+        snprintf(base_mimetype, sizeof(base_mimetype), "%.*s",
+                (int) strcspn(format->mimetype, ";"), format->mimetype);
+
+        const char* base[] = { base_mimetype, NULL };
+        CU_ASSERT_TRUE(guac_video_mimetypes_support_format(base, format));
+
+    }
+
+}
@@ -0,0 +1,282 @@
+/*
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ * KIND, either express or implied.  See the License for the
+ * specific language governing permissions and limitations
+ * under the License.
+ */
+
+
+#include <CUnit/CUnit.h>
+#include <guacamole/protocol.h>
+#include <guacamole/socket.h>
+#include <guacamole/writer.h>
+
+#include <signal.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/resource.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+/**
+ * The size of the queue of each guac_writer tested below, in bytes.
+ */
+#define QUEUE_SIZE 1024
+
+/**
+ * Reads everything which remains within the given pipe until end-of-file,
+ * storing that data in the given buffer.
+ *
+ * @param fd
+ *     The file descriptor of the read end of the pipe. The write end of the
+ *     pipe must already be closed.
+ *
+ * @param buffer
+ *     The buffer in which to store the data read.
+ *
+ * @param length
+ *     The number of bytes available within the given buffer.
+ *
+ * @return
+ *     The number of bytes read.
+ */
+static size_t read_all(int fd, char* buffer, size_t length) {
+
+    size_t total = 0;
+
+    ssize_t received;
+    while (total < length
+            && (received = read(fd, buffer + total, length - total)) > 0)
+        total += received;
+
+    return total;
+
+}
+
+/**
+ * Test which verifies that all data written to a guac_writer is written to
+ * its file descriptor, in order, once the writer is stopped, and that the
+ * file descriptor is not closed by the writer.
+ */
+void test_writer__write() {
+
+    int fd[2];
+    CU_ASSERT_EQUAL_FATAL(pipe(fd), 0);
+
+    guac_writer* writer = guac_writer_alloc(fd[1], QUEUE_SIZE,
+            GUAC_WRITER_SYNC_NEVER);
+    CU_ASSERT_PTR_NOT_NULL_FATAL(writer);
+
+    /* Write enough data to wrap around the end of the queue several times */
+    char expected[QUEUE_SIZE * 4];
+    for (int i = 0; i < sizeof(expected); i++)
+        expected[i] = 'A' + (i % 26);
+
+    /* Writes smaller than the queue should never be dropped while the
+     * background thread is keeping up */
+    for (int i = 0; i < sizeof(expected); i += 100) {
+
+        size_t length = sizeof(expected) - i;
+        if (length > 100)
+            length = 100;
+
+        while (guac_writer_available(writer) < length)
+            usleep(1000);
+
+        CU_ASSERT_EQUAL(guac_writer_write(writer, expected + i, length), 0);
+
+    }
+
+    guac_writer_stop(writer);
+    CU_ASSERT_EQUAL(guac_writer_get_dropped(writer), 0);
+    CU_ASSERT_EQUAL(writer->bytes_written, sizeof(expected));
+
+    guac_writer_free(writer);
+    CU_ASSERT_EQUAL(close(fd[1]), 0);
+
+    char actual[sizeof(expected) + 1];
+    CU_ASSERT_EQUAL(read_all(fd[0], actual, sizeof(actual)), sizeof(expected));
+    CU_ASSERT_NSTRING_EQUAL(actual, expected, sizeof(expected));
+
+    close(fd[0]);
+
+}
+
+/**
+ * Test which verifies that writes which cannot fit within the queue, as well
+ * as writes after the writer has been stopped, are dropped in their entirety
+ * and counted.
+ */
+void test_writer__drop() {
+
+    int fd[2];
+    CU_ASSERT_EQUAL_FATAL(pipe(fd), 0);
+
+    guac_writer* writer = guac_writer_alloc(fd[1], QUEUE_SIZE,
+            GUAC_WRITER_SYNC_NEVER);
+    CU_ASSERT_PTR_NOT_NULL_FATAL(writer);
+
+    char data[QUEUE_SIZE + 1];
+    memset(data, 'x', sizeof(data));
+
+    /* A write larger than the entire queue can never fit */
+    CU_ASSERT_NOT_EQUAL(guac_writer_write(writer, data, sizeof(data)), 0);
+    CU_ASSERT_EQUAL(guac_writer_get_dropped(writer), sizeof(data));
+    CU_ASSERT_EQUAL(writer->writes_dropped, 1);
+
+    /* Smaller writes are still accepted */
+    CU_ASSERT_EQUAL(guac_writer_write(writer, "hello", 5), 0);
+    guac_writer_stop(writer);
+
+    /* Nothing is accepted after stopping */
+    CU_ASSERT_NOT_EQUAL(guac_writer_write(writer, "world", 5), 0);
+    CU_ASSERT_EQUAL(guac_writer_get_dropped(writer), sizeof(data) + 5);
+    CU_ASSERT_EQUAL(writer->writes_dropped, 2);
+
+    guac_writer_free(writer);
+    close(fd[1]);
+
+    /* Only the data which was accepted was written */
+    char actual[sizeof(data)];
+    CU_ASSERT_EQUAL(read_all(fd[0], actual, sizeof(actual)), 5);
+    CU_ASSERT_NSTRING_EQUAL(actual, "hello", 5);
+
+    close(fd[0]);
+
+}
+
+/**
+ * Test which verifies that a guac_writer stops writing entirely once a write
+ * to its file descriptor fails part way through, counting only the data which
+ * was not written as dropped, and dropping all later writes.
+ */
+void test_writer__failure() {
+
+    char path[] = "/tmp/guac-writer-test-XXXXXX";
+    int fd = mkstemp(path);
+    CU_ASSERT_NOT_EQUAL_FATAL(fd, -1);
+    unlink(path);
+
+    /* Limit the size of files written by this process, such that writes
+     * beyond that size are only partially written and then fail (with
+     * EFBIG) rather than raising SIGXFSZ */
+    struct rlimit original;
+    CU_ASSERT_EQUAL_FATAL(getrlimit(RLIMIT_FSIZE, &original), 0);
+
+    struct rlimit limited = original;
+    limited.rlim_cur = 50;
+
+    void (*original_handler)(int) = signal(SIGXFSZ, SIG_IGN);
+    CU_ASSERT_EQUAL_FATAL(setrlimit(RLIMIT_FSIZE, &limited), 0);
+
+    guac_writer* writer = guac_writer_alloc(fd, QUEUE_SIZE,
+            GUAC_WRITER_SYNC_NEVER);
+    CU_ASSERT_PTR_NOT_NULL_FATAL(writer);
+
+    char data[100];
+    memset(data, 'x', sizeof(data));
+
+    CU_ASSERT_EQUAL(guac_writer_write(writer, data, sizeof(data)), 0);
+    guac_writer_flush(writer);
+
+    /* Wait for the failed write to be recorded */
+    for (int i = 0; i < 1000 && guac_writer_get_dropped(writer) == 0; i++)
+        usleep(1000);
+
+    /* Only the portion which could not be written is dropped */
+    CU_ASSERT_EQUAL(guac_writer_get_dropped(writer), sizeof(data) - 50);
+
+    /* Nothing further is accepted, even though it would fit */
+    CU_ASSERT_NOT_EQUAL(guac_writer_write(writer, "hello", 5), 0);
+    guac_writer_stop(writer);
+
+    CU_ASSERT_EQUAL(writer->bytes_written, 50);
+    CU_ASSERT_EQUAL(guac_writer_get_dropped(writer), sizeof(data) - 50 + 5);
+    CU_ASSERT_EQUAL(writer->writes_dropped, 1);
+
+    guac_writer_free(writer);
+
+    setrlimit(RLIMIT_FSIZE, &original);
+    signal(SIGXFSZ, original_handler);
+
+    /* Nothing was appended after the failed write */
+    struct stat file_stat;
+    CU_ASSERT_EQUAL_FATAL(fstat(fd, &file_stat), 0);
+    CU_ASSERT_EQUAL(file_stat.st_size, 50);
+
+    close(fd);
+
+}
+
+/**
+ * Test which verifies that a flushed guac_writer writes data which does not
+ * fill a block without needing to be stopped.
+ */
+void test_writer__flush() {
+
+    int fd[2];
+    CU_ASSERT_EQUAL_FATAL(pipe(fd), 0);
+
+    guac_writer* writer = guac_writer_alloc(fd[1], QUEUE_SIZE,
+            GUAC_WRITER_SYNC_ALWAYS);
+    CU_ASSERT_PTR_NOT_NULL_FATAL(writer);
+
+    CU_ASSERT_EQUAL(guac_writer_write(writer, "hello", 5), 0);
+    guac_writer_flush(writer);
+
+    /* Data arrives without stopping the writer (read() blocks until then) */
+    char actual[5];
+    CU_ASSERT_EQUAL(read(fd[0], actual, sizeof(actual)), 5);
+    CU_ASSERT_NSTRING_EQUAL(actual, "hello", 5);
+
+    guac_writer_free(writer);
+    close(fd[1]);
+    close(fd[0]);
+
+}
+
+/**
+ * Test which verifies that a guac_socket writing through a guac_writer
+ * writes each instruction intact and closes the file descriptor of the
+ * writer when freed.
+ */
+void test_writer__socket() {
+
+    int fd[2];
+    CU_ASSERT_EQUAL_FATAL(pipe(fd), 0);
+
+    guac_writer* writer = guac_writer_alloc(fd[1], QUEUE_SIZE,
+            GUAC_WRITER_SYNC_NEVER);
+    CU_ASSERT_PTR_NOT_NULL_FATAL(writer);
+
+    guac_socket* socket = guac_socket_open_writer(writer);
+    CU_ASSERT_PTR_NOT_NULL_FATAL(socket);
+
+    CU_ASSERT_EQUAL(guac_protocol_send_sync(socket, 12345, 0), 0);
+    CU_ASSERT_EQUAL(guac_protocol_send_name(socket, "test"), 0);
+    guac_socket_free(socket);
+
+    const char expected[] = "4.sync,5.12345,1.0;4.name,4.test;";
+
+    /* End-of-file is reached only if the write end was closed */
+    char actual[sizeof(expected)];
+    CU_ASSERT_EQUAL(read_all(fd[0], actual, sizeof(actual)),
+            sizeof(expected) - 1);
+    CU_ASSERT_NSTRING_EQUAL(actual, expected, sizeof(expected) - 1);
+
+    close(fd[0]);
+
+}
+
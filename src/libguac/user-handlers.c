@@ -21,6 +21,7 @@
 
 #include "guacamole/mem.h"
 #include "guacamole/client.h"
+#include "guacamole/congestion.h"
 #include "guacamole/object.h"
 #include "guacamole/protocol.h"
 #include "guacamole/stream.h"
@@ -149,6 +150,10 @@ int __guac_handle_sync(guac_user* user, int argc, char** argv) {
 
         user->processing_lag = processing_lag;
 
+        /* Update estimate of network conditions */
+        guac_congestion_frame_acknowledged(user->congestion, timestamp,
+                current);
+
     }
 
     /* Log received timestamp and calculated lag (at TRACE level only) */
@@ -24,9 +24,11 @@
 #include "encode-webp.h"
 #include "guacamole/mem.h"
 #include "guacamole/client.h"
+#include "guacamole/congestion.h"
 #include "guacamole/object.h"
 #include "guacamole/pool.h"
 #include "guacamole/protocol.h"
+#include "guacamole/rate-limit.h"
 #include "guacamole/socket.h"
 #include "guacamole/stream.h"
 #include "guacamole/string.h"
@@ -57,6 +59,9 @@ guac_user* guac_user_alloc() {
     user->processing_lag = 0;
     user->active = 1;
 
+    /* Nothing is yet known about the user's connection */
+    user->congestion = guac_congestion_alloc();
+
     /* Allocate stream pool */
     user->__stream_pool = guac_pool_alloc(0);
 
@@ -96,6 +101,8 @@ void guac_user_free(guac_user* user) {
     /* Free object pool */
     guac_pool_free(user->__object_pool);
 
+    guac_congestion_free(user->congestion);
+
     /* Clean up user */
     guac_mem_free(user->user_id);
     guac_mem_free(user);
@@ -200,6 +207,15 @@ void vguac_user_abort(guac_user* user, guac_protocol_status status,
 
 }
 
+void guac_user_set_rate_limit(guac_user* user, int rate) {
+
+    /* The socket retains its own reference to the limit */
+    guac_rate_limit* limit = guac_rate_limit_alloc(rate);
+    guac_socket_add_rate_limit(user->socket, limit);
+    guac_rate_limit_free(limit);
+
+}
+
 void guac_user_abort(guac_user* user, guac_protocol_status status,
         const char* format, ...) {
 
@@ -282,8 +298,12 @@ void guac_user_stream_jpeg(guac_user* user, guac_socket* socket,
     /* Declare stream as containing image data */
     guac_protocol_send_img(socket, stream, mode, layer, "image/jpeg", x, y);
 
-    /* Write JPEG data */
-    guac_jpeg_write(socket, stream, surface, quality);
+    /* Write JPEG data, trading color detail and DCT accuracy for size and
+     * speed as lag increases */
+    int lag = user->processing_lag;
+    guac_jpeg_write(socket, stream, surface, quality,
+            guac_jpeg_suggest_subsampling(lag),
+            guac_jpeg_suggest_dct_method(lag));
 
     /* Terminate stream */
     guac_protocol_send_end(socket, stream);
@@ -0,0 +1,134 @@
+/*
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ * KIND, either express or implied.  See the License for the
+ * specific language governing permissions and limitations
+ * under the License.
+ */
+
+#include "config.h"
+
+#include "guacamole/client.h"
+#include "guacamole/user.h"
+#include "video-format.h"
+
+#include <stddef.h>
+#include <string.h>
+
+const guac_video_format guac_video_formats[] = {
+
+    {
+        "video/webm; codecs=\"vp8\"", "webm", "libvpx",
+        "deadline=realtime:cpu-used=8:lag-in-frames=0:error-resilient=1",
+        "live=1"
+    },
+
+    {
+        "video/mp4; codecs=\"avc1.42E01E\"", "mp4", "libx264",
+        "preset=ultrafast:tune=zerolatency:profile=baseline",
+        "movflags=frag_every_frame+empty_moov+default_base_moof"
+    },
+
+    { NULL }
+
+};
+
+int guac_video_mimetypes_support_format(const char** mimetypes,
+        const guac_video_format* format) {
+
+    /* Length of mimetype excluding any parameters */
+    size_t base_length = strcspn(format->mimetype, ";");
+
+    if (mimetypes == NULL)
+        return 0;
+
+    for (; *mimetypes != NULL; mimetypes++) {
+
+        if (strcmp(*mimetypes, format->mimetype) == 0)
+            return 1;
+
+        if (strlen(*mimetypes) == base_length
+                && strncmp(*mimetypes, format->mimetype, base_length) == 0)
+            return 1;
+
+    }
+
+    return 0;
+
+}
+
+/**
+ * Callback which is invoked by guac_video_client_supports_format() for each
+ * user associated with the given client, clearing the candidate format if
+ * that user does not support it.
+ *
+ * @param user
+ *     The user to check for support of the candidate format.
+ *
+ * @param data
+ *     Pointer to the candidate guac_video_format pointer, which will be set
+ *     to NULL if the user does not support the format.
+ *
+ * @return
+ *     Always NULL.
+ */
+static void* guac_video_format_support_callback(guac_user* user, void* data) {
+
+    const guac_video_format** format = (const guac_video_format**) data;
+
+    if (*format != NULL && !guac_video_mimetypes_support_format(
+                user->info.video_mimetypes, *format))
+        *format = NULL;
+
+    return NULL;
+
+}
+
+int guac_video_client_supports_format(const guac_video_format* format,
+        void* data) {
+
+    guac_client* client = (guac_client*) data;
+
+    /* Video makes no sense without anyone to watch it */
+    if (client->connected_users == 0)
+        return 0;
+
+    const guac_video_format* supported = format;
+    guac_client_foreach_user(client, guac_video_format_support_callback,
+            &supported);
+
+    return supported != NULL;
+
+}
+
+const guac_video_format* guac_video_select_format(
+        const guac_video_format* formats,
+        guac_video_encoder_check* has_encoder,
+        guac_video_format_check* is_supported, void* data) {
+
+    for (const guac_video_format* current = formats;
+            current->mimetype != NULL; current++) {
+
+        /* Skip formats that this build cannot encode */
+        if (!has_encoder(current->codec))
+            continue;
+
+        if (is_supported(current, data))
+            return current;
+
+    }
+
+    return NULL;
+
+}
@@ -0,0 +1,177 @@
+/*
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ * KIND, either express or implied.  See the License for the
+ * specific language governing permissions and limitations
+ * under the License.
+ */
+
+#ifndef __GUAC_VIDEO_FORMAT_H
+#define __GUAC_VIDEO_FORMAT_H
+
+/**
+ * Provides the list of video formats which libguac may use to stream live
+ * video, along with functions for choosing between those formats. None of
+ * these functions depend on the availability of any particular encoder, such
+ * that format selection is identical regardless of how libguac was built.
+ *
+ * @file video-format.h
+ */
+
+#include "guacamole/client-types.h"
+
+/**
+ * A video format which libguac may use to stream live video, consisting of
+ * the mimetype declared to the client, the libavformat container which
+ * produces that mimetype, and the libavcodec encoder used for its frames.
+ */
+typedef struct guac_video_format {
+
+    /**
+     * The mimetype of the video format, as used within the "video"
+     * instruction. Users declaring support for this mimetype or for the base
+     * mimetype (the portion preceding any parameters) are considered to
+     * support this format.
+     */
+    const char* mimetype;
+
+    /**
+     * The name of the libavformat muxer which produces this format.
+     */
+    const char* container;
+
+    /**
+     * The name of the libavcodec encoder to use for frames of video.
+     */
+    const char* codec;
+
+    /**
+     * Encoder options tuning the codec for low-latency, live encoding, in the
+     * format accepted by av_dict_parse_string().
+     */
+    const char* codec_options;
+
+    /**
+     * Muxer options allowing the container to be played back while it is
+     * still being written, in the format accepted by av_dict_parse_string().
+     */
+    const char* container_options;
+
+} guac_video_format;
+
+/**
+ * Handler which determines whether an encoder for the given codec is
+ * available.
+ *
+ * @param codec
+ *     The name of the libavcodec encoder to check, as stored within the codec
+ *     member of a guac_video_format.
+ *
+ * @return
+ *     Non-zero if the encoder is available, zero otherwise.
+ */
+typedef int guac_video_encoder_check(const char* codec);
+
+/**
+ * All video formats supported by libguac, in order of preference. The list is
+ * terminated by an entry having a NULL mimetype.
+ */
+extern const guac_video_format guac_video_formats[];
+
+/**
+ * Returns whether the given list of mimetypes, as declared by a user within
+ * the "video" handshake instruction, includes the given video format, either
+ * through its exact mimetype or through its base mimetype (the portion of the
+ * mimetype preceding any parameters).
+ *
+ * @param mimetypes
+ *     The NULL-terminated list of mimetypes to check, or NULL if no mimetypes
+ *     were declared.
+ *
+ * @param format
+ *     The video format to check.
+ *
+ * @return
+ *     Non-zero if the given mimetypes include the given video format, zero
+ *     otherwise.
+ */
+int guac_video_mimetypes_support_format(const char** mimetypes,
+        const guac_video_format* format);
+
+/**
+ * Handler which determines whether a candidate video format may be used.
+ *
+ * @param format
+ *     The video format to check.
+ *
+ * @param data
+ *     The arbitrary data passed to guac_video_select_format().
+ *
+ * @return
+ *     Non-zero if the video format may be used, zero otherwise.
+ */
+typedef int guac_video_format_check(const guac_video_format* format,
+        void* data);
+
+/**
+ * Returns whether all users of the given client support the given video
+ * format. A client without any users supports no video formats. This
+ * function is a guac_video_format_check which accepts the guac_client as its
+ * arbitrary data.
+ *
+ * @param format
+ *     The video format to check.
+ *
+ * @param data
+ *     The guac_client whose users should be checked.
+ *
+ * @return
+ *     Non-zero if the client has at least one user and all of its users
+ *     support the given video format, zero otherwise.
+ */
+int guac_video_client_supports_format(const guac_video_format* format,
+        void* data);
+
+/**
+ * Returns the first video format at or after the given position within a
+ * list of formats for which an encoder is available and which is accepted by
+ * the given handler. Later formats are used only if no earlier format
+ * qualifies, allowing callers to fall back to the next format by passing the
+ * position following a format which could not be used.
+ *
+ * @param formats
+ *     The position within a list of video formats, terminated by an entry
+ *     having a NULL mimetype, at which the search should begin.
+ *
+ * @param has_encoder
+ *     The handler to invoke to determine whether the encoder of each
+ *     candidate format is available.
+ *
+ * @param is_supported
+ *     The handler to invoke to determine whether each candidate format having
+ *     an available encoder is supported by its recipients. This handler is
+ *     typically guac_video_client_supports_format().
+ *
+ * @param data
+ *     Arbitrary data to pass to is_supported.
+ *
+ * @return
+ *     The first qualifying video format, or NULL if no such format exists.
+ */
+const guac_video_format* guac_video_select_format(
+        const guac_video_format* formats,
+        guac_video_encoder_check* has_encoder,
+        guac_video_format_check* is_supported, void* data);
+
+#endif
@@ -0,0 +1,522 @@
+/*
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ * KIND, either express or implied.  See the License for the
+ * specific language governing permissions and limitations
+ * under the License.
+ */
+
+#include "config.h"
+
+#include "guacamole/client.h"
+#include "guacamole/layer.h"
+#include "guacamole/video.h"
+
+#include <cairo/cairo.h>
+
+#ifdef ENABLE_VIDEO_STREAMING
+
+#include "guacamole/mem.h"
+#include "guacamole/protocol.h"
+#include "guacamole/socket.h"
+#include "guacamole/stream.h"
+#include "guacamole/timestamp.h"
+#include "guacamole/user.h"
+#include "video-format.h"
+
+#include <libavcodec/avcodec.h>
+#include <libavformat/avformat.h>
+#include <libavutil/dict.h>
+#include <libavutil/imgutils.h>
+#include <libavutil/mem.h>
+#include <libswscale/swscale.h>
+
+#include <stdint.h>
+
+/**
+ * The size of the buffer used by libavformat for output, in bytes. Each time
+ * this buffer fills or is flushed, its contents are sent as "blob"
+ * instructions.
+ */
+#define GUAC_VIDEO_IO_BUFFER_SIZE 6048
+
+/**
+ * The target bitrate of encoded video, in bits per pixel per frame. This is
+ * deliberately generous, as regions promoted to video typically contain
+ * high-motion content which would otherwise be sent as a series of JPEG or
+ * WebP images.
+ */
+#define GUAC_VIDEO_BITS_PER_PIXEL 0.1
+
+/**
+ * The maximum number of frames between keyframes. Shorter intervals allow
+ * playback to recover more quickly from dropped data at the cost of
+ * bandwidth.
+ */
+#define GUAC_VIDEO_KEYFRAME_INTERVAL 60
+
+struct guac_video_stream {
+
+    /**
+     * The client that owns this video stream.
+     */
+    guac_client* client;
+
+    /**
+     * The socket over which all video data is sent.
+     */
+    guac_socket* socket;
+
+    /**
+     * The underlying Guacamole stream over which video data is sent.
+     */
+    guac_stream* stream;
+
+    /**
+     * The width of each frame of video, in pixels.
+     */
+    int width;
+
+    /**
+     * The height of each frame of video, in pixels.
+     */
+    int height;
+
+    /**
+     * The libavformat context of the container being written.
+     */
+    AVFormatContext* format_context;
+
+    /**
+     * The libavcodec context of the encoder producing each frame.
+     */
+    AVCodecContext* codec_context;
+
+    /**
+     * The stream within the container receiving encoded frames.
+     */
+    AVStream* av_stream;
+
+    /**
+     * The frame which receives the converted contents of each image prior
+     * to encoding.
+     */
+    AVFrame* frame;
+
+    /**
+     * Reusable packet receiving encoded data from the encoder.
+     */
+    AVPacket* packet;
+
+    /**
+     * The libswscale context which converts each image to the pixel format
+     * required by the encoder.
+     */
+    struct SwsContext* sws;
+
+    /**
+     * The time that the first frame was written, in milliseconds, or zero if
+     * no frame has yet been written.
+     */
+    guac_timestamp start;
+
+    /**
+     * The presentation timestamp of the most recently written frame, in
+     * milliseconds relative to the start of the stream, or -1 if no frame has
+     * yet been written.
+     */
+    int64_t last_pts;
+
+};
+
+/**
+ * Returns whether the libavcodec encoder having the given name is available
+ * within this build of libavcodec.
+ *
+ * @param codec
+ *     The name of the libavcodec encoder to check.
+ *
+ * @return
+ *     Non-zero if the encoder is available, zero otherwise.
+ */
+static int guac_video_has_encoder(const char* codec) {
+    return avcodec_find_encoder_by_name(codec) != NULL;
+}
+
+/**
+ * Write callback for the AVIOContext of a video stream, sending each chunk of
+ * container data written by libavformat as one or more "blob" instructions.
+ *
+ * @param opaque
+ *     The guac_video_stream associated with the AVIOContext.
+ *
+ * @param buf
+ *     The container data to send.
+ *
+ * @param buf_size
+ *     The number of bytes of container data to send.
+ *
+ * @return
+ *     The number of bytes written, or a negative value on error.
+ */
+#if LIBAVFORMAT_VERSION_MAJOR >= 61
+static int guac_video_write_packet(void* opaque, const uint8_t* buf,
+        int buf_size) {
+#else
+static int guac_video_write_packet(void* opaque, uint8_t* buf,
+        int buf_size) {
+#endif
+
+    guac_video_stream* video = (guac_video_stream*) opaque;
+
+    if (guac_protocol_send_blobs(video->socket, video->stream, buf,
+                buf_size))
+        return AVERROR(EIO);
+
+    return buf_size;
+
+}
+
+/**
+ * Sends all encoded packets currently available from the encoder of the given
+ * video stream to the container, flushing the container output such that
+ * all users receive the data immediately.
+ *
+ * @param video
+ *     The video stream whose encoded packets should be written.
+ *
+ * @return
+ *     Zero if all available packets were written successfully, non-zero
+ *     otherwise.
+ */
+static int guac_video_write_packets(guac_video_stream* video) {
+
+    int ret;
+    while ((ret = avcodec_receive_packet(video->codec_context,
+                    video->packet)) == 0) {
+
+        av_packet_rescale_ts(video->packet, video->codec_context->time_base,
+                video->av_stream->time_base);
+        video->packet->stream_index = video->av_stream->index;
+
+        if (av_interleaved_write_frame(video->format_context,
+                    video->packet) < 0)
+            return 1;
+
+    }
+
+    /* Running out of packets is expected */
+    if (ret != AVERROR(EAGAIN) && ret != AVERROR_EOF)
+        return 1;
+
+    avio_flush(video->format_context->pb);
+    return 0;
+
+}
+
+int guac_client_supports_video(guac_client* client) {
+
+    return guac_video_select_format(guac_video_formats,
+            guac_video_has_encoder, guac_video_client_supports_format,
+            client) != NULL;
+
+}
+
+/**
+ * Allocates a new live video stream using the given video format, sending the
+ * corresponding "video" instruction over the given socket once the encoder
+ * has been opened. If the stream cannot be created, all partially-allocated
+ * resources are freed and NULL is returned, such that the caller may fall
+ * back to another format.
+ *
+ * @param client
+ *     The guac_client for which the video stream is being allocated.
+ *
+ * @param socket
+ *     The socket over which the video stream should be sent.
+ *
+ * @param layer
+ *     The layer within which the video should play back.
+ *
+ * @param format
+ *     The video format to encode.
+ *
+ * @param width
+ *     The width of each frame of video, in pixels.
+ *
+ * @param height
+ *     The height of each frame of video, in pixels.
+ *
+ * @param framerate
+ *     The nominal framerate of the video, in frames per second.
+ *
+ * @return
+ *     A newly-allocated guac_video_stream, or NULL if the stream could not be
+ *     created using the given format.
+ */
+static guac_video_stream* guac_video_stream_open(guac_client* client,
+        guac_socket* socket, const guac_layer* layer,
+        const guac_video_format* format, int width, int height,
+        int framerate) {
+
+    const AVCodec* codec = avcodec_find_encoder_by_name(format->codec);
+    if (codec == NULL)
+        return NULL;
+
+    guac_video_stream* video = guac_mem_zalloc(sizeof(guac_video_stream));
+    video->client = client;
+    video->socket = socket;
+    video->width = width;
+    video->height = height;
+    video->last_pts = -1;
+
+    AVDictionary* codec_options = NULL;
+    AVDictionary* container_options = NULL;
+
+    if (avformat_alloc_output_context2(&video->format_context, NULL,
+                format->container, NULL) < 0
+            || video->format_context == NULL) {
+        guac_client_log(client, GUAC_LOG_DEBUG, "Video container \"%s\" "
+                "is not available.", format->container);
+        goto fail;
+    }
+
+    video->av_stream = avformat_new_stream(video->format_context, NULL);
+    video->codec_context = avcodec_alloc_context3(codec);
+    video->frame = av_frame_alloc();
+    video->packet = av_packet_alloc();
+    if (video->av_stream == NULL || video->codec_context == NULL
+            || video->frame == NULL || video->packet == NULL)
+        goto fail;
+
+    /* Timestamps are in milliseconds, as frames are written as content
+     * changes rather than at a fixed rate */
+    AVCodecContext* context = video->codec_context;
+    context->width = width;
+    context->height = height;
+    context->pix_fmt = AV_PIX_FMT_YUV420P;
+    context->time_base = (AVRational) { 1, 1000 };
+    context->framerate = (AVRational) { framerate, 1 };
+    context->gop_size = GUAC_VIDEO_KEYFRAME_INTERVAL;
+    context->max_b_frames = 0;
+    context->bit_rate = (int64_t) (width * height * framerate
+            * GUAC_VIDEO_BITS_PER_PIXEL);
+
+    if (video->format_context->oformat->flags & AVFMT_GLOBALHEADER)
+        context->flags |= AV_CODEC_FLAG_GLOBAL_HEADER;
+
+    av_dict_parse_string(&codec_options, format->codec_options, "=", ":", 0);
+    if (avcodec_open2(context, codec, &codec_options) < 0) {
+        guac_client_log(client, GUAC_LOG_DEBUG, "Video encoder \"%s\" could "
+                "not be opened.", format->codec);
+        goto fail;
+    }
+
+    if (avcodec_parameters_from_context(video->av_stream->codecpar,
+                context) < 0)
+        goto fail;
+
+    video->av_stream->time_base = context->time_base;
+
+    /* Allocate frame receiving converted image data */
+    video->frame->format = context->pix_fmt;
+    video->frame->width = width;
+    video->frame->height = height;
+    if (av_frame_get_buffer(video->frame, 0) < 0)
+        goto fail;
+
+    /* Cairo pixels are native-endian 32-bit ARGB values */
+    video->sws = sws_getContext(width, height, AV_PIX_FMT_RGB32,
+            width, height, context->pix_fmt, SWS_FAST_BILINEAR,
+            NULL, NULL, NULL);
+    if (video->sws == NULL)
+        goto fail;
+
+    /* Direct all container output to the Guacamole stream */
+    unsigned char* io_buffer = av_malloc(GUAC_VIDEO_IO_BUFFER_SIZE);
+    if (io_buffer == NULL)
+        goto fail;
+
+    video->format_context->pb = avio_alloc_context(io_buffer,
+            GUAC_VIDEO_IO_BUFFER_SIZE, 1, video, NULL,
+            guac_video_write_packet, NULL);
+    if (video->format_context->pb == NULL) {
+        av_free(io_buffer);
+        goto fail;
+    }
+
+    /* Declare stream only once we know the encoder is ready */
+    video->stream = guac_client_alloc_stream(client);
+    guac_protocol_send_video(socket, video->stream, layer, format->mimetype);
+
+    av_dict_parse_string(&container_options, format->container_options,
+            "=", ":", 0);
+    if (avformat_write_header(video->format_context,
+                &container_options) < 0) {
+        guac_protocol_send_end(socket, video->stream);
+        goto fail;
+    }
+
+    av_dict_free(&codec_options);
+    av_dict_free(&container_options);
+
+    guac_client_log(client, GUAC_LOG_DEBUG, "Streaming %ix%i video as "
+            "\"%s\".", width, height, format->mimetype);
+
+    return video;
+
+fail:
+    av_dict_free(&codec_options);
+    av_dict_free(&container_options);
+
+    if (video->stream != NULL)
+        guac_client_free_stream(client, video->stream);
+
+    if (video->format_context != NULL) {
+        if (video->format_context->pb != NULL) {
+            av_freep(&video->format_context->pb->buffer);
+            avio_context_free(&video->format_context->pb);
+        }
+        avformat_free_context(video->format_context);
+    }
+
+    sws_freeContext(video->sws);
+    av_packet_free(&video->packet);
+    av_frame_free(&video->frame);
+    avcodec_free_context(&video->codec_context);
+    guac_mem_free(video);
+    return NULL;
+
+}
+
+guac_video_stream* guac_video_stream_alloc(guac_client* client,
+        guac_socket* socket, const guac_layer* layer, int width, int height,
+        int framerate) {
+
+    /* Most encoders require even dimensions for 4:2:0 chroma subsampling */
+    if (width < 2 || height < 2 || width % 2 || height % 2 || framerate <= 0)
+        return NULL;
+
+    /* Fall back to later formats if the encoder or container of a preferred
+     * format turns out to be unusable */
+    const guac_video_format* format = guac_video_select_format(
+            guac_video_formats, guac_video_has_encoder,
+            guac_video_client_supports_format, client);
+
+    while (format != NULL) {
+
+        guac_video_stream* video = guac_video_stream_open(client, socket,
+                layer, format, width, height, framerate);
+
+        if (video != NULL)
+            return video;
+
+        format = guac_video_select_format(format + 1,
+                guac_video_has_encoder, guac_video_client_supports_format,
+                client);
+
+    }
+
+    return NULL;
+
+}
+
+int guac_video_stream_write(guac_video_stream* video, cairo_surface_t* frame) {
+
+    if (cairo_image_surface_get_width(frame) != video->width
+            || cairo_image_surface_get_height(frame) != video->height)
+        return 1;
+
+    /* Timestamp frame relative to first frame, ensuring timestamps strictly
+     * increase even if frames are written within the same millisecond */
+    guac_timestamp now = guac_timestamp_current();
+    if (video->start == 0)
+        video->start = now;
+
+    int64_t pts = now - video->start;
+    if (pts <= video->last_pts)
+        pts = video->last_pts + 1;
+
+    if (av_frame_make_writable(video->frame) < 0)
+        return 1;
+
+    /* Convert image to the encoder's pixel format */
+    cairo_surface_flush(frame);
+    const uint8_t* src_data[1] = { cairo_image_surface_get_data(frame) };
+    const int src_stride[1] = { cairo_image_surface_get_stride(frame) };
+
+    sws_scale(video->sws, src_data, src_stride, 0, video->height,
+            video->frame->data, video->frame->linesize);
+
+    video->frame->pts = pts;
+    video->last_pts = pts;
+
+    if (avcodec_send_frame(video->codec_context, video->frame) < 0)
+        return 1;
+
+    return guac_video_write_packets(video);
+
+}
+
+void guac_video_stream_free(guac_video_stream* video) {
+
+    /* Flush any frames still buffered within the encoder */
+    if (avcodec_send_frame(video->codec_context, NULL) == 0)
+        guac_video_write_packets(video);
+
+    av_write_trailer(video->format_context);
+    avio_flush(video->format_context->pb);
+
+    guac_protocol_send_end(video->socket, video->stream);
+    guac_client_free_stream(video->client, video->stream);
+
+    av_freep(&video->format_context->pb->buffer);
+    avio_context_free(&video->format_context->pb);
+    avformat_free_context(video->format_context);
+
+    sws_freeContext(video->sws);
+    av_packet_free(&video->packet);
+    av_frame_free(&video->frame);
+    avcodec_free_context(&video->codec_context);
+    guac_mem_free(video);
+
+}
+
+#else
+
+/*
+ * Live video streaming requires libavcodec, libavformat, libavutil and
+ * libswscale. Without them, video is never supported and all encoding is
+ * performed using images.
+ */
+
+int guac_client_supports_video(guac_client* client) {
+    return 0;
+}
+
+guac_video_stream* guac_video_stream_alloc(guac_client* client,
+        guac_socket* socket, const guac_layer* layer, int width, int height,
+        int framerate) {
+    return NULL;
+}
+
+int guac_video_stream_write(guac_video_stream* video, cairo_surface_t* frame) {
+    return 1;
+}
+
+void guac_video_stream_free(guac_video_stream* video) {
+}
+
+#endif
+
@@ -0,0 +1,454 @@
+/*
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ * KIND, either express or implied.  See the License for the
+ * specific language governing permissions and limitations
+ * under the License.
+ */
+
+#include "config.h"
+
+#include "guacamole/mem.h"
+#include "guacamole/timestamp.h"
+#include "guacamole/writer.h"
+
+#include <errno.h>
+#include <pthread.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+#include <sys/uio.h>
+#include <time.h>
+#include <unistd.h>
+
+/**
+ * Returns the number of queued bytes which the background thread of the
+ * given writer should write now. Unless a flush or stop has been requested,
+ * or the queue is at least half full, only whole blocks are written, with
+ * each write ending on a block boundary relative to the start of the file.
+ * The writer must be locked.
+ *
+ * @param writer
+ *     The guac_writer to check.
+ *
+ * @return
+ *     The number of bytes which should be written now, which may be zero.
+ */
+static size_t guac_writer_ready(guac_writer* writer) {
+
+    if (writer->__flush_requested || writer->__stop_requested)
+        return writer->__queue_length;
+
+    /* Do not let producers run out of space while waiting for a block */
+    if (writer->__queue_length >= writer->__queue_size / 2)
+        return writer->__queue_length;
+
+    uint64_t end = writer->__offset + writer->__queue_length;
+    size_t partial = end % GUAC_WRITER_BLOCK_SIZE;
+
+    if (writer->__queue_length < partial)
+        return 0;
+
+    return writer->__queue_length - partial;
+
+}
+
+/**
+ * Waits on the condition of the given writer for at most the given number of
+ * milliseconds. The writer must be locked.
+ *
+ * @param writer
+ *     The guac_writer to wait on.
+ *
+ * @param msec
+ *     The maximum number of milliseconds to wait, or a negative value to
+ *     wait indefinitely.
+ */
+static void guac_writer_wait(guac_writer* writer, int msec) {
+
+    if (msec < 0) {
+        pthread_cond_wait(&writer->__queued, &writer->__lock);
+        return;
+    }
+
+    struct timespec deadline;
+    clock_gettime(CLOCK_REALTIME, &deadline);
+
+    deadline.tv_sec += msec / 1000;
+    deadline.tv_nsec += (msec % 1000) * 1000000L;
+    if (deadline.tv_nsec >= 1000000000L) {
+        deadline.tv_sec++;
+        deadline.tv_nsec -= 1000000000L;
+    }
+
+    pthread_cond_timedwait(&writer->__queued, &writer->__lock, &deadline);
+
+}
+
+/**
+ * Writes the given number of bytes from the start of the queue of the given
+ * writer to its file descriptor using as few system calls as possible. The
+ * writer must NOT be locked, and the queued data being written must not be
+ * modified until this function returns.
+ *
+ * @param writer
+ *     The guac_writer whose queued data should be written.
+ *
+ * @param length
+ *     The number of bytes to write from the start of the queue.
+ *
+ * @return
+ *     The number of bytes written, which is less than the requested length
+ *     only if an error prevented the remaining data from being written.
+ */
+static size_t guac_writer_write_queue(guac_writer* writer, size_t length) {
+
+    struct iovec iov[2];
+    int iovcnt = 1;
+
+    /* Queued data may wrap around the end of the circular buffer */
+    size_t first = writer->__queue_size - writer->__queue_start;
+    if (first > length)
+        first = length;
+
+    iov[0].iov_base = writer->__queue + writer->__queue_start;
+    iov[0].iov_len = first;
+
+    if (first < length) {
+        iov[1].iov_base = writer->__queue;
+        iov[1].iov_len = length - first;
+        iovcnt = 2;
+    }
+
+    size_t total = 0;
+
+    struct iovec* current = iov;
+    while (iovcnt > 0) {
+
+        ssize_t written = writev(writer->fd, current, iovcnt);
+        if (written < 0) {
+            if (errno == EINTR)
+                continue;
+            return total;
+        }
+
+        total += written;
+
+        /* Advance past any completely-written segments */
+        while (iovcnt > 0 && (size_t) written >= current->iov_len) {
+            written -= current->iov_len;
+            current++;
+            iovcnt--;
+        }
+
+        /* Advance within any partially-written segment */
+        if (iovcnt > 0) {
+            current->iov_base = (char*) current->iov_base + written;
+            current->iov_len -= written;
+        }
+
+    }
+
+    return total;
+
+}
+
+/**
+ * Removes all marks of the given writer which describe only data which has
+ * been written, such that the first mark describes the oldest queued byte.
+ * The writer must be locked.
+ *
+ * @param writer
+ *     The guac_writer whose marks should be updated.
+ */
+static void guac_writer_remove_marks(guac_writer* writer) {
+
+    if (writer->__queue_length == 0) {
+        writer->__mark_count = 0;
+        return;
+    }
+
+    /* The oldest queued byte was queued no earlier than the last mark at or
+     * before its offset */
+    int written = 0;
+    while (written + 1 < writer->__mark_count
+            && writer->__marks[written + 1].offset <= writer->__offset)
+        written++;
+
+    writer->__mark_count -= written;
+    memmove(writer->__marks, writer->__marks + written,
+            writer->__mark_count * sizeof(guac_writer_mark));
+
+}
+
+/**
+ * The background thread of a guac_writer, writing queued data to the file
+ * descriptor of that writer until the writer is stopped.
+ *
+ * @param data
+ *     The guac_writer whose queued data should be written.
+ *
+ * @return
+ *     Always NULL.
+ */
+static void* guac_writer_thread(void* data) {
+
+    guac_writer* writer = (guac_writer*) data;
+    int unsynced = 0;
+
+    pthread_mutex_lock(&writer->__lock);
+
+    for (;;) {
+
+        size_t length = guac_writer_ready(writer);
+        guac_timestamp now = guac_timestamp_current();
+
+        /* Sync with storage if the sync interval has elapsed */
+        if (unsynced && writer->sync_interval > 0
+                && now - writer->__last_sync >= writer->sync_interval) {
+            pthread_mutex_unlock(&writer->__lock);
+            fsync(writer->fd);
+            pthread_mutex_lock(&writer->__lock);
+            writer->__last_sync = now;
+            unsynced = 0;
+        }
+
+        if (length == 0) {
+
+            /* Stop only once everything has been written */
+            if (writer->__stop_requested)
+                break;
+
+            /* Any requested flush is complete once the queue is empty */
+            if (writer->__queue_length == 0)
+                writer->__flush_requested = 0;
+
+            /* Wait for a full block, but write partial blocks anyway if they
+             * have waited for too long */
+            int timeout = -1;
+            if (writer->__queue_length > 0) {
+                timeout = GUAC_WRITER_MAX_DELAY
+                    - (now - writer->__marks[0].timestamp);
+                if (timeout <= 0) {
+                    writer->__flush_requested = 1;
+                    continue;
+                }
+            }
+
+            /* Wake in time for the next sync, if any */
+            if (unsynced && writer->sync_interval > 0) {
+                int until_sync = writer->sync_interval
+                    - (now - writer->__last_sync);
+                if (timeout < 0 || until_sync < timeout)
+                    timeout = until_sync;
+            }
+
+            guac_writer_wait(writer, timeout);
+            continue;
+
+        }
+
+        /* Write without holding the lock, such that writes to the queue are
+         * never blocked by storage. Only free space is modified by other
+         * threads, so the data being written remains untouched. */
+        pthread_mutex_unlock(&writer->__lock);
+        size_t written = guac_writer_write_queue(writer, length);
+
+        if (written > 0 && writer->sync_interval == GUAC_WRITER_SYNC_ALWAYS)
+            fsync(writer->fd);
+
+        pthread_mutex_lock(&writer->__lock);
+
+        writer->bytes_written += written;
+        if (written > 0)
+            unsynced = 1;
+
+        /* Stop writing entirely after the first error, discarding everything
+         * still queued, such that the file is never continued past data that
+         * was only partially written */
+        if (written < length) {
+            writer->__failed = 1;
+            length = writer->__queue_length;
+            writer->bytes_dropped += length - written;
+        }
+
+        if (writer->sync_interval == GUAC_WRITER_SYNC_ALWAYS)
+            unsynced = 0;
+
+        /* Remove written (or discarded) data from queue */
+        writer->__offset += length;
+        writer->__queue_start = (writer->__queue_start + length)
+            % writer->__queue_size;
+        writer->__queue_length -= length;
+
+        guac_writer_remove_marks(writer);
+
+    }
+
+    pthread_mutex_unlock(&writer->__lock);
+
+    /* Ensure everything written has reached storage, unless syncing is
+     * disabled entirely */
+    if (unsynced && writer->sync_interval != GUAC_WRITER_SYNC_NEVER)
+        fsync(writer->fd);
+
+    return NULL;
+
+}
+
+guac_writer* guac_writer_alloc(int fd, size_t queue_size, int sync_interval) {
+
+    guac_writer* writer = guac_mem_zalloc(sizeof(guac_writer));
+
+    writer->fd = fd;
+    writer->sync_interval = sync_interval;
+    writer->__queue = guac_mem_alloc(queue_size);
+    writer->__queue_size = queue_size;
+    writer->__last_sync = guac_timestamp_current();
+
+    pthread_mutex_init(&writer->__lock, NULL);
+    pthread_cond_init(&writer->__queued, NULL);
+
+    if (pthread_create(&writer->__writer_thread, NULL, guac_writer_thread, writer)) {
+        pthread_cond_destroy(&writer->__queued);
+        pthread_mutex_destroy(&writer->__lock);
+        guac_mem_free(writer->__queue);
+        guac_mem_free(writer);
+        return NULL;
+    }
+
+    return writer;
+
+}
+
+int guac_writer_write(guac_writer* writer, const void* buffer, size_t length) {
+
+    pthread_mutex_lock(&writer->__lock);
+
+    /* Drop the entire write if it does not fit or can no longer be written */
+    if (writer->__stop_requested || writer->__failed
+            || length > writer->__queue_size - writer->__queue_length) {
+        writer->bytes_dropped += length;
+        writer->writes_dropped++;
+        pthread_mutex_unlock(&writer->__lock);
+        return 1;
+    }
+
+    int was_empty = (writer->__queue_length == 0);
+
+    /* Record when this data was queued, unless data was already queued
+     * within the same millisecond or no further times can be tracked */
+    guac_timestamp now = guac_timestamp_current();
+    int marks = writer->__mark_count;
+    if (marks == 0 || (marks < GUAC_WRITER_MAX_MARKS
+                && writer->__marks[marks - 1].timestamp != now)) {
+        writer->__marks[marks].offset = writer->__offset
+            + writer->__queue_length;
+        writer->__marks[marks].timestamp = now;
+        writer->__mark_count++;
+    }
+
+    size_t was_ready = guac_writer_ready(writer);
+
+    /* Copy data to end of queue, wrapping around if necessary */
+    size_t end = (writer->__queue_start + writer->__queue_length)
+        % writer->__queue_size;
+
+    size_t first = writer->__queue_size - end;
+    if (first > length)
+        first = length;
+
+    memcpy(writer->__queue + end, buffer, first);
+    memcpy(writer->__queue, (const char*) buffer + first, length - first);
+
+    writer->__queue_length += length;
+
+    /* Wake background thread only once there is a new block to write, or if
+     * the queue was previously empty (such that the maximum delay for partial
+     * blocks is honored) */
+    if (guac_writer_ready(writer) != was_ready || was_empty)
+        pthread_cond_signal(&writer->__queued);
+
+    pthread_mutex_unlock(&writer->__lock);
+    return 0;
+
+}
+
+size_t guac_writer_available(guac_writer* writer) {
+
+    pthread_mutex_lock(&writer->__lock);
+    size_t available = writer->__queue_size - writer->__queue_length;
+    pthread_mutex_unlock(&writer->__lock);
+
+    return available;
+
+}
+
+void guac_writer_flush(guac_writer* writer) {
+
+    pthread_mutex_lock(&writer->__lock);
+
+    if (writer->__queue_length > 0) {
+        writer->__flush_requested = 1;
+        pthread_cond_signal(&writer->__queued);
+    }
+
+    pthread_mutex_unlock(&writer->__lock);
+
+}
+
+uint64_t guac_writer_get_dropped(guac_writer* writer) {
+
+    pthread_mutex_lock(&writer->__lock);
+    uint64_t dropped = writer->bytes_dropped;
+    pthread_mutex_unlock(&writer->__lock);
+
+    return dropped;
+
+}
+
+void guac_writer_stop(guac_writer* writer) {
+
+    pthread_mutex_lock(&writer->__lock);
+
+    /* Do nothing if already stopping */
+    if (writer->__stop_requested) {
+        pthread_mutex_unlock(&writer->__lock);
+        return;
+    }
+
+    writer->__stop_requested = 1;
+    pthread_cond_signal(&writer->__queued);
+    pthread_mutex_unlock(&writer->__lock);
+
+    pthread_join(writer->__writer_thread, NULL);
+
+}
+
+void guac_writer_free(guac_writer* writer) {
+
+    /* Ignore NULL writer */
+    if (writer == NULL)
+        return;
+
+    guac_writer_stop(writer);
+
+    pthread_cond_destroy(&writer->__queued);
+    pthread_mutex_destroy(&writer->__lock);
+
+    guac_mem_free(writer->__queue);
+    guac_mem_free(writer);
+
+}
+
@@ -234,7 +234,8 @@ void* guac_kubernetes_client_thread(void* data) {
                 settings->recording_path,
                 settings->recording_name,
                 settings->create_recording_path,
-                !settings->recording_exclude_output,
+                !settings->recording_exclude_output
+                    && !settings->recording_cells,
                 !settings->recording_exclude_mouse,
                 0, /* Touch events not supported */
                 settings->recording_include_keys,
@@ -252,6 +253,8 @@ void* guac_kubernetes_client_thread(void* data) {
     options->font_size = settings->font_size;
     options->color_scheme = settings->color_scheme;
     options->backspace = settings->backspace;
+    options->glyph_atlas = settings->glyph_atlas;
+    options->resident_scrollback = settings->resident_scrollback;
 
     /* Create terminal */
     kubernetes_client->term = guac_terminal_create(client, options);
@@ -270,6 +273,12 @@ void* guac_kubernetes_client_thread(void* data) {
     guac_client_for_owner(client, guac_kubernetes_send_current_argv,
             kubernetes_client);
 
+    /* Record terminal display as character cells, if requested */
+    if (kubernetes_client->recording != NULL && settings->recording_cells
+            && !settings->recording_exclude_output)
+        guac_terminal_create_cell_recording(kubernetes_client->term,
+                kubernetes_client->recording->socket);
+
     /* Set up typescript, if requested */
     if (settings->typescript_path != NULL) {
         guac_terminal_create_typescript(kubernetes_client->term,
@@ -58,6 +58,9 @@ const char* GUAC_KUBERNETES_CLIENT_ARGS[] = {
     "scrollback",
     "disable-copy",
     "disable-paste",
+    "glyph-atlas",
+    "scrollback-resident",
+    "recording-cells",
     NULL
 };
 
@@ -255,6 +258,28 @@ enum KUBERNETES_ARGS_IDX {
      */
     IDX_DISABLE_PASTE,
 
+    /**
+     * Whether rendered glyphs should be stored within an off-screen buffer on
+     * the client, with text drawn by copying from that buffer rather than
+     * sent as images. By default, glyphs are sent as images.
+     */
+    IDX_GLYPH_ATLAS,
+
+    /**
+     * The number of rows of scrollback to hold in memory. Any older rows are
+     * moved to a temporary memory-mapped file. By default (or if zero), all
+     * scrollback is held in memory.
+     */
+    IDX_SCROLLBACK_RESIDENT,
+
+    /**
+     * Whether the terminal display should be recorded as character cell
+     * updates rather than as rendered graphics. Cell recordings are far
+     * smaller and can still be rendered to video by guacenc. By default,
+     * rendered graphics are recorded.
+     */
+    IDX_RECORDING_CELLS,
+
     KUBERNETES_ARGS_COUNT
 };
 
@@ -413,6 +438,11 @@ guac_kubernetes_settings* guac_kubernetes_parse_args(guac_user* user,
         guac_user_parse_args_boolean(user, GUAC_KUBERNETES_CLIENT_ARGS, argv,
                 IDX_RECORDING_WRITE_EXISTING, false);
 
+    /* Parse cell recording flag */
+    settings->recording_cells =
+        guac_user_parse_args_boolean(user, GUAC_KUBERNETES_CLIENT_ARGS, argv,
+                IDX_RECORDING_CELLS, false);
+
     /* Parse backspace key code */
     settings->backspace =
         guac_user_parse_args_int(user, GUAC_KUBERNETES_CLIENT_ARGS, argv,
@@ -428,6 +458,16 @@ guac_kubernetes_settings* guac_kubernetes_parse_args(guac_user* user,
         guac_user_parse_args_boolean(user, GUAC_KUBERNETES_CLIENT_ARGS, argv,
                 IDX_DISABLE_PASTE, false);
 
+    /* Parse glyph atlas flag */
+    settings->glyph_atlas =
+        guac_user_parse_args_boolean(user, GUAC_KUBERNETES_CLIENT_ARGS, argv,
+                IDX_GLYPH_ATLAS, false);
+
+    /* Read number of scrollback rows to hold in memory */
+    settings->resident_scrollback =
+        guac_user_parse_args_int(user, GUAC_KUBERNETES_CLIENT_ARGS, argv,
+                IDX_SCROLLBACK_RESIDENT, GUAC_TERMINAL_DEFAULT_RESIDENT_SCROLLBACK);
+
     /* Parsing was successful */
     return settings;
 
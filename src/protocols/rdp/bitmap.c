@@ -29,9 +29,49 @@
 #include <winpr/crt.h>
 #include <winpr/wtypes.h>
 
+#include <stdint.h>
 #include <stdio.h>
 #include <stdlib.h>
 
+/**
+ * Regenerates the evicted contents of the buffer caching the given bitmap
+ * from the bitmap's original image data. This function is a
+ * guac_common_surface_restore_handler.
+ *
+ * @param buffer
+ *     The buffer which must receive the bitmap's image data.
+ *
+ * @param width
+ *     The width of the buffer, in pixels.
+ *
+ * @param height
+ *     The height of the buffer, in pixels.
+ *
+ * @param stride
+ *     The number of bytes in each row of the buffer.
+ *
+ * @param data
+ *     The rdpBitmap whose image data should be restored.
+ */
+static void guac_rdp_bitmap_restore(unsigned char* buffer, int width,
+        int height, int stride, void* data) {
+
+    rdpBitmap* bitmap = (rdpBitmap*) data;
+
+    for (int y = 0; y < height; y++) {
+
+        const uint32_t* src = (const uint32_t*) (bitmap->data
+                + y * 4 * bitmap->width);
+        uint32_t* dst = (uint32_t*) (buffer + y * stride);
+
+        /* Image data is opaque RGB, lacking an alpha channel */
+        for (int x = 0; x < width; x++)
+            *(dst++) = *(src++) | 0xFF000000;
+
+    }
+
+}
+
 void guac_rdp_cache_bitmap(rdpContext* context, rdpBitmap* bitmap) {
 
     guac_client* client = ((rdp_freerdp_context*) context)->client;
@@ -55,6 +95,11 @@ void guac_rdp_cache_bitmap(rdpContext* context, rdpBitmap* bitmap) {
         /* Free surface */
         cairo_surface_destroy(image);
 
+        /* The image data can regenerate the buffer's contents, thus those
+         * contents need not be kept in memory while unused */
+        guac_common_surface_set_restore_handler(buffer->surface,
+                guac_rdp_bitmap_restore, bitmap);
+
     }
 
     /* Store buffer reference in bitmap */
@@ -161,6 +206,11 @@ BOOL guac_rdp_bitmap_setsurface(rdpContext* context, rdpBitmap* bitmap, BOOL pri
         rdp_client->current_surface =
             ((guac_rdp_bitmap*) bitmap)->layer->surface;
 
+        /* Drawing to the bitmap will make its contents differ from its
+         * original image data, which can then no longer restore them */
+        guac_common_surface_set_restore_handler(rdp_client->current_surface,
+                NULL, NULL);
+
     }
 
     return TRUE;
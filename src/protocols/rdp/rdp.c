@@ -479,9 +479,20 @@ static int guac_rdp_handle_connection(guac_client* client) {
             rdp_client->settings->width,
             rdp_client->settings->height);
 
+    /* Include all graphical updates within any recording */
+    if (rdp_client->recording != NULL)
+        guac_common_display_set_recording(rdp_client->display,
+                rdp_client->recording);
+
     /* Use lossless compression only if requested (otherwise, use default
      * heuristics) */
     guac_common_display_set_lossless(rdp_client->display, settings->lossless);
+    guac_common_display_set_refresh_interval(rdp_client->display,
+            settings->lossless_refresh_interval);
+
+    /* Limit memory used by server-side copies of cached bitmaps */
+    guac_common_display_set_memory_limit(rdp_client->display,
+            GUAC_RDP_SURFACE_MEMORY_LIMIT);
 
     rdp_client->current_surface = rdp_client->display->default_surface;
 
@@ -558,6 +569,10 @@ static int guac_rdp_handle_connection(guac_client* client) {
 
             int processing_lag = guac_client_get_processing_lag(client);
 
+            /* Lengthen frames as needed to keep network latency bounded */
+            int frame_duration = guac_client_suggest_frame_duration(client,
+                    GUAC_RDP_FRAME_DURATION);
+
             /* Read server messages until frame is built */
             do {
 
@@ -586,7 +601,7 @@ static int guac_rdp_handle_connection(guac_client* client) {
                 /* Calculate time remaining in frame */
                 guac_timestamp frame_start = client->last_sent_timestamp;
                 frame_end = guac_timestamp_current();
-                frame_remaining = frame_start + GUAC_RDP_FRAME_DURATION
+                frame_remaining = frame_start + frame_duration
                                 - frame_end;
 
                 /* Calculate time that client needs to catch up */
@@ -66,6 +66,14 @@
 #define GUAC_RDP_CONTEXT(rdp_instance) ((rdp_instance))
 #endif
 
+/**
+ * The number of bytes of surface memory that a single RDP connection may use
+ * before the server-side copies of its least-recently used cached bitmaps are
+ * evicted. Evicted bitmaps remain cached client-side, and their server-side
+ * copies are regenerated from the original bitmap data as needed.
+ */
+#define GUAC_RDP_SURFACE_MEMORY_LIMIT 67108864
+
 /**
  * RDP-specific client data.
  */
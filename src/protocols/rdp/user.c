@@ -62,12 +62,22 @@ int guac_rdp_user_join_handler(guac_user* user, int argc, char** argv) {
     /* Store settings at user level */
     user->data = settings;
 
+    /* Limit the rate of data sent to this user, if requested (kilobits per
+     * second, 125 bytes each) */
+    if (settings->bandwidth_limit > 0)
+        guac_user_set_rate_limit(user, settings->bandwidth_limit * 125);
+
     /* Connect via RDP if owner */
     if (user->owner) {
 
         /* Store owner's settings at client level */
         rdp_client->settings = settings;
 
+        /* Limit the combined rate of data sent to all users, if requested */
+        if (settings->connection_bandwidth_limit > 0)
+            guac_client_set_rate_limit(user->client,
+                    settings->connection_bandwidth_limit * 125);
+
         /* Start client thread */
         if (pthread_create(&rdp_client->client_thread, NULL,
                     guac_rdp_client_thread, user->client)) {
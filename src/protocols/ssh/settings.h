@@ -159,6 +159,20 @@ typedef struct guac_ssh_settings {
      */
     bool disable_paste;
 
+    /**
+     * Whether rendered glyphs should be stored within an off-screen buffer on
+     * the client, with text drawn by copying from that buffer rather than
+     * sent as images.
+     */
+    bool glyph_atlas;
+
+    /**
+     * The number of rows of scrollback to hold in memory, with any older rows
+     * moved to a temporary memory-mapped file, or zero if all scrollback
+     * should be held in memory.
+     */
+    int resident_scrollback;
+
     /**
      * Whether SFTP is enabled.
      */
@@ -263,6 +277,13 @@ typedef struct guac_ssh_settings {
      */
     bool recording_write_existing;
 
+    /**
+     * Whether the terminal display should be recorded as character cell
+     * updates (see guac_terminal_create_cell_recording()) rather than as
+     * rendered graphics. Disabled by default.
+     */
+    bool recording_cells;
+
     /**
      * The number of seconds between sending server alive messages.
      */
@@ -280,7 +280,8 @@ void* ssh_client_thread(void* data) {
                 settings->recording_path,
                 settings->recording_name,
                 settings->create_recording_path,
-                !settings->recording_exclude_output,
+                !settings->recording_exclude_output
+                    && !settings->recording_cells,
                 !settings->recording_exclude_mouse,
                 0, /* Touch events not supported */
                 settings->recording_include_keys,
@@ -298,6 +299,8 @@ void* ssh_client_thread(void* data) {
     options->font_size = settings->font_size;
     options->color_scheme = settings->color_scheme;
     options->backspace = settings->backspace;
+    options->glyph_atlas = settings->glyph_atlas;
+    options->resident_scrollback = settings->resident_scrollback;
 
     /* Create terminal */
     ssh_client->term = guac_terminal_create(client, options);
@@ -315,6 +318,12 @@ void* ssh_client_thread(void* data) {
     /* Send current values of exposed arguments to owner only */
     guac_client_for_owner(client, guac_ssh_send_current_argv, ssh_client);
 
+    /* Record terminal display as character cells, if requested */
+    if (ssh_client->recording != NULL && settings->recording_cells
+            && !settings->recording_exclude_output)
+        guac_terminal_create_cell_recording(ssh_client->term,
+                ssh_client->recording->socket);
+
     /* Set up typescript, if requested */
     if (settings->typescript_path != NULL) {
         guac_terminal_create_typescript(ssh_client->term,
@@ -109,13 +109,14 @@ int guac_telnet_client_free_handler(guac_client* client) {
     if (telnet_client->socket_fd != -1)
         close(telnet_client->socket_fd);
 
-    /* Clean up recording, if in progress */
-    if (telnet_client->recording != NULL)
-        guac_recording_free(telnet_client->recording);
-
     /* Kill terminal */
     guac_terminal_free(telnet_client->term);
 
+    /* Clean up recording, if in progress (after the terminal, which may
+     * still write to the recording as it is freed) */
+    if (telnet_client->recording != NULL)
+        guac_recording_free(telnet_client->recording);
+
     /* Wait for and free telnet session, if connected */
     if (telnet_client->telnet != NULL) {
         pthread_join(telnet_client->client_thread, NULL);
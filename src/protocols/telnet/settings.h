@@ -179,6 +179,20 @@ typedef struct guac_telnet_settings {
      */
     bool disable_paste;
 
+    /**
+     * Whether rendered glyphs should be stored within an off-screen buffer on
+     * the client, with text drawn by copying from that buffer rather than
+     * sent as images.
+     */
+    bool glyph_atlas;
+
+    /**
+     * The number of rows of scrollback to hold in memory, with any older rows
+     * moved to a temporary memory-mapped file, or zero if all scrollback
+     * should be held in memory.
+     */
+    int resident_scrollback;
+
     /**
      * The path in which the typescript should be saved, if enabled. If no
      * typescript should be saved, this will be NULL.
@@ -251,6 +265,13 @@ typedef struct guac_telnet_settings {
      */
     bool recording_write_existing;
 
+    /**
+     * Whether the terminal display should be recorded as character cell
+     * updates (see guac_terminal_create_cell_recording()) rather than as
+     * rendered graphics. Disabled by default.
+     */
+    bool recording_cells;
+
     /**
      * The ASCII code, as an integer, that the telnet client will use when the
      * backspace key is pressed.  By default, this is 127, ASCII delete, if
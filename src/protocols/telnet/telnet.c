@@ -532,7 +532,8 @@ void* guac_telnet_client_thread(void* data) {
                 settings->recording_path,
                 settings->recording_name,
                 settings->create_recording_path,
-                !settings->recording_exclude_output,
+                !settings->recording_exclude_output
+                    && !settings->recording_cells,
                 !settings->recording_exclude_mouse,
                 0, /* Touch events not supported */
                 settings->recording_include_keys,
@@ -550,6 +551,8 @@ void* guac_telnet_client_thread(void* data) {
     options->font_size = settings->font_size;
     options->color_scheme = settings->color_scheme;
     options->backspace = settings->backspace;
+    options->glyph_atlas = settings->glyph_atlas;
+    options->resident_scrollback = settings->resident_scrollback;
 
     /* Create terminal */
     telnet_client->term = guac_terminal_create(client, options);
@@ -568,6 +571,12 @@ void* guac_telnet_client_thread(void* data) {
     guac_client_for_owner(client, guac_telnet_send_current_argv,
             telnet_client);
 
+    /* Record terminal display as character cells, if requested */
+    if (telnet_client->recording != NULL && settings->recording_cells
+            && !settings->recording_exclude_output)
+        guac_terminal_create_cell_recording(telnet_client->term,
+                telnet_client->recording->socket);
+
     /* Set up typescript, if requested */
     if (settings->typescript_path != NULL) {
         guac_terminal_create_typescript(telnet_client->term,
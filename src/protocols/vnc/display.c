@@ -68,9 +68,9 @@ void guac_vnc_update(rfbClient* client, int x, int y, int w, int h) {
         return;
     }
 
-    /* Init Cairo buffer */
+    /* Init Cairo buffer within this thread's frame arena */
     stride = cairo_format_stride_for_width(CAIRO_FORMAT_RGB24, w);
-    buffer = guac_mem_alloc(h, stride);
+    buffer = guac_mem_arena_alloc(h, stride);
     buffer_row_current = buffer;
 
     bpp = client->format.bitsPerPixel/8;
@@ -135,7 +135,7 @@ void guac_vnc_update(rfbClient* client, int x, int y, int w, int h) {
 
     /* Free surface */
     cairo_surface_destroy(surface);
-    guac_mem_free(buffer);
+    guac_mem_arena_free(buffer);
 
 }
 
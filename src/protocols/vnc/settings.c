@@ -22,9 +22,11 @@
 #include "argv.h"
 #include "client.h"
 #include "common/defaults.h"
+#include "common/surface.h"
 #include "settings.h"
 
 #include <guacamole/mem.h>
+#include <guacamole/rate-limit-constants.h>
 #include <guacamole/user.h>
 #include <guacamole/wol-constants.h>
 
@@ -96,8 +98,11 @@ const char* GUAC_VNC_CLIENT_ARGS[] = {
     "wol-wait-time",
 
     "force-lossless",
+    "lossless-refresh-interval",
     "compress-level",
     "quality-level",
+    "bandwidth-limit",
+    "connection-bandwidth-limit",
     NULL
 };
 
@@ -398,6 +403,14 @@ enum VNC_ARGS_IDX {
      */
     IDX_FORCE_LOSSLESS,
 
+    /**
+     * The number of milliseconds that an area sent using lossy compression
+     * must remain unchanged before it is resent losslessly, or zero to never
+     * resend lossy areas. By default, GUAC_COMMON_SURFACE_REFRESH_INTERVAL is
+     * used.
+     */
+    IDX_LOSSLESS_REFRESH_INTERVAL,
+
     /**
      * The level of compression, on a scale of 0 (no compression) to 9 (maximum
      * compression), that the connection will be configured for.
@@ -410,9 +423,62 @@ enum VNC_ARGS_IDX {
      */
     IDX_QUALITY_LEVEL,
 
+    /**
+     * The maximum rate, in kilobits per second, at which data may be sent to
+     * the user providing this parameter. If blank or zero, the rate is not
+     * limited.
+     */
+    IDX_BANDWIDTH_LIMIT,
+
+    /**
+     * The maximum combined rate, in kilobits per second, at which data may be
+     * sent to all users of the connection. Only the value provided by the
+     * owner of the connection is used. If blank or zero, the rate is not
+     * limited.
+     */
+    IDX_CONNECTION_BANDWIDTH_LIMIT,
+
     VNC_ARGS_COUNT
 };
 
+/**
+ * Parses the bandwidth limit, in kilobits per second, given for the argument
+ * having the given index. Limits which are negative, or which are too large
+ * to be represented in bytes per second (see GUAC_RATE_LIMIT_MAX_KBPS), are
+ * ignored with a warning.
+ *
+ * @param user
+ *     The user who submitted the given arguments while joining the
+ *     connection.
+ *
+ * @param argv
+ *     The values of all arguments provided by the user.
+ *
+ * @param index
+ *     The index of the bandwidth limit argument within argv.
+ *
+ * @return
+ *     The requested bandwidth limit, in kilobits per second, or zero if the
+ *     bandwidth should not be limited.
+ */
+static int guac_vnc_parse_bandwidth_limit(guac_user* user, const char** argv,
+        int index) {
+
+    int limit = guac_user_parse_args_int(user, GUAC_VNC_CLIENT_ARGS, argv,
+            index, 0);
+
+    if (limit < 0 || limit > GUAC_RATE_LIMIT_MAX_KBPS) {
+        guac_user_log(user, GUAC_LOG_WARNING, "Specified value \"%s\" for "
+                "parameter \"%s\" is not between 0 and %i. The bandwidth "
+                "will not be limited.", argv[index],
+                GUAC_VNC_CLIENT_ARGS[index], GUAC_RATE_LIMIT_MAX_KBPS);
+        return 0;
+    }
+
+    return limit;
+
+}
+
 guac_vnc_settings* guac_vnc_parse_args(guac_user* user,
         int argc, const char** argv) {
 
@@ -479,6 +545,20 @@ guac_vnc_settings* guac_vnc_parse_args(guac_user* user,
         guac_user_parse_args_boolean(user, GUAC_VNC_CLIENT_ARGS, argv,
                 IDX_FORCE_LOSSLESS, false);
 
+    /* Interval before lossy areas are resent losslessly */
+    settings->lossless_refresh_interval =
+        guac_user_parse_args_int(user, GUAC_VNC_CLIENT_ARGS, argv,
+                IDX_LOSSLESS_REFRESH_INTERVAL,
+                GUAC_COMMON_SURFACE_REFRESH_INTERVAL);
+
+    /* Outbound bandwidth limits */
+    settings->bandwidth_limit =
+        guac_vnc_parse_bandwidth_limit(user, argv, IDX_BANDWIDTH_LIMIT);
+
+    settings->connection_bandwidth_limit =
+        guac_vnc_parse_bandwidth_limit(user, argv,
+                IDX_CONNECTION_BANDWIDTH_LIMIT);
+
     /* Compression level */
     settings->compress_level =
         guac_user_parse_args_int(user, GUAC_VNC_CLIENT_ARGS, argv,
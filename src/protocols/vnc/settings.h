@@ -82,6 +82,28 @@ typedef struct guac_vnc_settings {
      */
     bool lossless;
 
+    /**
+     * The number of milliseconds that an area sent using lossy compression
+     * must remain unchanged before it is resent losslessly, or zero if lossy
+     * areas should never be resent.
+     */
+    int lossless_refresh_interval;
+
+    /**
+     * The maximum rate, in kilobits per second, at which data may be sent to
+     * this user, or zero if the rate is not limited. This is never greater
+     * than GUAC_RATE_LIMIT_MAX_KBPS.
+     */
+    int bandwidth_limit;
+
+    /**
+     * The maximum combined rate, in kilobits per second, at which data may be
+     * sent to all users of the connection, or zero if the rate is not
+     * limited. Only the value provided by the owner is used. This is never
+     * greater than GUAC_RATE_LIMIT_MAX_KBPS.
+     */
+    int connection_bandwidth_limit;
+
     /**
      * The level of compression to ask the VNC client library to perform.
      */
@@ -483,9 +483,16 @@ void* guac_vnc_client_thread(void* data) {
     vnc_client->display = guac_common_display_alloc(client,
             rfb_client->width, rfb_client->height);
 
+    /* Include all graphical updates within any recording */
+    if (vnc_client->recording != NULL)
+        guac_common_display_set_recording(vnc_client->display,
+                vnc_client->recording);
+
     /* Use lossless compression only if requested (otherwise, use default
      * heuristics) */
     guac_common_display_set_lossless(vnc_client->display, settings->lossless);
+    guac_common_display_set_refresh_interval(vnc_client->display,
+            settings->lossless_refresh_interval);
 
     /* If compression and display quality have been configured, set those. */
     if (settings->compress_level >= 0 && settings->compress_level <= 9)
@@ -516,6 +523,10 @@ void* guac_vnc_client_thread(void* data) {
         if (wait_result > 0) {
 
             int processing_lag = guac_client_get_processing_lag(client);
+
+            /* Lengthen frames as needed to keep network latency bounded */
+            int frame_duration = guac_client_suggest_frame_duration(client,
+                    GUAC_VNC_FRAME_DURATION);
             guac_timestamp frame_start = guac_timestamp_current();
 
             /* Read server messages until frame is built */
@@ -534,7 +545,7 @@ void* guac_vnc_client_thread(void* data) {
 
                 /* Calculate time remaining in frame */
                 frame_end = guac_timestamp_current();
-                frame_remaining = frame_start + GUAC_VNC_FRAME_DURATION
+                frame_remaining = frame_start + frame_duration
                                 - frame_end;
 
                 /* Calculate time that client needs to catch up */
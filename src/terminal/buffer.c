@@ -21,9 +21,15 @@
 #include "terminal/common.h"
 
 #include <guacamole/mem.h>
+#include <guacamole/string.h>
 
+#include <errno.h>
+#include <fcntl.h>
+#include <stdbool.h>
 #include <stdlib.h>
 #include <string.h>
+#include <sys/mman.h>
+#include <unistd.h>
 
 guac_terminal_buffer* guac_terminal_buffer_alloc(int rows, guac_terminal_char* default_character) {
 
@@ -41,20 +47,42 @@ guac_terminal_buffer* guac_terminal_buffer_alloc(int rows, guac_terminal_char* d
     buffer->length = 0;
     buffer->rows = guac_mem_alloc(sizeof(guac_terminal_buffer_row), buffer->available);
 
-    /* Init scrollback rows */
+    /* Init scrollback rows (storage for each row is allocated upon first
+     * use) */
     row = buffer->rows;
     for (i=0; i<rows; i++) {
 
-        /* Allocate row  */
-        row->available = 256;
+        row->available = 0;
         row->length = 0;
-        row->characters = guac_mem_alloc(sizeof(guac_terminal_char), row->available);
+        row->characters = NULL;
+        row->compact = NULL;
+        row->spill_segment = -1;
 
         /* Next row */
         row++;
 
     }
 
+    /* No rows are compacted yet */
+    buffer->attributes = NULL;
+    buffer->attributes_refcount = NULL;
+    buffer->attributes_free = NULL;
+    buffer->attributes_free_length = 0;
+    buffer->attributes_length = 0;
+    buffer->attributes_available = 0;
+    buffer->attributes_index = NULL;
+    buffer->attributes_index_size = 0;
+    buffer->compacted_rows = 0;
+    buffer->compact_scratch = NULL;
+    buffer->compact_scratch_size = 0;
+
+    /* All scrollback is held in memory unless spilling is enabled */
+    buffer->resident_rows = 0;
+    buffer->spill_fd = -1;
+    buffer->spill_segments = NULL;
+    buffer->spill_segments_length = 0;
+    buffer->spill_current = -1;
+
     return buffer;
 
 }
@@ -64,18 +92,816 @@ void guac_terminal_buffer_free(guac_terminal_buffer* buffer) {
     int i;
     guac_terminal_buffer_row* row = buffer->rows;
 
-    /* Free all rows */
+    /* Free all rows (rows within the spill file are freed along with the
+     * file itself) */
     for (i=0; i<buffer->available; i++) {
         guac_mem_free(row->characters);
+        if (row->spill_segment == -1)
+            guac_mem_free(row->compact);
         row++;
     }
 
+    /* Unmap and close spill file, if any */
+    for (i=0; i<buffer->spill_segments_length; i++)
+        munmap(buffer->spill_segments[i].data,
+                GUAC_TERMINAL_BUFFER_SPILL_SEGMENT_SIZE);
+
+    guac_mem_free(buffer->spill_segments);
+    if (buffer->spill_fd != -1)
+        close(buffer->spill_fd);
+
+    /* Free storage used for compacted rows */
+    guac_mem_free(buffer->attributes);
+    guac_mem_free(buffer->attributes_refcount);
+    guac_mem_free(buffer->attributes_free);
+    guac_mem_free(buffer->attributes_index);
+    guac_mem_free(buffer->compact_scratch);
+
     /* Free actual buffer */
     guac_mem_free(buffer->rows);
     guac_mem_free(buffer);
 
 }
 
+/**
+ * Returns whether the given sets of character attributes are identical.
+ *
+ * @param a
+ *     The first set of attributes to compare.
+ *
+ * @param b
+ *     The second set of attributes to compare.
+ *
+ * @return
+ *     true if the given attributes are identical, false otherwise.
+ */
+static bool guac_terminal_buffer_attributes_equal(
+        const guac_terminal_attributes* a, const guac_terminal_attributes* b) {
+
+    return a->bold        == b->bold
+        && a->half_bright == b->half_bright
+        && a->reverse     == b->reverse
+        && a->cursor      == b->cursor
+        && a->underscore  == b->underscore
+        && a->foreground.palette_index == b->foreground.palette_index
+        && a->foreground.red   == b->foreground.red
+        && a->foreground.green == b->foreground.green
+        && a->foreground.blue  == b->foreground.blue
+        && a->background.palette_index == b->background.palette_index
+        && a->background.red   == b->background.red
+        && a->background.green == b->background.green
+        && a->background.blue  == b->background.blue;
+
+}
+
+/**
+ * Returns a hash of the given character attributes, suitable for locating
+ * those attributes within the attributes_index table of a buffer.
+ *
+ * @param attributes
+ *     The attributes to hash.
+ *
+ * @return
+ *     A hash of the given attributes.
+ */
+static unsigned int guac_terminal_buffer_hash_attributes(
+        const guac_terminal_attributes* attributes) {
+
+    const guac_terminal_color* fg = &attributes->foreground;
+    const guac_terminal_color* bg = &attributes->background;
+
+    unsigned int flags =
+          (attributes->bold        ? 0x01 : 0)
+        | (attributes->half_bright ? 0x02 : 0)
+        | (attributes->reverse     ? 0x04 : 0)
+        | (attributes->cursor      ? 0x08 : 0)
+        | (attributes->underscore  ? 0x10 : 0);
+
+    unsigned int values[] = {
+        flags,
+        (unsigned int) fg->palette_index,
+        (fg->red << 16) | (fg->green << 8) | fg->blue,
+        (unsigned int) bg->palette_index,
+        (bg->red << 16) | (bg->green << 8) | bg->blue
+    };
+
+    /* FNV-1a over each value */
+    unsigned int hash = 2166136261u;
+    for (int i = 0; i < sizeof(values) / sizeof(values[0]); i++) {
+        hash ^= values[i];
+        hash *= 16777619u;
+    }
+
+    return hash;
+
+}
+
+/**
+ * Stores the given index within the attributes_index table of the given
+ * buffer, at the first free slot for the given hash. The table must have at
+ * least one free slot.
+ *
+ * @param buffer
+ *     The buffer whose attributes_index table should be updated.
+ *
+ * @param hash
+ *     The hash of the attributes at the given index.
+ *
+ * @param index
+ *     The index of the attributes within the attributes array.
+ */
+static void guac_terminal_buffer_index_attributes(guac_terminal_buffer* buffer,
+        unsigned int hash, int index) {
+
+    unsigned int mask = buffer->attributes_index_size - 1;
+    unsigned int slot = hash & mask;
+
+    while (buffer->attributes_index[slot] != 0)
+        slot = (slot + 1) & mask;
+
+    buffer->attributes_index[slot] = index + 1;
+
+}
+
+/**
+ * Removes the given index from the attributes_index table of the given
+ * buffer, moving any later entries of the same probe sequence back such that
+ * all remaining entries can still be found.
+ *
+ * @param buffer
+ *     The buffer whose attributes_index table should be updated.
+ *
+ * @param index
+ *     The index of the attributes to remove, which must be present within
+ *     the table.
+ */
+static void guac_terminal_buffer_unindex_attributes(
+        guac_terminal_buffer* buffer, int index) {
+
+    unsigned int mask = buffer->attributes_index_size - 1;
+    unsigned int slot = guac_terminal_buffer_hash_attributes(
+            &buffer->attributes[index]) & mask;
+
+    while (buffer->attributes_index[slot] != index + 1)
+        slot = (slot + 1) & mask;
+
+    /* Fill the emptied slot with any later entry which could not otherwise
+     * be reached, repeating for the slot that entry leaves behind */
+    unsigned int next = (slot + 1) & mask;
+    int entry;
+    while ((entry = buffer->attributes_index[next]) != 0) {
+
+        unsigned int home = guac_terminal_buffer_hash_attributes(
+                &buffer->attributes[entry - 1]) & mask;
+
+        /* Entries whose probe sequence begins after the emptied slot (and no
+         * later than their current slot) remain reachable */
+        if (((next - home) & mask) >= ((next - slot) & mask)) {
+            buffer->attributes_index[slot] = entry;
+            slot = next;
+        }
+
+        next = (next + 1) & mask;
+
+    }
+
+    buffer->attributes_index[slot] = 0;
+
+}
+
+/**
+ * Releases a reference to the attributes having the given index within the
+ * attributes array of the given buffer, as acquired by
+ * guac_terminal_buffer_intern_attributes(). Once no references remain, the
+ * element is freed for reuse.
+ *
+ * @param buffer
+ *     The buffer containing the attributes.
+ *
+ * @param index
+ *     The index of the attributes to release.
+ */
+static void guac_terminal_buffer_release_attributes(
+        guac_terminal_buffer* buffer, int index) {
+
+    if (--buffer->attributes_refcount[index] > 0)
+        return;
+
+    /* Start over entirely once nothing at all is referenced */
+    if (buffer->attributes_free_length + 1 == buffer->attributes_length) {
+        buffer->attributes_length = 0;
+        buffer->attributes_free_length = 0;
+        memset(buffer->attributes_index, 0,
+                sizeof(int) * buffer->attributes_index_size);
+        return;
+    }
+
+    guac_terminal_buffer_unindex_attributes(buffer, index);
+    buffer->attributes_free[buffer->attributes_free_length++] = index;
+
+}
+
+/**
+ * Returns the index of the given attributes within the attributes array of
+ * the given buffer, adding those attributes if they are not yet present, and
+ * acquiring a reference to that element. Each reference must eventually be
+ * released with guac_terminal_buffer_release_attributes().
+ *
+ * @param buffer
+ *     The buffer to search.
+ *
+ * @param attributes
+ *     The attributes to locate.
+ *
+ * @return
+ *     The index of the given attributes, or -1 if the attributes are not
+ *     present and GUAC_TERMINAL_BUFFER_MAX_ATTRIBUTES distinct sets of
+ *     attributes are already referenced.
+ */
+static int guac_terminal_buffer_intern_attributes(guac_terminal_buffer* buffer,
+        const guac_terminal_attributes* attributes) {
+
+    unsigned int hash = guac_terminal_buffer_hash_attributes(attributes);
+
+    /* Search for existing identical attributes */
+    if (buffer->attributes_index_size > 0) {
+
+        unsigned int mask = buffer->attributes_index_size - 1;
+        unsigned int slot = hash & mask;
+
+        int entry;
+        while ((entry = buffer->attributes_index[slot]) != 0) {
+
+            if (guac_terminal_buffer_attributes_equal(
+                        &buffer->attributes[entry - 1], attributes)) {
+                buffer->attributes_refcount[entry - 1]++;
+                return entry - 1;
+            }
+
+            slot = (slot + 1) & mask;
+
+        }
+
+    }
+
+    int referenced = buffer->attributes_length
+        - buffer->attributes_free_length;
+
+    if (referenced >= GUAC_TERMINAL_BUFFER_MAX_ATTRIBUTES)
+        return -1;
+
+    int index;
+
+    /* Reuse freed elements before using new elements */
+    if (buffer->attributes_free_length > 0)
+        index = buffer->attributes_free[--buffer->attributes_free_length];
+
+    else {
+
+        /* Expand attributes arrays if necessary */
+        if (buffer->attributes_length == buffer->attributes_available) {
+
+            buffer->attributes_available = buffer->attributes_available
+                ? guac_mem_ckd_mul_or_die(buffer->attributes_available, 2)
+                : 16;
+
+            buffer->attributes = guac_mem_realloc_or_die(buffer->attributes,
+                    sizeof(guac_terminal_attributes),
+                    buffer->attributes_available);
+
+            buffer->attributes_refcount = guac_mem_realloc_or_die(
+                    buffer->attributes_refcount, sizeof(int),
+                    buffer->attributes_available);
+
+            buffer->attributes_free = guac_mem_realloc_or_die(
+                    buffer->attributes_free, sizeof(int),
+                    buffer->attributes_available);
+
+        }
+
+        index = buffer->attributes_length++;
+
+    }
+
+    buffer->attributes[index] = *attributes;
+    buffer->attributes_refcount[index] = 1;
+
+    /* Rebuild index once more than half full */
+    if ((referenced + 1) * 2 > buffer->attributes_index_size) {
+
+        guac_mem_free(buffer->attributes_index);
+        buffer->attributes_index_size = buffer->attributes_index_size
+            ? guac_mem_ckd_mul_or_die(buffer->attributes_index_size, 2) : 64;
+        buffer->attributes_index = guac_mem_realloc_or_die(NULL,
+                sizeof(int), buffer->attributes_index_size);
+        memset(buffer->attributes_index, 0,
+                sizeof(int) * buffer->attributes_index_size);
+
+        for (int i = 0; i < buffer->attributes_length; i++) {
+            if (buffer->attributes_refcount[i] > 0)
+                guac_terminal_buffer_index_attributes(buffer,
+                        guac_terminal_buffer_hash_attributes(
+                            &buffer->attributes[i]), i);
+        }
+
+    }
+
+    else
+        guac_terminal_buffer_index_attributes(buffer, hash, index);
+
+    return index;
+
+}
+
+/**
+ * Writes the given value to the given location as a variable-length integer,
+ * seven bits at a time with the high bit of each byte set if more bytes
+ * follow.
+ *
+ * @param data
+ *     The location to write to, which must have space for at least five
+ *     bytes.
+ *
+ * @param value
+ *     The value to write.
+ *
+ * @return
+ *     The location immediately following the written value.
+ */
+static unsigned char* guac_terminal_buffer_write_varint(unsigned char* data,
+        unsigned int value) {
+
+    while (value >= 0x80) {
+        *(data++) = (value & 0x7F) | 0x80;
+        value >>= 7;
+    }
+
+    *(data++) = value;
+    return data;
+
+}
+
+/**
+ * Reads a variable-length integer previously written with
+ * guac_terminal_buffer_write_varint(), advancing the given location past the
+ * value read.
+ *
+ * @param data
+ *     Pointer to the location to read from. This location will be updated to
+ *     point immediately after the value read.
+ *
+ * @return
+ *     The value read.
+ */
+static unsigned int guac_terminal_buffer_read_varint(const unsigned char** data) {
+
+    const unsigned char* current = *data;
+    unsigned int value = 0;
+    int shift = 0;
+
+    while (*current & 0x80) {
+        value |= (*(current++) & 0x7F) << shift;
+        shift += 7;
+    }
+
+    value |= *(current++) << shift;
+
+    *data = current;
+    return value;
+
+}
+
+/**
+ * Flag which may be set within the width byte of a compacted run, indicating
+ * that each character of the run is implicitly followed by width - 1
+ * GUAC_CHAR_CONTINUATION characters having the same attributes.
+ */
+#define GUAC_TERMINAL_BUFFER_RUN_CONTINUED 0x80
+
+/**
+ * Returns the width byte that would describe the character at the given
+ * column within a compacted run, as well as the number of columns occupied by
+ * that character and any implied continuation characters.
+ *
+ * @param characters
+ *     The characters of the row being compacted.
+ *
+ * @param column
+ *     The column of the character to describe.
+ *
+ * @param length
+ *     The number of characters in the row.
+ *
+ * @param span
+ *     Pointer to an int which will receive the number of columns described.
+ *
+ * @return
+ *     The width byte describing the character, or -1 if the character cannot
+ *     be represented within a compacted row.
+ */
+static int guac_terminal_buffer_run_width(const guac_terminal_char* characters,
+        int column, int length, int* span) {
+
+    const guac_terminal_char* current = &characters[column];
+    int width = current->width;
+
+    /* Continuation characters are not relevant if not applicable */
+    if (current->value == GUAC_CHAR_CONTINUATION)
+        width = 0;
+
+    if (width < 0 || width >= GUAC_TERMINAL_BUFFER_RUN_CONTINUED)
+        return -1;
+
+    *span = 1;
+
+    /* Imply any continuation characters following a multi-column character
+     * if they are exactly as guac_terminal_buffer_set_columns() would store
+     * them */
+    if (width > 1 && column + width <= length) {
+
+        for (int i = 1; i < width; i++) {
+            const guac_terminal_char* continuation = current + i;
+            if (continuation->value != GUAC_CHAR_CONTINUATION
+                    || !guac_terminal_buffer_attributes_equal(
+                        &continuation->attributes, &current->attributes))
+                return width;
+        }
+
+        *span = width;
+        return width | GUAC_TERMINAL_BUFFER_RUN_CONTINUED;
+
+    }
+
+    return width;
+
+}
+
+/**
+ * Allocates space for a compacted row of the given size within the spill
+ * file of the given buffer, growing the file as necessary. The disk space
+ * backing each segment is reserved when that segment is added, and rows are
+ * only ever written to reserved space.
+ *
+ * @param buffer
+ *     The buffer whose spill file should be used.
+ *
+ * @param size
+ *     The number of bytes required.
+ *
+ * @param segment
+ *     Pointer to an int which will receive the index of the segment
+ *     containing the allocated space.
+ *
+ * @return
+ *     A pointer to the allocated space, or NULL if the space could not be
+ *     allocated, such as if the filesystem containing the spill file is
+ *     full.
+ */
+static unsigned char* guac_terminal_buffer_spill_alloc(
+        guac_terminal_buffer* buffer, size_t size, int* segment) {
+
+    if (size > GUAC_TERMINAL_BUFFER_SPILL_SEGMENT_SIZE)
+        return NULL;
+
+    int current = buffer->spill_current;
+
+    /* Find another segment if current segment is full */
+    if (current == -1 || buffer->spill_segments[current].used + size
+            > GUAC_TERMINAL_BUFFER_SPILL_SEGMENT_SIZE) {
+
+        /* Reuse the first empty segment, if any */
+        current = -1;
+        for (int i = 0; i < buffer->spill_segments_length; i++) {
+            if (buffer->spill_segments[i].live == 0) {
+                current = i;
+                break;
+            }
+        }
+
+        /* Otherwise, extend file by a new segment */
+        if (current == -1) {
+
+            int index = buffer->spill_segments_length;
+            off_t offset = (off_t) index * GUAC_TERMINAL_BUFFER_SPILL_SEGMENT_SIZE;
+
+            /* Reserve the disk space backing the new segment up front. A
+             * sparse file would instead only fail once rows are written
+             * through the mapping, raising SIGBUS if the filesystem is full */
+            int result = posix_fallocate(buffer->spill_fd, offset,
+                    GUAC_TERMINAL_BUFFER_SPILL_SEGMENT_SIZE);
+
+            if (result) {
+                errno = result;
+                return NULL;
+            }
+
+            void* data = mmap(NULL, GUAC_TERMINAL_BUFFER_SPILL_SEGMENT_SIZE,
+                    PROT_READ | PROT_WRITE, MAP_SHARED, buffer->spill_fd,
+                    offset);
+
+            if (data == MAP_FAILED)
+                return NULL;
+
+            buffer->spill_segments = guac_mem_realloc_or_die(
+                    buffer->spill_segments,
+                    sizeof(guac_terminal_buffer_spill_segment), index + 1);
+
+            guac_terminal_buffer_spill_segment* new_segment =
+                &buffer->spill_segments[index];
+
+            new_segment->data = data;
+            new_segment->used = 0;
+            new_segment->live = 0;
+
+            buffer->spill_segments_length++;
+            current = index;
+
+        }
+
+        buffer->spill_current = current;
+
+    }
+
+    /* Append to current segment */
+    guac_terminal_buffer_spill_segment* spill_segment =
+        &buffer->spill_segments[current];
+
+    unsigned char* data = spill_segment->data + spill_segment->used;
+    spill_segment->used += size;
+    spill_segment->live += size;
+
+    *segment = current;
+    return data;
+
+}
+
+/**
+ * Releases the storage used by the compact form of the given row, which must
+ * be compacted. The row is left with no compact form.
+ *
+ * @param buffer
+ *     The buffer containing the row.
+ *
+ * @param buffer_row
+ *     The row whose compact form should be released.
+ */
+static void guac_terminal_buffer_release_compact(guac_terminal_buffer* buffer,
+        guac_terminal_buffer_row* buffer_row) {
+
+    /* Rows held in memory are simply freed */
+    if (buffer_row->spill_segment == -1) {
+        guac_mem_free(buffer_row->compact);
+        return;
+    }
+
+    /* Rows within the spill file are freed when their segment is emptied */
+    guac_terminal_buffer_spill_segment* spill_segment =
+        &buffer->spill_segments[buffer_row->spill_segment];
+
+    spill_segment->live -= buffer_row->compact_size;
+    if (spill_segment->live == 0)
+        spill_segment->used = 0;
+
+    buffer_row->compact = NULL;
+    buffer_row->spill_segment = -1;
+
+}
+
+/**
+ * Moves the compact form of the given row, which must be compacted and held
+ * in memory, into the spill file. If space cannot be allocated within the
+ * spill file, the row is left in memory.
+ *
+ * @param buffer
+ *     The buffer containing the row.
+ *
+ * @param buffer_row
+ *     The row to move.
+ */
+static void guac_terminal_buffer_spill_row(guac_terminal_buffer* buffer,
+        guac_terminal_buffer_row* buffer_row) {
+
+    int segment;
+    unsigned char* data = guac_terminal_buffer_spill_alloc(buffer,
+            buffer_row->compact_size, &segment);
+
+    if (data == NULL)
+        return;
+
+    memcpy(data, buffer_row->compact, buffer_row->compact_size);
+    guac_mem_free(buffer_row->compact);
+
+    buffer_row->compact = data;
+    buffer_row->spill_segment = segment;
+
+}
+
+/**
+ * Releases the references to interned attributes held by each run within the
+ * given compacted data (see guac_terminal_buffer_compact_row()).
+ *
+ * @param buffer
+ *     The buffer containing the interned attributes.
+ *
+ * @param data
+ *     The first byte of the compacted data.
+ *
+ * @param end
+ *     The byte immediately following the last run of the compacted data.
+ */
+static void guac_terminal_buffer_release_runs(guac_terminal_buffer* buffer,
+        const unsigned char* data, const unsigned char* end) {
+
+    while (data < end) {
+
+        guac_terminal_buffer_release_attributes(buffer,
+                guac_terminal_buffer_read_varint(&data));
+
+        /* Skip width byte, count, and all values */
+        data++;
+        unsigned int count = guac_terminal_buffer_read_varint(&data);
+        for (unsigned int i = 0; i < count; i++)
+            guac_terminal_buffer_read_varint(&data);
+
+    }
+
+}
+
+/**
+ * Compacts the given row, replacing its array of characters with a sequence
+ * of runs of characters which share the same attributes and width. Each run
+ * is stored as the index of its attributes within the buffer (a varint), its
+ * width byte, and its number of characters (a varint), followed by the value
+ * of each character plus one (a varint). Each run holds its own reference to
+ * its interned attributes. If the row cannot be compacted, it is left
+ * untouched, and any attributes interned for it are released.
+ *
+ * @param buffer
+ *     The buffer containing the row.
+ *
+ * @param buffer_row
+ *     The row to compact, which must not already be compacted.
+ */
+static void guac_terminal_buffer_compact_row(guac_terminal_buffer* buffer,
+        guac_terminal_buffer_row* buffer_row) {
+
+    const guac_terminal_char* characters = buffer_row->characters;
+    int length = buffer_row->length;
+
+    /* Rows with no content need no storage at all */
+    if (length == 0) {
+        guac_mem_free(buffer_row->characters);
+        buffer_row->available = 0;
+        return;
+    }
+
+    /* Reserve enough scratch space for the worst case, where every character
+     * begins its own run */
+    size_t required = guac_mem_ckd_mul_or_die(length, 16);
+    if (required > buffer->compact_scratch_size) {
+        buffer->compact_scratch = guac_mem_realloc_or_die(
+                buffer->compact_scratch, required);
+        buffer->compact_scratch_size = required;
+    }
+
+    unsigned char* data = buffer->compact_scratch;
+
+    int column = 0;
+    while (column < length) {
+
+        const guac_terminal_char* first = &characters[column];
+
+        int span;
+        int width = guac_terminal_buffer_run_width(characters, column, length, &span);
+        if (width < 0) {
+            guac_terminal_buffer_release_runs(buffer,
+                    buffer->compact_scratch, data);
+            return;
+        }
+
+        int attributes = guac_terminal_buffer_intern_attributes(buffer,
+                &first->attributes);
+        if (attributes < 0) {
+            guac_terminal_buffer_release_runs(buffer,
+                    buffer->compact_scratch, data);
+            return;
+        }
+
+        /* Determine extent of run */
+        int count = 0;
+        int end = column;
+        while (end < length) {
+
+            int next_span;
+            const guac_terminal_char* current = &characters[end];
+
+            if (!guac_terminal_buffer_attributes_equal(&current->attributes,
+                        &first->attributes)
+                    || guac_terminal_buffer_run_width(characters, end, length,
+                        &next_span) != width)
+                break;
+
+            end += next_span;
+            count++;
+
+        }
+
+        /* Store run header followed by all values */
+        data = guac_terminal_buffer_write_varint(data, attributes);
+        *(data++) = width;
+        data = guac_terminal_buffer_write_varint(data, count);
+
+        for (; column < end; column += span)
+            data = guac_terminal_buffer_write_varint(data,
+                    (unsigned int) characters[column].value + 1);
+
+    }
+
+    /* Replace expanded characters with compacted form */
+    size_t size = data - buffer->compact_scratch;
+    unsigned char* compact = guac_mem_alloc(size);
+    if (compact == NULL) {
+        guac_terminal_buffer_release_runs(buffer, buffer->compact_scratch,
+                data);
+        return;
+    }
+
+    memcpy(compact, buffer->compact_scratch, size);
+    buffer_row->compact = compact;
+    buffer_row->compact_size = size;
+
+    guac_mem_free(buffer_row->characters);
+    buffer_row->available = 0;
+    buffer->compacted_rows++;
+
+}
+
+/**
+ * Expands the given compacted row, restoring its array of characters.
+ *
+ * @param buffer
+ *     The buffer containing the row.
+ *
+ * @param buffer_row
+ *     The row to expand, which must be compacted.
+ */
+static void guac_terminal_buffer_expand_row(guac_terminal_buffer* buffer,
+        guac_terminal_buffer_row* buffer_row) {
+
+    int length = buffer_row->length;
+
+    buffer_row->available = length;
+    if (buffer_row->available < GUAC_TERMINAL_BUFFER_ROW_MIN_AVAILABLE)
+        buffer_row->available = GUAC_TERMINAL_BUFFER_ROW_MIN_AVAILABLE;
+
+    buffer_row->characters = guac_mem_realloc_or_die(NULL,
+            sizeof(guac_terminal_char), buffer_row->available);
+
+    const unsigned char* data = buffer_row->compact;
+    guac_terminal_char* current = buffer_row->characters;
+    guac_terminal_char* end = current + length;
+
+    /* Restore characters from each run */
+    while (current < end) {
+
+        int index = guac_terminal_buffer_read_varint(&data);
+        const guac_terminal_attributes* attributes = &buffer->attributes[index];
+
+        int width = *(data++);
+        int count = guac_terminal_buffer_read_varint(&data);
+
+        bool continued = width & GUAC_TERMINAL_BUFFER_RUN_CONTINUED;
+        width &= ~GUAC_TERMINAL_BUFFER_RUN_CONTINUED;
+
+        for (int i = 0; i < count; i++) {
+
+            current->value = (int) guac_terminal_buffer_read_varint(&data) - 1;
+            current->attributes = *attributes;
+            current->width = width;
+            current++;
+
+            /* Restore any implied continuation characters */
+            if (continued) {
+                for (int j = 1; j < width; j++) {
+                    current->value = GUAC_CHAR_CONTINUATION;
+                    current->attributes = *attributes;
+                    current->width = 0;
+                    current++;
+                }
+            }
+
+        }
+
+        /* The row no longer refers to the attributes of this run */
+        guac_terminal_buffer_release_attributes(buffer, index);
+
+    }
+
+    guac_terminal_buffer_release_compact(buffer, buffer_row);
+    buffer->compacted_rows--;
+
+}
+
 guac_terminal_buffer_row* guac_terminal_buffer_get_row(guac_terminal_buffer* buffer, int row, int width) {
 
     int i;
@@ -90,6 +916,17 @@ guac_terminal_buffer_row* guac_terminal_buffer_get_row(guac_terminal_buffer* buf
     /* Get row */
     buffer_row = &(buffer->rows[index]);
 
+    /* Expand row if compacted */
+    if (buffer_row->compact != NULL)
+        guac_terminal_buffer_expand_row(buffer, buffer_row);
+
+    /* Allocate storage for row upon first use */
+    else if (buffer_row->characters == NULL) {
+        buffer_row->available = GUAC_TERMINAL_BUFFER_ROW_MIN_AVAILABLE;
+        buffer_row->characters = guac_mem_realloc_or_die(NULL,
+                sizeof(guac_terminal_char), buffer_row->available);
+    }
+
     /* If resizing is needed */
     if (width >= buffer_row->length) {
 
@@ -211,3 +1048,80 @@ void guac_terminal_buffer_set_columns(guac_terminal_buffer* buffer, int row,
 
 }
 
+void guac_terminal_buffer_set_text(guac_terminal_buffer* buffer, int row,
+        int start_column, const char* text, int length,
+        const guac_terminal_attributes* attributes) {
+
+    /* Get and expand row */
+    guac_terminal_buffer_row* buffer_row = guac_terminal_buffer_get_row(buffer,
+            row, start_column + length);
+
+    /* Set values */
+    guac_terminal_char* current = &(buffer_row->characters[start_column]);
+    for (int i = 0; i < length; i++) {
+        current->value = (unsigned char) text[i];
+        current->attributes = *attributes;
+        current->width = 1;
+        current++;
+    }
+
+    /* Update length depending on row written */
+    if (length > 0 && row >= buffer->length)
+        buffer->length = row+1;
+
+}
+
+void guac_terminal_buffer_compact_rows(guac_terminal_buffer* buffer,
+        int start_row, int end_row) {
+
+    for (int row = start_row; row <= end_row; row++) {
+
+        /* Normalize row index into a scrollback buffer index */
+        int index = (buffer->top + row) % buffer->available;
+        if (index < 0)
+            index += buffer->available;
+
+        /* Compact row only if not already compacted or unused */
+        guac_terminal_buffer_row* buffer_row = &(buffer->rows[index]);
+        if (buffer_row->compact == NULL && buffer_row->characters != NULL)
+            guac_terminal_buffer_compact_row(buffer, buffer_row);
+
+        /* Move compacted rows beyond the resident scrollback to disk */
+        if (buffer->spill_fd != -1 && row < -buffer->resident_rows
+                && buffer_row->compact != NULL
+                && buffer_row->spill_segment == -1)
+            guac_terminal_buffer_spill_row(buffer, buffer_row);
+
+    }
+
+}
+
+int guac_terminal_buffer_enable_spill(guac_terminal_buffer* buffer,
+        int resident_rows) {
+
+    /* Create spill file within system temporary directory */
+    const char* tmpdir = getenv("TMPDIR");
+    if (tmpdir == NULL || *tmpdir == '\0')
+        tmpdir = "/tmp";
+
+    char path[4096];
+    if (guac_strlcpy(path, tmpdir, sizeof(path)) >= sizeof(path)
+            || guac_strlcat(path, "/guac-scrollback-XXXXXX", sizeof(path))
+                >= sizeof(path)) {
+        errno = ENAMETOOLONG;
+        return 1;
+    }
+
+    int fd = mkstemp(path);
+    if (fd == -1)
+        return 1;
+
+    /* The file is only ever accessed through its descriptor */
+    unlink(path);
+    fcntl(fd, F_SETFD, FD_CLOEXEC);
+
+    buffer->spill_fd = fd;
+    buffer->resident_rows = resident_rows;
+    return 0;
+
+}
@@ -0,0 +1,287 @@
+/*
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ * KIND, either express or implied.  See the License for the
+ * specific language governing permissions and limitations
+ * under the License.
+ */
+
+#include "config.h"
+
+#include "terminal/cell-recording.h"
+#include "terminal/palette.h"
+
+#include <guacamole/mem.h>
+#include <guacamole/protocol.h>
+#include <guacamole/socket.h>
+#include <guacamole/timestamp.h>
+#include <guacamole/unicode.h>
+
+#include <stdio.h>
+
+/**
+ * Writes a single Guacamole protocol element containing the given string,
+ * prefixed with its length in Unicode characters.
+ *
+ * @param socket
+ *     The socket to write the element to.
+ *
+ * @param str
+ *     The NULL-terminated UTF-8 string to write.
+ *
+ * @return
+ *     Zero on success, non-zero if an error occurs.
+ */
+static int guac_terminal_cell_recording_write_string(guac_socket* socket,
+        const char* str) {
+
+    return
+           guac_socket_write_int(socket, guac_utf8_strlen(str))
+        || guac_socket_write_string(socket, ".")
+        || guac_socket_write_string(socket, str);
+
+}
+
+/**
+ * Writes a full instruction having the given opcode, integer arguments, and
+ * optional trailing text argument to the socket of the given cell recording.
+ *
+ * @param recording
+ *     The cell recording to write to.
+ *
+ * @param opcode
+ *     The opcode of the instruction.
+ *
+ * @param values
+ *     The integer arguments of the instruction, in order.
+ *
+ * @param count
+ *     The number of integer arguments.
+ *
+ * @param text
+ *     The final argument of the instruction, or NULL if the instruction has
+ *     only integer arguments.
+ */
+static void guac_terminal_cell_recording_write(
+        guac_terminal_cell_recording* recording, const char* opcode,
+        const int* values, int count, const char* text) {
+
+    guac_socket* socket = recording->socket;
+    char buffer[16];
+
+    guac_socket_instruction_begin(socket);
+
+    guac_terminal_cell_recording_write_string(socket, opcode);
+
+    for (int i = 0; i < count; i++) {
+        snprintf(buffer, sizeof(buffer), "%i", values[i]);
+        guac_socket_write_string(socket, ",");
+        guac_terminal_cell_recording_write_string(socket, buffer);
+    }
+
+    if (text != NULL) {
+        guac_socket_write_string(socket, ",");
+        guac_terminal_cell_recording_write_string(socket, text);
+    }
+
+    guac_socket_write_string(socket, ";");
+
+    guac_socket_instruction_end(socket);
+
+    recording->modified = 1;
+
+}
+
+/**
+ * Returns the given color as a 24-bit RGB value (0xRRGGBB).
+ *
+ * @param color
+ *     The color to convert.
+ *
+ * @return
+ *     The given color as a 24-bit RGB value.
+ */
+static int guac_terminal_cell_recording_rgb(const guac_terminal_color* color) {
+    return (color->red << 16) | (color->green << 8) | color->blue;
+}
+
+/**
+ * Writes the pending run of text, if any, as a "term-text" instruction.
+ *
+ * @param recording
+ *     The cell recording whose pending run should be written.
+ */
+static void guac_terminal_cell_recording_flush_run(
+        guac_terminal_cell_recording* recording) {
+
+    if (recording->run_length == 0)
+        return;
+
+    int values[] = {
+        recording->run_row,
+        recording->run_column,
+        recording->run_width,
+        recording->run_foreground,
+        recording->run_background,
+        recording->run_flags
+    };
+
+    guac_terminal_cell_recording_write(recording, "term-text", values,
+            sizeof(values) / sizeof(values[0]), recording->run_text);
+
+    recording->run_length = 0;
+    recording->run_text_length = 0;
+
+}
+
+guac_terminal_cell_recording* guac_terminal_cell_recording_alloc(
+        guac_socket* socket) {
+
+    guac_terminal_cell_recording* recording =
+        guac_mem_zalloc(sizeof(guac_terminal_cell_recording));
+
+    recording->socket = socket;
+    return recording;
+
+}
+
+void guac_terminal_cell_recording_free(
+        guac_terminal_cell_recording* recording) {
+
+    /* Do nothing if no recording provided */
+    if (recording == NULL)
+        return;
+
+    guac_terminal_cell_recording_flush_run(recording);
+    guac_mem_free(recording);
+
+}
+
+void guac_terminal_cell_recording_size(guac_terminal_cell_recording* recording,
+        int columns, int rows, int char_width, int char_height,
+        const guac_terminal_color* background) {
+
+    guac_terminal_cell_recording_flush_run(recording);
+
+    int values[] = {
+        columns, rows, char_width, char_height,
+        guac_terminal_cell_recording_rgb(background)
+    };
+
+    guac_terminal_cell_recording_write(recording, "term-size", values,
+            sizeof(values) / sizeof(values[0]), NULL);
+
+}
+
+void guac_terminal_cell_recording_set(guac_terminal_cell_recording* recording,
+        int row, int start_column, int end_column, int codepoint, int width,
+        const guac_terminal_color* foreground,
+        const guac_terminal_color* background, int flags) {
+
+    int rgb_foreground = guac_terminal_cell_recording_rgb(foreground);
+    int rgb_background = guac_terminal_cell_recording_rgb(background);
+
+    /* Blank cells are recorded as spaces */
+    if (codepoint == 0)
+        codepoint = ' ';
+
+    /* Ranges of more than one character are written as a single fill */
+    if (end_column - start_column + 1 > width) {
+
+        guac_terminal_cell_recording_flush_run(recording);
+
+        char text[5];
+        text[guac_utf8_write(codepoint, text, sizeof(text) - 1)] = '\0';
+
+        int values[] = {
+            row, start_column, end_column, width,
+            rgb_foreground, rgb_background, flags
+        };
+
+        guac_terminal_cell_recording_write(recording, "term-fill", values,
+                sizeof(values) / sizeof(values[0]), text);
+        return;
+
+    }
+
+    /* Start a new run unless this character directly follows the pending
+     * run and shares its attributes */
+    if (recording->run_length == 0
+            || recording->run_length == GUAC_TERMINAL_CELL_RECORDING_MAX_RUN
+            || recording->run_row != row
+            || recording->run_width != width
+            || recording->run_column + recording->run_length * width != start_column
+            || recording->run_foreground != rgb_foreground
+            || recording->run_background != rgb_background
+            || recording->run_flags != flags) {
+
+        guac_terminal_cell_recording_flush_run(recording);
+
+        recording->run_row = row;
+        recording->run_column = start_column;
+        recording->run_width = width;
+        recording->run_foreground = rgb_foreground;
+        recording->run_background = rgb_background;
+        recording->run_flags = flags;
+
+    }
+
+    /* Append character to run */
+    recording->run_text_length += guac_utf8_write(codepoint,
+            recording->run_text + recording->run_text_length,
+            sizeof(recording->run_text) - 1 - recording->run_text_length);
+
+    recording->run_text[recording->run_text_length] = '\0';
+    recording->run_length++;
+
+}
+
+void guac_terminal_cell_recording_copy_columns(
+        guac_terminal_cell_recording* recording, int row,
+        int start_column, int end_column, int offset) {
+
+    guac_terminal_cell_recording_flush_run(recording);
+
+    int values[] = { row, start_column, end_column, offset };
+    guac_terminal_cell_recording_write(recording, "term-copy", values,
+            sizeof(values) / sizeof(values[0]), NULL);
+
+}
+
+void guac_terminal_cell_recording_copy_rows(
+        guac_terminal_cell_recording* recording,
+        int start_row, int end_row, int offset) {
+
+    guac_terminal_cell_recording_flush_run(recording);
+
+    int values[] = { start_row, end_row, offset };
+    guac_terminal_cell_recording_write(recording, "term-scroll", values,
+            sizeof(values) / sizeof(values[0]), NULL);
+
+}
+
+void guac_terminal_cell_recording_sync(guac_terminal_cell_recording* recording,
+        guac_timestamp timestamp) {
+
+    guac_terminal_cell_recording_flush_run(recording);
+
+    /* Do not write empty frames */
+    if (!recording->modified)
+        return;
+
+    guac_protocol_send_sync(recording->socket, timestamp, 1);
+    recording->modified = 0;
+
+}
+
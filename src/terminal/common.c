@@ -18,6 +18,7 @@
  */
 
 #include "terminal/types.h"
+#include "terminal/unicode.h"
 
 #include <stdbool.h>
 #include <unistd.h>
@@ -79,9 +80,8 @@ int guac_terminal_encode_utf8(int codepoint, char* utf8) {
 
 bool guac_terminal_has_glyph(int codepoint) {
     return
-           codepoint != 0
-        && codepoint != ' '
-        && codepoint != GUAC_CHAR_CONTINUATION;
+           codepoint != GUAC_CHAR_CONTINUATION
+        && guac_terminal_unicode_class(codepoint) != GUAC_TERMINAL_UNICODE_BLANK;
 }
 
 int guac_terminal_write_all(int fd, const char* buffer, int size) {
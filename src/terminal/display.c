@@ -17,18 +17,22 @@
  * under the License.
  */
 
+#include "config.h"
+
 #include "common/surface.h"
+#include "terminal/cell-recording.h"
 #include "terminal/common.h"
 #include "terminal/display.h"
+#include "terminal/glyph-cache.h"
 #include "terminal/palette.h"
 #include "terminal/terminal.h"
 #include "terminal/terminal-priv.h"
 #include "terminal/types.h"
+#include "terminal/unicode.h"
 
 #include <math.h>
 #include <stdlib.h>
 #include <string.h>
-#include <wchar.h>
 
 #include <cairo/cairo.h>
 #include <glib-object.h>
@@ -36,6 +40,7 @@
 #include <guacamole/mem.h>
 #include <guacamole/protocol.h>
 #include <guacamole/socket.h>
+#include <guacamole/timestamp.h>
 #include <pango/pangocairo.h>
 
 /* Maps any codepoint onto a number between 0 and 511 inclusive */
@@ -51,11 +56,26 @@ int __guac_terminal_hash_codepoint(int codepoint) {
 }
 
 /**
- * Sets the attributes of the display such that future glyphs will render as
- * expected.
+ * Determines the actual foreground and background colors of a character
+ * having the given attributes, taking reverse video, bold, and half-bright
+ * into account.
+ *
+ * @param display
+ *     The display whose palette should be used to resolve the colors.
+ *
+ * @param attributes
+ *     The attributes of the character.
+ *
+ * @param glyph_foreground
+ *     The guac_terminal_color to populate with the resolved foreground color.
+ *
+ * @param glyph_background
+ *     The guac_terminal_color to populate with the resolved background color.
  */
-int __guac_terminal_set_colors(guac_terminal_display* display,
-        guac_terminal_attributes* attributes) {
+static void __guac_terminal_resolve_colors(guac_terminal_display* display,
+        const guac_terminal_attributes* attributes,
+        guac_terminal_color* glyph_foreground,
+        guac_terminal_color* glyph_background) {
 
     const guac_terminal_color* background;
     const guac_terminal_color* foreground;
@@ -78,72 +98,178 @@ int __guac_terminal_set_colors(guac_terminal_display* display,
             + GUAC_TERMINAL_INTENSE_OFFSET];
     }
 
-    display->glyph_foreground = *foreground;
+    *glyph_foreground = *foreground;
     guac_terminal_display_lookup_color(display,
-            foreground->palette_index, &display->glyph_foreground);
+            foreground->palette_index, glyph_foreground);
 
-    display->glyph_background = *background;
+    *glyph_background = *background;
     guac_terminal_display_lookup_color(display,
-            background->palette_index, &display->glyph_background);
+            background->palette_index, glyph_background);
 
     /* Modify color if half-bright (low intensity) */
     if (attributes->half_bright && !attributes->bold) {
-        display->glyph_foreground.red   /= 2;
-        display->glyph_foreground.green /= 2;
-        display->glyph_foreground.blue  /= 2;
+        glyph_foreground->red   /= 2;
+        glyph_foreground->green /= 2;
+        glyph_foreground->blue  /= 2;
     }
 
+}
+
+/**
+ * Sets the attributes of the display such that future glyphs will render as
+ * expected.
+ */
+int __guac_terminal_set_colors(guac_terminal_display* display,
+        guac_terminal_attributes* attributes) {
+
+    __guac_terminal_resolve_colors(display, attributes,
+            &display->glyph_foreground, &display->glyph_background);
+
     return 0;
 
 }
 
 /**
- * Sends the given character to the terminal at the given row and column,
- * rendering the character immediately. This bypasses the guac_terminal_display
- * mechanism and is intended for flushing of updates only.
+ * Records that the given range of columns has been set to the given
+ * character within the cell recording of the given display.
+ *
+ * @param display
+ *     The display whose cell recording should be updated. The display MUST
+ *     have an active cell recording.
+ *
+ * @param row
+ *     The row containing the modified columns.
+ *
+ * @param start_column
+ *     The first column modified, inclusive.
+ *
+ * @param end_column
+ *     The last column modified, inclusive.
+ *
+ * @param codepoint
+ *     The codepoint of the character.
+ *
+ * @param width
+ *     The number of columns occupied by each copy of the character.
+ *
+ * @param attributes
+ *     The attributes of the character.
  */
-int __guac_terminal_set(guac_terminal_display* display, int row, int col, int codepoint) {
+static void __guac_terminal_display_record_set(guac_terminal_display* display,
+        int row, int start_column, int end_column, int codepoint, int width,
+        const guac_terminal_attributes* attributes) {
 
-    int width;
+    guac_terminal_color foreground;
+    guac_terminal_color background;
+    __guac_terminal_resolve_colors(display, attributes,
+            &foreground, &background);
 
-    int bytes;
-    char utf8[4];
+    int flags = 0;
+    if (attributes->bold)
+        flags |= GUAC_TERMINAL_CELL_RECORDING_BOLD;
+    if (attributes->underscore)
+        flags |= GUAC_TERMINAL_CELL_RECORDING_UNDERSCORE;
 
-    /* Use foreground color */
-    const guac_terminal_color* color = &display->glyph_foreground;
+    guac_terminal_cell_recording_set(display->cell_recording, row,
+            start_column, end_column, codepoint, width,
+            &foreground, &background, flags);
 
-    /* Use background color */
-    const guac_terminal_color* background = &display->glyph_background;
+}
+
+/**
+ * Returns the X coordinate of the cell within the glyph atlas of the given
+ * display which corresponds to the given glyph.
+ *
+ * @param display
+ *     The display containing the glyph atlas.
+ *
+ * @param glyph
+ *     The glyph whose location within the glyph atlas should be returned.
+ *     This glyph MUST be stored within the glyph cache of the given display.
+ *
+ * @return
+ *     The X coordinate of the cell corresponding to the given glyph, in
+ *     pixels.
+ */
+static int __guac_terminal_glyph_atlas_x(guac_terminal_display* display,
+        guac_terminal_glyph* glyph) {
+
+    int index = glyph - display->glyph_cache->glyphs;
+    return (index % GUAC_TERMINAL_GLYPH_ATLAS_COLUMNS)
+        * display->char_width * GUAC_TERMINAL_MAX_CHAR_WIDTH;
+
+}
+
+/**
+ * Returns the Y coordinate of the cell within the glyph atlas of the given
+ * display which corresponds to the given glyph.
+ *
+ * @param display
+ *     The display containing the glyph atlas.
+ *
+ * @param glyph
+ *     The glyph whose location within the glyph atlas should be returned.
+ *     This glyph MUST be stored within the glyph cache of the given display.
+ *
+ * @return
+ *     The Y coordinate of the cell corresponding to the given glyph, in
+ *     pixels.
+ */
+static int __guac_terminal_glyph_atlas_y(guac_terminal_display* display,
+        guac_terminal_glyph* glyph) {
+
+    int index = glyph - display->glyph_cache->glyphs;
+    return (index / GUAC_TERMINAL_GLYPH_ATLAS_COLUMNS) * display->char_height;
+
+}
+
+/**
+ * Renders the given character into the given surface using the current font
+ * of the given display, replacing the entire contents of that surface.
+ *
+ * @param display
+ *     The display whose font should be used.
+ *
+ * @param surface
+ *     The surface to render the character into.
+ *
+ * @param codepoint
+ *     The codepoint of the character to render.
+ *
+ * @param color
+ *     The foreground color of the character.
+ *
+ * @param background
+ *     The background color of the character.
+ *
+ * @param surface_width
+ *     The width of the given surface, in pixels.
+ *
+ * @param surface_height
+ *     The height of the given surface, in pixels.
+ */
+static void __guac_terminal_render_glyph(guac_terminal_display* display,
+        cairo_surface_t* surface, int codepoint,
+        const guac_terminal_color* color,
+        const guac_terminal_color* background,
+        int surface_width, int surface_height) {
+
+    int bytes;
+    char utf8[4];
 
-    cairo_surface_t* surface;
     cairo_t* cairo;
-    int surface_width, surface_height;
-   
+
     PangoLayout* layout;
     int layout_width, layout_height;
     int ideal_layout_width, ideal_layout_height;
 
-    /* Calculate width in columns */
-    width = wcwidth(codepoint);
-    if (width < 0)
-        width = 1;
-
-    /* Do nothing if glyph is empty */
-    if (width == 0)
-        return 0;
-
     /* Convert to UTF-8 */
     bytes = guac_terminal_encode_utf8(codepoint, utf8);
 
-    surface_width = width * display->char_width;
-    surface_height = display->char_height;
-
     ideal_layout_width = surface_width * PANGO_SCALE;
     ideal_layout_height = surface_height * PANGO_SCALE;
 
-    /* Prepare surface */
-    surface = cairo_image_surface_create(CAIRO_FORMAT_RGB24,
-                                         surface_width, surface_height);
+    /* Prepare surface (the background fill below initializes every pixel) */
     cairo = cairo_create(surface);
 
     /* Fill background */
@@ -187,16 +313,82 @@ int __guac_terminal_set(guac_terminal_display* display, int row, int col, int co
     cairo_move_to(cairo, 0.0, 0.0);
     pango_cairo_show_layout(cairo, layout);
 
-    /* Draw */
-    guac_common_surface_draw(display->display_surface,
-        display->char_width * col,
-        display->char_height * row,
-        surface);
-
     /* Free all */
     g_object_unref(layout);
     cairo_destroy(cairo);
-    cairo_surface_destroy(surface);
+    cairo_surface_flush(surface);
+
+}
+
+/**
+ * Sends the given character to the terminal at the given row and column,
+ * rendering the character immediately, or reusing the previously-rendered
+ * glyph from the glyph cache if the same character has already been rendered
+ * in the same colors. If the glyph atlas is in use, the glyph is copied from
+ * the atlas rather than drawn as an image. This bypasses the
+ * guac_terminal_display mechanism and is intended for flushing of updates
+ * only.
+ */
+int __guac_terminal_set(guac_terminal_display* display, int row, int col, int codepoint) {
+
+    int width;
+
+    /* Use foreground color */
+    const guac_terminal_color* color = &display->glyph_foreground;
+
+    /* Use background color */
+    const guac_terminal_color* background = &display->glyph_background;
+
+    int surface_width, surface_height;
+
+    /* Calculate width in columns */
+    width = guac_terminal_unicode_width(codepoint);
+
+    /* Do nothing if glyph is empty */
+    if (width == 0)
+        return 0;
+
+    surface_width = width * display->char_width;
+    surface_height = display->char_height;
+
+    /* Render glyph only if not already cached */
+    guac_terminal_glyph* glyph = guac_terminal_glyph_cache_get(
+            display->glyph_cache, codepoint, color, background);
+
+    if (glyph == NULL) {
+
+        glyph = guac_terminal_glyph_cache_add(display->glyph_cache,
+                codepoint, color, background, surface_width, surface_height);
+
+        __guac_terminal_render_glyph(display, glyph->surface, codepoint,
+                color, background, surface_width, surface_height);
+
+        /* Store newly-rendered glyph within atlas, replacing any glyph
+         * evicted from the cache */
+        if (display->glyph_atlas != NULL)
+            guac_common_surface_draw(display->glyph_atlas,
+                    __guac_terminal_glyph_atlas_x(display, glyph),
+                    __guac_terminal_glyph_atlas_y(display, glyph),
+                    glyph->surface);
+
+    }
+
+    /* Copy glyph from atlas if possible */
+    if (display->glyph_atlas != NULL)
+        guac_common_surface_copy(display->glyph_atlas,
+                __guac_terminal_glyph_atlas_x(display, glyph),
+                __guac_terminal_glyph_atlas_y(display, glyph),
+                surface_width, surface_height,
+                display->display_surface,
+                display->char_width * col,
+                display->char_height * row);
+
+    /* Otherwise, draw glyph directly */
+    else
+        guac_common_surface_draw(display->display_surface,
+            display->char_width * col,
+            display->char_height * row,
+            glyph->surface);
 
     return 0;
 
@@ -215,10 +407,31 @@ static int get_margin_by_dpi(int dpi) {
     return dpi * GUAC_TERMINAL_MARGINS / GUAC_TERMINAL_MM_PER_INCH;
 }
 
+/**
+ * Frees the glyph atlas of the given display, including its underlying
+ * buffer, if the glyph atlas is in use.
+ *
+ * @param display
+ *     The display whose glyph atlas should be freed.
+ */
+static void __guac_terminal_display_free_glyph_atlas(
+        guac_terminal_display* display) {
+
+    if (display->glyph_atlas == NULL)
+        return;
+
+    guac_common_surface_free(display->glyph_atlas);
+    guac_client_free_buffer(display->client, display->glyph_atlas_buffer);
+
+    display->glyph_atlas = NULL;
+    display->glyph_atlas_buffer = NULL;
+
+}
+
 guac_terminal_display* guac_terminal_display_alloc(guac_client* client,
         const char* font_name, int font_size, int dpi,
         guac_terminal_color* foreground, guac_terminal_color* background,
-        guac_terminal_color (*palette)[256]) {
+        guac_terminal_color (*palette)[256], bool glyph_atlas) {
 
     /* Allocate display */
     guac_terminal_display* display = guac_mem_alloc(sizeof(guac_terminal_display));
@@ -257,14 +470,39 @@ guac_terminal_display* guac_terminal_display_alloc(guac_client* client,
     display->width = 0;
     display->height = 0;
     display->operations = NULL;
+    display->dirty_rows = NULL;
+    display->dirty_rows_length = 0;
+    display->dirty_left = NULL;
+    display->dirty_right = NULL;
+
+    /* Initially not recording */
+    display->cell_recording = NULL;
 
     /* Initially nothing selected */
     display->text_selected = false;
 
+    /* Initially no glyphs rendered */
+    display->glyph_cache = guac_terminal_glyph_cache_alloc();
+
+    /* Store rendered glyphs client-side if requested, sizing the atlas only
+     * once the font (and thus the size of each glyph) is known */
+    if (glyph_atlas) {
+        display->glyph_atlas_buffer = guac_client_alloc_buffer(client);
+        display->glyph_atlas = guac_common_surface_alloc(client,
+                client->socket, display->glyph_atlas_buffer, 0, 0);
+        guac_common_surface_set_lossless(display->glyph_atlas, 1);
+    }
+    else {
+        display->glyph_atlas_buffer = NULL;
+        display->glyph_atlas = NULL;
+    }
+
     /* Attempt to load font */
     if (guac_terminal_display_set_font(display, font_name, font_size, dpi)) {
         guac_client_abort(display->client, GUAC_PROTOCOL_STATUS_SERVER_ERROR,
                 "Unable to set initial font \"%s\"", font_name);
+        __guac_terminal_display_free_glyph_atlas(display);
+        guac_terminal_glyph_cache_free(display->glyph_cache);
         guac_mem_free(display);
         return NULL;
     }
@@ -283,6 +521,16 @@ void guac_terminal_display_free(guac_terminal_display* display) {
 
     /* Free operations buffers */
     guac_mem_free(display->operations);
+    guac_mem_free(display->dirty_rows);
+    guac_mem_free(display->dirty_left);
+    guac_mem_free(display->dirty_right);
+
+    /* Write any remaining recorded text */
+    guac_terminal_cell_recording_free(display->cell_recording);
+
+    /* Free all rendered glyphs */
+    __guac_terminal_display_free_glyph_atlas(display);
+    guac_terminal_glyph_cache_free(display->glyph_cache);
 
     /* Free display */
     guac_mem_free(display);
@@ -345,6 +593,49 @@ int guac_terminal_display_lookup_color(guac_terminal_display* display,
 
 }
 
+/**
+ * Records that the given range of columns within the given row may now
+ * contain pending operations, such that those columns are considered by the
+ * next flush. Rows and columns which have not been marked are skipped
+ * entirely when flushing.
+ *
+ * @param display
+ *     The display containing the modified row.
+ *
+ * @param row
+ *     The row that was modified, which must be within display bounds.
+ *
+ * @param start_column
+ *     The first column that was modified, which must be within display
+ *     bounds.
+ *
+ * @param end_column
+ *     The last column that was modified, inclusive, which must be within
+ *     display bounds.
+ */
+static void __guac_terminal_display_mark_dirty(guac_terminal_display* display,
+        int row, int start_column, int end_column) {
+
+    if (end_column < start_column)
+        return;
+
+    /* Add row to list if not yet dirty */
+    if (display->dirty_right[row] == -1) {
+        display->dirty_rows[display->dirty_rows_length++] = row;
+        display->dirty_left[row] = start_column;
+        display->dirty_right[row] = end_column;
+        return;
+    }
+
+    /* Otherwise, expand existing dirty range */
+    if (start_column < display->dirty_left[row])
+        display->dirty_left[row] = start_column;
+
+    if (end_column > display->dirty_right[row])
+        display->dirty_right[row] = end_column;
+
+}
+
 void guac_terminal_display_copy_columns(guac_terminal_display* display, int row,
         int start_column, int end_column, int offset) {
 
@@ -369,6 +660,13 @@ void guac_terminal_display_copy_columns(guac_terminal_display* display, int row,
     memmove(current, src_current,
         (end_column - start_column + 1) * sizeof(guac_terminal_operation));
 
+    __guac_terminal_display_mark_dirty(display, row,
+            start_column + offset, end_column + offset);
+
+    if (display->cell_recording != NULL)
+        guac_terminal_cell_recording_copy_columns(display->cell_recording,
+                row, start_column, end_column, offset);
+
     /* Update operations */
     for (i=start_column; i<=end_column; i++) {
 
@@ -406,6 +704,15 @@ void guac_terminal_display_copy_rows(guac_terminal_display* display,
     memmove(current_row, src_current_row,
         (end_row - start_row + 1) * sizeof(guac_terminal_operation) * display->width);
 
+    if (display->cell_recording != NULL)
+        guac_terminal_cell_recording_copy_rows(display->cell_recording,
+                start_row, end_row, offset);
+
+    /* Every column of each destination row now has an operation */
+    for (row=start_row; row<=end_row; row++)
+        __guac_terminal_display_mark_dirty(display, row + offset,
+                0, display->width - 1);
+
     /* Update operations */
     for (row=start_row; row<=end_row; row++) {
 
@@ -451,6 +758,13 @@ void guac_terminal_display_set_columns(guac_terminal_display* display, int row,
 
     current = &(display->operations[row * display->width + start_column]);
 
+    __guac_terminal_display_mark_dirty(display, row, start_column, end_column);
+
+    if (display->cell_recording != NULL)
+        __guac_terminal_display_record_set(display, row, start_column,
+                end_column, character->value, character->width,
+                &character->attributes);
+
     /* For each column in range */
     for (i = start_column; i <= end_column; i += character->width) {
 
@@ -465,6 +779,49 @@ void guac_terminal_display_set_columns(guac_terminal_display* display, int row,
 
 }
 
+void guac_terminal_display_set_text(guac_terminal_display* display, int row,
+        int start_column, const char* text, int length,
+        const guac_terminal_attributes* attributes) {
+
+    /* Ignore operations outside display bounds */
+    if (row < 0 || row >= display->height)
+        return;
+
+    /* Fit range within bounds */
+    if (start_column < 0) {
+        text -= start_column;
+        length += start_column;
+        start_column = 0;
+    }
+
+    if (start_column + length > display->width)
+        length = display->width - start_column;
+
+    if (length <= 0)
+        return;
+
+    __guac_terminal_display_mark_dirty(display, row, start_column,
+            start_column + length - 1);
+
+    guac_terminal_operation* current =
+        &(display->operations[row * display->width + start_column]);
+
+    /* Set operation for each character */
+    for (int i = 0; i < length; i++) {
+
+        if (display->cell_recording != NULL)
+            __guac_terminal_display_record_set(display, row, start_column + i,
+                    start_column + i, (unsigned char) text[i], 1, attributes);
+
+        current->type = GUAC_CHAR_SET;
+        current->character.value = (unsigned char) text[i];
+        current->character.attributes = *attributes;
+        current->character.width = 1;
+        current++;
+    }
+
+}
+
 void guac_terminal_display_resize(guac_terminal_display* display, int width, int height) {
 
     /* Resize display only if dimensions have changed */
@@ -492,6 +849,19 @@ void guac_terminal_display_resize(guac_terminal_display* display, int width, int
     display->operations = guac_mem_alloc(width, height,
             sizeof(guac_terminal_operation));
 
+    /* Reallocate dirty row tracking, initially with no dirty rows */
+    guac_mem_free(display->dirty_rows);
+    guac_mem_free(display->dirty_left);
+    guac_mem_free(display->dirty_right);
+
+    display->dirty_rows = guac_mem_alloc(sizeof(int), height);
+    display->dirty_left = guac_mem_alloc(sizeof(int), height);
+    display->dirty_right = guac_mem_alloc(sizeof(int), height);
+    display->dirty_rows_length = 0;
+
+    for (y=0; y<height; y++)
+        display->dirty_right[y] = -1;
+
     /* Init each operation buffer row */
     current = display->operations;
     for (y=0; y<height; y++) {
@@ -507,6 +877,7 @@ void guac_terminal_display_resize(guac_terminal_display* display, int width, int
             else {
                 current->type = GUAC_CHAR_SET;
                 current->character  = fill;
+                __guac_terminal_display_mark_dirty(display, y, x, x);
             }
 
             current++;
@@ -519,6 +890,11 @@ void guac_terminal_display_resize(guac_terminal_display* display, int width, int
     display->width = width;
     display->height = height;
 
+    if (display->cell_recording != NULL)
+        guac_terminal_cell_recording_size(display->cell_recording,
+                width, height, display->char_width, display->char_height,
+                &display->default_background);
+
     /* Send display size */
     guac_common_surface_resize(
             display->display_surface,
@@ -534,12 +910,17 @@ void guac_terminal_display_resize(guac_terminal_display* display, int width, int
 
 void __guac_terminal_display_flush_copy(guac_terminal_display* display) {
 
-    guac_terminal_operation* current = display->operations;
+    guac_terminal_operation* current;
     int row, col;
 
-    /* For each operation */
-    for (row=0; row<display->height; row++) {
-        for (col=0; col<display->width; col++) {
+    /* For each operation within the dirty region of each dirty row */
+    for (int i = 0; i < display->dirty_rows_length; i++) {
+
+        row = display->dirty_rows[i];
+        col = display->dirty_left[row];
+        current = &(display->operations[row * display->width + col]);
+
+        for (; col<=display->dirty_right[row]; col++) {
 
             /* If operation is a copy operation */
             if (current->type == GUAC_CHAR_COPY) {
@@ -659,12 +1040,17 @@ void __guac_terminal_display_flush_copy(guac_terminal_display* display) {
 
 void __guac_terminal_display_flush_clear(guac_terminal_display* display) {
 
-    guac_terminal_operation* current = display->operations;
+    guac_terminal_operation* current;
     int row, col;
 
-    /* For each operation */
-    for (row=0; row<display->height; row++) {
-        for (col=0; col<display->width; col++) {
+    /* For each operation within the dirty region of each dirty row */
+    for (int i = 0; i < display->dirty_rows_length; i++) {
+
+        row = display->dirty_rows[i];
+        col = display->dirty_left[row];
+        current = &(display->operations[row * display->width + col]);
+
+        for (; col<=display->dirty_right[row]; col++) {
 
             /* If operation is a clear operation (set to space) */
             if (current->type == GUAC_CHAR_SET &&
@@ -793,12 +1179,17 @@ void __guac_terminal_display_flush_clear(guac_terminal_display* display) {
 
 void __guac_terminal_display_flush_set(guac_terminal_display* display) {
 
-    guac_terminal_operation* current = display->operations;
+    guac_terminal_operation* current;
     int row, col;
 
-    /* For each operation */
-    for (row=0; row<display->height; row++) {
-        for (col=0; col<display->width; col++) {
+    /* For each operation within the dirty region of each dirty row */
+    for (int i = 0; i < display->dirty_rows_length; i++) {
+
+        row = display->dirty_rows[i];
+        col = display->dirty_left[row];
+        current = &(display->operations[row * display->width + col]);
+
+        for (; col<=display->dirty_right[row]; col++) {
 
             /* Perform given operation */
             if (current->type == GUAC_CHAR_SET) {
@@ -829,13 +1220,36 @@ void __guac_terminal_display_flush_set(guac_terminal_display* display) {
 
 }
 
+/**
+ * Comparator for qsort() which orders row indices ascending.
+ */
+static int __guac_terminal_display_compare_rows(const void* a, const void* b) {
+    return *((const int*) a) - *((const int*) b);
+}
+
 void guac_terminal_display_flush(guac_terminal_display* display) {
 
+    /* Flush rows top to bottom, as copies must be sent in the same order as
+     * if the entire display were scanned */
+    qsort(display->dirty_rows, display->dirty_rows_length, sizeof(int),
+            __guac_terminal_display_compare_rows);
+
     /* Flush operations, copies first, then clears, then sets. */
     __guac_terminal_display_flush_copy(display);
     __guac_terminal_display_flush_clear(display);
     __guac_terminal_display_flush_set(display);
 
+    /* All pending operations have now been handled */
+    for (int i = 0; i < display->dirty_rows_length; i++)
+        display->dirty_right[display->dirty_rows[i]] = -1;
+
+    display->dirty_rows_length = 0;
+
+    /* End the recorded frame, if any */
+    if (display->cell_recording != NULL)
+        guac_terminal_cell_recording_sync(display->cell_recording,
+                guac_timestamp_current());
+
     /* Flush surface */
     guac_common_surface_flush(display->display_surface);
 
@@ -844,6 +1258,11 @@ void guac_terminal_display_flush(guac_terminal_display* display) {
 void guac_terminal_display_dup(
         guac_terminal_display* display, guac_client* client, guac_socket* socket) {
 
+    /* Send glyph atlas, such that future copies of cached glyphs can be
+     * rendered by the joining users */
+    if (display->glyph_atlas != NULL)
+        guac_common_surface_dup(display->glyph_atlas, client, socket);
+
     /* Create default surface */
     guac_common_surface_dup(display->display_surface, client, socket);
 
@@ -1039,6 +1458,17 @@ int guac_terminal_display_set_font(guac_terminal_display* display,
     display->font_desc = font_desc;
     pango_font_description_free(old_font_desc);
 
+    /* Glyphs rendered with the old font can no longer be used */
+    guac_terminal_glyph_cache_clear(display->glyph_cache);
+
+    /* Resize glyph atlas such that each cell can hold any glyph */
+    if (display->glyph_atlas != NULL)
+        guac_common_surface_resize(display->glyph_atlas,
+                GUAC_TERMINAL_GLYPH_ATLAS_COLUMNS
+                    * GUAC_TERMINAL_MAX_CHAR_WIDTH * display->char_width,
+                GUAC_TERMINAL_GLYPH_CACHE_SIZE
+                    / GUAC_TERMINAL_GLYPH_ATLAS_COLUMNS * display->char_height);
+
     /* Recalculate dimensions which will fit within current surface */
     int new_width = pixel_width / display->char_width;
     int new_height = pixel_height / display->char_height;
@@ -1047,6 +1477,12 @@ int guac_terminal_display_set_font(guac_terminal_display* display,
     if (new_width != display->width || new_height != display->height)
         guac_terminal_display_resize(display, new_width, new_height);
 
+    /* Otherwise, record the new size of each character cell */
+    else if (display->cell_recording != NULL)
+        guac_terminal_cell_recording_size(display->cell_recording,
+                display->width, display->height,
+                display->char_width, display->char_height,
+                &display->default_background);
 
     return 0;
 
@@ -0,0 +1,157 @@
+/*
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ * KIND, either express or implied.  See the License for the
+ * specific language governing permissions and limitations
+ * under the License.
+ */
+
+#include "terminal/glyph-cache.h"
+#include "terminal/palette.h"
+
+#include <cairo/cairo.h>
+#include <guacamole/mem.h>
+
+#include <stdint.h>
+
+/**
+ * Packs the RGB components of the given color into a single 24-bit value.
+ *
+ * @param color
+ *     The color to pack.
+ *
+ * @return
+ *     The RGB components of the given color as a 24-bit value.
+ */
+static uint32_t guac_terminal_glyph_cache_pack(
+        const guac_terminal_color* color) {
+    return (color->red << 16) | (color->green << 8) | color->blue;
+}
+
+/**
+ * Returns the glyph within the given cache which corresponds to the given
+ * key, regardless of whether that glyph currently contains the character
+ * described by the key.
+ *
+ * @param cache
+ *     The glyph cache containing the glyph.
+ *
+ * @param codepoint
+ *     The codepoint of the character rendered by the glyph.
+ *
+ * @param foreground
+ *     The foreground color of the glyph, as a 24-bit RGB value.
+ *
+ * @param background
+ *     The background color of the glyph, as a 24-bit RGB value.
+ *
+ * @return
+ *     The glyph corresponding to the given key.
+ */
+static guac_terminal_glyph* guac_terminal_glyph_cache_slot(
+        guac_terminal_glyph_cache* cache, int codepoint,
+        uint32_t foreground, uint32_t background) {
+
+    uint32_t hash = (uint32_t) codepoint * 0x9E3779B1u;
+    hash ^= foreground * 0x85EBCA6Bu;
+    hash ^= background * 0xC2B2AE35u;
+    hash ^= hash >> 15;
+
+    return &cache->glyphs[hash & (GUAC_TERMINAL_GLYPH_CACHE_SIZE - 1)];
+
+}
+
+guac_terminal_glyph_cache* guac_terminal_glyph_cache_alloc() {
+    return guac_mem_zalloc(sizeof(guac_terminal_glyph_cache));
+}
+
+void guac_terminal_glyph_cache_free(guac_terminal_glyph_cache* cache) {
+
+    if (cache == NULL)
+        return;
+
+    guac_terminal_glyph_cache_clear(cache);
+    guac_mem_free(cache);
+
+}
+
+void guac_terminal_glyph_cache_clear(guac_terminal_glyph_cache* cache) {
+
+    for (int i = 0; i < GUAC_TERMINAL_GLYPH_CACHE_SIZE; i++) {
+
+        guac_terminal_glyph* glyph = &cache->glyphs[i];
+
+        if (glyph->surface != NULL)
+            cairo_surface_destroy(glyph->surface);
+
+        glyph->surface = NULL;
+        glyph->codepoint = 0;
+
+    }
+
+}
+
+guac_terminal_glyph* guac_terminal_glyph_cache_get(
+        guac_terminal_glyph_cache* cache, int codepoint,
+        const guac_terminal_color* foreground,
+        const guac_terminal_color* background) {
+
+    uint32_t fg = guac_terminal_glyph_cache_pack(foreground);
+    uint32_t bg = guac_terminal_glyph_cache_pack(background);
+
+    guac_terminal_glyph* glyph = guac_terminal_glyph_cache_slot(cache,
+            codepoint, fg, bg);
+
+    /* Only return the glyph if it actually matches */
+    if (glyph->surface != NULL && glyph->codepoint == codepoint
+            && glyph->foreground == fg
+            && glyph->background == bg)
+        return glyph;
+
+    return NULL;
+
+}
+
+guac_terminal_glyph* guac_terminal_glyph_cache_add(
+        guac_terminal_glyph_cache* cache, int codepoint,
+        const guac_terminal_color* foreground,
+        const guac_terminal_color* background,
+        int width, int height) {
+
+    uint32_t fg = guac_terminal_glyph_cache_pack(foreground);
+    uint32_t bg = guac_terminal_glyph_cache_pack(background);
+
+    guac_terminal_glyph* glyph = guac_terminal_glyph_cache_slot(cache,
+            codepoint, fg, bg);
+
+    /* Reuse the surface of any evicted glyph if it has the same dimensions
+     * (the case for all glyphs of the same width in columns) */
+    if (glyph->surface != NULL
+            && (cairo_image_surface_get_width(glyph->surface) != width
+             || cairo_image_surface_get_height(glyph->surface) != height)) {
+        cairo_surface_destroy(glyph->surface);
+        glyph->surface = NULL;
+    }
+
+    if (glyph->surface == NULL)
+        glyph->surface = cairo_image_surface_create(CAIRO_FORMAT_RGB24,
+                width, height);
+
+    glyph->codepoint = codepoint;
+    glyph->foreground = fg;
+    glyph->background = bg;
+
+    return glyph;
+
+}
@@ -25,6 +25,7 @@
 #include "terminal/terminal-handlers.h"
 #include "terminal/terminal-priv.h"
 #include "terminal/types.h"
+#include "terminal/unicode.h"
 #include "terminal/xparsecolor.h"
 
 #include <guacamole/client.h>
@@ -33,7 +34,10 @@
 
 #include <stdbool.h>
 #include <stdlib.h>
-#include <wchar.h>
+
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
 
 /**
  * Response string sent when identification is requested.
@@ -133,9 +137,7 @@ static void guac_terminal_move_cursor(guac_terminal* term, int row, int col) {
 int guac_terminal_echo(guac_terminal* term, unsigned char c) {
 
     int width;
-
-    static int bytes_remaining = 0;
-    static int codepoint = 0;
+    int codepoint;
 
     const int* char_mapping = term->char_mapping[term->active_char_set];
 
@@ -153,50 +155,51 @@ int guac_terminal_echo(guac_terminal* term, unsigned char c) {
 
     /* If using non-Unicode mapping, just map straight bytes */
     if (char_mapping != NULL) {
-        codepoint = c;
-        bytes_remaining = 0;
+        term->utf8_codepoint = c;
+        term->utf8_bytes_remaining = 0;
     }
 
     /* 1-byte UTF-8 codepoint */
     else if ((c & 0x80) == 0x00) {    /* 0xxxxxxx */
-        codepoint = c & 0x7F;
-        bytes_remaining = 0;
+        term->utf8_codepoint = c & 0x7F;
+        term->utf8_bytes_remaining = 0;
     }
 
     /* 2-byte UTF-8 codepoint */
     else if ((c & 0xE0) == 0xC0) { /* 110xxxxx */
-        codepoint = c & 0x1F;
-        bytes_remaining = 1;
+        term->utf8_codepoint = c & 0x1F;
+        term->utf8_bytes_remaining = 1;
     }
 
     /* 3-byte UTF-8 codepoint */
     else if ((c & 0xF0) == 0xE0) { /* 1110xxxx */
-        codepoint = c & 0x0F;
-        bytes_remaining = 2;
+        term->utf8_codepoint = c & 0x0F;
+        term->utf8_bytes_remaining = 2;
     }
 
     /* 4-byte UTF-8 codepoint */
     else if ((c & 0xF8) == 0xF0) { /* 11110xxx */
-        codepoint = c & 0x07;
-        bytes_remaining = 3;
+        term->utf8_codepoint = c & 0x07;
+        term->utf8_bytes_remaining = 3;
     }
 
     /* Continuation of UTF-8 codepoint */
     else if ((c & 0xC0) == 0x80) { /* 10xxxxxx */
-        codepoint = (codepoint << 6) | (c & 0x3F);
-        bytes_remaining--;
+        term->utf8_codepoint = (term->utf8_codepoint << 6) | (c & 0x3F);
+        term->utf8_bytes_remaining--;
     }
 
     /* Unrecognized prefix */
     else {
-        codepoint = '?';
-        bytes_remaining = 0;
+        term->utf8_codepoint = '?';
+        term->utf8_bytes_remaining = 0;
     }
 
     /* If we need more bytes, wait for more bytes */
-    if (bytes_remaining != 0)
+    if (term->utf8_bytes_remaining != 0)
         return 0;
 
+    codepoint = term->utf8_codepoint;
     switch (codepoint) {
 
         /* Enquiry */
@@ -289,9 +292,7 @@ int guac_terminal_echo(guac_terminal* term, unsigned char c) {
                     term->cursor_col,
                     codepoint);
 
-            width = wcwidth(codepoint);
-            if (width < 0)
-                width = 1;
+            width = guac_terminal_unicode_width(codepoint);
 
             /* Advance cursor */
             term->cursor_col += width;
@@ -302,6 +303,97 @@ int guac_terminal_echo(guac_terminal* term, unsigned char c) {
 
 }
 
+/**
+ * Returns the length of the run of printable ASCII characters (0x20 through
+ * 0x7E inclusive) at the beginning of the given data.
+ *
+ * @param text
+ *     The data to scan.
+ *
+ * @param length
+ *     The number of bytes of data available.
+ *
+ * @return
+ *     The number of leading bytes of the given data which are printable ASCII
+ *     characters.
+ */
+static int guac_terminal_printable_run(const char* text, int length) {
+
+    int i = 0;
+
+#ifdef __SSE2__
+    /* Test 16 bytes at a time. Comparisons are signed, so bytes >= 0x80 are
+     * negative and are rejected by the lower bound alongside controls */
+    const __m128i lower = _mm_set1_epi8(0x1F);
+    const __m128i upper = _mm_set1_epi8(0x7F);
+
+    for (; i + 16 <= length; i += 16) {
+
+        __m128i chunk = _mm_loadu_si128((const __m128i*) (text + i));
+        __m128i printable = _mm_and_si128(
+                _mm_cmpgt_epi8(chunk, lower),
+                _mm_cmplt_epi8(chunk, upper));
+
+        int mask = _mm_movemask_epi8(printable);
+        if (mask != 0xFFFF)
+            return i + __builtin_ctz(~mask);
+
+    }
+#endif
+
+    /* Test any remaining bytes individually */
+    for (; i < length; i++) {
+        unsigned char c = text[i];
+        if (c < 0x20 || c > 0x7E)
+            break;
+    }
+
+    return i;
+
+}
+
+int guac_terminal_echo_text(guac_terminal* term, const char* text, int length) {
+
+    /* Bulk handling is only equivalent to guac_terminal_echo() if no other
+     * state would alter how printable characters are handled */
+    if (term->char_handler != guac_terminal_echo
+            || term->pipe_stream != NULL
+            || term->insert_mode
+            || term->utf8_bytes_remaining != 0
+            || term->char_mapping[term->active_char_set] != NULL)
+        return 0;
+
+    int run = guac_terminal_printable_run(text, length);
+    int remaining = run;
+
+    while (remaining > 0) {
+
+        /* Wrap if necessary */
+        if (term->cursor_col >= term->term_width) {
+            term->cursor_col = 0;
+            guac_terminal_linefeed(term);
+        }
+
+        /* Write as much of the run as fits within the current row */
+        int count = term->term_width - term->cursor_col;
+        if (count > remaining)
+            count = remaining;
+
+        guac_terminal_set_text(term, term->cursor_row, term->cursor_col,
+                text, count);
+
+        /* Advance cursor */
+        term->cursor_col += count;
+
+        text += count;
+        remaining -= count;
+
+    }
+
+    return run;
+
+}
+
 int guac_terminal_escape(guac_terminal* term, unsigned char c) {
 
     switch (c) {
@@ -21,6 +21,7 @@
 #include "common/cursor.h"
 #include "common/iconv.h"
 #include "terminal/buffer.h"
+#include "terminal/cell-recording.h"
 #include "terminal/color-scheme.h"
 #include "terminal/common.h"
 #include "terminal/display.h"
@@ -31,9 +32,11 @@
 #include "terminal/terminal-priv.h"
 #include "terminal/types.h"
 #include "terminal/typescript.h"
+#include "terminal/unicode.h"
 
 #include <ctype.h>
 #include <errno.h>
+#include <inttypes.h>
 #include <pthread.h>
 #include <stdarg.h>
 #include <stdio.h>
@@ -41,7 +44,6 @@
 #include <string.h>
 #include <sys/time.h>
 #include <unistd.h>
-#include <wchar.h>
 
 #include <guacamole/client.h>
 #include <guacamole/error.h>
@@ -191,6 +193,63 @@ int guac_terminal_get_available_scroll(guac_terminal* term) {
     return guac_terminal_effective_buffer_length(term) - term->term_height;
 }
 
+/**
+ * Compacts the given range of rows within the terminal buffer, such that rows
+ * which are no longer visible do not consume more memory than necessary. Rows
+ * within the range which are not part of the scrollback (rows at or below the
+ * top of the terminal, or rows which are stored at the same location within
+ * the buffer as such rows) are ignored.
+ *
+ * @param term
+ *     The terminal whose buffer should be compacted.
+ *
+ * @param start_row
+ *     The first row to compact, relative to the top of the terminal.
+ *
+ * @param end_row
+ *     The last row to compact, inclusive, relative to the top of the
+ *     terminal.
+ */
+static void guac_terminal_compact_scrollback(guac_terminal* term,
+        int start_row, int end_row) {
+
+    /* Ignore rows which would wrap around to the terminal itself */
+    int oldest_row = term->term_height - term->buffer->available;
+    if (start_row < oldest_row)
+        start_row = oldest_row;
+
+    /* Ignore rows within the terminal */
+    if (end_row > -1)
+        end_row = -1;
+
+    if (start_row <= end_row)
+        guac_terminal_buffer_compact_rows(term->buffer, start_row, end_row);
+
+}
+
+/**
+ * Compacts the rows which have just entered the scrollback due to the
+ * terminal buffer being shifted up by the given number of rows. If older
+ * scrollback is being moved to disk, the rows which have been pushed beyond
+ * the resident portion of the scrollback by the same shift are moved, too.
+ *
+ * @param term
+ *     The terminal whose buffer was shifted.
+ *
+ * @param amount
+ *     The number of rows the buffer was shifted up.
+ */
+static void guac_terminal_scrollback_added(guac_terminal* term, int amount) {
+
+    guac_terminal_compact_scrollback(term, -amount, -1);
+
+    int resident = term->buffer->resident_rows;
+    if (resident > 0)
+        guac_terminal_compact_scrollback(term, -resident - amount,
+                -resident - 1);
+
+}
+
 int guac_terminal_get_rows(guac_terminal* term) {
     return term->term_height;
 }
@@ -205,6 +264,8 @@ void guac_terminal_reset(guac_terminal* term) {
 
     /* Set current state */
     term->char_handler = guac_terminal_echo; 
+    term->utf8_codepoint = 0;
+    term->utf8_bytes_remaining = 0;
     term->active_char_set = 0;
     term->char_mapping[0] =
     term->char_mapping[1] = NULL;
@@ -333,6 +394,8 @@ guac_terminal_options* guac_terminal_options_create(
     options->font_size = GUAC_TERMINAL_DEFAULT_FONT_SIZE;
     options->color_scheme = GUAC_TERMINAL_DEFAULT_COLOR_SCHEME;
     options->backspace = GUAC_TERMINAL_DEFAULT_BACKSPACE;
+    options->glyph_atlas = GUAC_TERMINAL_DEFAULT_GLYPH_ATLAS;
+    options->resident_scrollback = GUAC_TERMINAL_DEFAULT_RESIDENT_SCROLLBACK;
 
     return options;
 }
@@ -472,6 +535,11 @@ guac_terminal* guac_terminal_create(guac_client* client,
     pthread_cond_init(&(term->modified_cond), NULL);
     pthread_mutex_init(&(term->modified_lock), NULL);
 
+    /* Init frame pacing and output backpressure */
+    term->unrendered_bytes = 0;
+    term->last_frame_start = guac_timestamp_current();
+    pthread_cond_init(&(term->rendered_cond), NULL);
+
     /* Maximum and requested scrollback are initially the same */
     term->max_scrollback = options->max_scrollback;
     term->requested_scrollback = options->max_scrollback;
@@ -488,12 +556,26 @@ guac_terminal* guac_terminal_create(guac_client* client,
     term->buffer_alt = NULL;
     term->buffer_switched = false;
 
+    /* Move older scrollback to disk, if requested */
+    if (options->resident_scrollback > 0
+            && options->resident_scrollback < options->max_scrollback) {
+
+        if (guac_terminal_buffer_enable_spill(term->buffer,
+                    options->resident_scrollback))
+            guac_client_log(client, GUAC_LOG_WARNING, "Scrollback beyond %i "
+                    "rows cannot be moved to disk: %s. All scrollback will be "
+                    "held in memory.", options->resident_scrollback,
+                    strerror(errno));
+
+    }
+
     /* Init display */
     term->display = guac_terminal_display_alloc(client,
             options->font_name, options->font_size, options->dpi,
             &default_char.attributes.foreground,
             &default_char.attributes.background,
-            (guac_terminal_color(*)[256]) default_palette);
+            (guac_terminal_color(*)[256]) default_palette,
+            options->glyph_atlas);
 
     /* Fail if display init failed */
     if (term->display == NULL) {
@@ -629,8 +711,13 @@ void guac_terminal_free(guac_terminal* term) {
     /* Close and flush any open pipe stream */
     guac_terminal_pipe_stream_close(term);
 
-    /* Close and flush any active typescript */
-    guac_terminal_typescript_free(term->typescript);
+    /* Close and flush any active typescript, noting any output which could
+     * not be written */
+    uint64_t dropped = guac_terminal_typescript_free(term->typescript);
+    if (dropped > 0)
+        guac_client_log(term->client, GUAC_LOG_WARNING, "%" PRIu64 " bytes "
+                "of terminal output were dropped from the typescript because "
+                "it could not be written quickly enough.", dropped);
 
     /* Free display */
     guac_terminal_display_free(term->display);
@@ -750,17 +837,33 @@ int guac_terminal_render_frame(guac_terminal* terminal) {
     wait_result = guac_terminal_wait(terminal, 1000);
     if (wait_result || !terminal->started) {
 
+        int processing_lag = guac_client_get_processing_lag(client);
+
+        /* Lengthen frames as needed to keep network latency bounded */
+        int frame_duration = guac_client_suggest_frame_duration(client,
+                GUAC_TERMINAL_FRAME_DURATION);
         guac_timestamp frame_start = guac_timestamp_current();
 
         do {
 
             /* Calculate time remaining in frame */
             guac_timestamp frame_end = guac_timestamp_current();
-            int frame_remaining = frame_start + GUAC_TERMINAL_FRAME_DURATION
+            int frame_remaining = frame_start + frame_duration
                                 - frame_end;
 
+            /* Calculate time that client needs to catch up, relative to the
+             * start of the previous frame */
+            int time_elapsed = frame_end - terminal->last_frame_start;
+            int required_wait = processing_lag - time_elapsed;
+
+            /* Increase the duration of this frame if client is lagging. All
+             * changes made in the meantime are coalesced, with only the
+             * latest state of the display being sent. */
+            if (required_wait > GUAC_TERMINAL_FRAME_TIMEOUT)
+                wait_result = guac_terminal_wait(terminal, required_wait);
+
             /* Wait again if frame remaining */
-            if (frame_remaining > 0 || !terminal->started)
+            else if (frame_remaining > 0 || !terminal->started)
                 wait_result = guac_terminal_wait(terminal,
                         GUAC_TERMINAL_FRAME_TIMEOUT);
             else
@@ -774,6 +877,17 @@ int guac_terminal_render_frame(guac_terminal* terminal) {
         guac_terminal_flush(terminal);
         guac_terminal_unlock(terminal);
 
+        /* Record start of frame, such that rendering time is excluded when
+         * determining how long the client needs to catch up (as in the VNC
+         * and RDP frame loops) */
+        terminal->last_frame_start = frame_start;
+
+        /* Allow any writes blocked by backpressure to continue */
+        pthread_mutex_lock(&(terminal->modified_lock));
+        terminal->unrendered_bytes = 0;
+        pthread_cond_broadcast(&(terminal->rendered_cond));
+        pthread_mutex_unlock(&(terminal->modified_lock));
+
     }
 
     return 0;
@@ -881,12 +995,10 @@ char* guac_terminal_prompt(guac_terminal* terminal, const char* title,
 int guac_terminal_set(guac_terminal* term, int row, int col, int codepoint) {
 
     /* Calculate width in columns */
-    int width = wcwidth(codepoint);
-    if (width < 0)
-        width = 1;
+    int width = guac_terminal_unicode_width(codepoint);
 
     /* Do nothing if glyph is empty */
-    else if (width == 0)
+    if (width == 0)
         return 0;
 
     /* Build character with current attributes */
@@ -902,6 +1014,45 @@ int guac_terminal_set(guac_terminal* term, int row, int col, int codepoint) {
 
 }
 
+void guac_terminal_set_text(guac_terminal* term, int row, int col,
+        const char* text, int length) {
+
+    int end_col = col + length - 1;
+
+    /* Store entire run within buffer and display */
+    guac_terminal_display_set_text(term->display, row + term->scroll_offset,
+            col, text, length, &term->current_attributes);
+
+    guac_terminal_buffer_set_text(term->buffer, row, col, text, length,
+            &term->current_attributes);
+
+    /* Clear selection if region is modified */
+    guac_terminal_select_touch(term, row, col, row, end_col);
+
+    /* If visible cursor in current row, preserve state */
+    if (row == term->visible_cursor_row
+            && term->visible_cursor_col >= col
+            && term->visible_cursor_col <= end_col) {
+
+        guac_terminal_char cursor_character = {
+            .value      = (unsigned char) text[term->visible_cursor_col - col],
+            .attributes = term->current_attributes,
+            .width      = 1
+        };
+
+        cursor_character.attributes.cursor = true;
+
+        __guac_terminal_set_columns(term, row, term->visible_cursor_col,
+                term->visible_cursor_col, &cursor_character);
+
+    }
+
+    /* Force breaks around destination region */
+    __guac_terminal_force_break(term, row, col);
+    __guac_terminal_force_break(term, row, end_col + 1);
+
+}
+
 void guac_terminal_commit_cursor(guac_terminal* term) {
 
     guac_terminal_char* guac_char;
@@ -947,13 +1098,78 @@ void guac_terminal_commit_cursor(guac_terminal* term) {
 
 }
 
+/**
+ * Accounts for the given number of bytes of output about to be handled by
+ * guac_terminal_write(), first blocking until the next frame is rendered if
+ * the client is lagging and GUAC_TERMINAL_MAX_UNRENDERED_BYTES have already
+ * been handled within the current frame. As the output being written has
+ * typically just been read from the remote end of the connection, blocking
+ * here pushes back on that connection, preventing output floods from being
+ * processed faster than the client can possibly display them.
+ *
+ * @param term
+ *     The terminal receiving the output.
+ *
+ * @param length
+ *     The number of bytes of output about to be handled.
+ */
+static void guac_terminal_apply_backpressure(guac_terminal* term, int length) {
+
+    /* Backpressure is only necessary if the client is falling behind */
+    bool lagging = guac_client_get_processing_lag(term->client)
+        > GUAC_TERMINAL_FRAME_DURATION;
+
+    pthread_mutex_lock(&(term->modified_lock));
+
+    if (lagging && term->started
+            && term->unrendered_bytes >= GUAC_TERMINAL_MAX_UNRENDERED_BYTES
+            && term->client->state == GUAC_CLIENT_RUNNING) {
+
+        struct timespec timeout;
+        guac_terminal_get_absolute_time(&timeout,
+                GUAC_TERMINAL_BACKPRESSURE_TIMEOUT / 1000,
+                (GUAC_TERMINAL_BACKPRESSURE_TIMEOUT % 1000) * 1000);
+
+        /* Wait for next frame (unrendered_bytes is reset once rendered) */
+        while (term->unrendered_bytes >= GUAC_TERMINAL_MAX_UNRENDERED_BYTES) {
+            if (pthread_cond_timedwait(&(term->rendered_cond),
+                        &(term->modified_lock), &timeout) == ETIMEDOUT)
+                break;
+        }
+
+    }
+
+    term->unrendered_bytes += length;
+    pthread_mutex_unlock(&(term->modified_lock));
+
+}
+
 int guac_terminal_write(guac_terminal* term, const char* buffer, int length) {
 
+    guac_terminal_apply_backpressure(term, length);
+
     guac_terminal_lock(term);
-    for (int written = 0; written < length; written++) {
+    int written = 0;
+    while (written < length) {
+
+        /* Handle any leading run of printable text in bulk */
+        int run = guac_terminal_echo_text(term, buffer, length - written);
+        if (run > 0) {
+
+            /* Write run to typescript, if any */
+            if (term->typescript != NULL)
+                guac_terminal_typescript_write_buffer(term->typescript,
+                        buffer, run);
+
+            buffer += run;
+            written += run;
+            continue;
+
+        }
 
         /* Read and advance to next character */
         char current = *(buffer++);
+        written++;
 
         /* Write character to typescript, if any */
         if (term->typescript != NULL)
@@ -988,6 +1204,9 @@ int guac_terminal_scroll_up(guac_terminal* term,
         if (term->buffer->length > term->buffer->available)
             term->buffer->length = term->buffer->available;
 
+        /* Compact rows which have just entered the scrollback */
+        guac_terminal_scrollback_added(term, amount);
+
         /* Reset scrollbar bounds */
         guac_terminal_scrollbar_set_bounds(term->scrollbar,
                 -guac_terminal_get_available_scroll(term), 0);
@@ -1151,6 +1370,10 @@ void guac_terminal_scroll_display_down(guac_terminal* terminal,
                 scroll_amount, terminal->term_height - 1,
                 -scroll_amount);
 
+    /* Compact any scrollback rows scrolled out of view */
+    guac_terminal_compact_scrollback(terminal, -terminal->scroll_offset,
+            scroll_amount - terminal->scroll_offset - 1);
+
     /* Advance by scroll amount */
     terminal->scroll_offset -= scroll_amount;
     guac_terminal_scrollbar_set_value(terminal->scrollbar, -terminal->scroll_offset);
@@ -1214,6 +1437,11 @@ void guac_terminal_scroll_display_up(guac_terminal* terminal,
                 0, terminal->term_height - scroll_amount - 1,
                 scroll_amount);
 
+    /* Compact any scrollback rows scrolled out of view */
+    guac_terminal_compact_scrollback(terminal,
+            terminal->term_height - terminal->scroll_offset - scroll_amount,
+            terminal->term_height - terminal->scroll_offset - 1);
+
     /* Advance by scroll amount */
     terminal->scroll_offset += scroll_amount;
     guac_terminal_scrollbar_set_value(terminal->scrollbar, -terminal->scroll_offset);
@@ -1382,6 +1610,9 @@ static void __guac_terminal_resize(guac_terminal* term, int width, int height) {
             if (term->visible_cursor_row != -1)
                 term->visible_cursor_row -= shift_amount;
 
+            /* Compact rows which have just entered the scrollback */
+            guac_terminal_scrollback_added(term, shift_amount);
+
             /* Redraw characters within old region */
             __guac_terminal_redraw_rect(term, height - shift_amount, 0, height-1, width-1);
 
@@ -2218,6 +2449,33 @@ int guac_terminal_create_typescript(guac_terminal* term, const char* path,
 
 }
 
+void guac_terminal_create_cell_recording(guac_terminal* term,
+        guac_socket* socket) {
+
+    guac_terminal_lock(term);
+
+    guac_terminal_display* display = term->display;
+
+    /* Begin recording, starting with the current display contents */
+    display->cell_recording = guac_terminal_cell_recording_alloc(socket);
+    guac_terminal_cell_recording_size(display->cell_recording,
+            display->width, display->height,
+            display->char_width, display->char_height,
+            &display->default_background);
+
+    __guac_terminal_redraw_rect(term, 0, 0,
+            term->term_height - 1,
+            term->term_width - 1);
+
+    guac_terminal_unlock(term);
+
+    guac_terminal_notify(term);
+
+    guac_client_log(term->client, GUAC_LOG_INFO,
+            "Terminal display will be recorded as character cells.");
+
+}
+
 /**
  * Synchronize the state of the provided terminal to a subset of users of
  * the provided guac_client using the provided socket.
@@ -28,13 +28,68 @@
 
 #include "types.h"
 
+#include <stddef.h>
+
+/**
+ * The minimum number of characters to allocate for a row when its contents
+ * are first stored in expanded form.
+ */
+#define GUAC_TERMINAL_BUFFER_ROW_MIN_AVAILABLE 256
+
+/**
+ * The maximum number of distinct sets of character attributes that may be
+ * referenced by compacted rows at any one time. Rows containing attributes
+ * beyond this limit are left expanded.
+ */
+#define GUAC_TERMINAL_BUFFER_MAX_ATTRIBUTES 65536
+
+/**
+ * The size of each segment of the file used to store compacted rows beyond
+ * the resident portion of the scrollback, in bytes. Rows whose compacted form
+ * is larger than this are never moved to the file.
+ */
+#define GUAC_TERMINAL_BUFFER_SPILL_SEGMENT_SIZE 1048576
+
+/**
+ * A fixed-size, independently-mapped region of the file used to store
+ * compacted rows beyond the resident portion of the scrollback. Rows are
+ * appended to a segment until it is full, and a segment may be reused once
+ * none of the rows stored within it remain.
+ */
+typedef struct guac_terminal_buffer_spill_segment {
+
+    /**
+     * The memory mapping of this segment of the file.
+     */
+    unsigned char* data;
+
+    /**
+     * The number of bytes at the beginning of this segment which have been
+     * allocated to rows, including rows which have since been removed.
+     */
+    size_t used;
+
+    /**
+     * The number of bytes within this segment still allocated to rows. Once
+     * this reaches zero, the segment is empty and may be reused.
+     */
+    size_t live;
+
+} guac_terminal_buffer_spill_segment;
+
 /**
- * A single variable-length row of terminal data.
+ * A single variable-length row of terminal data. Each row is stored in one of
+ * two forms: expanded, as an array of guac_terminal_char which may be read
+ * and modified directly, or compacted, as a run-length encoded sequence of
+ * bytes referencing attributes interned within the buffer. Rows which have
+ * scrolled off the terminal display are compacted, and are transparently
+ * expanded again by guac_terminal_buffer_get_row() when next accessed.
  */
 typedef struct guac_terminal_buffer_row {
 
     /**
-     * Array of guac_terminal_char representing the contents of the row.
+     * Array of guac_terminal_char representing the contents of the row, or
+     * NULL if the row is compacted or has not yet been used.
      */
     guac_terminal_char* characters;
 
@@ -51,6 +106,26 @@ typedef struct guac_terminal_buffer_row {
      */
     int available;
 
+    /**
+     * The run-length encoded contents of this row, or NULL if the row is not
+     * compacted. While a row is compacted, its length is still the number of
+     * characters it contains, but the characters array is NULL.
+     */
+    unsigned char* compact;
+
+    /**
+     * The size of the compact form of this row, in bytes. This value is only
+     * applicable if the row is compacted.
+     */
+    int compact_size;
+
+    /**
+     * The index of the guac_terminal_buffer_spill_segment containing the
+     * compact form of this row, or -1 if the compact form of this row (if
+     * any) is stored in memory.
+     */
+    int spill_segment;
+
 } guac_terminal_buffer_row;
 
 /**
@@ -91,6 +166,105 @@ typedef struct guac_terminal_buffer {
      */
     int available;
 
+    /**
+     * Every distinct set of character attributes referenced by compacted
+     * rows. Compacted rows refer to attributes by their index within this
+     * array. Elements which are no longer referenced are free and are reused
+     * for other attributes.
+     */
+    guac_terminal_attributes* attributes;
+
+    /**
+     * The number of runs within compacted rows which refer to each element
+     * of the attributes array, or zero if that element is free.
+     */
+    int* attributes_refcount;
+
+    /**
+     * The indices of all free elements within the attributes array, in no
+     * particular order.
+     */
+    int* attributes_free;
+
+    /**
+     * The number of indices currently stored within the attributes_free
+     * array.
+     */
+    int attributes_free_length;
+
+    /**
+     * The number of elements of the attributes array which have been used,
+     * including elements which have since been freed. Once every such element
+     * has been freed, this is reset to zero.
+     */
+    int attributes_length;
+
+    /**
+     * The number of elements in the attributes, attributes_refcount, and
+     * attributes_free arrays. After attributes_length equals this value, the
+     * arrays must be resized.
+     */
+    int attributes_available;
+
+    /**
+     * Open-addressed hash table, using linear probing, mapping sets of
+     * attributes to their index within the attributes array. Each element is
+     * one greater than the index of the attributes it refers to, or zero if
+     * unused. Free elements of the attributes array are not present.
+     */
+    int* attributes_index;
+
+    /**
+     * The number of elements in the attributes_index table. This is always
+     * either zero or a power of two.
+     */
+    int attributes_index_size;
+
+    /**
+     * The number of rows currently compacted.
+     */
+    int compacted_rows;
+
+    /**
+     * Temporary storage used while compacting rows.
+     */
+    unsigned char* compact_scratch;
+
+    /**
+     * The size of the compact_scratch buffer, in bytes.
+     */
+    size_t compact_scratch_size;
+
+    /**
+     * The number of rows of scrollback (rows above the top of the terminal)
+     * whose compact forms are held in memory, or zero if no rows are moved to
+     * a file. Compacted rows older than this are stored within
+     * spill_segments.
+     */
+    int resident_rows;
+
+    /**
+     * The file descriptor of the unlinked temporary file which backs
+     * spill_segments, or -1 if no such file exists.
+     */
+    int spill_fd;
+
+    /**
+     * Array of all segments of the spill file.
+     */
+    guac_terminal_buffer_spill_segment* spill_segments;
+
+    /**
+     * The number of segments within the spill_segments array.
+     */
+    int spill_segments_length;
+
+    /**
+     * The index of the segment to which newly-moved rows are appended, or -1
+     * if no rows have yet been moved.
+     */
+    int spill_current;
+
 } guac_terminal_buffer;
 
 /**
@@ -106,7 +280,7 @@ void guac_terminal_buffer_free(guac_terminal_buffer* buffer);
 
 /**
  * Returns the row at the given location. The row returned is guaranteed to be at least the given
- * width.
+ * width. If the row is compacted, it is expanded first.
  */
 guac_terminal_buffer_row* guac_terminal_buffer_get_row(guac_terminal_buffer* buffer, int row, int width);
 
@@ -131,5 +305,78 @@ void guac_terminal_buffer_copy_rows(guac_terminal_buffer* buffer,
 void guac_terminal_buffer_set_columns(guac_terminal_buffer* buffer, int row,
         int start_column, int end_column, guac_terminal_char* character);
 
+/**
+ * Sets consecutive columns within the given row, beginning at the given
+ * column, to the characters of the given text, each having the given
+ * attributes. Every byte of the text MUST be a printable ASCII character,
+ * occupying exactly one column.
+ *
+ * @param buffer
+ *     The buffer containing the row to modify.
+ *
+ * @param row
+ *     The row to modify.
+ *
+ * @param start_column
+ *     The column that should receive the first character of the text.
+ *
+ * @param text
+ *     The printable ASCII text to store.
+ *
+ * @param length
+ *     The number of characters in the given text.
+ *
+ * @param attributes
+ *     The attributes to assign to each character.
+ */
+void guac_terminal_buffer_set_text(guac_terminal_buffer* buffer, int row,
+        int start_column, const char* text, int length,
+        const guac_terminal_attributes* attributes);
+
+/**
+ * Compacts each row within the given range which is not already compacted,
+ * storing its contents as runs of characters sharing the same attributes and
+ * releasing its expanded storage. Compacted rows are expanded again
+ * automatically when retrieved with guac_terminal_buffer_get_row(), and thus
+ * this should only be invoked for rows which are unlikely to be accessed
+ * soon, such as rows which have scrolled out of view. If spilling has been
+ * enabled with guac_terminal_buffer_enable_spill(), compacted rows older than
+ * the resident portion of the scrollback are additionally moved to the spill
+ * file.
+ *
+ * @param buffer
+ *     The buffer containing the rows to compact.
+ *
+ * @param start_row
+ *     The first row to compact.
+ *
+ * @param end_row
+ *     The last row to compact, inclusive.
+ */
+void guac_terminal_buffer_compact_rows(guac_terminal_buffer* buffer,
+        int start_row, int end_row);
+
+/**
+ * Enables storage of the compacted scrollback beyond the given number of rows
+ * within a temporary, memory-mapped file, rather than in memory. The file is
+ * unlinked as soon as it is created, and is thus removed automatically once
+ * the buffer is freed. Rows stored within the file are read back (and paged
+ * in by the kernel) only when retrieved with guac_terminal_buffer_get_row().
+ *
+ * @param buffer
+ *     The buffer to enable spilling for.
+ *
+ * @param resident_rows
+ *     The number of rows of scrollback whose compact forms should still be
+ *     held in memory.
+ *
+ * @return
+ *     Zero if spilling has been enabled, non-zero if the temporary file could
+ *     not be created, in which case errno is set appropriately and all
+ *     scrollback continues to be held in memory.
+ */
+int guac_terminal_buffer_enable_spill(guac_terminal_buffer* buffer,
+        int resident_rows);
+
 #endif
 
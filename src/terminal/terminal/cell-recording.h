@@ -0,0 +1,285 @@
+/*
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ * KIND, either express or implied.  See the License for the
+ * specific language governing permissions and limitations
+ * under the License.
+ */
+
+#ifndef GUAC_TERMINAL_CELL_RECORDING_H
+#define GUAC_TERMINAL_CELL_RECORDING_H
+
+/**
+ * Constants, structures, and function definitions related to recordings of
+ * terminal sessions which describe changes to the character cells of the
+ * terminal display rather than the rendered pixels.
+ *
+ * Cell recordings are written as Guacamole protocol instructions, such that
+ * they may share a file (and parser) with the mouse and key events of a
+ * standard session recording:
+ *
+ *     term-size,COLUMNS,ROWS,CHAR_WIDTH,CHAR_HEIGHT,BACKGROUND;
+ *     term-text,ROW,COLUMN,WIDTH,FOREGROUND,BACKGROUND,FLAGS,TEXT;
+ *     term-fill,ROW,START,END,WIDTH,FOREGROUND,BACKGROUND,FLAGS,TEXT;
+ *     term-copy,ROW,START,END,OFFSET;
+ *     term-scroll,START,END,OFFSET;
+ *     sync,TIMESTAMP,FRAMES;
+ *
+ * Colors are 24-bit RGB values (0xRRGGBB) written in decimal, with reverse
+ * video, bold and half-bright already applied. Each character of TEXT
+ * occupies WIDTH columns, and blank cells are recorded as spaces.
+ *
+ * @file cell-recording.h
+ */
+
+#include "palette.h"
+
+#include <guacamole/socket.h>
+#include <guacamole/timestamp.h>
+
+/**
+ * The maximum number of characters which may be accumulated within a single
+ * "term-text" instruction before that instruction is written.
+ */
+#define GUAC_TERMINAL_CELL_RECORDING_MAX_RUN 256
+
+/**
+ * Flag set within the FLAGS element of "term-text" and "term-fill"
+ * instructions if the text should be rendered in bold.
+ */
+#define GUAC_TERMINAL_CELL_RECORDING_BOLD 1
+
+/**
+ * Flag set within the FLAGS element of "term-text" and "term-fill"
+ * instructions if the text should be underlined.
+ */
+#define GUAC_TERMINAL_CELL_RECORDING_UNDERSCORE 2
+
+/**
+ * An active cell recording, writing terminal display operations to a
+ * guac_socket. Consecutive single characters written to the same row with
+ * identical attributes are coalesced into a single "term-text" instruction.
+ */
+typedef struct guac_terminal_cell_recording {
+
+    /**
+     * The socket to which all recorded instructions should be written.
+     */
+    guac_socket* socket;
+
+    /**
+     * The row of the pending run of text, if any.
+     */
+    int run_row;
+
+    /**
+     * The column at which the pending run of text begins.
+     */
+    int run_column;
+
+    /**
+     * The number of columns occupied by each character of the pending run of
+     * text.
+     */
+    int run_width;
+
+    /**
+     * The number of characters within the pending run of text, or zero if
+     * there is no pending run.
+     */
+    int run_length;
+
+    /**
+     * The foreground color of the pending run of text, as a 24-bit RGB value.
+     */
+    int run_foreground;
+
+    /**
+     * The background color of the pending run of text, as a 24-bit RGB value.
+     */
+    int run_background;
+
+    /**
+     * The GUAC_TERMINAL_CELL_RECORDING_BOLD and
+     * GUAC_TERMINAL_CELL_RECORDING_UNDERSCORE flags of the pending run of
+     * text.
+     */
+    int run_flags;
+
+    /**
+     * The UTF-8 text of the pending run, including NULL terminator.
+     */
+    char run_text[GUAC_TERMINAL_CELL_RECORDING_MAX_RUN * 4 + 1];
+
+    /**
+     * The number of bytes of UTF-8 within run_text, excluding NULL
+     * terminator.
+     */
+    int run_text_length;
+
+    /**
+     * Whether any operation has been recorded since the last "sync"
+     * instruction was written.
+     */
+    int modified;
+
+} guac_terminal_cell_recording;
+
+/**
+ * Allocates a new cell recording which writes to the given socket. The
+ * socket is not owned by the cell recording and will not be freed when the
+ * cell recording is freed.
+ *
+ * @param socket
+ *     The socket to which recorded instructions should be written.
+ *
+ * @return
+ *     A newly-allocated cell recording.
+ */
+guac_terminal_cell_recording* guac_terminal_cell_recording_alloc(
+        guac_socket* socket);
+
+/**
+ * Writes any pending run of text and frees the given cell recording. The
+ * underlying socket is not freed. If the provided cell recording is NULL,
+ * this function has no effect.
+ *
+ * @param recording
+ *     The cell recording to free.
+ */
+void guac_terminal_cell_recording_free(guac_terminal_cell_recording* recording);
+
+/**
+ * Records that the terminal display has changed size. Any newly-exposed
+ * cells are implicitly cleared to the given background color.
+ *
+ * @param recording
+ *     The cell recording to write to.
+ *
+ * @param columns
+ *     The new width of the display, in characters.
+ *
+ * @param rows
+ *     The new height of the display, in characters.
+ *
+ * @param char_width
+ *     The width of each character cell, in pixels.
+ *
+ * @param char_height
+ *     The height of each character cell, in pixels.
+ *
+ * @param background
+ *     The default background color of the display.
+ */
+void guac_terminal_cell_recording_size(guac_terminal_cell_recording* recording,
+        int columns, int rows, int char_width, int char_height,
+        const guac_terminal_color* background);
+
+/**
+ * Records that the given range of columns within a row has been set to the
+ * given character. Ranges containing a single character are coalesced with
+ * any pending run of text.
+ *
+ * @param recording
+ *     The cell recording to write to.
+ *
+ * @param row
+ *     The row containing the modified columns.
+ *
+ * @param start_column
+ *     The first column modified, inclusive.
+ *
+ * @param end_column
+ *     The last column modified, inclusive.
+ *
+ * @param codepoint
+ *     The Unicode codepoint of the character, or zero if blank.
+ *
+ * @param width
+ *     The number of columns occupied by each copy of the character.
+ *
+ * @param foreground
+ *     The color in which the character should be drawn.
+ *
+ * @param background
+ *     The color of the background behind the character.
+ *
+ * @param flags
+ *     Any combination of GUAC_TERMINAL_CELL_RECORDING_BOLD and
+ *     GUAC_TERMINAL_CELL_RECORDING_UNDERSCORE.
+ */
+void guac_terminal_cell_recording_set(guac_terminal_cell_recording* recording,
+        int row, int start_column, int end_column, int codepoint, int width,
+        const guac_terminal_color* foreground,
+        const guac_terminal_color* background, int flags);
+
+/**
+ * Records that a range of columns within a row has been copied by the given
+ * offset.
+ *
+ * @param recording
+ *     The cell recording to write to.
+ *
+ * @param row
+ *     The row containing the copied columns.
+ *
+ * @param start_column
+ *     The first column copied, inclusive.
+ *
+ * @param end_column
+ *     The last column copied, inclusive.
+ *
+ * @param offset
+ *     The number of columns to move the copied range by.
+ */
+void guac_terminal_cell_recording_copy_columns(
+        guac_terminal_cell_recording* recording, int row,
+        int start_column, int end_column, int offset);
+
+/**
+ * Records that a range of rows has been copied by the given offset, as
+ * happens when a region of the display scrolls.
+ *
+ * @param recording
+ *     The cell recording to write to.
+ *
+ * @param start_row
+ *     The first row copied, inclusive.
+ *
+ * @param end_row
+ *     The last row copied, inclusive.
+ *
+ * @param offset
+ *     The number of rows to move the copied range by.
+ */
+void guac_terminal_cell_recording_copy_rows(
+        guac_terminal_cell_recording* recording,
+        int start_row, int end_row, int offset);
+
+/**
+ * Writes any pending run of text, followed by a "sync" instruction marking
+ * the end of a frame. If nothing has been recorded since the previous frame,
+ * this function has no effect.
+ *
+ * @param recording
+ *     The cell recording to write to.
+ *
+ * @param timestamp
+ *     The time at which the frame ended.
+ */
+void guac_terminal_cell_recording_sync(guac_terminal_cell_recording* recording,
+        guac_timestamp timestamp);
+
+#endif
+
@@ -26,7 +26,9 @@
  * @file display.h
  */
 
+#include "cell-recording.h"
 #include "common/surface.h"
+#include "glyph-cache.h"
 #include "palette.h"
 #include "types.h"
 
@@ -42,6 +44,13 @@
  */
 #define GUAC_TERMINAL_MAX_CHAR_WIDTH 2
 
+/**
+ * The number of cells in each row of the glyph atlas. Each cell is wide
+ * enough to hold a glyph of GUAC_TERMINAL_MAX_CHAR_WIDTH columns, and the
+ * atlas has enough rows of cells to hold every glyph within the glyph cache.
+ */
+#define GUAC_TERMINAL_GLYPH_ATLAS_COLUMNS 64
+
 /**
  * The size of margins between the console text and the border in mm.
  */
@@ -122,6 +131,35 @@ typedef struct guac_terminal_display {
      */
     guac_terminal_operation* operations;
 
+    /**
+     * The indices of all rows which may contain pending operations, in the
+     * order those rows were first modified. Each row is listed at most once.
+     */
+    int* dirty_rows;
+
+    /**
+     * The number of rows within the dirty_rows array.
+     */
+    int dirty_rows_length;
+
+    /**
+     * For each row, the leftmost column which may contain a pending
+     * operation. This value is only applicable if the row is dirty.
+     */
+    int* dirty_left;
+
+    /**
+     * For each row, the rightmost column which may contain a pending
+     * operation, or -1 if the row has no pending operations.
+     */
+    int* dirty_right;
+
+    /**
+     * The cell recording to which all display operations should be written,
+     * or NULL if the contents of the display are not being recorded.
+     */
+    guac_terminal_cell_recording* cell_recording;
+
     /**
      * The width of the screen, in characters.
      */
@@ -185,6 +223,28 @@ typedef struct guac_terminal_display {
      */
     guac_terminal_color glyph_background;
 
+    /**
+     * Cache of previously-rendered glyphs, keyed by character and color.
+     */
+    guac_terminal_glyph_cache* glyph_cache;
+
+    /**
+     * Off-screen surface containing a copy of each glyph within glyph_cache,
+     * from which glyphs are copied to display_surface such that each glyph
+     * is sent to connected users only once, or NULL if glyphs are instead
+     * drawn directly to display_surface as images. The glyph at index i of
+     * the glyph cache occupies the cell at column
+     * (i % GUAC_TERMINAL_GLYPH_ATLAS_COLUMNS) and row
+     * (i / GUAC_TERMINAL_GLYPH_ATLAS_COLUMNS) of this surface.
+     */
+    guac_common_surface* glyph_atlas;
+
+    /**
+     * The buffer backing glyph_atlas, or NULL if the glyph atlas is not in
+     * use.
+     */
+    guac_layer* glyph_atlas_buffer;
+
     /**
      * The surface containing the actual terminal.
      */
@@ -229,12 +289,15 @@ typedef struct guac_terminal_display {
 
 /**
  * Allocates a new display having the given default foreground and background
- * colors.
+ * colors. If glyph_atlas is true, rendered glyphs are stored within an
+ * off-screen buffer on the client and text is drawn with "copy" instructions
+ * from that buffer, rather than by sending each changed character as part of
+ * an image.
  */
 guac_terminal_display* guac_terminal_display_alloc(guac_client* client,
         const char* font_name, int font_size, int dpi,
         guac_terminal_color* foreground, guac_terminal_color* background,
-        guac_terminal_color (*palette)[256]);
+        guac_terminal_color (*palette)[256], bool glyph_atlas);
 
 /**
  * Frees the given display.
@@ -311,6 +374,35 @@ void guac_terminal_display_copy_rows(guac_terminal_display* display,
 void guac_terminal_display_set_columns(guac_terminal_display* display, int row,
         int start_column, int end_column, guac_terminal_char* character);
 
+/**
+ * Sets consecutive columns within the given row, beginning at the given
+ * column, to the characters of the given text, each having the given
+ * attributes. Every byte of the text MUST be a printable ASCII character,
+ * occupying exactly one column. Any part of the text which falls outside the
+ * display is ignored.
+ *
+ * @param display
+ *     The display containing the row to modify.
+ *
+ * @param row
+ *     The row to modify.
+ *
+ * @param start_column
+ *     The column that should receive the first character of the text.
+ *
+ * @param text
+ *     The printable ASCII text to draw.
+ *
+ * @param length
+ *     The number of characters in the given text.
+ *
+ * @param attributes
+ *     The attributes to assign to each character.
+ */
+void guac_terminal_display_set_text(guac_terminal_display* display, int row,
+        int start_column, const char* text, int length,
+        const guac_terminal_attributes* attributes);
+
 /**
  * Resize the terminal to the given dimensions.
  */
@@ -0,0 +1,177 @@
+/*
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ * KIND, either express or implied.  See the License for the
+ * specific language governing permissions and limitations
+ * under the License.
+ */
+
+#ifndef GUAC_TERMINAL_GLYPH_CACHE_H
+#define GUAC_TERMINAL_GLYPH_CACHE_H
+
+/**
+ * A bounded cache of rendered terminal glyphs, allowing the same character
+ * drawn in the same colors to be copied directly into the terminal display
+ * rather than laid out and rasterized again.
+ *
+ * @file glyph-cache.h
+ */
+
+#include "palette.h"
+
+#include <cairo/cairo.h>
+#include <stdint.h>
+
+/**
+ * The number of glyphs that a glyph cache can hold. This MUST be a power of
+ * two.
+ */
+#define GUAC_TERMINAL_GLYPH_CACHE_SIZE 2048
+
+/**
+ * A single rendered glyph within a glyph cache.
+ */
+typedef struct guac_terminal_glyph {
+
+    /**
+     * The codepoint of the character rendered within this glyph, or zero if
+     * this glyph is unused.
+     */
+    int codepoint;
+
+    /**
+     * The foreground color of this glyph, as a 24-bit RGB value.
+     */
+    uint32_t foreground;
+
+    /**
+     * The background color of this glyph, as a 24-bit RGB value.
+     */
+    uint32_t background;
+
+    /**
+     * The rendered glyph, or NULL if no surface has yet been allocated for
+     * this glyph. The surface of an unused glyph may be retained for reuse by
+     * future glyphs of the same dimensions.
+     */
+    cairo_surface_t* surface;
+
+} guac_terminal_glyph;
+
+/**
+ * A fixed-size, direct-mapped cache of rendered glyphs. Each glyph is keyed by
+ * its codepoint and the actual RGB values of its foreground and background
+ * colors, such that changes to the terminal palette never result in stale
+ * glyphs being drawn. As the font is not part of that key, the cache MUST be
+ * cleared whenever the font of the terminal display changes.
+ */
+typedef struct guac_terminal_glyph_cache {
+
+    /**
+     * All glyphs within this cache, indexed by the hash of their key. The
+     * location of a glyph within this array never changes, and may be used to
+     * associate each glyph with storage elsewhere, such as a cell within a
+     * glyph atlas.
+     */
+    guac_terminal_glyph glyphs[GUAC_TERMINAL_GLYPH_CACHE_SIZE];
+
+} guac_terminal_glyph_cache;
+
+/**
+ * Allocates a new, empty glyph cache.
+ *
+ * @return
+ *     A newly-allocated glyph cache, which must eventually be freed with a
+ *     call to guac_terminal_glyph_cache_free().
+ */
+guac_terminal_glyph_cache* guac_terminal_glyph_cache_alloc();
+
+/**
+ * Frees the given glyph cache and all glyphs within it.
+ *
+ * @param cache
+ *     The glyph cache to free.
+ */
+void guac_terminal_glyph_cache_free(guac_terminal_glyph_cache* cache);
+
+/**
+ * Removes all glyphs from the given glyph cache, freeing their surfaces.
+ *
+ * @param cache
+ *     The glyph cache to clear.
+ */
+void guac_terminal_glyph_cache_clear(guac_terminal_glyph_cache* cache);
+
+/**
+ * Returns the glyph for the given character and colors, if that glyph is
+ * present within the given cache.
+ *
+ * @param cache
+ *     The glyph cache to search.
+ *
+ * @param codepoint
+ *     The codepoint of the character rendered by the glyph.
+ *
+ * @param foreground
+ *     The foreground color of the glyph.
+ *
+ * @param background
+ *     The background color of the glyph.
+ *
+ * @return
+ *     The cached glyph, or NULL if no such glyph is cached. The returned glyph
+ *     is owned by the cache and its contents remain valid only until the next
+ *     call to any other glyph cache function.
+ */
+guac_terminal_glyph* guac_terminal_glyph_cache_get(
+        guac_terminal_glyph_cache* cache, int codepoint,
+        const guac_terminal_color* foreground,
+        const guac_terminal_color* background);
+
+/**
+ * Adds a glyph for the given character and colors to the given cache,
+ * replacing any other glyph stored at the same location. The contents of the
+ * surface of the returned glyph are undefined, and the caller MUST render the
+ * glyph in its entirety before calling any other glyph cache function.
+ *
+ * @param cache
+ *     The glyph cache to add the glyph to.
+ *
+ * @param codepoint
+ *     The codepoint of the character rendered by the glyph.
+ *
+ * @param foreground
+ *     The foreground color of the glyph.
+ *
+ * @param background
+ *     The background color of the glyph.
+ *
+ * @param width
+ *     The width of the glyph, in pixels.
+ *
+ * @param height
+ *     The height of the glyph, in pixels.
+ *
+ * @return
+ *     The newly-added glyph, whose surface must be rendered into. The
+ *     returned glyph is owned by the cache and its contents remain valid only
+ *     until the next call to any other glyph cache function.
+ */
+guac_terminal_glyph* guac_terminal_glyph_cache_add(
+        guac_terminal_glyph_cache* cache, int codepoint,
+        const guac_terminal_color* foreground,
+        const guac_terminal_color* background,
+        int width, int height);
+
+#endif
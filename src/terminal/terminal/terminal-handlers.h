@@ -44,6 +44,33 @@
  */
 int guac_terminal_echo(guac_terminal* term, unsigned char c);
 
+/**
+ * Handles as many leading characters of the given data as possible in bulk,
+ * provided the terminal is in the default mode and those characters are
+ * printable ASCII. Such runs are written directly to the terminal buffer and
+ * display a row segment at a time, producing the same result as passing each
+ * character to guac_terminal_echo() individually. If the terminal is in any
+ * other state (another character handler is active, a pipe stream is open,
+ * insert mode is enabled, a UTF-8 sequence is partially decoded, or a
+ * non-Unicode character set is active), or the data does not begin with a
+ * printable ASCII character, no data is handled.
+ *
+ * @param term
+ *     The terminal that received the given data.
+ *
+ * @param text
+ *     The data received by the given terminal.
+ *
+ * @param length
+ *     The number of bytes of data received.
+ *
+ * @return
+ *     The number of leading bytes of the given data that were handled, which
+ *     may be zero. Any remaining bytes must be handled by the current
+ *     character handler as usual.
+ */
+int guac_terminal_echo_text(guac_terminal* term, const char* text, int length);
+
 /**
  * Handles any characters which follow an ANSI ESC (0x1B) character.
  *
@@ -28,6 +28,8 @@
 #include "terminal.h"
 #include "typescript.h"
 
+#include <guacamole/timestamp.h>
+
 /**
  * Handler for characters printed to the terminal. When a character is printed,
  * the current char handler for the terminal is called and given that
@@ -104,6 +106,26 @@ struct guac_terminal {
      */
     pthread_cond_t modified_cond;
 
+    /**
+     * The number of bytes of output passed to guac_terminal_write() since the
+     * last frame was rendered. The modified_lock will always be acquired
+     * before this value is read or altered.
+     */
+    int unrendered_bytes;
+
+    /**
+     * Condition which is signalled each time a frame has been rendered and
+     * unrendered_bytes has been reset to zero.
+     */
+    pthread_cond_t rendered_cond;
+
+    /**
+     * The time that the most recently rendered frame began, used to determine
+     * how long the next frame must be delayed to allow a lagging client to
+     * catch up.
+     */
+    guac_timestamp last_frame_start;
+
     /**
      * Pipe which will be the source of user input. When a terminal code
      * generates synthesized user input, that data will be written to
@@ -317,6 +339,19 @@ struct guac_terminal {
      */
     guac_terminal_char_handler* char_handler;
 
+    /**
+     * The bits of the UTF-8 sequence currently being decoded by
+     * guac_terminal_echo() that have been received thus far.
+     */
+    int utf8_codepoint;
+
+    /**
+     * The number of bytes remaining in the UTF-8 sequence currently being
+     * decoded by guac_terminal_echo(), or zero if no such sequence is in
+     * progress.
+     */
+    int utf8_bytes_remaining;
+
     /**
      * The difference between the currently-rendered screen and the current
      * state of the terminal, and the contextual information necessary to
@@ -551,6 +586,32 @@ void guac_terminal_reset(guac_terminal* term);
  */
 int guac_terminal_set(guac_terminal* term, int row, int col, int codepoint);
 
+/**
+ * Sets consecutive characters within the given row, beginning at the given
+ * column, to the characters of the given text, using the current attributes
+ * of the terminal. This is equivalent to invoking guac_terminal_set() for
+ * each character, but updates the buffer and display for the entire run at
+ * once. Every byte of the text MUST be a printable ASCII character, and the
+ * text MUST fit within the remaining columns of the row.
+ *
+ * @param term
+ *     The terminal to modify.
+ *
+ * @param row
+ *     The row to modify.
+ *
+ * @param col
+ *     The column that should receive the first character of the text.
+ *
+ * @param text
+ *     The printable ASCII text to write.
+ *
+ * @param length
+ *     The number of characters in the given text.
+ */
+void guac_terminal_set_text(guac_terminal* term, int row, int col,
+        const char* text, int length);
+
 /**
  * Clears the given region within a single row.
  */
@@ -31,6 +31,7 @@
 #include <stdbool.h>
 
 #include <guacamole/client.h>
+#include <guacamole/socket.h>
 #include <guacamole/stream.h>
 
 /**
@@ -64,6 +65,18 @@
  */
 #define GUAC_TERMINAL_DEFAULT_DISABLE_COPY false
 
+/**
+ * The default value for the "glyph atlas" flag; by default glyphs are sent
+ * as images.
+ */
+#define GUAC_TERMINAL_DEFAULT_GLYPH_ATLAS false
+
+/**
+ * The default number of rows of scrollback to hold in memory, where zero
+ * means that all scrollback is held in memory.
+ */
+#define GUAC_TERMINAL_DEFAULT_RESIDENT_SCROLLBACK 0
+
 /**
  * The absolute maximum number of rows to allow within the display.
  */
@@ -86,6 +99,20 @@
  */
 #define GUAC_TERMINAL_FRAME_TIMEOUT 10
 
+/**
+ * The number of bytes of output that may be handled by guac_terminal_write()
+ * within a single frame while the client is lagging behind. Once this many
+ * bytes have been handled, further writes block until the next frame is
+ * rendered, pushing back on whatever is producing the output.
+ */
+#define GUAC_TERMINAL_MAX_UNRENDERED_BYTES 65536
+
+/**
+ * The maximum amount of time that guac_terminal_write() will block while
+ * waiting for a lagging client, in milliseconds.
+ */
+#define GUAC_TERMINAL_BACKPRESSURE_TIMEOUT 1000
+
 /**
  * The maximum number of custom tab stops.
  */
@@ -238,6 +265,21 @@ typedef struct guac_terminal_options {
      */
     int backspace;
 
+    /**
+     * Whether rendered glyphs should be stored within an off-screen buffer on
+     * the client, with text drawn using "copy" instructions from that buffer
+     * rather than as images.
+     */
+    bool glyph_atlas;
+
+    /**
+     * The number of rows of scrollback to hold in memory. Any older rows
+     * within the scrollback are moved to a temporary memory-mapped file, and
+     * are read back only when scrolled into view or selected. If zero, or if
+     * at least max_scrollback, all scrollback is held in memory.
+     */
+    int resident_scrollback;
+
 } guac_terminal_options;
 
 /**
@@ -787,6 +829,24 @@ void guac_terminal_remove_user(guac_terminal* terminal, guac_user* user);
 int guac_terminal_create_typescript(guac_terminal* term, const char* path,
         const char* name, int create_path, int allow_write_existing);
 
+/**
+ * Requests that the terminal record all changes to its display as character
+ * cell updates, writing those updates as "term-*" instructions to the given
+ * socket rather than recording the rendered display. This is intended for
+ * use with the socket of a session recording which does not include
+ * graphical output, such that guacenc can later render the terminal contents
+ * to video. The cell recording will automatically be closed once the
+ * terminal is freed, but the socket will not be freed.
+ *
+ * @param term
+ *     The terminal whose display should be recorded.
+ *
+ * @param socket
+ *     The socket to which the cell recording should be written.
+ */
+void guac_terminal_create_cell_recording(guac_terminal* term,
+        guac_socket* socket);
+
 /**
  * Immediately applies the given color scheme to the given terminal, overriding
  * the color scheme provided when the terminal was created. Valid color schemes
@@ -28,6 +28,9 @@
  */
 
 #include <guacamole/timestamp.h>
+#include <guacamole/writer-types.h>
+
+#include <stdint.h>
 
 /**
  * A NULL-terminated string of raw bytes which should be written at the
@@ -116,6 +119,26 @@ typedef struct guac_terminal_typescript {
      */
     int timing_fd;
 
+    /**
+     * The guac_writer which queues raw terminal output and writes that output
+     * to the data file from a background thread.
+     */
+    guac_writer* data_writer;
+
+    /**
+     * The guac_writer which queues timing information and writes that
+     * information to the timing file from a background thread.
+     */
+    guac_writer* timing_writer;
+
+    /**
+     * The total number of bytes of raw terminal output which have been
+     * dropped from this typescript because the data or timing file could not
+     * be written quickly enough. Output is dropped together with its timing
+     * entry, such that the two files remain consistent.
+     */
+    uint64_t bytes_dropped;
+
     /**
      * The last time that this typescript was flushed. If this typescript was
      * never flushed, this will be the time the typescript was created.
@@ -171,9 +194,30 @@ guac_terminal_typescript* guac_terminal_typescript_alloc(const char* path,
 void guac_terminal_typescript_write(guac_terminal_typescript* typescript,
         char c);
 
+/**
+ * Writes an arbitrary number of bytes of terminal data to the typescript,
+ * flushing and writing new timestamps as necessary. This is equivalent to
+ * calling guac_terminal_typescript_write() for each byte, but avoids copying
+ * the data one byte at a time.
+ *
+ * @param typescript
+ *     The typescript that the given raw terminal data should be written to.
+ *
+ * @param buffer
+ *     The raw terminal data to write to the typescript.
+ *
+ * @param length
+ *     The number of bytes of raw terminal data to write.
+ */
+void guac_terminal_typescript_write_buffer(
+        guac_terminal_typescript* typescript, const char* buffer, int length);
+
 /**
  * Flushes any pending data to the typescript, writing a new timestamp to the
- * timing file if any data was flushed.
+ * timing file if any data was flushed. The data and its timestamp are queued
+ * for writing by background threads, and this function does not wait for
+ * either to reach storage. If either cannot be queued, both are dropped and
+ * counted within bytes_dropped.
  *
  * @param typescript
  *     The typescript which should be flushed.
@@ -182,13 +226,20 @@ void guac_terminal_typescript_flush(guac_terminal_typescript* typescript);
 
 /**
  * Frees all resources associated with the given typescript, flushing and
- * closing the data and timing files and freeing all related memory. If the
- * provided typescript is NULL, this function has no effect.
+ * closing the data and timing files and freeing all related memory. All
+ * queued data, including the typescript footer, is written before this
+ * function returns. If the provided typescript is NULL, this function has no
+ * effect.
  *
  * @param typescript
  *     The typescript to free.
+ *
+ * @return
+ *     The total number of bytes of the data file, including raw terminal
+ *     output and the typescript footer, which were dropped because they
+ *     could not be queued or written, or zero if the typescript is NULL.
  */
-void guac_terminal_typescript_free(guac_terminal_typescript* typescript);
+uint64_t guac_terminal_typescript_free(guac_terminal_typescript* typescript);
 
 #endif
 
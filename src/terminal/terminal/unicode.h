@@ -0,0 +1,119 @@
+/*
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ * KIND, either express or implied.  See the License for the
+ * specific language governing permissions and limitations
+ * under the License.
+ */
+
+#ifndef GUAC_TERMINAL_UNICODE_H
+#define GUAC_TERMINAL_UNICODE_H
+
+/**
+ * Locale-independent classification of Unicode characters by the number of
+ * columns they occupy and whether they have a visible glyph, backed by
+ * lookup tables generated at build time from the Unicode Character Database
+ * (see unicode/generate.pl).
+ *
+ * @file unicode.h
+ */
+
+#include <stdbool.h>
+
+/**
+ * The class of characters which occupy a single column and have a visible
+ * glyph. This is the class of all characters not otherwise classified.
+ */
+#define GUAC_TERMINAL_UNICODE_NARROW 0
+
+/**
+ * The class of characters which occupy no columns, such as combining marks
+ * and format characters.
+ */
+#define GUAC_TERMINAL_UNICODE_ZERO 1
+
+/**
+ * The class of characters which occupy two columns, such as East Asian wide
+ * and fullwidth characters, including emoji with default emoji presentation.
+ */
+#define GUAC_TERMINAL_UNICODE_WIDE 2
+
+/**
+ * The class of characters which occupy a single column but have no visible
+ * glyph, such as spaces.
+ */
+#define GUAC_TERMINAL_UNICODE_BLANK 3
+
+/**
+ * The number of codepoints covered by each block of the second level of the
+ * lookup table.
+ */
+#define GUAC_TERMINAL_UNICODE_BLOCK_SIZE 256
+
+/**
+ * The number of bytes within each block of the second level of the lookup
+ * table. Each byte contains the classes of four consecutive codepoints, two
+ * bits per codepoint, with the lowest codepoint in the least significant
+ * bits.
+ */
+#define GUAC_TERMINAL_UNICODE_BLOCK_BYTES (GUAC_TERMINAL_UNICODE_BLOCK_SIZE / 4)
+
+/**
+ * The number of entries in the first level of the lookup table, one for each
+ * block of GUAC_TERMINAL_UNICODE_BLOCK_SIZE codepoints.
+ */
+#define GUAC_TERMINAL_UNICODE_INDEX_SIZE (0x110000 / GUAC_TERMINAL_UNICODE_BLOCK_SIZE)
+
+/**
+ * The first level of the lookup table, mapping each block of codepoints to
+ * the index of the corresponding block within guac_terminal_unicode_blocks.
+ * Identical blocks are stored only once.
+ */
+extern const unsigned short guac_terminal_unicode_index[GUAC_TERMINAL_UNICODE_INDEX_SIZE];
+
+/**
+ * The second level of the lookup table, containing the packed classes of each
+ * distinct block of codepoints.
+ */
+extern const unsigned char guac_terminal_unicode_blocks[][GUAC_TERMINAL_UNICODE_BLOCK_BYTES];
+
+/**
+ * Returns the class of the given codepoint, as defined by the
+ * GUAC_TERMINAL_UNICODE_* constants. Values which are not valid codepoints
+ * are considered GUAC_TERMINAL_UNICODE_NARROW.
+ *
+ * @param codepoint
+ *     The codepoint to classify.
+ *
+ * @return
+ *     The class of the given codepoint.
+ */
+int guac_terminal_unicode_class(int codepoint);
+
+/**
+ * Returns the number of columns occupied by the given codepoint when
+ * displayed within the terminal. Unlike wcwidth(), the result does not depend
+ * on the current locale, and characters which are not printable (such as
+ * control characters) are considered to occupy a single column.
+ *
+ * @param codepoint
+ *     The codepoint to measure.
+ *
+ * @return
+ *     The number of columns occupied by the given codepoint: 0, 1, or 2.
+ */
+int guac_terminal_unicode_width(int codepoint);
+
+#endif
+
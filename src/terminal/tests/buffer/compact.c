@@ -0,0 +1,412 @@
+/*
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ * KIND, either express or implied.  See the License for the
+ * specific language governing permissions and limitations
+ * under the License.
+ */
+
+#include "terminal/buffer.h"
+#include "terminal/types.h"
+
+#include <CUnit/CUnit.h>
+#include <stdbool.h>
+#include <string.h>
+
+/**
+ * The number of columns in each row tested below.
+ */
+#define TEST_COLUMNS 80
+
+/**
+ * Returns whether the given characters are identical, comparing each field
+ * individually such that structure padding is ignored.
+ *
+ * @param a
+ *     The first character to compare.
+ *
+ * @param b
+ *     The second character to compare.
+ *
+ * @return
+ *     true if the characters are identical, false otherwise.
+ */
+static bool chars_equal(const guac_terminal_char* a,
+        const guac_terminal_char* b) {
+
+    const guac_terminal_attributes* x = &a->attributes;
+    const guac_terminal_attributes* y = &b->attributes;
+
+    return a->value == b->value
+        && a->width == b->width
+        && x->bold == y->bold
+        && x->half_bright == y->half_bright
+        && x->reverse == y->reverse
+        && x->cursor == y->cursor
+        && x->underscore == y->underscore
+        && x->foreground.palette_index == y->foreground.palette_index
+        && x->foreground.red == y->foreground.red
+        && x->foreground.green == y->foreground.green
+        && x->foreground.blue == y->foreground.blue
+        && x->background.palette_index == y->background.palette_index
+        && x->background.red == y->background.red
+        && x->background.green == y->background.green
+        && x->background.blue == y->background.blue;
+
+}
+
+/**
+ * Returns a blank character having the default attributes used by the tests
+ * below.
+ *
+ * @return
+ *     A blank, single-column character.
+ */
+static guac_terminal_char blank_char() {
+
+    guac_terminal_char blank = {
+        .value = ' ',
+        .attributes = {
+            .foreground = { .palette_index = 7, .red = 0xAA, .green = 0xAA, .blue = 0xAA },
+            .background = { .palette_index = 0 }
+        },
+        .width = 1
+    };
+
+    return blank;
+
+}
+
+/**
+ * Compacts row 0 of the given buffer, verifies that it was compacted, and
+ * verifies that it expands back to exactly the given characters.
+ *
+ * @param buffer
+ *     The buffer whose first row should be compacted and expanded.
+ *
+ * @param expected
+ *     The characters which row 0 must contain after being expanded.
+ *
+ * @param length
+ *     The number of characters within row 0.
+ */
+static void assert_round_trip(guac_terminal_buffer* buffer,
+        const guac_terminal_char* expected, int length) {
+
+    guac_terminal_buffer_compact_rows(buffer, 0, 0);
+
+    /* The row must now be stored only in compact form */
+    guac_terminal_buffer_row* row = &buffer->rows[buffer->top];
+    CU_ASSERT_PTR_NULL(row->characters);
+    CU_ASSERT_PTR_NOT_NULL_FATAL(row->compact);
+    CU_ASSERT_EQUAL(row->length, length);
+    CU_ASSERT_EQUAL(buffer->compacted_rows, 1);
+
+    /* Retrieving the row must restore every character exactly */
+    row = guac_terminal_buffer_get_row(buffer, 0, 0);
+    CU_ASSERT_PTR_NULL(row->compact);
+    CU_ASSERT_PTR_NOT_NULL_FATAL(row->characters);
+    CU_ASSERT_EQUAL_FATAL(row->length, length);
+
+    for (int i = 0; i < length; i++)
+        CU_ASSERT_TRUE(chars_equal(&row->characters[i], &expected[i]));
+
+    /* Attributes are discarded once no compacted row refers to them */
+    CU_ASSERT_EQUAL(buffer->compacted_rows, 0);
+    CU_ASSERT_EQUAL(buffer->attributes_length, 0);
+
+}
+
+/**
+ * Test which verifies that a row whose characters have many different
+ * attributes, including characters whose values require multi-byte varints,
+ * is restored exactly after being compacted and expanded.
+ */
+void test_buffer__compact_mixed_attributes() {
+
+    guac_terminal_char blank = blank_char();
+    guac_terminal_buffer* buffer = guac_terminal_buffer_alloc(4, &blank);
+
+    for (int column = 0; column < TEST_COLUMNS; column++) {
+
+        guac_terminal_char c = blank;
+
+        /* Vary every attribute at a different rate, such that runs of
+         * differing lengths result */
+        c.value = (column % 3 == 0) ? 0x1F600 + column : 'a' + column % 26;
+        c.attributes.bold = (column / 2) % 2;
+        c.attributes.half_bright = (column / 5) % 2;
+        c.attributes.reverse = (column / 7) % 2;
+        c.attributes.underscore = (column / 11) % 2;
+        c.attributes.foreground.palette_index = (column / 4) % 3 == 2 ? -1 : 1;
+        c.attributes.foreground.red = column * 3;
+        c.attributes.foreground.green = 255 - column;
+        c.attributes.background.blue = column / 8;
+
+        guac_terminal_buffer_set_columns(buffer, 0, column, column, &c);
+
+    }
+
+    /* The value zero must also survive encoding as value plus one */
+    guac_terminal_char zero = blank;
+    zero.value = 0;
+    guac_terminal_buffer_set_columns(buffer, 0, TEST_COLUMNS - 1,
+            TEST_COLUMNS - 1, &zero);
+
+    guac_terminal_char expected[TEST_COLUMNS];
+    guac_terminal_buffer_row* row = guac_terminal_buffer_get_row(buffer, 0, 0);
+    CU_ASSERT_EQUAL_FATAL(row->length, TEST_COLUMNS);
+    memcpy(expected, row->characters, sizeof(expected));
+
+    assert_round_trip(buffer, expected, TEST_COLUMNS);
+    guac_terminal_buffer_free(buffer);
+
+}
+
+/**
+ * Test which verifies that rows containing multi-column characters are
+ * restored exactly after being compacted and expanded, whether the
+ * continuation characters of those characters are implied by the compact
+ * form or stored explicitly.
+ */
+void test_buffer__compact_wide() {
+
+    guac_terminal_char blank = blank_char();
+    guac_terminal_buffer* buffer = guac_terminal_buffer_alloc(4, &blank);
+
+    guac_terminal_char wide = blank;
+    wide.value = 0x4E00;
+    wide.width = 2;
+
+    /* A run of wide characters, each followed by its continuation */
+    guac_terminal_buffer_set_columns(buffer, 0, 0, 19, &wide);
+
+    /* A wide character whose continuation has been overwritten */
+    guac_terminal_buffer_set_columns(buffer, 0, 30, 31, &wide);
+    guac_terminal_char narrow = blank;
+    narrow.value = 'x';
+    guac_terminal_buffer_set_columns(buffer, 0, 31, 31, &narrow);
+
+    /* A wide character whose continuation has different attributes */
+    guac_terminal_buffer_set_columns(buffer, 0, 40, 41, &wide);
+    guac_terminal_buffer_row* row = guac_terminal_buffer_get_row(buffer, 0, 0);
+    row->characters[41].attributes.reverse = true;
+
+    /* A wide character which is cut off by the end of the row, as happens
+     * when the terminal is made narrower */
+    guac_terminal_buffer_set_columns(buffer, 0, TEST_COLUMNS - 1,
+            TEST_COLUMNS, &wide);
+    row = guac_terminal_buffer_get_row(buffer, 0, 0);
+    row->length = TEST_COLUMNS;
+
+    guac_terminal_char expected[TEST_COLUMNS];
+    memcpy(expected, row->characters, sizeof(expected));
+
+    assert_round_trip(buffer, expected, TEST_COLUMNS);
+    guac_terminal_buffer_free(buffer);
+
+}
+
+/**
+ * Test which verifies that long runs of characters sharing the same
+ * attributes are stored as a single run, and are restored exactly after
+ * being compacted and expanded.
+ */
+void test_buffer__compact_runs() {
+
+    guac_terminal_char blank = blank_char();
+    guac_terminal_buffer* buffer = guac_terminal_buffer_alloc(4, &blank);
+
+    guac_terminal_attributes attributes = blank.attributes;
+    attributes.bold = true;
+
+    /* A single run of text followed by a single run of blanks */
+    const char text[] = "The quick brown fox jumps over the lazy dog";
+    guac_terminal_buffer_set_text(buffer, 0, 0, text, sizeof(text) - 1,
+            &attributes);
+    guac_terminal_buffer_get_row(buffer, 0, TEST_COLUMNS);
+
+    guac_terminal_char expected[TEST_COLUMNS];
+    guac_terminal_buffer_row* row = guac_terminal_buffer_get_row(buffer, 0, 0);
+    CU_ASSERT_EQUAL_FATAL(row->length, TEST_COLUMNS);
+    memcpy(expected, row->characters, sizeof(expected));
+
+    /* Each of the two runs is a three-byte header followed by one byte per
+     * character */
+    guac_terminal_buffer_compact_rows(buffer, 0, 0);
+    CU_ASSERT_EQUAL(buffer->rows[buffer->top].compact_size,
+            2 * 3 + TEST_COLUMNS);
+    CU_ASSERT_EQUAL(buffer->attributes_length, 2);
+
+    /* Compacting a compacted row has no effect */
+    guac_terminal_buffer_compact_rows(buffer, 0, 0);
+    CU_ASSERT_EQUAL(buffer->compacted_rows, 1);
+
+    guac_terminal_buffer_get_row(buffer, 0, 0);
+    assert_round_trip(buffer, expected, TEST_COLUMNS);
+
+    /* Expanded rows may be extended as usual */
+    row = guac_terminal_buffer_get_row(buffer, 0, TEST_COLUMNS * 2);
+    CU_ASSERT_EQUAL(row->length, TEST_COLUMNS * 2);
+    CU_ASSERT_TRUE(chars_equal(&row->characters[TEST_COLUMNS * 2 - 1],
+                &blank));
+
+    guac_terminal_buffer_free(buffer);
+
+}
+
+
+/**
+ * Returns the truecolor attributes used by the tests below for the given
+ * number, such that each number results in distinct attributes.
+ *
+ * @param number
+ *     The number identifying the attributes, which must be less than 2^24.
+ *
+ * @return
+ *     The attributes identified by the given number.
+ */
+static guac_terminal_attributes numbered_attributes(int number) {
+
+    guac_terminal_attributes attributes = blank_char().attributes;
+    attributes.foreground.palette_index = -1;
+    attributes.foreground.red = number >> 16;
+    attributes.foreground.green = (number >> 8) & 0xFF;
+    attributes.foreground.blue = number & 0xFF;
+
+    return attributes;
+
+}
+
+/**
+ * Test which verifies that attributes no longer referenced by any compacted
+ * row are reused, such that rows continue to be compacted after far more
+ * than GUAC_TERMINAL_BUFFER_MAX_ATTRIBUTES distinct attributes have been
+ * seen, and that rows which remain compacted throughout are restored
+ * exactly.
+ */
+void test_buffer__compact_attribute_reuse() {
+
+    const int rows = 64;
+    const int rounds = 2500;
+
+    guac_terminal_char blank = blank_char();
+    guac_terminal_buffer* buffer = guac_terminal_buffer_alloc(rows, &blank);
+
+    /* The number of the first attributes written to each row */
+    int first[rows];
+    int next = 0;
+
+    int failures = 0;
+    int mismatched = 0;
+
+    for (int round = 0; round < rounds; round++) {
+
+        int row_index = round % rows;
+
+        /* Verify the previous contents of the row, if any */
+        guac_terminal_buffer_row* row = guac_terminal_buffer_get_row(buffer,
+                row_index, TEST_COLUMNS);
+
+        if (round >= rows) {
+            for (int column = 0; column < TEST_COLUMNS; column++) {
+                guac_terminal_char expected = blank;
+                expected.value = 'A' + column % 26;
+                expected.attributes =
+                    numbered_attributes(first[row_index] + column);
+                if (!chars_equal(&row->characters[column], &expected))
+                    mismatched++;
+            }
+        }
+
+        /* Rewrite the row such that every character has new attributes */
+        first[row_index] = next;
+        for (int column = 0; column < TEST_COLUMNS; column++) {
+            guac_terminal_char c = blank;
+            c.value = 'A' + column % 26;
+            c.attributes = numbered_attributes(next++);
+            guac_terminal_buffer_set_columns(buffer, row_index, column,
+                    column, &c);
+        }
+
+        guac_terminal_buffer_compact_rows(buffer, row_index, row_index);
+        if (buffer->rows[(buffer->top + row_index) % buffer->available]
+                .compact == NULL)
+            failures++;
+
+    }
+
+    CU_ASSERT(next > GUAC_TERMINAL_BUFFER_MAX_ATTRIBUTES * 2);
+    CU_ASSERT_EQUAL(failures, 0);
+    CU_ASSERT_EQUAL(mismatched, 0);
+
+    /* Only the attributes of rows which are still compacted are kept */
+    CU_ASSERT_EQUAL(buffer->compacted_rows, rows);
+    CU_ASSERT_EQUAL(buffer->attributes_length
+            - buffer->attributes_free_length, rows * TEST_COLUMNS);
+
+    /* Everything is discarded once no rows are compacted */
+    for (int row_index = 0; row_index < rows; row_index++)
+        guac_terminal_buffer_get_row(buffer, row_index, 0);
+
+    CU_ASSERT_EQUAL(buffer->compacted_rows, 0);
+    CU_ASSERT_EQUAL(buffer->attributes_length, 0);
+
+    guac_terminal_buffer_free(buffer);
+
+}
+
+/**
+ * Test which verifies that a row which cannot be compacted part way through
+ * is left expanded and untouched, without leaving behind references to the
+ * attributes interned before compaction was abandoned.
+ */
+void test_buffer__compact_abort() {
+
+    guac_terminal_char blank = blank_char();
+    guac_terminal_buffer* buffer = guac_terminal_buffer_alloc(4, &blank);
+
+    for (int column = 0; column < TEST_COLUMNS; column++) {
+        guac_terminal_char c = blank;
+        c.value = 'a' + column % 26;
+        c.attributes = numbered_attributes(column);
+        guac_terminal_buffer_set_columns(buffer, 0, column, column, &c);
+    }
+
+    /* A character whose width cannot be represented within a compacted row
+     * prevents the row from being compacted */
+    guac_terminal_buffer_row* row = guac_terminal_buffer_get_row(buffer, 0, 0);
+    row->characters[TEST_COLUMNS / 2].width = 200;
+
+    guac_terminal_char expected[TEST_COLUMNS];
+    memcpy(expected, row->characters, sizeof(expected));
+
+    guac_terminal_buffer_compact_rows(buffer, 0, 0);
+
+    CU_ASSERT_PTR_NULL(row->compact);
+    CU_ASSERT_PTR_NOT_NULL_FATAL(row->characters);
+    CU_ASSERT_EQUAL(buffer->compacted_rows, 0);
+    CU_ASSERT_EQUAL(buffer->attributes_length, 0);
+
+    for (int i = 0; i < TEST_COLUMNS; i++)
+        CU_ASSERT_TRUE(chars_equal(&row->characters[i], &expected[i]));
+
+    /* Rows compacted later are unaffected */
+    row->characters[TEST_COLUMNS / 2].width = 1;
+    expected[TEST_COLUMNS / 2].width = 1;
+    assert_round_trip(buffer, expected, TEST_COLUMNS);
+
+    guac_terminal_buffer_free(buffer);
+
+}
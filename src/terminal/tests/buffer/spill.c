@@ -0,0 +1,228 @@
+/*
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ * KIND, either express or implied.  See the License for the
+ * specific language governing permissions and limitations
+ * under the License.
+ */
+
+#include "terminal/buffer.h"
+#include "terminal/types.h"
+
+#include <CUnit/CUnit.h>
+#include <stdio.h>
+
+/**
+ * The total number of rows within the buffer tested below, including the
+ * rows of the terminal itself.
+ */
+#define TEST_BUFFER_ROWS 16
+
+/**
+ * The number of rows of the terminal whose buffer is tested below.
+ */
+#define TEST_TERMINAL_ROWS 4
+
+/**
+ * The number of rows of scrollback whose compact forms remain in memory.
+ */
+#define TEST_RESIDENT_ROWS 4
+
+/**
+ * The number of lines written to the terminal, which is enough for the ring
+ * of rows within the buffer to wrap around several times.
+ */
+#define TEST_LINES 50
+
+/**
+ * The number of columns of the terminal whose buffer is tested below.
+ */
+#define TEST_COLUMNS 80
+
+/**
+ * Returns the row within the ring of rows of the given buffer which is
+ * displayed at the given row of the terminal, without expanding that row.
+ *
+ * @param buffer
+ *     The buffer containing the row.
+ *
+ * @param row
+ *     The row to return, relative to the top of the terminal.
+ *
+ * @return
+ *     The requested row of the buffer.
+ */
+static guac_terminal_buffer_row* peek_row(guac_terminal_buffer* buffer,
+        int row) {
+
+    int index = (buffer->top + row) % buffer->available;
+    if (index < 0)
+        index += buffer->available;
+
+    return &buffer->rows[index];
+
+}
+
+/**
+ * Writes the given line of text to the bottom row of the terminal, followed
+ * by a wide character which depends on the line number, with attributes
+ * which also depend on the line number.
+ *
+ * @param buffer
+ *     The buffer of the terminal.
+ *
+ * @param line
+ *     The number of the line being written.
+ */
+static void write_line(guac_terminal_buffer* buffer, int line) {
+
+    guac_terminal_char c = buffer->default_character;
+    c.attributes.bold = line % 2;
+    c.attributes.foreground.red = line;
+
+    char text[32];
+    int length = snprintf(text, sizeof(text), "line %i", line);
+    guac_terminal_buffer_set_text(buffer, TEST_TERMINAL_ROWS - 1, 0, text,
+            length, &c.attributes);
+
+    c.value = 0x4E00 + line;
+    c.width = 2;
+    guac_terminal_buffer_set_columns(buffer, TEST_TERMINAL_ROWS - 1, 10, 11,
+            &c);
+
+}
+
+/**
+ * Verifies that the given row contains exactly what write_line() wrote for
+ * the given line.
+ *
+ * @param row
+ *     The expanded row to verify.
+ *
+ * @param line
+ *     The number of the line which the row should contain.
+ */
+static void assert_line(guac_terminal_buffer_row* row, int line) {
+
+    char text[32];
+    int length = snprintf(text, sizeof(text), "line %i", line);
+
+    CU_ASSERT_PTR_NOT_NULL_FATAL(row->characters);
+    CU_ASSERT_FATAL(row->length >= 12);
+
+    for (int i = 0; i < length; i++) {
+        CU_ASSERT_EQUAL(row->characters[i].value, text[i]);
+        CU_ASSERT_EQUAL(row->characters[i].attributes.bold, line % 2);
+        CU_ASSERT_EQUAL(row->characters[i].attributes.foreground.red, line);
+    }
+
+    CU_ASSERT_EQUAL(row->characters[10].value, 0x4E00 + line);
+    CU_ASSERT_EQUAL(row->characters[10].width, 2);
+    CU_ASSERT_EQUAL(row->characters[11].value, GUAC_CHAR_CONTINUATION);
+    CU_ASSERT_EQUAL(row->characters[11].attributes.foreground.red, line);
+
+}
+
+/**
+ * Scrolls the terminal up by one row, compacting the row which enters the
+ * scrollback and the row which leaves the resident portion of the
+ * scrollback, and clearing the newly-exposed bottom row, as the terminal
+ * does.
+ *
+ * @param buffer
+ *     The buffer of the terminal.
+ */
+static void scroll_up(guac_terminal_buffer* buffer) {
+
+    buffer->top = (buffer->top + 1) % buffer->available;
+    if (buffer->length < buffer->available)
+        buffer->length++;
+
+    guac_terminal_buffer_compact_rows(buffer, -1, -1);
+
+    int spilled = -TEST_RESIDENT_ROWS - 1;
+    if (spilled >= TEST_TERMINAL_ROWS - TEST_BUFFER_ROWS)
+        guac_terminal_buffer_compact_rows(buffer, spilled, spilled);
+
+    guac_terminal_buffer_set_columns(buffer, TEST_TERMINAL_ROWS - 1, 0,
+            TEST_COLUMNS - 1, &buffer->default_character);
+
+}
+
+/**
+ * Test which verifies that rows pushed beyond the resident portion of the
+ * scrollback are moved to the spill file, and are read back exactly after
+ * the ring of rows within the buffer has wrapped around several times.
+ */
+void test_buffer__spill_round_trip() {
+
+    guac_terminal_char blank = {
+        .value = ' ',
+        .attributes = {
+            .foreground = { .palette_index = 7, .red = 0xAA, .green = 0xAA, .blue = 0xAA },
+            .background = { .palette_index = 0 }
+        },
+        .width = 1
+    };
+
+    guac_terminal_buffer* buffer =
+        guac_terminal_buffer_alloc(TEST_BUFFER_ROWS, &blank);
+
+    CU_ASSERT_EQUAL_FATAL(guac_terminal_buffer_enable_spill(buffer,
+                TEST_RESIDENT_ROWS), 0);
+
+    for (int line = 0; line < TEST_LINES; line++) {
+        write_line(buffer, line);
+        scroll_up(buffer);
+    }
+
+    /* The most recent line now occupies the second-to-last row of the
+     * terminal, with older lines above it */
+    int newest_row = TEST_TERMINAL_ROWS - 2;
+    int oldest_row = TEST_TERMINAL_ROWS - TEST_BUFFER_ROWS;
+
+    /* Rows beyond the resident scrollback must have been moved to the
+     * spill file, while the resident scrollback remains in memory */
+    for (int row = oldest_row; row < 0; row++) {
+
+        guac_terminal_buffer_row* buffer_row = peek_row(buffer, row);
+        CU_ASSERT_PTR_NOT_NULL(buffer_row->compact);
+        CU_ASSERT_PTR_NULL(buffer_row->characters);
+
+        if (row < -TEST_RESIDENT_ROWS) {
+            CU_ASSERT_NOT_EQUAL(buffer_row->spill_segment, -1);
+        }
+        else {
+            CU_ASSERT_EQUAL(buffer_row->spill_segment, -1);
+        }
+
+    }
+
+    /* Space freed by rows recycled as the ring wraps must be reused, with
+     * these small rows never requiring more than one segment */
+    CU_ASSERT_EQUAL(buffer->spill_segments_length, 1);
+
+    /* Every row must read back exactly as written */
+    for (int row = oldest_row; row <= newest_row; row++)
+        assert_line(guac_terminal_buffer_get_row(buffer, row, 0),
+                TEST_LINES - 1 - (newest_row - row));
+
+    /* No space within the spill file remains allocated once all rows have
+     * been read back */
+    CU_ASSERT_EQUAL(buffer->spill_segments[0].live, 0);
+
+    guac_terminal_buffer_free(buffer);
+
+}
+
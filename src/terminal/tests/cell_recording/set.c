@@ -0,0 +1,304 @@
+/*
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ * KIND, either express or implied.  See the License for the
+ * specific language governing permissions and limitations
+ * under the License.
+ */
+
+#include "terminal/cell-recording.h"
+#include "terminal/palette.h"
+
+#include <CUnit/CUnit.h>
+#include <guacamole/mem.h>
+#include <guacamole/parser.h>
+#include <guacamole/socket.h>
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+/**
+ * The maximum number of instructions read back by read_instructions().
+ */
+#define MAX_INSTRUCTIONS 16
+
+/**
+ * The maximum length of each instruction read back by read_instructions(),
+ * including NULL terminator.
+ */
+#define MAX_INSTRUCTION_LENGTH 2048
+
+/**
+ * The foreground color used within the tests below (0x112233).
+ */
+static const guac_terminal_color foreground = { -1, 0x11, 0x22, 0x33 };
+
+/**
+ * The background color used within the tests below (0x445566).
+ */
+static const guac_terminal_color background = { -1, 0x44, 0x55, 0x66 };
+
+/**
+ * An alternative foreground color used within the tests below (0xFF0000).
+ */
+static const guac_terminal_color red = { -1, 0xFF, 0x00, 0x00 };
+
+/**
+ * The instructions written by a cell recording, as read back by
+ * read_instructions(). Each instruction is represented by its opcode and
+ * arguments separated by commas, without length prefixes.
+ */
+typedef struct recorded_instructions {
+
+    /**
+     * The number of instructions read.
+     */
+    int count;
+
+    /**
+     * Each instruction read, in order.
+     */
+    char instructions[MAX_INSTRUCTIONS][MAX_INSTRUCTION_LENGTH];
+
+} recorded_instructions;
+
+/**
+ * Allocates a new cell recording which writes to a new temporary file.
+ *
+ * @param socket
+ *     Storage for the socket written by the cell recording, which must be
+ *     freed with guac_socket_free() once the recording is freed.
+ *
+ * @param read_fd
+ *     Storage for a file descriptor from which everything written to the
+ *     socket can be read back.
+ *
+ * @return
+ *     A newly-allocated cell recording.
+ */
+static guac_terminal_cell_recording* open_recording(guac_socket** socket,
+        int* read_fd) {
+
+    char path[] = "/tmp/guac-cell-recording-test-XXXXXX";
+    int fd = mkstemp(path);
+    CU_ASSERT_NOT_EQUAL_FATAL(fd, -1);
+    unlink(path);
+
+    *read_fd = dup(fd);
+    CU_ASSERT_NOT_EQUAL_FATAL(*read_fd, -1);
+
+    *socket = guac_socket_open(fd);
+    return guac_terminal_cell_recording_alloc(*socket);
+
+}
+
+/**
+ * Frees the given cell recording and its socket, and reads back all
+ * instructions written.
+ *
+ * @param recording
+ *     The cell recording to free.
+ *
+ * @param socket
+ *     The socket written by the cell recording.
+ *
+ * @param read_fd
+ *     The file descriptor from which everything written to the socket can be
+ *     read back. This file descriptor is closed by this function.
+ *
+ * @param result
+ *     Storage for the instructions read back.
+ */
+static void close_recording(guac_terminal_cell_recording* recording,
+        guac_socket* socket, int read_fd, recorded_instructions* result) {
+
+    guac_terminal_cell_recording_free(recording);
+    guac_socket_free(socket);
+
+    result->count = 0;
+
+    CU_ASSERT_EQUAL_FATAL(lseek(read_fd, 0, SEEK_SET), 0);
+    socket = guac_socket_open(read_fd);
+    guac_parser* parser = guac_parser_alloc();
+
+    while (guac_parser_read(parser, socket, 1000000) == 0) {
+
+        CU_ASSERT_FATAL(result->count < MAX_INSTRUCTIONS);
+
+        char* instruction = result->instructions[result->count++];
+        int length = snprintf(instruction, MAX_INSTRUCTION_LENGTH, "%s",
+                parser->opcode);
+
+        for (int i = 0; i < parser->argc; i++)
+            length += snprintf(instruction + length,
+                    MAX_INSTRUCTION_LENGTH - length, ",%s", parser->argv[i]);
+
+    }
+
+    guac_parser_free(parser);
+    guac_socket_free(socket);
+
+}
+
+/**
+ * Test which verifies that consecutive characters written to the same row
+ * with identical attributes are coalesced into a single "term-text"
+ * instruction, including wide and multibyte characters, and that any change
+ * in row, position, width or attributes begins a new run.
+ */
+void test_cell_recording__set_runs() {
+
+    guac_socket* socket;
+    int read_fd;
+    guac_terminal_cell_recording* recording = open_recording(&socket,
+            &read_fd);
+
+    /* Single run spanning a multibyte character */
+    guac_terminal_cell_recording_set(recording, 0, 0, 0, 'a', 1,
+            &foreground, &background, 0);
+    guac_terminal_cell_recording_set(recording, 0, 1, 1, 0xE9, 1,
+            &foreground, &background, 0);
+    guac_terminal_cell_recording_set(recording, 0, 2, 2, 'c', 1,
+            &foreground, &background, 0);
+
+    /* Gap within the row */
+    guac_terminal_cell_recording_set(recording, 0, 4, 4, 'd', 1,
+            &foreground, &background, 0);
+
+    /* Different foreground */
+    guac_terminal_cell_recording_set(recording, 0, 5, 5, 'e', 1,
+            &red, &background, 0);
+
+    /* Different flags */
+    guac_terminal_cell_recording_set(recording, 0, 6, 6, 'f', 1,
+            &red, &background, GUAC_TERMINAL_CELL_RECORDING_BOLD);
+
+    /* Different row, continuing as wide characters, with blank cells
+     * recorded as spaces */
+    guac_terminal_cell_recording_set(recording, 1, 7, 7, 'g', 1,
+            &red, &background, GUAC_TERMINAL_CELL_RECORDING_BOLD);
+    guac_terminal_cell_recording_set(recording, 1, 8, 9, 0x4E2D, 2,
+            &red, &background, GUAC_TERMINAL_CELL_RECORDING_BOLD);
+    guac_terminal_cell_recording_set(recording, 1, 10, 11, 0, 2,
+            &red, &background, GUAC_TERMINAL_CELL_RECORDING_BOLD);
+
+    guac_terminal_cell_recording_sync(recording, 1234);
+
+    recorded_instructions result;
+    close_recording(recording, socket, read_fd, &result);
+
+    CU_ASSERT_EQUAL_FATAL(result.count, 7);
+    CU_ASSERT_STRING_EQUAL(result.instructions[0],
+            "term-text,0,0,1,1122867,4478310,0,a\xC3\xA9" "c");
+    CU_ASSERT_STRING_EQUAL(result.instructions[1],
+            "term-text,0,4,1,1122867,4478310,0,d");
+    CU_ASSERT_STRING_EQUAL(result.instructions[2],
+            "term-text,0,5,1,16711680,4478310,0,e");
+    CU_ASSERT_STRING_EQUAL(result.instructions[3],
+            "term-text,0,6,1,16711680,4478310,1,f");
+    CU_ASSERT_STRING_EQUAL(result.instructions[4],
+            "term-text,1,7,1,16711680,4478310,1,g");
+    CU_ASSERT_STRING_EQUAL(result.instructions[5],
+            "term-text,1,8,2,16711680,4478310,1,\xE4\xB8\xAD ");
+    CU_ASSERT_STRING_EQUAL(result.instructions[6], "sync,1234,1");
+
+}
+
+/**
+ * Test which verifies that runs are split once they reach
+ * GUAC_TERMINAL_CELL_RECORDING_MAX_RUN characters, and that any pending run
+ * is written when the recording is freed.
+ */
+void test_cell_recording__set_max_run() {
+
+    guac_socket* socket;
+    int read_fd;
+    guac_terminal_cell_recording* recording = open_recording(&socket,
+            &read_fd);
+
+    int length = GUAC_TERMINAL_CELL_RECORDING_MAX_RUN + 10;
+    for (int column = 0; column < length; column++)
+        guac_terminal_cell_recording_set(recording, 3, column, column, 'x', 1,
+                &foreground, &background, 0);
+
+    recorded_instructions result;
+    close_recording(recording, socket, read_fd, &result);
+
+    char expected[MAX_INSTRUCTION_LENGTH];
+    int offset = snprintf(expected, sizeof(expected),
+            "term-text,3,0,1,1122867,4478310,0,");
+    memset(expected + offset, 'x', GUAC_TERMINAL_CELL_RECORDING_MAX_RUN);
+    expected[offset + GUAC_TERMINAL_CELL_RECORDING_MAX_RUN] = '\0';
+
+    CU_ASSERT_EQUAL_FATAL(result.count, 2);
+    CU_ASSERT_STRING_EQUAL(result.instructions[0], expected);
+
+    snprintf(expected, sizeof(expected),
+            "term-text,3,%i,1,1122867,4478310,0,xxxxxxxxxx",
+            GUAC_TERMINAL_CELL_RECORDING_MAX_RUN);
+    CU_ASSERT_STRING_EQUAL(result.instructions[1], expected);
+
+}
+
+/**
+ * Test which verifies that ranges spanning more than one character are
+ * written as a single "term-fill" instruction, after any pending run, and
+ * that a range covering exactly one wide character is coalesced as text.
+ */
+void test_cell_recording__set_fill() {
+
+    guac_socket* socket;
+    int read_fd;
+    guac_terminal_cell_recording* recording = open_recording(&socket,
+            &read_fd);
+
+    guac_terminal_cell_recording_set(recording, 2, 0, 0, 'a', 1,
+            &foreground, &background, 0);
+
+    /* Blank fill */
+    guac_terminal_cell_recording_set(recording, 2, 1, 79, 0, 1,
+            &foreground, &background, GUAC_TERMINAL_CELL_RECORDING_UNDERSCORE);
+
+    /* Fill of wide characters */
+    guac_terminal_cell_recording_set(recording, 4, 10, 15, 0x4E2D, 2,
+            &red, &background, 0);
+
+    /* Exactly one wide character */
+    guac_terminal_cell_recording_set(recording, 5, 0, 1, 0x4E2D, 2,
+            &red, &background, 0);
+    guac_terminal_cell_recording_set(recording, 5, 2, 3, 0x4E2D, 2,
+            &red, &background, 0);
+
+    guac_terminal_cell_recording_sync(recording, 10);
+
+    /* Nothing further is written for frames without changes */
+    guac_terminal_cell_recording_sync(recording, 20);
+
+    recorded_instructions result;
+    close_recording(recording, socket, read_fd, &result);
+
+    CU_ASSERT_EQUAL_FATAL(result.count, 5);
+    CU_ASSERT_STRING_EQUAL(result.instructions[0],
+            "term-text,2,0,1,1122867,4478310,0,a");
+    CU_ASSERT_STRING_EQUAL(result.instructions[1],
+            "term-fill,2,1,79,1,1122867,4478310,2, ");
+    CU_ASSERT_STRING_EQUAL(result.instructions[2],
+            "term-fill,4,10,15,2,16711680,4478310,0,\xE4\xB8\xAD");
+    CU_ASSERT_STRING_EQUAL(result.instructions[3],
+            "term-text,5,0,2,16711680,4478310,0,\xE4\xB8\xAD\xE4\xB8\xAD");
+    CU_ASSERT_STRING_EQUAL(result.instructions[4], "sync,10,1");
+
+}
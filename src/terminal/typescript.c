@@ -17,15 +17,16 @@
  * under the License.
  */
 
-#include "common/io.h"
 #include "terminal/typescript.h"
 
 #include <guacamole/mem.h>
 #include <guacamole/timestamp.h>
+#include <guacamole/writer.h>
 
 #include <errno.h>
 #include <stdlib.h>
 #include <stdio.h>
+#include <string.h>
 #include <unistd.h>
 
 #include <sys/types.h>
@@ -156,12 +157,28 @@ guac_terminal_typescript* guac_terminal_typescript_alloc(const char* path,
         return NULL;
     }
 
+    /* Queue writes to both files such that slow storage does not block
+     * terminal output */
+    typescript->data_writer = guac_writer_alloc(typescript->data_fd,
+            GUAC_WRITER_DEFAULT_QUEUE_SIZE, GUAC_WRITER_SYNC_NEVER);
+    typescript->timing_writer = guac_writer_alloc(typescript->timing_fd,
+            GUAC_WRITER_DEFAULT_QUEUE_SIZE, GUAC_WRITER_SYNC_NEVER);
+    if (typescript->data_writer == NULL || typescript->timing_writer == NULL) {
+        guac_writer_free(typescript->data_writer);
+        guac_writer_free(typescript->timing_writer);
+        close(typescript->data_fd);
+        close(typescript->timing_fd);
+        guac_mem_free(typescript);
+        return NULL;
+    }
+
     /* Typescript starts out flushed */
     typescript->length = 0;
     typescript->last_flush = guac_timestamp_current();
+    typescript->bytes_dropped = 0;
 
     /* Write header */
-    guac_common_write(typescript->data_fd, GUAC_TERMINAL_TYPESCRIPT_HEADER,
+    guac_writer_write(typescript->data_writer, GUAC_TERMINAL_TYPESCRIPT_HEADER,
             sizeof(GUAC_TERMINAL_TYPESCRIPT_HEADER) - 1);
 
     return typescript;
@@ -180,6 +197,30 @@ void guac_terminal_typescript_write(guac_terminal_typescript* typescript,
 
 }
 
+void guac_terminal_typescript_write_buffer(
+        guac_terminal_typescript* typescript, const char* buffer, int length) {
+
+    while (length > 0) {
+
+        /* Flush buffer if no space is available */
+        if (typescript->length == sizeof(typescript->buffer))
+            guac_terminal_typescript_flush(typescript);
+
+        /* Copy as much as fits within the remaining space */
+        int remaining = sizeof(typescript->buffer) - typescript->length;
+        if (remaining > length)
+            remaining = length;
+
+        memcpy(typescript->buffer + typescript->length, buffer, remaining);
+        typescript->length += remaining;
+
+        buffer += remaining;
+        length -= remaining;
+
+    }
+
+}
+
 void guac_terminal_typescript_flush(guac_terminal_typescript* typescript) {
 
     /* Do nothing if nothing to flush */
@@ -204,12 +245,23 @@ void guac_terminal_typescript_flush(guac_terminal_typescript* typescript) {
     if (timestamp_length > sizeof(timestamp_buffer))
         timestamp_length = sizeof(timestamp_buffer);
 
+    /* Drop both the data and its timestamp if either cannot be queued. The
+     * time elapsed is then folded into the next timestamp written, keeping
+     * the overall duration of the typescript accurate. */
+    if (guac_writer_available(typescript->timing_writer) < timestamp_length
+            || guac_writer_available(typescript->data_writer)
+                < typescript->length) {
+        typescript->bytes_dropped += typescript->length;
+        typescript->length = 0;
+        return;
+    }
+
     /* Write timestamp to timing file */
-    guac_common_write(typescript->timing_fd,
+    guac_writer_write(typescript->timing_writer,
             timestamp_buffer, timestamp_length);
 
     /* Empty buffer into data file */
-    guac_common_write(typescript->data_fd,
+    guac_writer_write(typescript->data_writer,
             typescript->buffer, typescript->length);
 
     /* Buffer is now flushed */
@@ -218,19 +270,30 @@ void guac_terminal_typescript_flush(guac_terminal_typescript* typescript) {
 
 }
 
-void guac_terminal_typescript_free(guac_terminal_typescript* typescript) {
+uint64_t guac_terminal_typescript_free(guac_terminal_typescript* typescript) {
 
     /* Do nothing if no typescript provided */
     if (typescript == NULL)
-        return;
+        return 0;
 
     /* Flush any pending data */
     guac_terminal_typescript_flush(typescript);
 
     /* Write footer */
-    guac_common_write(typescript->data_fd, GUAC_TERMINAL_TYPESCRIPT_FOOTER,
+    guac_writer_write(typescript->data_writer, GUAC_TERMINAL_TYPESCRIPT_FOOTER,
             sizeof(GUAC_TERMINAL_TYPESCRIPT_FOOTER) - 1);
 
+    /* Write all remaining queued data */
+    guac_writer_stop(typescript->data_writer);
+    guac_writer_stop(typescript->timing_writer);
+
+    /* Only now is it known whether everything queued was written */
+    uint64_t dropped = typescript->bytes_dropped
+        + guac_writer_get_dropped(typescript->data_writer);
+
+    guac_writer_free(typescript->data_writer);
+    guac_writer_free(typescript->timing_writer);
+
     /* Close file descriptors */
     close(typescript->data_fd);
     close(typescript->timing_fd);
@@ -238,5 +301,7 @@ void guac_terminal_typescript_free(guac_terminal_typescript* typescript) {
     /* Free allocated typescript data */
     guac_mem_free(typescript);
 
+    return dropped;
+
 }
 
@@ -0,0 +1,59 @@
+/*
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ * KIND, either express or implied.  See the License for the
+ * specific language governing permissions and limitations
+ * under the License.
+ */
+
+#include "config.h"
+#include "terminal/unicode.h"
+
+int guac_terminal_unicode_class(int codepoint) {
+
+    /* Treat anything which is not a valid codepoint as narrow */
+    if (codepoint < 0 || codepoint > 0x10FFFF)
+        return GUAC_TERMINAL_UNICODE_NARROW;
+
+    /* Locate block containing codepoint */
+    const unsigned char* block = guac_terminal_unicode_blocks[
+        guac_terminal_unicode_index[codepoint / GUAC_TERMINAL_UNICODE_BLOCK_SIZE]];
+
+    /* Extract class from the two bits corresponding to the codepoint */
+    int offset = codepoint % GUAC_TERMINAL_UNICODE_BLOCK_SIZE;
+    return (block[offset / 4] >> ((offset % 4) * 2)) & 0x3;
+
+}
+
+int guac_terminal_unicode_width(int codepoint) {
+
+    /* NULL is never drawn, and thus occupies no columns (as with wcwidth()) */
+    if (codepoint == 0)
+        return 0;
+
+    switch (guac_terminal_unicode_class(codepoint)) {
+
+        case GUAC_TERMINAL_UNICODE_ZERO:
+            return 0;
+
+        case GUAC_TERMINAL_UNICODE_WIDE:
+            return 2;
+
+        default:
+            return 1;
+
+    }
+
+}
+
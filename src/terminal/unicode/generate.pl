@@ -0,0 +1,187 @@
+#!/usr/bin/env perl
+#
+# Licensed to the Apache Software Foundation (ASF) under one
+# or more contributor license agreements.  See the NOTICE file
+# distributed with this work for additional information
+# regarding copyright ownership.  The ASF licenses this file
+# to you under the Apache License, Version 2.0 (the
+# "License"); you may not use this file except in compliance
+# with the License.  You may obtain a copy of the License at
+#
+#   http://www.apache.org/licenses/LICENSE-2.0
+#
+# Unless required by applicable law or agreed to in writing,
+# software distributed under the License is distributed on an
+# "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+# KIND, either express or implied.  See the License for the
+# specific language governing permissions and limitations
+# under the License.
+#
+
+#
+# generate.pl
+#
+# Parse EastAsianWidth.txt and DerivedGeneralCategory.txt from the Unicode
+# Character Database, producing _generated_unicode_tables.c, a two-level
+# lookup table mapping each codepoint to its terminal character class (see
+# terminal/unicode.h).
+#
+
+use strict;
+use warnings;
+
+# Character classes (must match terminal/unicode.h)
+my $NARROW = 0;
+my $ZERO   = 1;
+my $WIDE   = 2;
+my $BLANK  = 3;
+
+# Codepoints per second-level block, and classes per byte
+my $BLOCK_SIZE      = 256;
+my $CLASSES_PER_BYTE = 4;
+
+my $MAX_CODEPOINT = 0x10FFFF;
+
+my ($eaw_filename, $gc_filename) = @ARGV;
+die "Usage: $0 EastAsianWidth.txt DerivedGeneralCategory.txt\n"
+    unless defined $gc_filename;
+
+#
+# Reads the given UCD file, invoking the given callback for each range of
+# codepoints and the property value assigned to that range.
+#
+sub read_ucd {
+
+    my ($filename, $callback) = @_;
+
+    open my $input, '<', $filename
+        or die "$filename: ERROR: $!\n";
+
+    while (<$input>) {
+
+        chomp;
+
+        # Strip comments and skip blank lines
+        s/#.*$//;
+        next if m/^\s*$/;
+
+        my ($first, $last, $value) =
+            m/^\s*([0-9A-Fa-f]+)(?:\.\.([0-9A-Fa-f]+))?\s*;\s*(\S+)\s*$/
+            or die "$filename: $.: ERROR: Invalid entry\n";
+
+        $last = $first unless defined $last;
+        $callback->(hex($first), hex($last), $value);
+
+    }
+
+    close $input;
+
+}
+
+# All codepoints are narrow unless stated otherwise
+my @classes = ($NARROW) x ($MAX_CODEPOINT + 1);
+
+# Fullwidth and wide characters (including emoji with default emoji
+# presentation, which are all "W" as of Unicode 9.0) occupy two columns
+read_ucd($eaw_filename, sub {
+    my ($first, $last, $value) = @_;
+    if ($value eq 'W' || $value eq 'F') {
+        @classes[$first..$last] = ($WIDE) x ($last - $first + 1);
+    }
+});
+
+# Nonspacing and enclosing marks and format characters occupy no columns,
+# while (non-wide) space separators occupy one column but have no glyph
+read_ucd($gc_filename, sub {
+    my ($first, $last, $value) = @_;
+    for my $codepoint ($first..$last) {
+        if ($value eq 'Mn' || $value eq 'Me' || $value eq 'Cf') {
+            $classes[$codepoint] = $ZERO;
+        }
+        elsif ($value eq 'Zs' && $classes[$codepoint] == $NARROW) {
+            $classes[$codepoint] = $BLANK;
+        }
+    }
+});
+
+# Hangul Jamo medial vowels and final consonants combine with the preceding
+# initial consonant and occupy no columns of their own
+@classes[0x1160..0x11FF] = ($ZERO) x (0x11FF - 0x1160 + 1);
+@classes[0xD7B0..0xD7FF] = ($ZERO) x (0xD7FF - 0xD7B0 + 1);
+
+# SOFT HYPHEN is a format character, but is conventionally displayed
+$classes[0x00AD] = $NARROW;
+
+# OGHAM SPACE MARK is a space separator, but has a visible glyph
+$classes[0x1680] = $NARROW;
+
+# NULL is used to represent empty cells, which have no glyph
+$classes[0x0000] = $BLANK;
+
+#
+# Pack classes into blocks, storing each distinct block only once
+#
+
+my @blocks = ();
+my %block_ids = ();
+my @index = ();
+
+for (my $start = 0; $start <= $MAX_CODEPOINT; $start += $BLOCK_SIZE) {
+
+    my @bytes = ();
+    for (my $i = 0; $i < $BLOCK_SIZE; $i += $CLASSES_PER_BYTE) {
+        my $byte = 0;
+        for (my $j = 0; $j < $CLASSES_PER_BYTE; $j++) {
+            $byte |= $classes[$start + $i + $j] << ($j * 2);
+        }
+        push @bytes, $byte;
+    }
+
+    my $key = join(',', @bytes);
+    if (!exists $block_ids{$key}) {
+        $block_ids{$key} = scalar @blocks;
+        push @blocks, \@bytes;
+    }
+
+    push @index, $block_ids{$key};
+
+}
+
+#
+# _generated_unicode_tables.c
+#
+
+open OUTPUT, ">", "_generated_unicode_tables.c"
+    or die "_generated_unicode_tables.c: ERROR: $!\n";
+
+print OUTPUT
+       '#include "config.h"'                                . "\n"
+     . '#include "terminal/unicode.h"'                      . "\n"
+     .                                                        "\n";
+
+printf OUTPUT "const unsigned short "
+     . "guac_terminal_unicode_index[GUAC_TERMINAL_UNICODE_INDEX_SIZE] = {\n";
+
+for (my $i = 0; $i < scalar @index; $i += 12) {
+    my $last = $i + 11 < $#index ? $i + 11 : $#index;
+    print OUTPUT "    " . join(', ', @index[$i..$last]) . ",\n";
+}
+
+print OUTPUT "};\n\n";
+
+print OUTPUT "const unsigned char "
+     . "guac_terminal_unicode_blocks[][GUAC_TERMINAL_UNICODE_BLOCK_BYTES] = {\n";
+
+for my $block (@blocks) {
+    print OUTPUT "    {\n";
+    for (my $i = 0; $i < scalar @$block; $i += 8) {
+        print OUTPUT "        "
+            . join(', ', map { sprintf('0x%02x', $_) } @$block[$i..$i+7])
+            . ",\n";
+    }
+    print OUTPUT "    },\n";
+}
+
+print OUTPUT "};\n";
+
+close OUTPUT;